@@ -19,10 +19,12 @@
 #include "drm_dumb_buffer.h"
 #include "drm_egl_backend.h"
 #include "drm_gpu.h"
+#include "drm_layer.h"
 #include "drm_output.h"
 #include "drm_pipeline.h"
 #include "drm_plane.h"
 #include "drm_pointer.h"
+#include "drm_render_backend.h"
 #include "platformsupport/scenes/qpainter/qpainterbackend.h"
 
 #include <drm_fourcc.h>
@@ -39,6 +41,43 @@ private Q_SLOTS:
     void testModeGeneration_data();
     void testModeGeneration();
     void testConnectorLifetime();
+    void testOverlayPlaneAssignment();
+    void testOverlayPlaneFallback();
+};
+
+class TestOverlayLayer : public DrmOverlayPlaneLayer
+{
+public:
+    TestOverlayLayer(DrmPipeline *pipeline, int planeIndex, const std::shared_ptr<DrmFramebuffer> &buffer, const QRect &targetRect)
+        : DrmOverlayPlaneLayer(pipeline, planeIndex)
+        , m_buffer(buffer)
+    {
+        m_sourceRect = QRect(QPoint(), buffer->buffer()->size());
+        m_targetRect = targetRect;
+    }
+
+    std::optional<OutputLayerBeginFrameInfo> beginFrame() override
+    {
+        return std::nullopt;
+    }
+    bool endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion) override
+    {
+        return false;
+    }
+    bool checkTestBuffer() override
+    {
+        return true;
+    }
+    std::shared_ptr<DrmFramebuffer> currentBuffer() const override
+    {
+        return m_buffer;
+    }
+    void releaseBuffers() override
+    {
+    }
+
+private:
+    const std::shared_ptr<DrmFramebuffer> m_buffer;
 };
 
 static void verifyCleanup(MockGpu *mockGpu)
@@ -316,5 +355,113 @@ void DrmTest::testConnectorLifetime()
     verifyCleanup(mockGpu.get());
 }
 
+void DrmTest::testOverlayPlaneAssignment()
+{
+    const auto mockGpu = std::make_unique<MockGpu>(1, 2);
+    for (int i = 0; i < 3; i++) {
+        const auto plane = std::make_shared<MockPlane>(mockGpu.get(), PlaneType::Overlay, 0);
+        plane->possibleCrtcs = 0b11;
+        mockGpu->planes << plane;
+    }
+    // a plane that only works with the second crtc
+    mockGpu->planes << std::make_shared<MockPlane>(mockGpu.get(), PlaneType::Overlay, 1);
+
+    const auto one = std::make_shared<MockConnector>(mockGpu.get());
+    const auto two = std::make_shared<MockConnector>(mockGpu.get());
+    mockGpu->connectors.push_back(one);
+    mockGpu->connectors.push_back(two);
+
+    const auto session = Session::create(Session::Type::Noop);
+    const auto backend = std::make_unique<DrmBackend>(session.get());
+    const auto renderBackend = backend->createQPainterBackend();
+    auto gpu = std::make_unique<DrmGpu>(backend.get(), "test", 1, 0);
+    QVERIFY(gpu->atomicModeSetting());
+    QVERIFY(gpu->updateOutputs());
+    QCOMPARE(gpu->drmOutputs().size(), 2);
+
+    // the overlay planes should be distributed evenly, and never be shared
+    QCOMPARE(gpu->maxOverlayPlaneCount(), 2);
+    QVector<DrmPlane *> assigned;
+    for (DrmOutput *output : gpu->drmOutputs()) {
+        QVERIFY(output->pipeline()->crtc());
+        const auto overlayPlanes = output->pipeline()->crtc()->overlayPlanes();
+        QCOMPARE(overlayPlanes.size(), 2);
+        for (DrmPlane *plane : overlayPlanes) {
+            QCOMPARE(plane->type(), DrmPlane::TypeIndex::Overlay);
+            QVERIFY(!assigned.contains(plane));
+            assigned << plane;
+        }
+        // the QPainter backend doesn't use overlay planes
+        QVERIFY(output->pipeline()->overlayLayers().isEmpty());
+    }
+
+    gpu.reset();
+    verifyCleanup(mockGpu.get());
+}
+
+void DrmTest::testOverlayPlaneFallback()
+{
+    const auto mockGpu = std::make_unique<MockGpu>(1, 1);
+    const auto overlayPlane = std::make_shared<MockPlane>(mockGpu.get(), PlaneType::Overlay, 0);
+    mockGpu->planes << overlayPlane;
+    const auto primaryPlane = mockGpu->crtcs.front()->legacyPlane;
+    mockGpu->connectors.push_back(std::make_shared<MockConnector>(mockGpu.get()));
+
+    const auto session = Session::create(Session::Type::Noop);
+    const auto backend = std::make_unique<DrmBackend>(session.get());
+    const auto renderBackend = backend->createQPainterBackend();
+    auto gpu = std::make_unique<DrmGpu>(backend.get(), "test", 1, 0);
+    QVERIFY(gpu->updateOutputs());
+    QCOMPARE(gpu->drmOutputs().size(), 1);
+    DrmOutput *output = gpu->drmOutputs().front();
+    DrmPipeline *pipeline = output->pipeline();
+    QCOMPARE(pipeline->crtc()->overlayPlanes().size(), 1);
+
+    // put a buffer on the overlay plane, the way the EGL backend does for client buffers
+    const auto drmRenderBackend = dynamic_cast<DrmRenderBackend *>(renderBackend.get());
+    QVERIFY(drmRenderBackend);
+    auto primaryLayer = drmRenderBackend->createPrimaryLayer(pipeline);
+    auto overlayBuffer = DrmFramebuffer::createFramebuffer(DrmDumbBuffer::createDumbBuffer(gpu.get(), QSize(64, 64), DRM_FORMAT_XRGB8888));
+    QVERIFY(overlayBuffer);
+    auto overlayLayer = std::make_shared<TestOverlayLayer>(pipeline, 0, overlayBuffer, QRect(10, 10, 64, 64));
+    pipeline->setLayers(primaryLayer, drmRenderBackend->createCursorLayer(pipeline), {overlayLayer});
+    pipeline->applyPendingChanges();
+    QCOMPARE(output->overlayLayers().size(), 1);
+
+    // a disabled overlay layer doesn't need to be tested
+    QVERIFY(output->testOverlayLayers());
+
+    // the overlay plane is tested together with the primary buffer that was just rendered
+    overlayLayer->setEnabled(true);
+    QVERIFY(primaryLayer->beginFrame());
+    QVERIFY(primaryLayer->endFrame(QRegion(), QRegion()));
+    QVERIFY(output->testOverlayLayers());
+    QVERIFY(primaryPlane->testedFb);
+    QCOMPARE(primaryPlane->testedFb->id, primaryLayer->currentBuffer()->framebufferId());
+    QVERIFY(overlayPlane->testedFb);
+    QCOMPARE(overlayPlane->testedFb->id, overlayBuffer->framebufferId());
+
+    QVERIFY(primaryLayer->beginFrame());
+    QVERIFY(primaryLayer->endFrame(QRegion(), QRegion()));
+    QVERIFY(output->testOverlayLayers());
+    QCOMPARE(primaryPlane->testedFb->id, primaryLayer->currentBuffer()->framebufferId());
+
+    // if the hardware rejects the overlay plane, the test fails and the
+    // compositor falls back to painting the surface into the primary buffer
+    overlayPlane->rejectActive = true;
+    QVERIFY(!output->testOverlayLayers());
+    overlayLayer->setEnabled(false);
+    QVERIFY(output->testOverlayLayers());
+    QVERIFY(!overlayPlane->testedFb);
+    QCOMPARE(primaryPlane->testedFb->id, primaryLayer->currentBuffer()->framebufferId());
+
+    // the pipeline owns the layers from here on
+    primaryLayer.reset();
+    overlayLayer.reset();
+    overlayBuffer.reset();
+    gpu.reset();
+    verifyCleanup(mockGpu.get());
+}
+
 QTEST_GUILESS_MAIN(DrmTest)
 #include "drmTest.moc"
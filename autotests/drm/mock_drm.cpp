@@ -1076,9 +1076,20 @@ int drmModeAtomicCommit(int fd, drmModeAtomicReqPtr req, uint32_t flags, void *u
     }
     for (int i = 0; i < planeCopies.count(); i++) {
         if (auto crtc = planeCopies[i].getProp(QStringLiteral("CRTC_ID"))) {
+            if (planeCopies[i].rejectActive) {
+                qWarning("plane %u can't be enabled", planeCopies[i].id);
+                return -(errno = EINVAL);
+            }
             bool found = false;
             for (int p = 0; p < pipelines.count(); p++) {
-                if (pipelines[p].crtc->id == crtc) {
+                if (pipelines[p].crtc->id == crtc && planeCopies[i].type != PlaneType::Primary) {
+                    if (!(planeCopies[i].possibleCrtcs & (1 << pipelines[p].crtc->pipeIndex))) {
+                        qWarning("crtc %u is not suitable for plane %u", pipelines[p].crtc->id, planeCopies[i].id);
+                        return -(errno = EINVAL);
+                    }
+                    found = true;
+                    break;
+                } else if (pipelines[p].crtc->id == crtc) {
                     if (pipelines[p].primaryPlane) {
                         qWarning("crtc %u has more than one primary planes assigned: %u and %u", pipelines[p].crtc->id, pipelines[p].primaryPlane->id, planeCopies[i].id);
                         return -(errno = EINVAL);
@@ -1134,7 +1145,11 @@ int drmModeAtomicCommit(int fd, drmModeAtomicReqPtr req, uint32_t flags, void *u
 
     // if wanted, apply them
 
-    if (!(flags & DRM_MODE_ATOMIC_TEST_ONLY)) {
+    if (flags & DRM_MODE_ATOMIC_TEST_ONLY) {
+        for (const auto &plane : std::as_const(planeCopies)) {
+            gpu->findPlane(plane.id)->testedFb = plane.nextFb;
+        }
+    } else {
         for (auto &conn : std::as_const(gpu->connectors)) {
             auto it = std::find_if(connCopies.constBegin(), connCopies.constEnd(), [conn](auto c){return c.id == conn->id;});
             if (it == connCopies.constEnd()) {
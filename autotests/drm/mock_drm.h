@@ -120,8 +120,12 @@ public:
 
     MockFb *currentFb = nullptr;
     MockFb *nextFb = nullptr;
+    // the buffer this plane would have shown with the last TEST_ONLY commit
+    MockFb *testedFb = nullptr;
     int possibleCrtcs;
     PlaneType type;
+    // emulates hardware restrictions: all commits that enable this plane fail
+    bool rejectActive = false;
 };
 
 class MockFb {
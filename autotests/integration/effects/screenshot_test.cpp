@@ -0,0 +1,167 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "kwin_wayland_test.h"
+
+#include "composite.h"
+#include "core/outputbackend.h"
+#include "core/renderbackend.h"
+#include "effectloader.h"
+#include "effects.h"
+#include "effects/screenshot/screenshot.h"
+#include "wayland_server.h"
+#include "window.h"
+#include "workspace.h"
+
+#include <KWayland/Client/surface.h>
+
+using namespace KWin;
+
+static const QString s_socketName = QStringLiteral("wayland_test_effects_screenshot-0");
+
+class ScreenShotTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void init();
+    void cleanup();
+
+    void testWindow();
+    void testArea();
+    void testScreen();
+    void testUnloadWhilePending();
+
+private:
+    ScreenShotEffect *m_effect = nullptr;
+};
+
+static QImage filledImage(const QSize &size, const QColor &color)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    image.fill(color);
+    return image;
+}
+
+void ScreenShotTest::initTestCase()
+{
+    qputenv("XDG_DATA_DIRS", QCoreApplication::applicationDirPath().toUtf8());
+
+    qRegisterMetaType<KWin::Window *>();
+    QSignalSpy applicationStartedSpy(kwinApp(), &Application::started);
+    QVERIFY(waylandServer()->init(s_socketName));
+    QMetaObject::invokeMethod(kwinApp()->outputBackend(), "setVirtualOutputs", Qt::DirectConnection, Q_ARG(QVector<QRect>, QVector<QRect>() << QRect(0, 0, 1280, 1024)));
+
+    auto config = KSharedConfig::openConfig(QString(), KConfig::SimpleConfig);
+    KConfigGroup plugins(config, QStringLiteral("Plugins"));
+    const auto builtinNames = EffectLoader().listOfKnownEffects();
+    for (const QString &name : builtinNames) {
+        plugins.writeEntry(name + QStringLiteral("Enabled"), false);
+    }
+    config->sync();
+    kwinApp()->setConfig(config);
+
+    qputenv("KWIN_COMPOSE", QByteArrayLiteral("O2"));
+
+    kwinApp()->start();
+    QVERIFY(applicationStartedSpy.wait());
+
+    QCOMPARE(Compositor::self()->backend()->compositingType(), KWin::OpenGLCompositing);
+}
+
+void ScreenShotTest::init()
+{
+    QVERIFY(Test::setupWaylandConnection());
+
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    QVERIFY(effectsImpl);
+    QVERIFY(effectsImpl->loadEffect(QStringLiteral("screenshot")));
+    m_effect = qobject_cast<ScreenShotEffect *>(effectsImpl->findEffect(QStringLiteral("screenshot")));
+    QVERIFY(m_effect);
+}
+
+void ScreenShotTest::cleanup()
+{
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    QVERIFY(effectsImpl);
+    effectsImpl->unloadAllEffects();
+    QVERIFY(effectsImpl->loadedEffects().isEmpty());
+    m_effect = nullptr;
+
+    Test::destroyWaylandConnection();
+}
+
+void ScreenShotTest::testWindow()
+{
+    // The pixels are read back asynchronously, the image must still match the window.
+    std::unique_ptr<KWayland::Client::Surface> surface(Test::createSurface());
+    std::unique_ptr<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.get()));
+    Window *window = Test::renderAndWaitForShown(surface.get(), QSize(100, 50), Qt::red);
+    QVERIFY(window);
+
+    QFuture<QImage> future = m_effect->scheduleScreenShot(window->effectWindow());
+    QTRY_VERIFY(future.isFinished());
+    QVERIFY(!future.isCanceled());
+    QCOMPARE(future.result(), filledImage(QSize(100, 50), Qt::red));
+}
+
+void ScreenShotTest::testArea()
+{
+    std::unique_ptr<KWayland::Client::Surface> surface(Test::createSurface());
+    std::unique_ptr<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.get()));
+    Window *window = Test::renderAndWaitForShown(surface.get(), QSize(100, 50), Qt::blue);
+    QVERIFY(window);
+    window->move(QPoint(100, 200));
+
+    // The area only covers the window, the rows must not come out flipped or shifted.
+    const QRect area = QRect(110, 210, 80, 30);
+    QFuture<QImage> future = m_effect->scheduleScreenShot(area);
+    QTRY_VERIFY(future.isFinished());
+    QVERIFY(!future.isCanceled());
+
+    const QImage image = future.result().convertToFormat(QImage::Format_ARGB32);
+    QCOMPARE(image, filledImage(area.size(), Qt::blue));
+}
+
+void ScreenShotTest::testScreen()
+{
+    std::unique_ptr<KWayland::Client::Surface> surface(Test::createSurface());
+    std::unique_ptr<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.get()));
+    Window *window = Test::renderAndWaitForShown(surface.get(), QSize(100, 50), Qt::green);
+    QVERIFY(window);
+    window->move(QPoint(300, 400));
+
+    EffectScreen *screen = effects->screens().constFirst();
+    QFuture<QImage> future = m_effect->scheduleScreenShot(screen);
+    QTRY_VERIFY(future.isFinished());
+    QVERIFY(!future.isCanceled());
+
+    const QImage image = future.result();
+    QCOMPARE(image.size(), screen->geometry().size());
+    QCOMPARE(image.copy(window->frameGeometry().toRect()), filledImage(QSize(100, 50), Qt::green));
+}
+
+void ScreenShotTest::testUnloadWhilePending()
+{
+    // If the effect goes away before the screenshot is taken, the caller must get an error
+    // rather than wait forever.
+    EffectScreen *screen = effects->screens().constFirst();
+    QFuture<QImage> future = m_effect->scheduleScreenShot(screen);
+
+    auto effectsImpl = qobject_cast<EffectsHandlerImpl *>(effects);
+    effectsImpl->unloadAllEffects();
+    m_effect = nullptr;
+
+    QTRY_VERIFY(future.isFinished());
+    QVERIFY(future.isCanceled());
+}
+
+WAYLANDTEST_MAIN(ScreenShotTest)
+#include "screenshot_test.moc"
@@ -84,6 +84,7 @@ private Q_SLOTS:
     void init();
     void testWindowCasting();
     void testOutputCasting();
+    void testOutputCastingDamage();
 
 private:
     std::optional<QImage> oneFrameAndClose(Test::ScreencastingStreamV1 *stream);
@@ -178,5 +179,63 @@ void ScreencastingTest::testOutputCasting()
 
 }
 
+void ScreencastingTest::testOutputCastingDamage()
+{
+    // Only the damaged parts of the frame are copied, the other parts of the buffers must stay intact.
+    auto theOutput = KWin::Test::waylandOutputs().constFirst();
+
+    std::unique_ptr<KWayland::Client::Surface> surface(Test::createSurface());
+    QVERIFY(surface != nullptr);
+
+    std::unique_ptr<Test::XdgToplevel> shellSurface(Test::createXdgToplevelSurface(surface.get()));
+    QVERIFY(shellSurface != nullptr);
+
+    QImage sourceImage(theOutput->pixelSize(), QImage::Format_RGBA8888_Premultiplied);
+    sourceImage.fill(Qt::green);
+
+    Window *window = Test::renderAndWaitForShown(surface.get(), sourceImage);
+    QVERIFY(window);
+    QCOMPARE(window->frameGeometry(), window->output()->geometry());
+
+    auto stream = KWin::Test::screencasting()->createOutputStream(theOutput->output(), QtWayland::zkde_screencast_unstable_v1::pointer_hidden);
+
+    PipeWireSourceStream pwStream;
+    connect(stream, &Test::ScreencastingStreamV1::closed, qGuiApp, [&pwStream] {
+        pwStream.setActive(false);
+    });
+    connect(stream, &Test::ScreencastingStreamV1::created, qGuiApp, [&pwStream](quint32 nodeId) {
+        pwStream.createStream(nodeId, 0);
+    });
+
+    QList<QImage> frames;
+    connect(&pwStream, &PipeWireSourceStream::frameReceived, qGuiApp, [&frames](const PipeWireFrame &frame) {
+        if (frame.image) {
+            frames.append(frame.image->convertedToFormat(QImage::Format_RGBA8888_Premultiplied));
+        }
+    });
+
+    QTRY_VERIFY(!frames.isEmpty());
+    QCOMPARE(frames.constFirst(), sourceImage);
+
+    // Update small parts of the window more times than there are buffers (at most 16), so that
+    // every buffer gets reused. Every frame must match either the previous or the new contents
+    // exactly, a later correct frame must not hide a broken one.
+    for (int i = 0; i < 20; ++i) {
+        const QImage previousImage = sourceImage.copy();
+        frames.clear();
+        {
+            QPainter painter(&sourceImage);
+            painter.fillRect(QRect(10 + i * 40, 10 + i * 20, 30, 30), i % 2 ? Qt::red : Qt::blue);
+        }
+        Test::render(surface.get(), sourceImage);
+        QTRY_VERIFY(!frames.isEmpty() && frames.constLast() == sourceImage);
+        for (const QImage &frame : std::as_const(frames)) {
+            QVERIFY(frame == sourceImage || frame == previousImage);
+        }
+    }
+
+    pwStream.stopStreaming();
+}
+
 WAYLANDTEST_MAIN(KWin::ScreencastingTest)
 #include "screencasting_test.moc"
@@ -0,0 +1,213 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "libkwineffects/kwinglplatform.h"
+#include "libkwineffects/kwingltexture.h"
+#include "libkwineffects/kwingltexturepool.h"
+#include "libkwineffects/kwinglutils.h"
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QThread>
+#include <QtTest>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+// All textures that are used in the tests take 16 KiB.
+static const qint64 s_textureBytes = 64 * 64 * 4;
+
+class GLTexturePoolTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+    void init();
+
+    void testReuseExactSize();
+    void testReuseExactFormat();
+    void testContentsReset();
+    void testLruEviction();
+    void testBudget();
+    void testTrimIdle();
+
+private:
+    QOffscreenSurface m_surface;
+    QOpenGLContext m_context;
+};
+
+void GLTexturePoolTest::initTestCase()
+{
+    m_surface.create();
+    if (!m_context.create() || !m_context.makeCurrent(&m_surface)) {
+        QSKIP("An OpenGL context is required to test the texture pool");
+    }
+
+    GLPlatform::instance()->detect(EglPlatformInterface);
+    initGL([](const char *name) {
+        return QOpenGLContext::currentContext()->getProcAddress(name);
+    });
+}
+
+void GLTexturePoolTest::cleanupTestCase()
+{
+    if (QOpenGLContext::currentContext()) {
+        cleanupGL();
+        m_context.doneCurrent();
+    }
+}
+
+void GLTexturePoolTest::init()
+{
+    GLTexturePool::setBudget(64 * 1024 * 1024);
+    GLTexturePool::clear();
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+}
+
+void GLTexturePoolTest::testReuseExactSize()
+{
+    auto texture = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64));
+    QVERIFY(texture);
+    const GLuint name = texture->texture();
+    GLTexturePool::release(std::move(texture));
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+
+    // A texture with a different size or number of mipmap levels doesn't match.
+    auto smaller = GLTexturePool::acquire(GL_RGBA8, QSize(64, 32));
+    QVERIFY(smaller);
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+    auto mipmapped = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64), 2);
+    QVERIFY(mipmapped);
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+
+    auto reused = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64));
+    QVERIFY(reused);
+    QCOMPARE(reused->texture(), name);
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+}
+
+void GLTexturePoolTest::testReuseExactFormat()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        QSKIP("Textures are always allocated as GL_RGBA8 on GLES");
+    }
+
+    GLTexturePool::release(GLTexturePool::acquire(GL_RGBA8, QSize(64, 64)));
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+
+    auto other = GLTexturePool::acquire(GL_RGB10_A2, QSize(64, 64));
+    QVERIFY(other);
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+
+    auto reused = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64));
+    QVERIFY(reused);
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+}
+
+void GLTexturePoolTest::testContentsReset()
+{
+    auto texture = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64));
+    QVERIFY(texture);
+    texture->setFilter(GL_LINEAR);
+    texture->setWrapMode(GL_CLAMP_TO_EDGE);
+    texture->setContentTransform(TextureTransform::MirrorY);
+    GLTexturePool::release(std::move(texture));
+
+    auto reused = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64));
+    QVERIFY(reused);
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+    QCOMPARE(reused->filter(), GLenum(GL_NEAREST));
+    QCOMPARE(reused->contentTransforms(), TextureTransforms());
+}
+
+void GLTexturePoolTest::testLruEviction()
+{
+    GLTexturePool::setBudget(2 * s_textureBytes);
+
+    auto a = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64));
+    auto b = GLTexturePool::acquire(GL_RGBA8, QSize(128, 32));
+    auto c = GLTexturePool::acquire(GL_RGBA8, QSize(32, 128));
+    QVERIFY(a && b && c);
+
+    GLTexturePool::release(std::move(a));
+    GLTexturePool::release(std::move(b));
+
+    // Reusing a texture makes it the most recently released one once it comes back.
+    a = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64));
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+    GLTexturePool::release(std::move(a));
+
+    // b is the least recently released texture now, so it has to go first.
+    GLTexturePool::release(std::move(c));
+    QCOMPARE(GLTexturePool::usage(), 2 * s_textureBytes);
+
+    b = GLTexturePool::acquire(GL_RGBA8, QSize(128, 32));
+    QVERIFY(b);
+    QCOMPARE(GLTexturePool::usage(), 2 * s_textureBytes);
+
+    a = GLTexturePool::acquire(GL_RGBA8, QSize(64, 64));
+    QVERIFY(a);
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+    c = GLTexturePool::acquire(GL_RGBA8, QSize(32, 128));
+    QVERIFY(c);
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+}
+
+void GLTexturePoolTest::testBudget()
+{
+    GLTexturePool::setBudget(3 * s_textureBytes);
+
+    const QSize sizes[] = {QSize(64, 64), QSize(128, 32), QSize(32, 128), QSize(256, 16), QSize(16, 256)};
+    for (const QSize &size : sizes) {
+        GLTexturePool::release(GLTexturePool::acquire(GL_RGBA8, size));
+        QVERIFY(GLTexturePool::usage() <= GLTexturePool::budget());
+    }
+    QCOMPARE(GLTexturePool::usage(), 3 * s_textureBytes);
+
+    // A texture that doesn't fit in the budget at all is deleted right away.
+    const qint64 usage = GLTexturePool::usage();
+    GLTexturePool::release(GLTexturePool::acquire(GL_RGBA8, QSize(256, 256)));
+    QCOMPARE(GLTexturePool::usage(), usage);
+
+    // Lowering the budget trims the pool.
+    GLTexturePool::setBudget(s_textureBytes);
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+
+    // A budget of zero disables pooling.
+    GLTexturePool::setBudget(0);
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+    GLTexturePool::release(GLTexturePool::acquire(GL_RGBA8, QSize(64, 64)));
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+}
+
+void GLTexturePoolTest::testTrimIdle()
+{
+    GLTexturePool::release(GLTexturePool::acquire(GL_RGBA8, QSize(64, 64)));
+    QThread::msleep(200);
+    GLTexturePool::release(GLTexturePool::acquire(GL_RGBA8, QSize(128, 32)));
+    QCOMPARE(GLTexturePool::usage(), 2 * s_textureBytes);
+
+    // Only the texture that has been sitting in the pool for long enough is deleted.
+    GLTexturePool::trimIdle(100ms);
+    QCOMPARE(GLTexturePool::usage(), s_textureBytes);
+
+    auto recent = GLTexturePool::acquire(GL_RGBA8, QSize(128, 32));
+    QVERIFY(recent);
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+    GLTexturePool::release(std::move(recent));
+
+    GLTexturePool::trimIdle(0ms);
+    QCOMPARE(GLTexturePool::usage(), qint64(0));
+}
+
+QTEST_MAIN(GLTexturePoolTest)
+
+#include "gltexturepooltest.moc"
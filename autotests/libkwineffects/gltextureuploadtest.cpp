@@ -0,0 +1,145 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "libkwineffects/kwinglplatform.h"
+#include "libkwineffects/kwingltexture.h"
+#include "libkwineffects/kwingltexture_p.h"
+#include "libkwineffects/kwinglutils.h"
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QPainter>
+#include <QtTest>
+
+using namespace KWin;
+
+class GLTextureUploadTest : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testMergeUploadRects_data();
+    void testMergeUploadRects();
+    void testRingWraparound();
+    void testUploadWraparound();
+
+private:
+    QOffscreenSurface m_surface;
+    QOpenGLContext m_context;
+};
+
+static QImage readTexture(GLTexture *texture)
+{
+    QImage image(texture->size(), QImage::Format_RGBA8888_Premultiplied);
+    GLFramebuffer framebuffer(texture);
+    GLFramebuffer::pushFramebuffer(&framebuffer);
+    glReadPixels(0, 0, image.width(), image.height(), GL_RGBA, GL_UNSIGNED_BYTE, image.bits());
+    GLFramebuffer::popFramebuffer();
+    return image;
+}
+
+void GLTextureUploadTest::initTestCase()
+{
+    m_surface.create();
+    if (!m_context.create() || !m_context.makeCurrent(&m_surface)) {
+        QSKIP("An OpenGL context is required to test texture uploads");
+    }
+
+    GLPlatform::instance()->detect(EglPlatformInterface);
+    initGL([](const char *name) {
+        return QOpenGLContext::currentContext()->getProcAddress(name);
+    });
+}
+
+void GLTextureUploadTest::cleanupTestCase()
+{
+    if (QOpenGLContext::currentContext()) {
+        cleanupGL();
+        m_context.doneCurrent();
+    }
+}
+
+void GLTextureUploadTest::testMergeUploadRects_data()
+{
+    QTest::addColumn<QRegion>("region");
+    QTest::addColumn<QVector<QRect>>("expected");
+
+    QTest::addRow("single") << QRegion(0, 0, 10, 10) << QVector<QRect>{QRect(0, 0, 10, 10)};
+    QTest::addRow("dense") << (QRegion(0, 0, 10, 10) + QRect(0, 12, 10, 10)) << QVector<QRect>{QRect(0, 0, 10, 22)};
+    QTest::addRow("sparse") << (QRegion(0, 0, 10, 10) + QRect(100, 100, 10, 10)) << QVector<QRect>{QRect(0, 0, 10, 10), QRect(100, 100, 10, 10)};
+
+    QRegion many;
+    for (int i = 0; i < 17; ++i) {
+        many += QRect(i * 20, i * 20, 5, 5);
+    }
+    QTest::addRow("many") << many << QVector<QRect>{QRect(0, 0, 325, 325)};
+}
+
+void GLTextureUploadTest::testMergeUploadRects()
+{
+    QFETCH(QRegion, region);
+    QFETCH(QVector<QRect>, expected);
+
+    QCOMPARE(GLTexturePrivate::mergeUploadRects(region), expected);
+}
+
+void GLTextureUploadTest::testRingWraparound()
+{
+    if (!GLTexturePrivate::s_unpackBuffer) {
+        QSKIP("Persistently mapped pixel buffers are not supported");
+    }
+
+    GLStreamingUnpackBuffer buffer;
+    const qsizetype chunkSize = 1024 * 1024;
+    QCOMPARE(buffer.allocate(chunkSize), 0);
+    QCOMPARE(buffer.segment(), 0);
+
+    // The ranges are handed out in order, and once every segment has been used, the first one
+    // is reused.
+    const qsizetype chunksPerSegment = buffer.segmentSize() / chunkSize;
+    int allocations = 1;
+    bool leftFirstSegment = false;
+    while (!leftFirstSegment || buffer.segment() != 0) {
+        // Make sure the fences of the used segments have signalled.
+        glFinish();
+
+        const qsizetype offset = buffer.allocate(chunkSize);
+        QCOMPARE(offset, buffer.segment() * buffer.segmentSize() + (allocations % chunksPerSegment) * chunkSize);
+        leftFirstSegment |= buffer.segment() != 0;
+        allocations++;
+        QVERIFY(allocations < 100);
+    }
+    QCOMPARE(allocations % chunksPerSegment, 1);
+}
+
+void GLTextureUploadTest::testUploadWraparound()
+{
+    // Upload more than fits in the ring, every upload must arrive in the texture intact.
+    GLTexture texture(GL_RGBA8, QSize(512, 512));
+    QImage image(texture.size(), QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::black);
+    texture.update(image, QRegion(0, 0, image.width(), image.height()));
+
+    const QColor colors[] = {Qt::red, Qt::green, Qt::blue, Qt::white};
+    for (int i = 0; i < 80; ++i) {
+        const QRect rect(i % 64, (i * 3) % 64, 256 + i % 64, 256);
+        {
+            QPainter painter(&image);
+            painter.fillRect(rect, colors[i % 4]);
+        }
+        texture.update(image, QRegion(rect) + QRect(400, 400, 10, 10));
+        QCOMPARE(readTexture(&texture), image.convertToFormat(QImage::Format_RGBA8888_Premultiplied));
+    }
+}
+
+QTEST_MAIN(GLTextureUploadTest)
+#include "gltextureuploadtest.moc"
@@ -0,0 +1,245 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "libkwineffects/windowquadclipper.h"
+#include <QTest>
+
+using namespace KWin;
+
+Q_DECLARE_METATYPE(KWin::WindowQuadClipper::Kernel)
+
+class WindowQuadClipperTest : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testClip_data();
+    void testClip();
+    void testNoClipRects();
+    void testCompactQuad();
+    void testCompactQuads_data();
+    void testCompactQuads();
+    void benchmarkClip_data();
+    void benchmarkClip();
+};
+
+static WindowQuadList makeQuads(const QRectF &rect, int gridSize)
+{
+    WindowQuad quad;
+    quad[0] = WindowVertex(rect.left(), rect.top(), 0, 0);
+    quad[1] = WindowVertex(rect.right(), rect.top(), 1, 0);
+    quad[2] = WindowVertex(rect.right(), rect.bottom(), 1, 1);
+    quad[3] = WindowVertex(rect.left(), rect.bottom(), 0, 1);
+
+    WindowQuadList quads;
+    quads.append(quad);
+    return gridSize ? quads.makeGrid(gridSize) : quads;
+}
+
+static QVector<QRectF> makeClipRects(int count)
+{
+    // A staircase of rectangles, the way a region with many overlapping windows looks like.
+    QVector<QRectF> rects;
+    for (int i = 0; i < count; ++i) {
+        rects.append(QRectF(i * 37.5, i * 40, 300 + i * 11, 40));
+    }
+    return rects;
+}
+
+// The way the quads were clipped before WindowQuadClipper, kept as the reference.
+static void referenceClip(const WindowQuadList &quads, const QVector<QRectF> &deviceClipRects, qreal scale, RenderGeometry &geometry)
+{
+    for (const WindowQuad &quad : quads) {
+        const QRectF bounds = quad.bounds();
+        const QRectF deviceBounds(QPointF(std::round(bounds.left() * scale), std::round(bounds.top() * scale)),
+                                  QPointF(std::round(bounds.right() * scale), std::round(bounds.bottom() * scale)));
+        for (const QRectF &clipRect : deviceClipRects) {
+            const QRectF intersected = clipRect.intersected(deviceBounds);
+            if (intersected.isValid()) {
+                if (deviceBounds == intersected) {
+                    geometry.appendWindowQuad(quad, scale);
+                    break;
+                }
+                geometry.appendSubQuad(quad, intersected, scale);
+            }
+        }
+    }
+}
+
+static void compareGeometry(const RenderGeometry &actual, const RenderGeometry &expected)
+{
+    QCOMPARE(actual.count(), expected.count());
+    for (int i = 0; i < actual.count(); ++i) {
+        QCOMPARE(actual[i].position, expected[i].position);
+        QCOMPARE(actual[i].texcoord, expected[i].texcoord);
+    }
+}
+
+void WindowQuadClipperTest::testClip_data()
+{
+    QTest::addColumn<WindowQuadClipper::Kernel>("kernel");
+    QTest::addColumn<qreal>("scale");
+    QTest::addColumn<int>("gridSize");
+    QTest::addColumn<int>("clipRectCount");
+
+    const QList<WindowQuadClipper::Kernel> kernels{WindowQuadClipper::Kernel::Scalar, WindowQuadClipper::Kernel::Auto};
+    for (WindowQuadClipper::Kernel kernel : kernels) {
+        const char *kernelName = kernel == WindowQuadClipper::Kernel::Scalar ? "scalar" : "auto";
+        QTest::addRow("%s, single quad", kernelName) << kernel << 1.0 << 0 << 3;
+        QTest::addRow("%s, grid", kernelName) << kernel << 1.0 << 30 << 1;
+        QTest::addRow("%s, grid with many rects", kernelName) << kernel << 1.0 << 30 << 12;
+        QTest::addRow("%s, fractional scale", kernelName) << kernel << 1.25 << 17 << 7;
+        QTest::addRow("%s, odd quad count", kernelName) << kernel << 2.0 << 143 << 5;
+    }
+}
+
+void WindowQuadClipperTest::testClip()
+{
+    QFETCH(WindowQuadClipper::Kernel, kernel);
+    QFETCH(qreal, scale);
+    QFETCH(int, gridSize);
+    QFETCH(int, clipRectCount);
+
+    const WindowQuadList quads = makeQuads(QRectF(10, 20, 500, 400), gridSize);
+    const QVector<QRectF> clipRects = makeClipRects(clipRectCount);
+
+    RenderGeometry expected;
+    referenceClip(quads, clipRects, scale, expected);
+    QVERIFY(!expected.isEmpty());
+
+    WindowQuadClipper clipper(kernel);
+    RenderGeometry actual;
+    clipper.clip(quads, clipRects, scale, actual);
+    compareGeometry(actual, expected);
+
+    // The clipper must not keep any state from the previous call.
+    RenderGeometry again;
+    clipper.clip(quads, clipRects, scale, again);
+    compareGeometry(again, expected);
+
+    // Nor from a call with a different number of clip rectangles.
+    const QVector<QRectF> otherClipRects = makeClipRects(1);
+    RenderGeometry otherExpected;
+    referenceClip(quads, otherClipRects, scale, otherExpected);
+    RenderGeometry other;
+    clipper.clip(quads, otherClipRects, scale, other);
+    compareGeometry(other, otherExpected);
+
+    RenderGeometry last;
+    clipper.clip(quads, clipRects, scale, last);
+    compareGeometry(last, expected);
+}
+
+void WindowQuadClipperTest::testNoClipRects()
+{
+    const WindowQuadList quads = makeQuads(QRectF(10, 20, 500, 400), 50);
+
+    RenderGeometry expected;
+    for (const WindowQuad &quad : quads) {
+        expected.appendWindowQuad(quad, 1.0);
+    }
+
+    WindowQuadClipper clipper;
+    RenderGeometry actual;
+    clipper.clip(quads, QVector<QRectF>(), 1.0, actual);
+    compareGeometry(actual, expected);
+}
+
+void WindowQuadClipperTest::testCompactQuad()
+{
+    static_assert(sizeof(CompactWindowQuad) == sizeof(WindowQuad) / 2);
+    static_assert(alignof(CompactWindowQuad) == 16);
+
+    const WindowQuad quad = makeQuads(QRectF(10.5, 20, 500, 400.25), 0).constFirst();
+    const CompactWindowQuad compactQuad(quad);
+    QCOMPARE(compactQuad.bounds(), quad.bounds());
+
+    const WindowQuad roundTrip = compactQuad.toWindowQuad();
+    for (int i = 0; i < 4; ++i) {
+        QCOMPARE(roundTrip[i].x(), quad[i].x());
+        QCOMPARE(roundTrip[i].y(), quad[i].y());
+        QCOMPARE(roundTrip[i].u(), quad[i].u());
+        QCOMPARE(roundTrip[i].v(), quad[i].v());
+    }
+}
+
+void WindowQuadClipperTest::testCompactQuads_data()
+{
+    QTest::addColumn<qreal>("scale");
+    QTest::addColumn<int>("clipRectCount");
+
+    QTest::addRow("unclipped") << 1.0 << 0;
+    QTest::addRow("clipped") << 1.0 << 9;
+    QTest::addRow("clipped, fractional scale") << 1.5 << 9;
+}
+
+void WindowQuadClipperTest::testCompactQuads()
+{
+    QFETCH(qreal, scale);
+    QFETCH(int, clipRectCount);
+
+    const WindowQuadList quads = makeQuads(QRectF(10, 20, 500, 400), 30);
+    const QVector<QRectF> clipRects = makeClipRects(clipRectCount);
+
+    WindowQuadClipper clipper;
+    RenderGeometry expected;
+    clipper.clip(quads, clipRects, scale, expected);
+
+    RenderGeometry actual;
+    clipper.clip(CompactWindowQuadList(quads), clipRects, scale, actual);
+
+    // The texture coordinates are interpolated from single precision values.
+    QCOMPARE(actual.count(), expected.count());
+    for (int i = 0; i < actual.count(); ++i) {
+        QCOMPARE(actual[i].position, expected[i].position);
+        QVERIFY((actual[i].texcoord - expected[i].texcoord).length() < 1e-5);
+    }
+}
+
+void WindowQuadClipperTest::benchmarkClip_data()
+{
+    QTest::addColumn<int>("implementation");
+    QTest::addColumn<int>("clipRectCount");
+
+    const QByteArray instructionSet = WindowQuadClipper::instructionSet().toLatin1();
+
+    // A grid of 20x20 pixel quads, the way wobbly windows and magic lamp subdivide windows.
+    for (int clipRectCount : {1, 4, 16}) {
+        QTest::addRow("reference, %d rects", clipRectCount) << 0 << clipRectCount;
+        QTest::addRow("scalar, %d rects", clipRectCount) << 1 << clipRectCount;
+        QTest::addRow("simd (%s), %d rects", instructionSet.constData(), clipRectCount) << 2 << clipRectCount;
+        QTest::addRow("simd (%s), compact, %d rects", instructionSet.constData(), clipRectCount) << 3 << clipRectCount;
+    }
+}
+
+void WindowQuadClipperTest::benchmarkClip()
+{
+    QFETCH(int, implementation);
+    QFETCH(int, clipRectCount);
+
+    const WindowQuadList quads = makeQuads(QRectF(0, 0, 1280, 800), 20);
+    const CompactWindowQuadList compactQuads(quads);
+    const QVector<QRectF> clipRects = makeClipRects(clipRectCount);
+
+    WindowQuadClipper clipper(implementation == 1 ? WindowQuadClipper::Kernel::Scalar : WindowQuadClipper::Kernel::Auto);
+    RenderGeometry geometry;
+    geometry.reserve(quads.count() * 6);
+
+    QBENCHMARK {
+        geometry.clear();
+        if (implementation == 0) {
+            referenceClip(quads, clipRects, 1.0, geometry);
+        } else if (implementation == 3) {
+            clipper.clip(compactQuads, clipRects, 1.0, geometry);
+        } else {
+            clipper.clip(quads, clipRects, 1.0, geometry);
+        }
+    }
+}
+
+QTEST_MAIN(WindowQuadClipperTest)
+#include "windowquadclippertest.moc"
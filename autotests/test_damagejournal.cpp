@@ -0,0 +1,172 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "utils/damagejournal.h"
+
+using namespace KWin;
+
+class TestDamageJournal : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testAccumulate();
+    void testFallback();
+    void testCapacity();
+    void testRandom();
+    void testCoarse();
+    void benchmarkAccumulate();
+};
+
+void TestDamageJournal::testAccumulate()
+{
+    DamageJournal journal;
+    journal.add(QRect(0, 0, 10, 10));
+    journal.add(QRect(10, 0, 10, 10));
+    journal.add(QRect(20, 0, 10, 10));
+
+    QCOMPARE(journal.lastDamage(), QRegion(20, 0, 10, 10));
+    QCOMPARE(journal.accumulate(1), QRegion());
+    QCOMPARE(journal.accumulate(2), QRegion(20, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3), QRegion(10, 0, 20, 10));
+
+    // The same buffer age is requested every frame, the window must follow the new damage.
+    journal.add(QRect(30, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3), QRegion(20, 0, 20, 10));
+    journal.add(QRect(40, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3), QRegion(30, 0, 20, 10));
+    journal.add(QRect(50, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3), QRegion(40, 0, 20, 10));
+}
+
+void TestDamageJournal::testFallback()
+{
+    const QRegion fallback(0, 0, 100, 100);
+
+    DamageJournal journal;
+    QCOMPARE(journal.accumulate(1, fallback), fallback);
+
+    journal.add(QRect(0, 0, 10, 10));
+    QCOMPARE(journal.accumulate(0, fallback), fallback);
+    QCOMPARE(journal.accumulate(2, fallback), fallback);
+
+    journal.clear();
+    QCOMPARE(journal.accumulate(1, fallback), fallback);
+    QCOMPARE(journal.lastDamage(), QRegion());
+}
+
+void TestDamageJournal::testCapacity()
+{
+    DamageJournal journal;
+    journal.setCapacity(2);
+    journal.add(QRect(0, 0, 10, 10));
+    journal.add(QRect(10, 0, 10, 10));
+    journal.add(QRect(20, 0, 10, 10));
+    QCOMPARE(journal.accumulate(2), QRegion(20, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3, QRect(0, 0, 1, 1)), QRegion(0, 0, 1, 1));
+
+    // The most recent damage is kept if the capacity changes.
+    journal.setCapacity(5);
+    QCOMPARE(journal.accumulate(2), QRegion(20, 0, 10, 10));
+    journal.add(QRect(30, 0, 10, 10));
+    QCOMPARE(journal.accumulate(3), QRegion(20, 0, 20, 10));
+}
+
+void TestDamageJournal::testRandom()
+{
+    // Compare against uniting the damage regions every time.
+    QRandomGenerator generator(42);
+    const QRegion fallback(-1, -1, 1, 1);
+
+    for (int iteration = 0; iteration < 100; ++iteration) {
+        DamageJournal journal;
+        const int capacity = generator.bounded(1, 10);
+        journal.setCapacity(capacity);
+
+        QList<QRegion> log;
+        int bufferAge = generator.bounded(1, 5);
+        for (int i = 0; i < 200; ++i) {
+            QRegion damage;
+            for (int j = generator.bounded(3); j >= 0; --j) {
+                damage += QRect(generator.bounded(500), generator.bounded(500), generator.bounded(1, 100), generator.bounded(1, 100));
+            }
+            journal.add(damage);
+            log.prepend(damage);
+            while (log.size() > capacity) {
+                log.removeLast();
+            }
+
+            // The buffer age changes every now and then.
+            if (generator.bounded(10) == 0) {
+                bufferAge = generator.bounded(0, 12);
+            }
+
+            QRegion expected = fallback;
+            if (bufferAge > 0 && bufferAge <= log.size()) {
+                expected = QRegion();
+                for (int j = 0; j < bufferAge - 1; ++j) {
+                    expected += log[j];
+                }
+            }
+            QCOMPARE(journal.accumulate(bufferAge, fallback), expected);
+            QCOMPARE(journal.lastDamage(), log.first());
+        }
+    }
+}
+
+void TestDamageJournal::testCoarse()
+{
+    DamageJournal journal;
+    journal.setMode(DamageJournal::Mode::Coarse);
+
+    // A lot of scattered damage is replaced by its bounding rectangle.
+    for (int i = 0; i < 8; ++i) {
+        QRegion damage;
+        for (int j = 0; j < 10; ++j) {
+            damage += QRect(i * 100 + j * 8, j * 8, 4, 4);
+        }
+        journal.add(damage);
+    }
+    const QRegion accumulated = journal.accumulate(5);
+    QCOMPARE(accumulated.rectCount(), 1);
+    QCOMPARE(accumulated.boundingRect(), QRect(400, 0, 376, 76));
+
+    // A few rectangles are kept as is.
+    journal.add(QRect(0, 0, 10, 10));
+    journal.add(QRect(100, 100, 10, 10));
+    QCOMPARE(journal.accumulate(3), QRegion(0, 0, 10, 10) | QRegion(100, 100, 10, 10));
+
+    // The last damage is never coarsened.
+    QCOMPARE(journal.lastDamage(), QRegion(100, 100, 10, 10));
+}
+
+void TestDamageJournal::benchmarkAccumulate()
+{
+    QRandomGenerator generator(7);
+    QList<QRegion> damages;
+    for (int i = 0; i < 64; ++i) {
+        QRegion damage;
+        for (int j = 0; j < 4; ++j) {
+            damage += QRect(generator.bounded(1920), generator.bounded(1080), generator.bounded(1, 200), generator.bounded(1, 200));
+        }
+        damages.append(damage);
+    }
+
+    DamageJournal journal;
+    int index = 0;
+    QBENCHMARK {
+        journal.add(damages[index++ % damages.size()]);
+        journal.accumulate(4);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestDamageJournal)
+#include "test_damagejournal.moc"
@@ -0,0 +1,155 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "core/framearena.h"
+
+#include <QMatrix4x4>
+
+using namespace KWin;
+
+class TestFrameArena : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testAllocate();
+    void testAlignment();
+    void testGrow();
+    void testFrames();
+    void benchmarkHeap();
+    void benchmarkArena();
+};
+
+void TestFrameArena::testAllocate()
+{
+    FrameArena arena(1024);
+
+    std::pmr::vector<int> numbers(&arena);
+    for (int i = 0; i < 100; ++i) {
+        numbers.push_back(i);
+    }
+    QCOMPARE(numbers.size(), 100u);
+    QCOMPARE(numbers.back(), 99);
+    QVERIFY(arena.allocationCount() > 0);
+    QVERIFY(arena.allocatedBytes() >= 100 * sizeof(int));
+
+    const int allocationCount = arena.allocationCount();
+    const std::size_t allocatedBytes = arena.allocatedBytes();
+    numbers = std::pmr::vector<int>(&arena);
+
+    arena.reset();
+    QCOMPARE(arena.allocationCount(), 0);
+    QCOMPARE(arena.allocatedBytes(), 0u);
+    QCOMPARE(arena.lastFrameAllocationCount(), allocationCount);
+    QCOMPARE(arena.lastFrameAllocatedBytes(), allocatedBytes);
+    QCOMPARE(arena.capacity(), 1024u);
+}
+
+void TestFrameArena::testAlignment()
+{
+    FrameArena arena(1024);
+
+    QVERIFY(arena.allocate(1, 1));
+    void *matrix = arena.allocate(sizeof(QMatrix4x4), 64);
+    QCOMPARE(quintptr(matrix) % 64, 0u);
+    void *byte = arena.allocate(1, 1);
+    QVERIFY(quintptr(byte) >= quintptr(matrix) + sizeof(QMatrix4x4));
+}
+
+void TestFrameArena::testGrow()
+{
+    FrameArena arena(256);
+
+    // Allocations that don't fit make the arena allocate more memory.
+    std::array<void *, 16> pointers;
+    for (void *&pointer : pointers) {
+        pointer = arena.allocate(100, 8);
+        memset(pointer, 0xff, 100);
+    }
+    QCOMPARE(arena.allocationCount(), 16);
+    QCOMPARE(arena.capacity(), 256u);
+
+    // Once rewound, the arena keeps a single block big enough for the previous frame.
+    arena.reset();
+    QVERIFY(arena.capacity() >= 16 * 104);
+    const std::size_t capacity = arena.capacity();
+
+    void *first = arena.allocate(104, 8);
+    for (int i = 1; i < 16; ++i) {
+        void *pointer = arena.allocate(104, 8);
+        QCOMPARE(quintptr(pointer) - quintptr(first), quintptr(i * 104));
+    }
+    arena.reset();
+    QCOMPARE(arena.capacity(), capacity);
+}
+
+void TestFrameArena::testFrames()
+{
+    // The way WorkspaceScene keeps its paint data between preparing and finishing a frame.
+    FrameArena arena(256);
+    std::pmr::vector<QMatrix4x4> transforms(&arena);
+
+    for (int frame = 0; frame < 3; ++frame) {
+        transforms = std::pmr::vector<QMatrix4x4>(&arena);
+        arena.reset();
+        QCOMPARE(arena.allocationCount(), 0);
+
+        for (int i = 0; i < 8; ++i) {
+            transforms.push_back(QMatrix4x4());
+        }
+        QCOMPARE(transforms.get_allocator().resource(), &arena);
+        QVERIFY(arena.allocationCount() > 0);
+    }
+
+    // The first frame needed more memory, the following ones fit into the merged block.
+    QVERIFY(arena.capacity() > 256);
+    QCOMPARE(arena.lastFrameAllocationCount(), arena.allocationCount());
+}
+
+// Roughly the temporaries of painting one window with a few sub-surfaces.
+template<typename Allocate>
+static void paintWindow(Allocate allocate)
+{
+    for (int i = 0; i < 4; ++i) {
+        auto transforms = allocate.template operator()<QMatrix4x4>();
+        auto opacities = allocate.template operator()<qreal>();
+        for (int j = 0; j < 4; ++j) {
+            transforms.push_back(QMatrix4x4());
+            opacities.push_back(1.0);
+        }
+    }
+}
+
+void TestFrameArena::benchmarkHeap()
+{
+    QBENCHMARK {
+        for (int i = 0; i < 100; ++i) {
+            paintWindow([]<typename T>() {
+                return std::vector<T>();
+            });
+        }
+    }
+}
+
+void TestFrameArena::benchmarkArena()
+{
+    FrameArena arena;
+    QBENCHMARK {
+        for (int i = 0; i < 100; ++i) {
+            paintWindow([&arena]<typename T>() {
+                return std::pmr::vector<T>(&arena);
+            });
+        }
+        arena.reset();
+    }
+}
+
+QTEST_GUILESS_MAIN(TestFrameArena)
+#include "test_framearena.moc"
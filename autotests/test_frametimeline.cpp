@@ -0,0 +1,140 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTest>
+#include <QThread>
+
+#include "frametimeline.h"
+
+using namespace KWin;
+
+class TestFrameTimeline : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testRecord();
+    void testThreads();
+    void testWrapAround();
+    void benchmarkInstant();
+};
+
+static QJsonArray dumpEvents()
+{
+    const QJsonDocument document = QJsonDocument::fromJson(FrameTimeline::toTraceEventJson());
+    return document.object().value(QStringLiteral("traceEvents")).toArray();
+}
+
+static QList<QJsonObject> findEvents(const QJsonArray &events, const QString &name, quint64 object)
+{
+    const QString objectString = QStringLiteral("0x%1").arg(object, 0, 16);
+
+    QList<QJsonObject> result;
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("name")) == name && event.value(QStringLiteral("args")).toObject().value(QStringLiteral("object")) == objectString) {
+            result.append(event);
+        }
+    }
+    return result;
+}
+
+void TestFrameTimeline::testRecord()
+{
+    QVERIFY(FrameTimeline::isEnabled());
+
+    const quint64 frame = FrameTimeline::startFrame();
+    QCOMPARE(FrameTimeline::currentFrame(), frame);
+
+    FrameTimeline::instant(FrameTimelineEvent::TimerFired, 0x1);
+    {
+        FrameTimelineScope scope(FrameTimelineEvent::Composite, 0x1);
+        QThread::msleep(1);
+    }
+    FrameTimeline::instant(FrameTimelineEvent::PageFlip, 0x1, frame);
+
+    const QJsonArray events = dumpEvents();
+
+    const auto timerFired = findEvents(events, QStringLiteral("TimerFired"), 0x1);
+    QCOMPARE(timerFired.count(), 1);
+    QCOMPARE(timerFired[0].value(QStringLiteral("ph")).toString(), QStringLiteral("i"));
+    QCOMPARE(timerFired[0].value(QStringLiteral("args")).toObject().value(QStringLiteral("frame")).toString(), QString::number(frame));
+
+    const auto composite = findEvents(events, QStringLiteral("Composite"), 0x1);
+    QCOMPARE(composite.count(), 1);
+    QCOMPARE(composite[0].value(QStringLiteral("ph")).toString(), QStringLiteral("X"));
+    QVERIFY(composite[0].value(QStringLiteral("dur")).toDouble() >= 1000);
+    QVERIFY(composite[0].value(QStringLiteral("ts")).toDouble() >= timerFired[0].value(QStringLiteral("ts")).toDouble());
+
+    const auto pageFlip = findEvents(events, QStringLiteral("PageFlip"), 0x1);
+    QCOMPARE(pageFlip.count(), 1);
+    QCOMPARE(pageFlip[0].value(QStringLiteral("args")).toObject().value(QStringLiteral("frame")).toString(), QString::number(frame));
+
+    // Events are not recorded while the timeline is disabled.
+    FrameTimeline::create(this);
+    FrameTimeline::self()->setEnabled(false);
+    FrameTimeline::instant(FrameTimelineEvent::TimerFired, 0x2);
+    FrameTimeline::self()->setEnabled(true);
+    QVERIFY(findEvents(dumpEvents(), QStringLiteral("TimerFired"), 0x2).isEmpty());
+}
+
+void TestFrameTimeline::testThreads()
+{
+    QThread *thread = QThread::create([]() {
+        FrameTimeline::instant(FrameTimelineEvent::AtomicCommit, 0x3);
+    });
+    thread->setObjectName(QStringLiteral("TestThread"));
+    thread->start();
+    QVERIFY(thread->wait());
+
+    FrameTimeline::instant(FrameTimelineEvent::ClientCommit, 0x3);
+
+    const QJsonArray events = dumpEvents();
+    const auto atomicCommit = findEvents(events, QStringLiteral("AtomicCommit"), 0x3);
+    const auto clientCommit = findEvents(events, QStringLiteral("ClientCommit"), 0x3);
+    QCOMPARE(atomicCommit.count(), 1);
+    QCOMPARE(clientCommit.count(), 1);
+    QVERIFY(atomicCommit[0].value(QStringLiteral("tid")) != clientCommit[0].value(QStringLiteral("tid")));
+
+    bool threadNameFound = false;
+    for (const QJsonValue &value : events) {
+        const QJsonObject event = value.toObject();
+        if (event.value(QStringLiteral("ph")) == QStringLiteral("M") && event.value(QStringLiteral("tid")) == atomicCommit[0].value(QStringLiteral("tid"))) {
+            threadNameFound = event.value(QStringLiteral("args")).toObject().value(QStringLiteral("name")) == QStringLiteral("TestThread");
+        }
+    }
+    QVERIFY(threadNameFound);
+
+    delete thread;
+}
+
+void TestFrameTimeline::testWrapAround()
+{
+    const int count = 20000;
+    for (int i = 0; i < count; ++i) {
+        FrameTimeline::instant(FrameTimelineEvent::ScheduleRepaint, 0x10000 + i);
+    }
+
+    const QJsonArray events = dumpEvents();
+    QVERIFY(events.count() < count);
+    QVERIFY(findEvents(events, QStringLiteral("ScheduleRepaint"), 0x10000).isEmpty());
+    QCOMPARE(findEvents(events, QStringLiteral("ScheduleRepaint"), 0x10000 + count - 1).count(), 1);
+}
+
+void TestFrameTimeline::benchmarkInstant()
+{
+    QBENCHMARK {
+        FrameTimeline::instant(FrameTimelineEvent::ScheduleRepaint);
+    }
+}
+
+QTEST_GUILESS_MAIN(TestFrameTimeline)
+#include "test_frametimeline.moc"
@@ -0,0 +1,234 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "core/renderlayer.h"
+#include "core/renderloop.h"
+#include "scene/item.h"
+#include "scene/itemrenderer.h"
+#include "scene/scene.h"
+#include "scene/workspacescene.h"
+#include "utils/region.h"
+
+using namespace KWin;
+
+class TestScene : public Scene
+{
+public:
+    TestScene()
+        : Scene(nullptr)
+    {
+    }
+
+    void prePaint(SceneDelegate *delegate) override
+    {
+    }
+
+    void postPaint() override
+    {
+    }
+
+    void paint(const RenderTarget &renderTarget, const QRegion &region) override
+    {
+    }
+};
+
+class TestItem : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void init();
+    void cleanup();
+    void testCollectRepaints();
+    void testReparent();
+    void testDelegates();
+    void benchmarkCollectOne();
+    void benchmarkCollectAll();
+
+private:
+    void createWindows(int count);
+
+    std::unique_ptr<RenderLoop> m_renderLoop;
+    std::unique_ptr<TestScene> m_scene;
+    std::unique_ptr<RenderLayer> m_layer;
+    SceneDelegate *m_delegate = nullptr;
+    std::unique_ptr<Item> m_rootItem;
+    std::vector<std::unique_ptr<Item>> m_items;
+    QList<Item *> m_leafItems;
+};
+
+void TestItem::init()
+{
+    m_renderLoop = std::make_unique<RenderLoop>();
+    // Repaints are only recorded, no frames are going to be painted.
+    m_renderLoop->inhibit();
+
+    m_scene = std::make_unique<TestScene>();
+    m_scene->setGeometry(QRect(0, 0, 2560, 1440));
+
+    m_layer = std::make_unique<RenderLayer>(m_renderLoop.get());
+    auto delegate = std::make_unique<SceneDelegate>(m_scene.get(), nullptr);
+    m_delegate = delegate.get();
+    m_layer->setDelegate(std::move(delegate));
+
+    m_rootItem = std::make_unique<Item>(m_scene.get());
+    m_rootItem->setSize(QSizeF(2560, 1440));
+}
+
+void TestItem::cleanup()
+{
+    m_leafItems.clear();
+    // Destroy the children before their parents.
+    while (!m_items.empty()) {
+        m_items.pop_back();
+    }
+    m_rootItem.reset();
+    m_layer.reset();
+    m_scene.reset();
+    m_renderLoop.reset();
+}
+
+void TestItem::createWindows(int count)
+{
+    // Every window has a main surface with a few sub-surfaces, some of them nested.
+    for (int i = 0; i < count; ++i) {
+        Item *windowItem = m_items.emplace_back(std::make_unique<Item>(m_scene.get(), m_rootItem.get())).get();
+        windowItem->setPosition(QPointF((i % 25) * 100, (i / 25) % 14 * 100));
+        windowItem->setSize(QSizeF(200, 200));
+
+        Item *surfaceItem = m_items.emplace_back(std::make_unique<Item>(m_scene.get(), windowItem)).get();
+        surfaceItem->setSize(QSizeF(200, 200));
+        for (int j = 0; j < 3; ++j) {
+            Item *subsurfaceItem = m_items.emplace_back(std::make_unique<Item>(m_scene.get(), surfaceItem)).get();
+            subsurfaceItem->setPosition(QPointF(j * 50, j * 50));
+            subsurfaceItem->setSize(QSizeF(50, 50));
+
+            Item *nestedItem = m_items.emplace_back(std::make_unique<Item>(m_scene.get(), subsurfaceItem)).get();
+            nestedItem->setSize(QSizeF(10, 10));
+            m_leafItems.append(nestedItem);
+        }
+    }
+
+    Region repaints;
+    WorkspaceScene::accumulateRepaints(m_rootItem.get(), m_delegate, &repaints);
+}
+
+void TestItem::testCollectRepaints()
+{
+    createWindows(10);
+    QVERIFY(!m_rootItem->hasRepaints(m_delegate));
+
+    Item *leafItem = m_leafItems.at(4);
+    leafItem->scheduleRepaint(QRectF(0, 0, 5, 5));
+    QVERIFY(leafItem->hasRepaints(m_delegate));
+    QVERIFY(leafItem->parentItem()->hasRepaints(m_delegate));
+    QVERIFY(m_rootItem->hasRepaints(m_delegate));
+
+    // The clean windows must not be marked.
+    const QList<Item *> windowItems = m_rootItem->childItems();
+    int dirtyWindowCount = 0;
+    for (Item *windowItem : windowItems) {
+        dirtyWindowCount += windowItem->hasRepaints(m_delegate);
+    }
+    QCOMPARE(dirtyWindowCount, 1);
+
+    Region repaints;
+    WorkspaceScene::accumulateRepaints(m_rootItem.get(), m_delegate, &repaints);
+    QCOMPARE(repaints.toQRegion(), QRegion(leafItem->mapToGlobal(QRectF(0, 0, 5, 5)).toAlignedRect()));
+    QVERIFY(!m_rootItem->hasRepaints(m_delegate));
+    QVERIFY(!leafItem->hasRepaints(m_delegate));
+
+    // Repaints scheduled after the collection must be picked up by the next one.
+    leafItem->scheduleRepaint(QRectF(0, 0, 5, 5));
+    QVERIFY(m_rootItem->hasRepaints(m_delegate));
+
+    m_leafItems.at(7)->scheduleRepaint(QRectF(0, 0, 10, 10));
+    repaints.clear();
+    WorkspaceScene::accumulateRepaints(m_rootItem.get(), m_delegate, &repaints);
+    QCOMPARE(repaints.toQRegion(), QRegion(leafItem->mapToGlobal(QRectF(0, 0, 5, 5)).toAlignedRect()) + m_leafItems.at(7)->mapToGlobal(QRectF(0, 0, 10, 10)).toAlignedRect());
+    for (Item *item : std::as_const(m_leafItems)) {
+        QVERIFY(!item->hasRepaints(m_delegate));
+    }
+}
+
+void TestItem::testReparent()
+{
+    createWindows(2);
+
+    const QList<Item *> windowItems = m_rootItem->childItems();
+    Item *leafItem = m_leafItems.constFirst();
+    leafItem->scheduleRepaint(QRectF(0, 0, 5, 5));
+    QVERIFY(windowItems[0]->hasRepaints(m_delegate));
+    QVERIFY(!windowItems[1]->hasRepaints(m_delegate));
+
+    // The pending repaints follow the item to its new parent.
+    leafItem->setParentItem(windowItems[1]);
+    QVERIFY(windowItems[1]->hasRepaints(m_delegate));
+
+    Region repaints;
+    WorkspaceScene::accumulateRepaints(windowItems[1], m_delegate, &repaints);
+    QVERIFY(!repaints.isEmpty());
+    QVERIFY(!leafItem->hasRepaints(m_delegate));
+}
+
+void TestItem::testDelegates()
+{
+    createWindows(1);
+
+    RenderLayer otherLayer(m_renderLoop.get());
+    auto otherDelegate = std::make_unique<SceneDelegate>(m_scene.get(), nullptr);
+    SceneDelegate *other = otherDelegate.get();
+    otherLayer.setDelegate(std::move(otherDelegate));
+
+    m_leafItems.constFirst()->scheduleRepaint(QRectF(0, 0, 5, 5));
+    QVERIFY(m_rootItem->hasRepaints(m_delegate));
+    QVERIFY(m_rootItem->hasRepaints(other));
+
+    // Collecting the repaints for one delegate leaves the other one alone.
+    Region repaints;
+    WorkspaceScene::accumulateRepaints(m_rootItem.get(), m_delegate, &repaints);
+    QVERIFY(!m_rootItem->hasRepaints(m_delegate));
+    QVERIFY(m_rootItem->hasRepaints(other));
+}
+
+void TestItem::benchmarkCollectOne()
+{
+    createWindows(500);
+
+    Item *leafItem = m_leafItems.at(m_leafItems.count() / 2);
+    QBENCHMARK {
+        leafItem->scheduleRepaint(QRectF(0, 0, 5, 5));
+        Region repaints;
+        WorkspaceScene::accumulateRepaints(m_rootItem.get(), m_delegate, &repaints);
+        // The damage leaves the scene as a QRegion.
+        const QRegion damage = repaints.toQRegion();
+        Q_UNUSED(damage)
+    }
+}
+
+void TestItem::benchmarkCollectAll()
+{
+    createWindows(500);
+
+    // The worst case, every item has to be visited.
+    QBENCHMARK {
+        for (Item *leafItem : std::as_const(m_leafItems)) {
+            leafItem->scheduleRepaint(QRectF(0, 0, 5, 5));
+        }
+        Region repaints;
+        WorkspaceScene::accumulateRepaints(m_rootItem.get(), m_delegate, &repaints);
+        // The damage leaves the scene as a QRegion.
+        const QRegion damage = repaints.toQRegion();
+        Q_UNUSED(damage)
+    }
+}
+
+QTEST_GUILESS_MAIN(TestItem)
+#include "test_item.moc"
@@ -0,0 +1,284 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QRandomGenerator>
+#include <QTest>
+
+#include "utils/region.h"
+
+using namespace KWin;
+
+class TestRegion : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testUnite();
+    void testSubtract();
+    void testIntersect();
+    void testTranslate();
+    void testRandom();
+    void benchmark_data();
+    void benchmarkQRegion();
+    void benchmarkRegion();
+};
+
+// Each frame is a list of damaged rectangles followed by a list of opaque rectangles that
+// occlude everything damaged below them, the way WorkspaceScene accumulates the damage.
+struct DamageFrame
+{
+    QList<QRect> damage;
+    QList<QRect> opaque;
+};
+
+Q_DECLARE_METATYPE(QList<DamageFrame>)
+
+static QRect randomRect(QRandomGenerator *generator, const QRect &bounds, int maxSize)
+{
+    const int width = generator->bounded(1, maxSize);
+    const int height = generator->bounded(1, maxSize);
+    const int x = generator->bounded(bounds.x(), bounds.x() + bounds.width() - width + 1);
+    const int y = generator->bounded(bounds.y(), bounds.y() + bounds.height() - height + 1);
+    return QRect(x, y, width, height);
+}
+
+void TestRegion::testEmpty()
+{
+    Region region;
+    QVERIFY(region.isEmpty());
+    QCOMPARE(region.rectCount(), 0);
+    QCOMPARE(region.boundingRect(), QRect());
+    QCOMPARE(region.toQRegion(), QRegion());
+
+    region.unite(QRect());
+    QVERIFY(region.isEmpty());
+
+    region.unite(QRect(0, 0, 10, 10));
+    QVERIFY(!region.isEmpty());
+    region.clear();
+    QVERIFY(region.isEmpty());
+}
+
+void TestRegion::testUnite()
+{
+    Region region(QRect(0, 0, 100, 100));
+
+    // Rectangles that are already in the region don't change it.
+    region.unite(QRect(10, 10, 10, 10));
+    QCOMPARE(region.rectCount(), 1);
+
+    region.unite(QRect(50, 50, 100, 100));
+    QCOMPARE(region.boundingRect(), QRect(0, 0, 150, 150));
+    QCOMPARE(region.toQRegion(), QRegion(0, 0, 100, 100) | QRegion(50, 50, 100, 100));
+    QVERIFY(region.contains(QRect(60, 60, 80, 80)));
+    QVERIFY(!region.contains(QRect(110, 0, 10, 10)));
+    QVERIFY(region.intersects(QRect(140, 140, 20, 20)));
+    QVERIFY(!region.intersects(QRect(110, 0, 10, 10)));
+
+    // The pieces are disjoint, the total area must match.
+    int area = 0;
+    for (const QRect &rect : region) {
+        area += rect.width() * rect.height();
+    }
+    QCOMPARE(area, 100 * 100 * 2 - 50 * 50);
+}
+
+void TestRegion::testSubtract()
+{
+    Region region(QRect(0, 0, 100, 100));
+    region.subtract(QRect(25, 25, 50, 50));
+    QCOMPARE(region.toQRegion(), QRegion(0, 0, 100, 100) - QRegion(25, 25, 50, 50));
+    QVERIFY(!region.intersects(QRect(30, 30, 10, 10)));
+
+    region.subtract(QRect(-10, -10, 200, 200));
+    QVERIFY(region.isEmpty());
+}
+
+void TestRegion::testIntersect()
+{
+    Region region(QRect(0, 0, 100, 100));
+    region.unite(QRect(200, 0, 100, 100));
+    region.intersect(QRect(50, 50, 200, 10));
+    QCOMPARE(region.toQRegion(), QRegion(50, 50, 50, 10) | QRegion(200, 50, 50, 10));
+    QCOMPARE(region.boundingRect(), QRect(50, 50, 200, 10));
+}
+
+void TestRegion::testTranslate()
+{
+    Region region(QRect(0, 0, 10, 10));
+    region.unite(QRect(20, 20, 10, 10));
+    region.translate(QPoint(5, -5));
+    QCOMPARE(region.toQRegion(), QRegion(5, -5, 10, 10) | QRegion(25, 15, 10, 10));
+    QCOMPARE(region.boundingRect(), QRect(5, -5, 30, 30));
+}
+
+void TestRegion::testRandom()
+{
+    // Compare against QRegion, which is assumed to be correct.
+    QRandomGenerator generator(42);
+    const QRect bounds(0, 0, 1920, 1080);
+
+    for (int iteration = 0; iteration < 200; ++iteration) {
+        Region region;
+        QRegion reference;
+        for (int i = 0; i < 40; ++i) {
+            const QRect rect = randomRect(&generator, bounds, 400);
+            switch (generator.bounded(4)) {
+            case 0:
+            case 1:
+                region.unite(rect);
+                reference += rect;
+                break;
+            case 2:
+                region.subtract(rect);
+                reference -= rect;
+                break;
+            case 3:
+                QCOMPARE(region.intersects(rect), reference.intersects(rect));
+                QCOMPARE(region.contains(rect), reference.intersected(rect) == QRegion(rect));
+                break;
+            }
+            QCOMPARE(region.toQRegion(), reference);
+            QCOMPARE(region.boundingRect(), reference.boundingRect());
+        }
+
+        const QRect clip = randomRect(&generator, bounds, 1000);
+        QCOMPARE(region.intersected(clip).toQRegion(), reference & clip);
+    }
+}
+
+static QList<DamageFrame> typingFrames()
+{
+    // A blinking cursor and a few glyphs in a text editor.
+    QList<DamageFrame> frames;
+    for (int i = 0; i < 60; ++i) {
+        frames.append(DamageFrame{
+            .damage = {QRect(400 + i * 9, 300, 9, 18), QRect(400 + (i + 1) * 9, 300, 2, 18)},
+            .opaque = {QRect(100, 100, 1200, 800)},
+        });
+    }
+    return frames;
+}
+
+static QList<DamageFrame> scrollingFrames()
+{
+    // A web browser scrolling, the whole view and the scroll bar change.
+    QList<DamageFrame> frames;
+    for (int i = 0; i < 60; ++i) {
+        frames.append(DamageFrame{
+            .damage = {QRect(0, 80, 1900, 1000), QRect(1900, 80 + i * 10, 20, 100)},
+            .opaque = {QRect(0, 0, 1920, 1080)},
+        });
+    }
+    return frames;
+}
+
+static QList<DamageFrame> videoFrames()
+{
+    // A video player with a progress bar, partially covered by a chat window.
+    QList<DamageFrame> frames;
+    for (int i = 0; i < 60; ++i) {
+        frames.append(DamageFrame{
+            .damage = {QRect(200, 150, 1280, 720), QRect(200, 880, 1280, 6), QRect(1300, 600, 400, 400)},
+            .opaque = {QRect(1300, 600, 400, 400), QRect(200, 150, 1280, 736)},
+        });
+    }
+    return frames;
+}
+
+static QList<DamageFrame> windowDragFrames()
+{
+    // A window being dragged, both the old and the new geometry are damaged.
+    QList<DamageFrame> frames;
+    for (int i = 0; i < 60; ++i) {
+        const QRect previous(100 + i * 12, 100 + i * 5, 800, 600);
+        const QRect current = previous.translated(12, 5);
+        frames.append(DamageFrame{
+            .damage = {previous, current, current.adjusted(-20, -20, 20, 20)},
+            .opaque = {current},
+        });
+    }
+    return frames;
+}
+
+static QList<DamageFrame> occlusionFrames()
+{
+    // A lot of stacked windows with small updates, most of them occluded.
+    QRandomGenerator generator(7);
+    const QRect bounds(0, 0, 2560, 1440);
+
+    QList<QRect> windows;
+    for (int i = 0; i < 20; ++i) {
+        windows.append(randomRect(&generator, bounds, 1000));
+    }
+
+    QList<DamageFrame> frames;
+    for (int i = 0; i < 60; ++i) {
+        DamageFrame frame;
+        for (const QRect &window : std::as_const(windows)) {
+            frame.damage.append(randomRect(&generator, window, std::min(window.width(), window.height()) / 2 + 2));
+            frame.opaque.append(window);
+        }
+        frames.append(frame);
+    }
+    return frames;
+}
+
+void TestRegion::benchmark_data()
+{
+    QTest::addColumn<QList<DamageFrame>>("frames");
+
+    QTest::addRow("typing") << typingFrames();
+    QTest::addRow("scrolling") << scrollingFrames();
+    QTest::addRow("video") << videoFrames();
+    QTest::addRow("window drag") << windowDragFrames();
+    QTest::addRow("occlusion") << occlusionFrames();
+}
+
+void TestRegion::benchmarkQRegion()
+{
+    QFETCH(QList<DamageFrame>, frames);
+
+    QBENCHMARK {
+        for (const DamageFrame &frame : std::as_const(frames)) {
+            QRegion damage;
+            QRegion opaque;
+            for (int i = frame.damage.size() - 1; i >= 0; --i) {
+                damage += QRegion(frame.damage[i]) - opaque;
+                if (i < frame.opaque.size()) {
+                    opaque += frame.opaque[i];
+                }
+            }
+        }
+    }
+}
+
+void TestRegion::benchmarkRegion()
+{
+    QFETCH(QList<DamageFrame>, frames);
+
+    QBENCHMARK {
+        for (const DamageFrame &frame : std::as_const(frames)) {
+            Region damage;
+            Region opaque;
+            for (int i = frame.damage.size() - 1; i >= 0; --i) {
+                damage.unite(Region(frame.damage[i]).subtracted(opaque));
+                if (i < frame.opaque.size()) {
+                    opaque.unite(frame.opaque[i]);
+                }
+            }
+            // The damage is handed over to the renderer as a QRegion.
+            const QRegion region = damage.toQRegion();
+            Q_UNUSED(region)
+        }
+    }
+}
+
+QTEST_GUILESS_MAIN(TestRegion)
+#include "test_region.moc"
@@ -0,0 +1,155 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "core/renderjournal.h"
+
+#include <random>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestRenderJournal : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testEmpty();
+    void testConstant();
+    void testMissRate_data();
+    void testMissRate();
+    void testStepChange();
+    void testGpuTime();
+};
+
+/**
+ * Generates a frame time trace with normally distributed durations and occasional spikes,
+ * which resembles what is recorded on a moderately loaded desktop.
+ */
+static QVector<std::chrono::nanoseconds> generateTrace(int count, double mean, double deviation, double spikeProbability = 0.0)
+{
+    std::mt19937 generator(42);
+    std::normal_distribution<double> normal(mean, deviation);
+    std::bernoulli_distribution spike(spikeProbability);
+
+    QVector<std::chrono::nanoseconds> trace;
+    trace.reserve(count);
+    for (int i = 0; i < count; ++i) {
+        double duration = std::max(0.0, normal(generator));
+        if (spike(generator)) {
+            duration *= 2;
+        }
+        trace.append(std::chrono::nanoseconds(std::llround(duration)));
+    }
+    return trace;
+}
+
+void TestRenderJournal::testEmpty()
+{
+    RenderJournal journal;
+    QCOMPARE(journal.estimate(0.01), 0ns);
+    QCOMPARE(journal.cpuTime(), 0ns);
+    QCOMPARE(journal.gpuTime(), 0ns);
+}
+
+void TestRenderJournal::testConstant()
+{
+    RenderJournal journal;
+    for (int i = 0; i < 100; ++i) {
+        journal.addCpuTime(4ms);
+    }
+    QCOMPARE(journal.cpuTime(), 4ms);
+    QCOMPARE(journal.estimate(0.01), 4ms);
+    QCOMPARE(journal.estimate(0.5), 4ms);
+}
+
+void TestRenderJournal::testMissRate_data()
+{
+    QTest::addColumn<double>("targetMissRate");
+    QTest::addColumn<double>("spikeProbability");
+
+    QTest::addRow("1%") << 0.01 << 0.0;
+    QTest::addRow("5%") << 0.05 << 0.0;
+    QTest::addRow("10%") << 0.1 << 0.0;
+    QTest::addRow("5% with spikes") << 0.05 << 0.01;
+}
+
+void TestRenderJournal::testMissRate()
+{
+    QFETCH(double, targetMissRate);
+    QFETCH(double, spikeProbability);
+
+    const QVector<std::chrono::nanoseconds> trace = generateTrace(5000, 5'000'000, 500'000, spikeProbability);
+
+    RenderJournal journal;
+    int misses = 0;
+    int predictions = 0;
+    for (int i = 0; i < trace.size(); ++i) {
+        // Skip the warm-up period, the estimate is not meaningful with only a couple of samples.
+        if (i >= 30) {
+            predictions++;
+            if (trace[i] > journal.estimate(targetMissRate)) {
+                misses++;
+            }
+        }
+        journal.addCpuTime(trace[i]);
+    }
+
+    // The variance is estimated from a short window, so allow some slack.
+    const double missRate = double(misses) / predictions;
+    QVERIFY2(missRate <= targetMissRate * 2 + spikeProbability, qPrintable(QString::number(missRate)));
+
+    // The estimate must not be needlessly pessimistic either.
+    QVERIFY(journal.estimate(targetMissRate) < 5ms + 500us * 4);
+}
+
+void TestRenderJournal::testStepChange()
+{
+    RenderJournal journal;
+    for (const std::chrono::nanoseconds &duration : generateTrace(200, 3'000'000, 200'000)) {
+        journal.addCpuTime(duration);
+    }
+    QVERIFY(journal.estimate(0.01) < 4ms);
+
+    // The scene got heavier, e.g. because a blur effect was enabled.
+    const QVector<std::chrono::nanoseconds> heavy = generateTrace(200, 8'000'000, 200'000);
+    for (int i = 0; i < 30; ++i) {
+        journal.addCpuTime(heavy[i]);
+    }
+    QVERIFY(journal.cpuTime() > 7500us);
+    QVERIFY(journal.estimate(0.01) > 8ms);
+
+    // Once the render time settles down, the deviation must shrink again.
+    for (int i = 30; i < heavy.size(); ++i) {
+        journal.addCpuTime(heavy[i]);
+    }
+    QVERIFY(journal.estimate(0.01) < 9ms);
+}
+
+void TestRenderJournal::testGpuTime()
+{
+    RenderJournal journal;
+    for (int i = 0; i < 100; ++i) {
+        journal.addCpuTime(2ms);
+    }
+    QCOMPARE(journal.estimate(0.01), 2ms);
+
+    for (int i = 0; i < 100; ++i) {
+        journal.addGpuTime(3ms);
+    }
+    QCOMPARE(journal.cpuTime(), 2ms);
+    QCOMPARE(journal.gpuTime(), 3ms);
+    QCOMPARE(journal.estimate(0.01), 5ms);
+
+    // The fixed window estimators only look at the CPU time.
+    QCOMPARE(journal.maximum(), 2ms);
+}
+
+QTEST_GUILESS_MAIN(TestRenderJournal)
+#include "test_renderjournal.moc"
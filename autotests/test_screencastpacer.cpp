@@ -0,0 +1,169 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include <QTest>
+
+#include "plugins/screencast/screencastpacer.h"
+
+#include <cmath>
+
+using namespace KWin;
+using namespace std::chrono_literals;
+
+class TestScreenCastPacer : public QObject
+{
+    Q_OBJECT
+private Q_SLOTS:
+    void testUnpaced();
+    void testStrictlyIncreasing();
+    void testAverageFrameRate_data();
+    void testAverageFrameRate();
+    void testFrameIntervalChange();
+    void testStall();
+};
+
+static std::chrono::nanoseconds intervalForRate(int rate)
+{
+    return std::chrono::nanoseconds(1'000'000'000 / rate);
+}
+
+/**
+ * Presents @a count frames at the given refresh @a interval starting at @a start, and returns
+ * the timestamps of the frames that the @a pacer has decided to record.
+ */
+static QVector<std::chrono::nanoseconds> present(ScreenCastPacer &pacer, std::chrono::nanoseconds start, std::chrono::nanoseconds interval, int count)
+{
+    QVector<std::chrono::nanoseconds> recorded;
+    for (int i = 0; i < count; ++i) {
+        const std::chrono::nanoseconds timestamp = start + interval * i;
+        if (pacer.shouldRecord(timestamp)) {
+            pacer.frameRecorded(timestamp);
+            recorded.append(timestamp);
+        }
+    }
+    return recorded;
+}
+
+static double averageFrameRate(const QVector<std::chrono::nanoseconds> &timestamps)
+{
+    const std::chrono::nanoseconds span = timestamps.last() - timestamps.first();
+    return (timestamps.count() - 1) * 1e9 / span.count();
+}
+
+void TestScreenCastPacer::testUnpaced()
+{
+    ScreenCastPacer pacer;
+    pacer.setRefreshInterval(intervalForRate(144));
+    QCOMPARE(pacer.frameInterval(), 0ns);
+
+    const auto recorded = present(pacer, 1s, intervalForRate(144), 144);
+    QCOMPARE(recorded.count(), 144);
+}
+
+void TestScreenCastPacer::testStrictlyIncreasing()
+{
+    ScreenCastPacer pacer;
+    pacer.setRefreshInterval(intervalForRate(144));
+    pacer.setFrameInterval(intervalForRate(30));
+
+    std::chrono::nanoseconds lastTimestamp = 0ns;
+    std::chrono::nanoseconds lastFrameTime = 0ns;
+    for (int i = 0; i < 1440; ++i) {
+        const std::chrono::nanoseconds timestamp = 1s + intervalForRate(144) * i;
+        if (!pacer.shouldRecord(timestamp)) {
+            continue;
+        }
+        pacer.frameRecorded(timestamp);
+        QVERIFY(timestamp > lastTimestamp);
+        QVERIFY(pacer.nextFrameTime() > lastFrameTime);
+        QVERIFY(pacer.nextFrameTime() > timestamp);
+        lastTimestamp = timestamp;
+        lastFrameTime = pacer.nextFrameTime();
+
+        // The same presentation must not be recorded twice.
+        QVERIFY(!pacer.shouldRecord(timestamp));
+    }
+}
+
+void TestScreenCastPacer::testAverageFrameRate_data()
+{
+    QTest::addColumn<int>("refreshRate");
+    QTest::addColumn<int>("frameRate");
+
+    QTest::addRow("144Hz at 30fps") << 144 << 30;
+    QTest::addRow("144Hz at 60fps") << 144 << 60;
+    QTest::addRow("165Hz at 60fps") << 165 << 60;
+    QTest::addRow("60Hz at 30fps") << 60 << 30;
+    QTest::addRow("60Hz at 24fps") << 60 << 24;
+    QTest::addRow("60Hz at 120fps") << 60 << 120;
+}
+
+void TestScreenCastPacer::testAverageFrameRate()
+{
+    QFETCH(int, refreshRate);
+    QFETCH(int, frameRate);
+
+    ScreenCastPacer pacer;
+    pacer.setRefreshInterval(intervalForRate(refreshRate));
+    pacer.setFrameInterval(intervalForRate(frameRate));
+
+    const auto recorded = present(pacer, 1s, intervalForRate(refreshRate), refreshRate * 10);
+    const double expected = std::min(refreshRate, frameRate);
+    QVERIFY2(std::abs(averageFrameRate(recorded) - expected) < expected * 0.01,
+             qPrintable(QStringLiteral("average frame rate %1").arg(averageFrameRate(recorded))));
+}
+
+void TestScreenCastPacer::testFrameIntervalChange()
+{
+    ScreenCastPacer pacer;
+    pacer.setRefreshInterval(intervalForRate(144));
+    pacer.setFrameInterval(intervalForRate(30));
+
+    const auto slow = present(pacer, 1s, intervalForRate(144), 1440);
+    QVERIFY(std::abs(averageFrameRate(slow) - 30) < 0.3);
+
+    // Setting the same interval again keeps the schedule.
+    const std::chrono::nanoseconds nextFrameTime = pacer.nextFrameTime();
+    pacer.setFrameInterval(intervalForRate(30));
+    QCOMPARE(pacer.nextFrameTime(), nextFrameTime);
+
+    // A new max framerate takes effect with the next presented frame.
+    pacer.setFrameInterval(intervalForRate(60));
+    QCOMPARE(pacer.frameInterval(), intervalForRate(60));
+    const std::chrono::nanoseconds start = 11s;
+    QVERIFY(pacer.shouldRecord(start));
+
+    const auto fast = present(pacer, start, intervalForRate(144), 1440);
+    QCOMPARE(fast.first(), start);
+    QVERIFY(std::abs(averageFrameRate(fast) - 60) < 0.6);
+
+    // Removing the limit records every frame.
+    pacer.setFrameInterval(0ns);
+    const auto unpaced = present(pacer, 21s, intervalForRate(144), 144);
+    QCOMPARE(unpaced.count(), 144);
+}
+
+void TestScreenCastPacer::testStall()
+{
+    ScreenCastPacer pacer;
+    pacer.setRefreshInterval(intervalForRate(60));
+    pacer.setFrameInterval(intervalForRate(30));
+
+    present(pacer, 1s, intervalForRate(60), 60);
+
+    // If nothing has been presented for a while, the next frame is recorded right away and
+    // the frames after it aren't recorded in a burst to catch up.
+    const auto recorded = present(pacer, 5s, intervalForRate(60), 60);
+    QCOMPARE(recorded.first(), std::chrono::nanoseconds(5s));
+    QCOMPARE(recorded.count(), 30);
+    QCOMPARE(pacer.deadline(), pacer.nextFrameTime() + intervalForRate(60) / 2);
+}
+
+QTEST_GUILESS_MAIN(TestScreenCastPacer)
+#include "test_screencastpacer.moc"
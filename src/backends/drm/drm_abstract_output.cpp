@@ -52,6 +52,16 @@ QVector<int32_t> DrmAbstractOutput::regionToRects(const QRegion &region) const
     return rects;
 }
 
+QVector<OutputLayer *> DrmAbstractOutput::overlayLayers() const
+{
+    return {};
+}
+
+bool DrmAbstractOutput::testOverlayLayers()
+{
+    return true;
+}
+
 DrmGpu *DrmAbstractOutput::gpu() const
 {
     return m_gpu;
@@ -16,6 +16,7 @@ namespace KWin
 class DrmBackend;
 class DrmGpu;
 class DrmOutputLayer;
+class OutputLayer;
 
 class DrmAbstractOutput : public Output
 {
@@ -32,6 +33,8 @@ public:
     virtual bool present() = 0;
     virtual DrmOutputLayer *primaryLayer() const = 0;
     virtual DrmOutputLayer *cursorLayer() const = 0;
+    virtual QVector<OutputLayer *> overlayLayers() const;
+    virtual bool testOverlayLayers();
 
     void updateEnabled(bool enabled);
 
@@ -11,6 +11,7 @@
 #include "drm_gpu.h"
 #include "drm_object.h"
 #include "drm_property.h"
+#include "frametimeline.h"
 
 namespace KWin
 {
@@ -44,11 +45,13 @@ bool DrmAtomicCommit::testAllowModeset()
 
 bool DrmAtomicCommit::commit()
 {
+    FrameTimelineScope timelineScope(FrameTimelineEvent::AtomicCommit, quintptr(this));
     return drmModeAtomicCommit(m_gpu->fd(), m_req.get(), DRM_MODE_ATOMIC_NONBLOCK | DRM_MODE_PAGE_FLIP_EVENT, m_gpu) == 0;
 }
 
 bool DrmAtomicCommit::commitModeset()
 {
+    FrameTimelineScope timelineScope(FrameTimelineEvent::AtomicCommit, quintptr(this));
     return drmModeAtomicCommit(m_gpu->fd(), m_req.get(), DRM_MODE_ATOMIC_ALLOW_MODESET, m_gpu) == 0;
 }
 
@@ -13,7 +13,9 @@
 #include "drm_gpu.h"
 #include "drm_logging.h"
 #include "drm_output.h"
+#include "drm_plane.h"
 #include "drm_pointer.h"
+#include <algorithm>
 #include <cerrno>
 
 namespace KWin
@@ -94,6 +96,23 @@ DrmPlane *DrmCrtc::cursorPlane() const
     return m_cursorPlane;
 }
 
+QVector<DrmPlane *> DrmCrtc::overlayPlanes() const
+{
+    return m_overlayPlanes;
+}
+
+void DrmCrtc::addOverlayPlane(DrmPlane *plane)
+{
+    m_overlayPlanes.push_back(plane);
+    const auto zpos = [](DrmPlane *plane) -> uint64_t {
+        const auto prop = plane->getProp(DrmPlane::PropertyIndex::Zpos);
+        return prop ? prop->current() : 0;
+    };
+    std::stable_sort(m_overlayPlanes.begin(), m_overlayPlanes.end(), [&zpos](DrmPlane *left, DrmPlane *right) {
+        return zpos(left) < zpos(right);
+    });
+}
+
 void DrmCrtc::disable(DrmAtomicCommit *commit)
 {
     commit->addProperty(getProp(PropertyIndex::Active), 0);
@@ -11,6 +11,7 @@
 #include "drm_object.h"
 
 #include <QPoint>
+#include <QVector>
 #include <memory>
 
 namespace KWin
@@ -45,6 +46,11 @@ public:
     int gammaRampSize() const;
     DrmPlane *primaryPlane() const;
     DrmPlane *cursorPlane() const;
+    /**
+     * The overlay planes that are reserved for this crtc, sorted by their zpos if available
+     */
+    QVector<DrmPlane *> overlayPlanes() const;
+    void addOverlayPlane(DrmPlane *plane);
     drmModeModeInfo queryCurrentMode();
 
     std::shared_ptr<DrmFramebuffer> current() const;
@@ -61,6 +67,7 @@ private:
     int m_pipeIndex;
     DrmPlane *m_primaryPlane;
     DrmPlane *m_cursorPlane;
+    QVector<DrmPlane *> m_overlayPlanes;
 };
 
 }
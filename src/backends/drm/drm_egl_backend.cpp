@@ -17,6 +17,7 @@
 #include "drm_dumb_swapchain.h"
 #include "drm_egl_cursor_layer.h"
 #include "drm_egl_layer.h"
+#include "drm_egl_overlay_layer.h"
 #include "drm_gbm_swapchain.h"
 #include "drm_gpu.h"
 #include "drm_logging.h"
@@ -227,6 +228,16 @@ OutputLayer *EglGbmBackend::cursorLayer(Output *output)
     return static_cast<DrmAbstractOutput *>(output)->cursorLayer();
 }
 
+QVector<OutputLayer *> EglGbmBackend::overlayLayers(Output *output)
+{
+    return static_cast<DrmAbstractOutput *>(output)->overlayLayers();
+}
+
+bool EglGbmBackend::testOverlayLayers(Output *output)
+{
+    return static_cast<DrmAbstractOutput *>(output)->testOverlayLayers();
+}
+
 std::shared_ptr<GLTexture> EglGbmBackend::textureForOutput(Output *output) const
 {
     const auto drmOutput = static_cast<DrmAbstractOutput *>(output);
@@ -266,6 +277,22 @@ std::shared_ptr<DrmOverlayLayer> EglGbmBackend::createCursorLayer(DrmPipeline *p
     return std::make_shared<EglGbmCursorLayer>(this, pipeline);
 }
 
+QVector<std::shared_ptr<DrmOverlayPlaneLayer>> EglGbmBackend::createOverlayLayers(DrmPipeline *pipeline)
+{
+    // overlay planes have lots of hardware specific restrictions, only use them when asked to
+    static bool ok = false;
+    static const bool enabled = qEnvironmentVariableIntValue("KWIN_DRM_USE_OVERLAYS", &ok) == 1 && ok;
+    if (!enabled || !pipeline->gpu()->atomicModeSetting()) {
+        return {};
+    }
+    QVector<std::shared_ptr<DrmOverlayPlaneLayer>> ret;
+    const int count = pipeline->gpu()->maxOverlayPlaneCount();
+    for (int i = 0; i < count; i++) {
+        ret.push_back(std::make_shared<EglGbmOverlayLayer>(pipeline, i));
+    }
+    return ret;
+}
+
 std::shared_ptr<DrmOutputLayer> EglGbmBackend::createLayer(DrmVirtualOutput *output)
 {
     return std::make_shared<VirtualEglGbmLayer>(this, output);
@@ -64,11 +64,14 @@ public:
     void present(Output *output) override;
     OutputLayer *primaryLayer(Output *output) override;
     OutputLayer *cursorLayer(Output *output) override;
+    QVector<OutputLayer *> overlayLayers(Output *output) override;
+    bool testOverlayLayers(Output *output) override;
 
     void init() override;
     bool prefer10bpc() const override;
     std::shared_ptr<DrmPipelineLayer> createPrimaryLayer(DrmPipeline *pipeline) override;
     std::shared_ptr<DrmOverlayLayer> createCursorLayer(DrmPipeline *pipeline) override;
+    QVector<std::shared_ptr<DrmOverlayPlaneLayer>> createOverlayLayers(DrmPipeline *pipeline) override;
     std::shared_ptr<DrmOutputLayer> createLayer(DrmVirtualOutput *output) override;
 
     std::shared_ptr<GLTexture> textureForOutput(Output *requestedOutput) const override;
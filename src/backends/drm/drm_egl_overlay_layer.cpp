@@ -0,0 +1,137 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#include "drm_egl_overlay_layer.h"
+#include "drm_backend.h"
+#include "drm_buffer_gbm.h"
+#include "drm_gpu.h"
+#include "drm_output.h"
+#include "drm_pipeline.h"
+#include "scene/surfaceitem_wayland.h"
+#include "wayland/linuxdmabufv1clientbuffer.h"
+#include "wayland/surface_interface.h"
+
+#include <cmath>
+#include <drm_fourcc.h>
+
+namespace KWin
+{
+
+EglGbmOverlayLayer::EglGbmOverlayLayer(DrmPipeline *pipeline, int planeIndex)
+    : DrmOverlayPlaneLayer(pipeline, planeIndex)
+{
+}
+
+std::optional<OutputLayerBeginFrameInfo> EglGbmOverlayLayer::beginFrame()
+{
+    // overlay planes are only used for direct scanout of client buffers
+    return std::nullopt;
+}
+
+bool EglGbmOverlayLayer::endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion)
+{
+    return false;
+}
+
+bool EglGbmOverlayLayer::scanout(SurfaceItem *surfaceItem)
+{
+    m_scanoutBuffer.reset();
+    setEnabled(false);
+
+    SurfaceItemWayland *item = qobject_cast<SurfaceItemWayland *>(surfaceItem);
+    if (!item || !item->surface()) {
+        return false;
+    }
+    DrmPlane *plane = m_pipeline->overlayPlane(m_planeIndex);
+    DrmOutput *output = m_pipeline->output();
+    if (!plane || !output || !m_pipeline->primaryLayer()->currentBuffer()) {
+        return false;
+    }
+    // hardware rotation isn't supported for overlay planes yet
+    const auto surface = item->surface();
+    if (output->transform() != Output::Transform::Normal || surface->bufferTransform() != Output::Transform::Normal) {
+        return false;
+    }
+    const auto buffer = qobject_cast<KWaylandServer::LinuxDmaBufV1ClientBuffer *>(surface->buffer());
+    if (!buffer) {
+        return false;
+    }
+
+    const auto formats = plane->formats();
+    if (!formats.contains(buffer->format())) {
+        return false;
+    }
+    if (buffer->attributes().modifier == DRM_FORMAT_MOD_INVALID && m_pipeline->gpu()->platform()->gpuCount() > 1) {
+        // importing a buffer from another GPU without an explicit modifier can mess up the buffer format
+        return false;
+    }
+    if (!formats[buffer->format()].contains(buffer->attributes().modifier)) {
+        return false;
+    }
+
+    const QRectF logicalRect = surfaceItem->mapToGlobal(surfaceItem->rect()).translated(-output->geometry().topLeft());
+    const qreal scale = output->scale();
+    const QRect targetRect = QRectF(QPointF(std::round(logicalRect.left() * scale), std::round(logicalRect.top() * scale)),
+                                    QPointF(std::round(logicalRect.right() * scale), std::round(logicalRect.bottom() * scale)))
+                                 .toRect();
+    const QRect sourceRect = surfaceItem->surfaceToBufferMatrix().mapRect(surfaceItem->rect()).toAlignedRect();
+    if (targetRect.isEmpty() || !QRect(QPoint(), m_pipeline->mode()->size()).contains(targetRect)) {
+        return false;
+    }
+    if (sourceRect.isEmpty() || !QRect(QPoint(), buffer->size()).contains(sourceRect)) {
+        return false;
+    }
+
+    const auto gbmBuffer = GbmBuffer::importBuffer(m_pipeline->gpu(), buffer);
+    if (!gbmBuffer) {
+        return false;
+    }
+    m_scanoutBuffer = DrmFramebuffer::createFramebuffer(gbmBuffer);
+    if (!m_scanoutBuffer) {
+        return false;
+    }
+    // the layer is only tested once the primary layer has rendered the buffer it will
+    // be presented with, see DrmOutput::testOverlayLayers()
+    m_sourceRect = sourceRect;
+    m_targetRect = targetRect;
+    m_currentDamage = surfaceItem->damage();
+    setEnabled(true);
+    return true;
+}
+
+bool EglGbmOverlayLayer::checkTestBuffer()
+{
+    return m_scanoutBuffer != nullptr;
+}
+
+std::shared_ptr<DrmFramebuffer> EglGbmOverlayLayer::currentBuffer() const
+{
+    return m_scanoutBuffer;
+}
+
+bool EglGbmOverlayLayer::hasDirectScanoutBuffer() const
+{
+    return m_scanoutBuffer != nullptr;
+}
+
+QRegion EglGbmOverlayLayer::currentDamage() const
+{
+    return m_currentDamage;
+}
+
+void EglGbmOverlayLayer::releaseBuffers()
+{
+    m_scanoutBuffer.reset();
+    setEnabled(false);
+}
+
+quint32 EglGbmOverlayLayer::format() const
+{
+    return m_scanoutBuffer ? m_scanoutBuffer->buffer()->format() : DRM_FORMAT_XRGB8888;
+}
+}
@@ -0,0 +1,38 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+#pragma once
+#include "drm_layer.h"
+
+#include <QRegion>
+#include <optional>
+
+namespace KWin
+{
+
+class EglGbmOverlayLayer : public DrmOverlayPlaneLayer
+{
+public:
+    EglGbmOverlayLayer(DrmPipeline *pipeline, int planeIndex);
+
+    std::optional<OutputLayerBeginFrameInfo> beginFrame() override;
+    bool endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion) override;
+    bool scanout(SurfaceItem *surfaceItem) override;
+    bool checkTestBuffer() override;
+    std::shared_ptr<DrmFramebuffer> currentBuffer() const override;
+    bool hasDirectScanoutBuffer() const override;
+    QRegion currentDamage() const override;
+    void releaseBuffers() override;
+    quint32 format() const override;
+
+private:
+    std::shared_ptr<DrmFramebuffer> m_scanoutBuffer;
+    QRegion m_currentDamage;
+};
+
+}
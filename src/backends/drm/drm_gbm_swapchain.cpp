@@ -31,6 +31,7 @@ GbmSwapchain::GbmSwapchain(DrmGpu *gpu, gbm_bo *initialBuffer, uint32_t flags)
     , m_flags(flags)
     , m_buffers({std::make_pair(initialBuffer, 0)})
 {
+    m_damageJournal.setMode(DamageJournal::Mode::Coarse);
 }
 
 GbmSwapchain::~GbmSwapchain()
@@ -214,6 +214,37 @@ void DrmGpu::initDrmResources()
         m_allObjects << crtc.get();
         m_crtcs.push_back(std::move(crtc));
     }
+
+    // distribute the overlay planes between the crtcs that can use them
+    for (const auto &plane : m_planes) {
+        if (plane->type() != DrmPlane::TypeIndex::Overlay) {
+            continue;
+        }
+        const uint64_t currentCrtc = plane->getProp(DrmPlane::PropertyIndex::CrtcId)->current();
+        DrmCrtc *bestCrtc = nullptr;
+        for (const auto &crtc : m_crtcs) {
+            if (!plane->isCrtcSupported(crtc->pipeIndex())) {
+                continue;
+            }
+            if (const auto primaryZpos = crtc->primaryPlane()->getProp(DrmPlane::PropertyIndex::Zpos)) {
+                // planes below the primary plane can't be used for overlays
+                const auto zpos = plane->getProp(DrmPlane::PropertyIndex::Zpos);
+                if (zpos && zpos->current() <= primaryZpos->current()) {
+                    continue;
+                }
+            }
+            // don't take away planes from other crtcs. The kernel currently rejects such commits
+            if (currentCrtc == crtc->id()) {
+                bestCrtc = crtc.get();
+                break;
+            } else if (currentCrtc == 0 && (!bestCrtc || crtc->overlayPlanes().size() < bestCrtc->overlayPlanes().size())) {
+                bestCrtc = crtc.get();
+            }
+        }
+        if (bestCrtc) {
+            bestCrtc->addOverlayPlane(plane.get());
+        }
+    }
 }
 
 bool DrmGpu::updateOutputs()
@@ -280,7 +311,7 @@ bool DrmGpu::updateOutputs()
             m_drmOutputs << output;
             addedOutputs << output;
             Q_EMIT outputAdded(output);
-            pipeline->setLayers(m_platform->renderBackend()->createPrimaryLayer(pipeline), m_platform->renderBackend()->createCursorLayer(pipeline));
+            pipeline->setLayers(m_platform->renderBackend()->createPrimaryLayer(pipeline), m_platform->renderBackend()->createCursorLayer(pipeline), m_platform->renderBackend()->createOverlayLayers(pipeline));
             pipeline->setActive(!conn->isNonDesktop());
             pipeline->applyPendingChanges();
         }
@@ -759,6 +790,10 @@ QVector<DrmObject *> DrmGpu::unusedObjects() const
             ret.removeOne(pipeline->crtc());
             ret.removeOne(pipeline->crtc()->primaryPlane());
             ret.removeOne(pipeline->crtc()->cursorPlane());
+            const auto overlayPlanes = pipeline->crtc()->overlayPlanes();
+            for (DrmPlane *plane : overlayPlanes) {
+                ret.removeOne(plane);
+            }
         }
     }
     return ret;
@@ -769,6 +804,15 @@ QSize DrmGpu::cursorSize() const
     return m_cursorSize;
 }
 
+int DrmGpu::maxOverlayPlaneCount() const
+{
+    int ret = 0;
+    for (const auto &crtc : m_crtcs) {
+        ret = std::max<int>(ret, crtc->overlayPlanes().size());
+    }
+    return ret;
+}
+
 void DrmGpu::releaseBuffers()
 {
     for (const auto &plane : std::as_const(m_planes)) {
@@ -780,6 +824,10 @@ void DrmGpu::releaseBuffers()
     for (const auto &pipeline : std::as_const(m_pipelines)) {
         pipeline->primaryLayer()->releaseBuffers();
         pipeline->cursorLayer()->releaseBuffers();
+        const auto overlayLayers = pipeline->overlayLayers();
+        for (DrmOverlayPlaneLayer *layer : overlayLayers) {
+            layer->releaseBuffers();
+        }
     }
     for (const auto &output : std::as_const(m_virtualOutputs)) {
         output->primaryLayer()->releaseBuffers();
@@ -789,7 +837,7 @@ void DrmGpu::releaseBuffers()
 void DrmGpu::recreateSurfaces()
 {
     for (const auto &pipeline : std::as_const(m_pipelines)) {
-        pipeline->setLayers(m_platform->renderBackend()->createPrimaryLayer(pipeline), m_platform->renderBackend()->createCursorLayer(pipeline));
+        pipeline->setLayers(m_platform->renderBackend()->createPrimaryLayer(pipeline), m_platform->renderBackend()->createCursorLayer(pipeline), m_platform->renderBackend()->createOverlayLayers(pipeline));
         pipeline->applyPendingChanges();
     }
     for (const auto &output : std::as_const(m_virtualOutputs)) {
@@ -84,6 +84,10 @@ public:
      */
     clockid_t presentationClock() const;
     QSize cursorSize() const;
+    /**
+     * Returns the highest number of overlay planes that are available to a single crtc
+     */
+    int maxOverlayPlaneCount() const;
 
     QVector<DrmVirtualOutput *> virtualOutputs() const;
     QVector<DrmOutput *> drmOutputs() const;
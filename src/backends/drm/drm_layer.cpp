@@ -66,4 +66,27 @@ bool DrmOverlayLayer::isVisible() const
 {
     return m_visible;
 }
+
+DrmOverlayPlaneLayer::DrmOverlayPlaneLayer(DrmPipeline *pipeline, int planeIndex)
+    : DrmPipelineLayer(pipeline)
+    , m_planeIndex(planeIndex)
+{
+    // overlay planes are only shown when a surface gets assigned to them
+    setEnabled(false);
+}
+
+int DrmOverlayPlaneLayer::planeIndex() const
+{
+    return m_planeIndex;
+}
+
+QRect DrmOverlayPlaneLayer::sourceRect() const
+{
+    return m_sourceRect;
+}
+
+QRect DrmOverlayPlaneLayer::targetRect() const
+{
+    return m_targetRect;
+}
 }
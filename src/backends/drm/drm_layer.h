@@ -60,4 +60,32 @@ protected:
     QPoint m_position;
     bool m_visible = false;
 };
+
+/**
+ * A layer that directly shows a client buffer on one of the overlay planes of the crtc,
+ * without going through composition
+ */
+class DrmOverlayPlaneLayer : public DrmPipelineLayer
+{
+public:
+    DrmOverlayPlaneLayer(DrmPipeline *pipeline, int planeIndex);
+
+    /**
+     * the index of the overlay plane in DrmCrtc::overlayPlanes() this layer is shown on
+     */
+    int planeIndex() const;
+    /**
+     * the part of the buffer that's shown, in buffer pixels
+     */
+    QRect sourceRect() const;
+    /**
+     * where the buffer is shown, in crtc pixels
+     */
+    QRect targetRect() const;
+
+protected:
+    const int m_planeIndex;
+    QRect m_sourceRect;
+    QRect m_targetRect;
+};
 }
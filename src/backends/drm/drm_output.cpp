@@ -467,6 +467,28 @@ DrmOutputLayer *DrmOutput::cursorLayer() const
     return m_pipeline->cursorLayer();
 }
 
+QVector<OutputLayer *> DrmOutput::overlayLayers() const
+{
+    const auto layers = m_pipeline->overlayLayers();
+    return QVector<OutputLayer *>(layers.begin(), layers.end());
+}
+
+bool DrmOutput::testOverlayLayers()
+{
+    const auto layers = m_pipeline->overlayLayers();
+    const bool overlaysEnabled = std::any_of(layers.begin(), layers.end(), [](DrmOverlayPlaneLayer *layer) {
+        return layer->isEnabled();
+    });
+    if (!overlaysEnabled) {
+        return true;
+    }
+    // the test commit has to contain the buffer that will actually be presented on the primary plane
+    if (!m_pipeline->primaryLayer()->currentBuffer()) {
+        return false;
+    }
+    return m_pipeline->testScanout();
+}
+
 bool DrmOutput::setGammaRamp(const std::shared_ptr<ColorTransformation> &transformation)
 {
     if (!m_pipeline->active()) {
@@ -44,6 +44,8 @@ public:
     bool present() override;
     DrmOutputLayer *primaryLayer() const override;
     DrmOutputLayer *cursorLayer() const override;
+    QVector<OutputLayer *> overlayLayers() const override;
+    bool testOverlayLayers() override;
 
     bool queueChanges(const std::shared_ptr<OutputChangeSet> &properties);
     void applyQueuedChanges(const std::shared_ptr<OutputChangeSet> &properties);
@@ -222,6 +222,21 @@ bool DrmPipeline::prepareAtomicPresentation(DrmAtomicCommit *commit)
         commit->addProperty(plane->getProp(DrmPlane::PropertyIndex::CrtcId), layer->isVisible() ? m_pending.crtc->id() : 0);
         commit->addProperty(plane->getProp(DrmPlane::PropertyIndex::FbId), layer->isVisible() ? layer->currentBuffer()->framebufferId() : 0);
     }
+
+    const auto overlayPlanes = m_pending.crtc->overlayPlanes();
+    for (int i = 0; i < overlayPlanes.size(); i++) {
+        DrmPlane *plane = overlayPlanes[i];
+        const auto layer = overlayLayer(i);
+        if (layer && layer->isEnabled() && layer->currentBuffer()) {
+            const QRect source = layer->sourceRect();
+            plane->set(commit, source.topLeft(), source.size(), layer->targetRect());
+            commit->addProperty(plane->getProp(DrmPlane::PropertyIndex::CrtcId), m_pending.crtc->id());
+            commit->addProperty(plane->getProp(DrmPlane::PropertyIndex::FbId), layer->currentBuffer()->framebufferId());
+        } else {
+            commit->addProperty(plane->getProp(DrmPlane::PropertyIndex::CrtcId), 0);
+            commit->addProperty(plane->getProp(DrmPlane::PropertyIndex::FbId), 0);
+        }
+    }
     return true;
 }
 
@@ -234,6 +249,10 @@ void DrmPipeline::prepareAtomicDisable(DrmAtomicCommit *commit)
         if (auto cursor = m_pending.crtc->cursorPlane()) {
             cursor->disable(commit);
         }
+        const auto overlayPlanes = m_pending.crtc->overlayPlanes();
+        for (DrmPlane *plane : overlayPlanes) {
+            plane->disable(commit);
+        }
     }
 }
 
@@ -280,6 +299,12 @@ void DrmPipeline::prepareAtomicModeset(DrmAtomicCommit *commit)
             commit->addEnum(rotation, DrmPlane::Transformation::Rotate0);
         }
     }
+    const auto overlayPlanes = m_pending.crtc->overlayPlanes();
+    for (DrmPlane *plane : overlayPlanes) {
+        if (const auto rotation = plane->getProp(DrmPlane::PropertyIndex::Rotation)) {
+            commit->addEnum(rotation, DrmPlane::Transformation::Rotate0);
+        }
+    }
 }
 
 void DrmPipeline::checkHardwareRotation()
@@ -334,6 +359,11 @@ void DrmPipeline::atomicCommitSuccessful()
         if (m_pending.crtc->cursorPlane()) {
             m_pending.crtc->cursorPlane()->setNext(cursorLayer()->currentBuffer());
         }
+        const auto overlayPlanes = m_pending.crtc->overlayPlanes();
+        for (int i = 0; i < overlayPlanes.size(); i++) {
+            const auto layer = overlayLayer(i);
+            overlayPlanes[i]->setNext(layer && layer->isEnabled() ? layer->currentBuffer() : nullptr);
+        }
     }
     m_current = m_pending;
 }
@@ -421,6 +451,10 @@ void DrmPipeline::pageFlipped(std::chrono::nanoseconds timestamp)
     if (m_current.crtc->cursorPlane()) {
         m_current.crtc->cursorPlane()->flipBuffer();
     }
+    const auto overlayPlanes = m_current.crtc->overlayPlanes();
+    for (DrmPlane *plane : overlayPlanes) {
+        plane->flipBuffer();
+    }
     m_pageflipPending = false;
     if (m_output) {
         m_output->pageFlipped(timestamp);
@@ -556,6 +590,32 @@ DrmOverlayLayer *DrmPipeline::cursorLayer() const
     return m_pending.cursorLayer.get();
 }
 
+QVector<DrmOverlayPlaneLayer *> DrmPipeline::overlayLayers() const
+{
+    QVector<DrmOverlayPlaneLayer *> ret;
+    ret.reserve(m_pending.overlayLayers.size());
+    for (const auto &layer : m_pending.overlayLayers) {
+        ret.push_back(layer.get());
+    }
+    return ret;
+}
+
+DrmOverlayPlaneLayer *DrmPipeline::overlayLayer(int planeIndex) const
+{
+    const auto it = std::find_if(m_pending.overlayLayers.begin(), m_pending.overlayLayers.end(), [planeIndex](const auto &layer) {
+        return layer->planeIndex() == planeIndex;
+    });
+    return it == m_pending.overlayLayers.end() ? nullptr : it->get();
+}
+
+DrmPlane *DrmPipeline::overlayPlane(int index) const
+{
+    if (!m_pending.crtc || index >= m_pending.crtc->overlayPlanes().size()) {
+        return nullptr;
+    }
+    return m_pending.crtc->overlayPlanes()[index];
+}
+
 DrmPlane::Transformations DrmPipeline::renderOrientation() const
 {
     return m_pending.renderOrientation;
@@ -614,10 +674,11 @@ void DrmPipeline::setEnable(bool enable)
     m_pending.enabled = enable;
 }
 
-void DrmPipeline::setLayers(const std::shared_ptr<DrmPipelineLayer> &primaryLayer, const std::shared_ptr<DrmOverlayLayer> &cursorLayer)
+void DrmPipeline::setLayers(const std::shared_ptr<DrmPipelineLayer> &primaryLayer, const std::shared_ptr<DrmOverlayLayer> &cursorLayer, const QVector<std::shared_ptr<DrmOverlayPlaneLayer>> &overlayLayers)
 {
     m_pending.layer = primaryLayer;
     m_pending.cursorLayer = cursorLayer;
+    m_pending.overlayLayers = overlayLayers;
 }
 
 void DrmPipeline::setRenderOrientation(DrmPlane::Transformations orientation)
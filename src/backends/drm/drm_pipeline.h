@@ -33,6 +33,7 @@ class GammaRamp;
 class DrmConnectorMode;
 class DrmPipelineLayer;
 class DrmOverlayLayer;
+class DrmOverlayPlaneLayer;
 
 class DrmGammaRamp
 {
@@ -106,6 +107,11 @@ public:
     bool enabled() const;
     DrmPipelineLayer *primaryLayer() const;
     DrmOverlayLayer *cursorLayer() const;
+    QVector<DrmOverlayPlaneLayer *> overlayLayers() const;
+    /**
+     * @returns the overlay plane of the crtc with index @p index, or @c nullptr if there is none
+     */
+    DrmPlane *overlayPlane(int index) const;
     DrmPlane::Transformations renderOrientation() const;
     DrmPlane::Transformations bufferOrientation() const;
     RenderLoopPrivate::SyncMode syncMode() const;
@@ -117,7 +123,7 @@ public:
     void setMode(const std::shared_ptr<DrmConnectorMode> &mode);
     void setActive(bool active);
     void setEnable(bool enable);
-    void setLayers(const std::shared_ptr<DrmPipelineLayer> &primaryLayer, const std::shared_ptr<DrmOverlayLayer> &cursorLayer);
+    void setLayers(const std::shared_ptr<DrmPipelineLayer> &primaryLayer, const std::shared_ptr<DrmOverlayLayer> &cursorLayer, const QVector<std::shared_ptr<DrmOverlayPlaneLayer>> &overlayLayers = {});
     void setRenderOrientation(DrmPlane::Transformations orientation);
     void setBufferOrientation(DrmPlane::Transformations orientation);
     void setSyncMode(RenderLoopPrivate::SyncMode mode);
@@ -138,6 +144,7 @@ public:
 
 private:
     bool isBufferForDirectScanout() const;
+    DrmOverlayPlaneLayer *overlayLayer(int planeIndex) const;
     uint32_t calculateUnderscan();
     static Error errnoToError();
     void checkHardwareRotation();
@@ -182,6 +189,7 @@ private:
 
         std::shared_ptr<DrmPipelineLayer> layer;
         std::shared_ptr<DrmOverlayLayer> cursorLayer;
+        QVector<std::shared_ptr<DrmOverlayPlaneLayer>> overlayLayers;
         QPoint cursorHotspot;
 
         // the transformation that this pipeline will apply to submitted buffers
@@ -37,6 +37,7 @@ DrmPlane::DrmPlane(DrmGpu *gpu, uint32_t planeId)
                                   PropertyDefinition(QByteArrayLiteral("CRTC_ID"), Requirement::Required),
                                   PropertyDefinition(QByteArrayLiteral("rotation"), Requirement::Optional, {QByteArrayLiteral("rotate-0"), QByteArrayLiteral("rotate-90"), QByteArrayLiteral("rotate-180"), QByteArrayLiteral("rotate-270"), QByteArrayLiteral("reflect-x"), QByteArrayLiteral("reflect-y")}),
                                   PropertyDefinition(QByteArrayLiteral("IN_FORMATS"), Requirement::Optional),
+                                  PropertyDefinition(QByteArrayLiteral("zpos"), Requirement::Optional),
                               },
                 DRM_MODE_OBJECT_PLANE)
 {
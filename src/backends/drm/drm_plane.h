@@ -43,6 +43,7 @@ public:
         CrtcId,
         Rotation,
         In_Formats,
+        Zpos,
         Count
     };
     Q_ENUM(PropertyIndex)
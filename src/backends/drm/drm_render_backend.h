@@ -8,6 +8,8 @@
 */
 #pragma once
 
+#include <QVector>
+
 #include <memory>
 
 namespace KWin
@@ -18,6 +20,7 @@ class DrmVirtualOutput;
 class DrmPipeline;
 class DrmOutputLayer;
 class DrmOverlayLayer;
+class DrmOverlayPlaneLayer;
 
 class DrmRenderBackend
 {
@@ -26,6 +29,10 @@ public:
 
     virtual std::shared_ptr<DrmPipelineLayer> createPrimaryLayer(DrmPipeline *pipeline) = 0;
     virtual std::shared_ptr<DrmOverlayLayer> createCursorLayer(DrmPipeline *pipeline) = 0;
+    virtual QVector<std::shared_ptr<DrmOverlayPlaneLayer>> createOverlayLayers(DrmPipeline *pipeline)
+    {
+        return {};
+    }
     virtual std::shared_ptr<DrmOutputLayer> createLayer(DrmVirtualOutput *output) = 0;
 };
 
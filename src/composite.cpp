@@ -21,6 +21,7 @@
 #include "dbusinterface.h"
 #include "decorations/decoratedclient.h"
 #include "effects.h"
+#include "frametimeline.h"
 #include "ftrace.h"
 #include "internalwindow.h"
 #include "platformsupport/scenes/opengl/openglbackend.h"
@@ -34,6 +35,7 @@
 #include "shadow.h"
 #include "useractions.h"
 #include "utils/common.h"
+#include "utils/region.h"
 #include "utils/xcbutils.h"
 #include "wayland/surface_interface.h"
 #include "wayland_server.h"
@@ -41,8 +43,10 @@
 #include "x11syncmanager.h"
 #include "x11window.h"
 
+#include "libkwineffects/glrendertimequery.h"
 #include "libkwineffects/kwinglplatform.h"
 #include "libkwineffects/kwingltexture.h"
+#include "libkwineffects/kwingltexturepool.h"
 
 #include <KCrash>
 #include <KGlobalAccel>
@@ -64,6 +68,7 @@
 #include <xcb/composite.h>
 #include <xcb/damage.h>
 
+#include <cmath>
 #include <cstdio>
 
 Q_DECLARE_METATYPE(KWin::X11Compositor::SuspendReason)
@@ -137,6 +142,12 @@ Compositor::Compositor(QObject *workspace)
     connect(&m_unusedSupportPropertyTimer, &QTimer::timeout,
             this, &Compositor::deleteUnusedSupportProperties);
 
+    // Pooled textures that haven't been reused for this long are given back to the driver.
+    m_texturePoolTrimTimer.setInterval(10000);
+    m_texturePoolTrimTimer.setSingleShot(true);
+    connect(&m_texturePoolTrimTimer, &QTimer::timeout,
+            this, &Compositor::trimTexturePool);
+
     // Delay the call to start by one event cycle.
     // The ctor of this class is invoked from the Workspace ctor, that means before
     // Workspace is completely constructed, so calling Workspace::self() would result
@@ -149,6 +160,7 @@ Compositor::Compositor(QObject *workspace)
     // register DBus
     new CompositorDBusInterface(this);
     FTraceLogger::create();
+    FrameTimeline::create(this);
 }
 
 Compositor::~Compositor()
@@ -465,6 +477,14 @@ void Compositor::addSuperLayer(RenderLayer *layer)
 void Compositor::removeSuperLayer(RenderLayer *layer)
 {
     m_superlayers.remove(layer->loop());
+    m_overlayRegions.remove(layer->loop());
+    if (auto it = m_renderTimeQueries.find(layer->loop()); it != m_renderTimeQueries.end()) {
+        if (it->second) {
+            // timer queries need a context current for destruction
+            static_cast<OpenGLBackend *>(m_backend.get())->makeCurrent();
+        }
+        m_renderTimeQueries.erase(it);
+    }
     disconnect(layer->loop(), &RenderLoop::frameRequested, this, &Compositor::handleFrameRequested);
     delete layer;
 }
@@ -485,6 +505,7 @@ void Compositor::stop()
     Q_EMIT aboutToToggleCompositing();
 
     m_releaseSelectionTimer.start();
+    m_texturePoolTrimTimer.stop();
 
     // Some effects might need access to effect windows when they are about to
     // be destroyed, for example to unreference deleted windows, so we have to
@@ -597,6 +618,15 @@ void Compositor::reinitialize()
     }
 }
 
+void Compositor::trimTexturePool()
+{
+    if (!m_scene || !m_scene->makeOpenGLContextCurrent()) {
+        return;
+    }
+    GLTexturePool::trimIdle(std::chrono::milliseconds(m_texturePoolTrimTimer.interval()));
+    m_scene->doneOpenGLContextCurrent();
+}
+
 void Compositor::handleFrameRequested(RenderLoop *renderLoop)
 {
     composite(renderLoop);
@@ -622,9 +652,13 @@ void Compositor::composite(RenderLoop *renderLoop)
     Output *output = findOutput(renderLoop);
     OutputLayer *primaryLayer = m_backend->primaryLayer(output);
     fTraceDuration("Paint (", output->name(), ")");
+    FrameTimelineScope timelineScope(FrameTimelineEvent::Composite, quintptr(renderLoop));
 
     RenderLayer *superLayer = m_superlayers[renderLoop];
-    prePaintPass(superLayer);
+    {
+        FrameTimelineScope prePaintScope(FrameTimelineEvent::PrePaint, quintptr(renderLoop));
+        prePaintPass(superLayer);
+    }
     superLayer->setOutputLayer(primaryLayer);
 
     SurfaceItem *scanoutCandidate = superLayer->delegate()->scanoutCandidate();
@@ -643,18 +677,61 @@ void Compositor::composite(RenderLoop *renderLoop)
         }
     }
 
+    const auto overlayLayers = m_backend->overlayLayers(output);
+    for (OutputLayer *overlayLayer : overlayLayers) {
+        overlayLayer->setEnabled(false);
+    }
+
     if (!directScanout) {
-        QRegion surfaceDamage = primaryLayer->repaints();
+        QVector<SurfaceItem *> overlayItems;
+        QRegion overlayRegion = assignOverlayLayers(output, superLayer, &overlayItems);
+
+        Region accumulatedDamage(primaryLayer->repaints());
         primaryLayer->resetRepaints();
-        preparePaintPass(superLayer, &surfaceDamage);
+        preparePaintPass(superLayer, &accumulatedDamage);
+        const QRegion accumulatedSurfaceDamage = accumulatedDamage.toQRegion();
 
-        if (auto beginInfo = primaryLayer->beginFrame()) {
+        while (auto beginInfo = primaryLayer->beginFrame()) {
             auto &[renderTarget, repaint] = beginInfo.value();
 
-            const QRegion bufferDamage = surfaceDamage.united(repaint).intersected(superLayer->rect().toAlignedRect());
+            // The contents below overlay planes are not painted. Once a surface leaves its
+            // overlay plane, the area it covered has to be repainted.
+            const QRegion surfaceDamage = accumulatedSurfaceDamage.united(m_overlayRegions.value(renderLoop) - overlayRegion) - overlayRegion;
+            const QRegion bufferDamage = surfaceDamage.united(repaint).intersected(superLayer->rect().toAlignedRect()) - overlayRegion;
+
+            GLRenderTimeQuery *query = renderTimeQuery(renderLoop);
+            if (query) {
+                while (const auto renderTime = query->takeResult()) {
+                    renderLoop->addGpuRenderTime(*renderTime);
+                }
+                query->begin();
+            }
 
             paintPass(superLayer, renderTarget, bufferDamage);
+
+            if (query) {
+                query->end();
+            }
             primaryLayer->endFrame(bufferDamage, surfaceDamage);
+
+            if (overlayRegion.isEmpty() || m_backend->testOverlayLayers(output)) {
+                m_overlayRegions[renderLoop] = overlayRegion;
+                for (SurfaceItem *surfaceItem : std::as_const(overlayItems)) {
+                    surfaceItem->resetDamage();
+                    // ensure the pixmap is updated when the surface gets composited again
+                    surfaceItem->destroyPixmap();
+                }
+                break;
+            }
+
+            // The hardware rejected the overlay planes together with the new primary buffer,
+            // composite the surfaces that were assigned to them into another buffer instead.
+            for (OutputLayer *overlayLayer : overlayLayers) {
+                overlayLayer->setEnabled(false);
+            }
+            m_overlayRegions[renderLoop] += overlayRegion;
+            overlayRegion = QRegion();
+            overlayItems.clear();
         }
     }
 
@@ -663,6 +740,10 @@ void Compositor::composite(RenderLoop *renderLoop)
 
     m_backend->present(output);
 
+    if (m_backend->compositingType() == OpenGLCompositing && !m_texturePoolTrimTimer.isActive()) {
+        m_texturePoolTrimTimer.start();
+    }
+
     // TODO: Put it inside the cursor layer once the cursor layer can be backed by a real output layer.
     if (waylandServer()) {
         const std::chrono::milliseconds frameTime =
@@ -677,6 +758,53 @@ void Compositor::composite(RenderLoop *renderLoop)
     }
 }
 
+GLRenderTimeQuery *Compositor::renderTimeQuery(RenderLoop *loop)
+{
+    auto it = m_renderTimeQueries.find(loop);
+    if (it == m_renderTimeQueries.end()) {
+        std::unique_ptr<GLRenderTimeQuery> query;
+        if (m_backend->compositingType() == OpenGLCompositing && GLRenderTimeQuery::supported()) {
+            query = std::make_unique<GLRenderTimeQuery>();
+        }
+        it = m_renderTimeQueries.emplace(loop, std::move(query)).first;
+    }
+    return it->second.get();
+}
+
+QRegion Compositor::assignOverlayLayers(Output *output, RenderLayer *superLayer, QVector<SurfaceItem *> *assignedItems)
+{
+    const auto overlayLayers = m_backend->overlayLayers(output);
+    if (overlayLayers.isEmpty() || output->directScanoutInhibited()) {
+        return QRegion();
+    }
+    const auto sublayers = superLayer->sublayers();
+    const bool overlaysPossible = std::none_of(sublayers.begin(), sublayers.end(), [](RenderLayer *sublayer) {
+        return sublayer->isVisible();
+    });
+    if (!overlaysPossible) {
+        return QRegion();
+    }
+
+    const QVector<SurfaceItem *> candidates = superLayer->delegate()->overlayCandidates();
+    auto candidate = candidates.cbegin();
+    QRegion region;
+    for (OutputLayer *overlayLayer : overlayLayers) {
+        // the layers are tested together with the primary buffer after it has been rendered
+        while (candidate != candidates.cend()) {
+            SurfaceItem *surfaceItem = *candidate++;
+            if (overlayLayer->scanout(surfaceItem)) {
+                assignedItems->append(surfaceItem);
+                // only exclude pixels that are completely covered by the overlay plane from painting
+                const QRectF rect = surfaceItem->mapToGlobal(surfaceItem->rect()).translated(-output->geometry().topLeft());
+                region += QRect(QPoint(std::ceil(rect.left()), std::ceil(rect.top())),
+                                QPoint(std::floor(rect.right()) - 1, std::floor(rect.bottom()) - 1));
+                break;
+            }
+        }
+    }
+    return region;
+}
+
 void Compositor::prePaintPass(RenderLayer *layer)
 {
     layer->delegate()->prePaint();
@@ -695,10 +823,16 @@ void Compositor::postPaintPass(RenderLayer *layer)
     }
 }
 
-void Compositor::preparePaintPass(RenderLayer *layer, QRegion *repaint)
+void Compositor::preparePaintPass(RenderLayer *layer, Region *repaint)
 {
     // TODO: Cull opaque region.
-    *repaint += layer->mapToGlobal(layer->repaints() + layer->delegate()->repaints());
+    Region repaints = layer->delegate()->repaints();
+    const QRegion layerRepaints = layer->repaints();
+    if (!layerRepaints.isEmpty()) {
+        repaints.unite(Region(layerRepaints));
+    }
+    repaints.translate(layer->mapToGlobal(QPoint(0, 0)));
+    repaint->unite(repaints);
     layer->resetRepaints();
     const auto sublayers = layer->sublayers();
     for (RenderLayer *sublayer : sublayers) {
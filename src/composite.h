@@ -14,6 +14,7 @@
 #include <QObject>
 #include <QRegion>
 #include <QTimer>
+#include <map>
 #include <memory>
 
 namespace KWin
@@ -23,6 +24,7 @@ class Output;
 class CompositorSelectionOwner;
 class CursorScene;
 class CursorView;
+class GLRenderTimeQuery;
 class RenderBackend;
 class RenderLayer;
 class RenderLoop;
@@ -32,6 +34,8 @@ class Window;
 class X11Window;
 class X11SyncManager;
 class RenderViewport;
+class SurfaceItem;
+class Region;
 
 class KWIN_EXPORT Compositor : public QObject
 {
@@ -200,18 +204,24 @@ private:
 
     void prePaintPass(RenderLayer *layer);
     void postPaintPass(RenderLayer *layer);
-    void preparePaintPass(RenderLayer *layer, QRegion *repaint);
+    void preparePaintPass(RenderLayer *layer, Region *repaint);
     void paintPass(RenderLayer *layer, const RenderTarget &renderTarget, const QRegion &region);
+    QRegion assignOverlayLayers(Output *output, RenderLayer *superLayer, QVector<SurfaceItem *> *assignedItems);
+    GLRenderTimeQuery *renderTimeQuery(RenderLoop *loop);
+    void trimTexturePool();
 
     State m_state = State::Off;
     std::unique_ptr<CompositorSelectionOwner> m_selectionOwner;
     QTimer m_releaseSelectionTimer;
     QList<xcb_atom_t> m_unusedSupportProperties;
     QTimer m_unusedSupportPropertyTimer;
+    QTimer m_texturePoolTrimTimer;
     std::unique_ptr<WorkspaceScene> m_scene;
     std::unique_ptr<CursorScene> m_cursorScene;
     std::unique_ptr<RenderBackend> m_backend;
     QHash<RenderLoop *, RenderLayer *> m_superlayers;
+    QHash<RenderLoop *, QRegion> m_overlayRegions;
+    std::map<RenderLoop *, std::unique_ptr<GLRenderTimeQuery>> m_renderTimeQueries;
     CompositingType m_selectedCompositor = NoCompositing;
 };
 
@@ -0,0 +1,106 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "core/framearena.h"
+
+namespace KWin
+{
+
+FrameArena::FrameArena(std::size_t capacity)
+{
+    addBlock(capacity);
+}
+
+FrameArena::~FrameArena()
+{
+}
+
+void FrameArena::addBlock(std::size_t size)
+{
+    m_blocks.push_back(Block{
+        .data = std::unique_ptr<std::byte[]>(new std::byte[size]),
+        .size = size,
+    });
+    m_offset = 0;
+}
+
+void FrameArena::reset()
+{
+    m_lastFrameAllocationCount = m_allocationCount;
+    m_lastFrameAllocatedBytes = m_allocatedBytes;
+    m_allocationCount = 0;
+    m_allocatedBytes = 0;
+
+    if (m_blocks.size() > 1) {
+        std::size_t capacity = 0;
+        for (const Block &block : m_blocks) {
+            capacity += block.size;
+        }
+        m_blocks.clear();
+        addBlock(capacity);
+    }
+    m_offset = 0;
+}
+
+std::size_t FrameArena::capacity() const
+{
+    return m_blocks.front().size;
+}
+
+int FrameArena::allocationCount() const
+{
+    return m_allocationCount;
+}
+
+std::size_t FrameArena::allocatedBytes() const
+{
+    return m_allocatedBytes;
+}
+
+int FrameArena::lastFrameAllocationCount() const
+{
+    return m_lastFrameAllocationCount;
+}
+
+std::size_t FrameArena::lastFrameAllocatedBytes() const
+{
+    return m_lastFrameAllocatedBytes;
+}
+
+void *FrameArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    m_allocationCount++;
+    m_allocatedBytes += bytes;
+
+    Block *block = &m_blocks.back();
+    void *pointer = block->data.get() + m_offset;
+    std::size_t space = block->size - m_offset;
+    if (!std::align(alignment, bytes, pointer, space)) {
+        addBlock(std::max(block->size * 2, bytes + alignment));
+        block = &m_blocks.back();
+        pointer = block->data.get();
+        space = block->size;
+        std::align(alignment, bytes, pointer, space);
+    }
+
+    m_offset = static_cast<std::byte *>(pointer) - block->data.get() + bytes;
+    return pointer;
+}
+
+void FrameArena::do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment)
+{
+    // The memory is reclaimed when the arena is rewound.
+}
+
+bool FrameArena::do_is_equal(const std::pmr::memory_resource &other) const noexcept
+{
+    return this == &other;
+}
+
+} // namespace KWin
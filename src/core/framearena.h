@@ -0,0 +1,91 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "libkwineffects/kwinglobals.h"
+
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+namespace KWin
+{
+
+/**
+ * The FrameArena class is a monotonic allocator for data that lives no longer than a frame.
+ *
+ * Allocations are carved out of a memory block by bumping an offset, freeing memory is a no-op.
+ * The arena is rewound once the frame has been rendered. If a frame needs more memory than the
+ * arena has, extra blocks are allocated and merged into a single bigger block when the arena
+ * is rewound, so the following frames don't need to hit the heap again.
+ *
+ * Every ItemRenderer owns an arena, which the scene rewinds when it starts preparing a new
+ * frame. The arena can be used with the allocator aware containers from std::pmr. It is not
+ * thread-safe.
+ */
+class KWIN_EXPORT FrameArena : public std::pmr::memory_resource
+{
+public:
+    explicit FrameArena(std::size_t capacity = 64 * 1024);
+    ~FrameArena() override;
+
+    /**
+     * Rewinds the arena. All memory allocated from the arena becomes invalid.
+     */
+    void reset();
+
+    /**
+     * Returns the size of the main memory block.
+     */
+    std::size_t capacity() const;
+
+    /**
+     * Returns the number of allocations made since the arena has been rewound.
+     */
+    int allocationCount() const;
+
+    /**
+     * Returns the number of bytes allocated since the arena has been rewound.
+     */
+    std::size_t allocatedBytes() const;
+
+    /**
+     * Returns the number of allocations made in the previous frame.
+     */
+    int lastFrameAllocationCount() const;
+
+    /**
+     * Returns the number of bytes allocated in the previous frame.
+     */
+    std::size_t lastFrameAllocatedBytes() const;
+
+protected:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void *pointer, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override;
+
+private:
+    struct Block
+    {
+        std::unique_ptr<std::byte[]> data;
+        std::size_t size = 0;
+    };
+
+    void addBlock(std::size_t size);
+
+    std::vector<Block> m_blocks;
+    std::size_t m_offset = 0;
+    int m_allocationCount = 0;
+    std::size_t m_allocatedBytes = 0;
+    int m_lastFrameAllocationCount = 0;
+    std::size_t m_lastFrameAllocatedBytes = 0;
+};
+
+} // namespace KWin
@@ -59,6 +59,16 @@ void OutputLayer::resetRepaints()
     m_repaints = QRegion();
 }
 
+bool OutputLayer::isEnabled() const
+{
+    return m_enabled;
+}
+
+void OutputLayer::setEnabled(bool enable)
+{
+    m_enabled = enable;
+}
+
 bool OutputLayer::scanout(SurfaceItem *surfaceItem)
 {
     return false;
@@ -43,6 +43,13 @@ public:
     void resetRepaints();
     void addRepaint(const QRegion &region);
 
+    /**
+     * Whether the layer should be shown in the next frame. This is only meaningful for
+     * layers that can be switched off independently of the output, e.g. overlay planes.
+     */
+    bool isEnabled() const;
+    void setEnabled(bool enable);
+
     virtual std::optional<OutputLayerBeginFrameInfo> beginFrame() = 0;
     virtual bool endFrame(const QRegion &renderedRegion, const QRegion &damagedRegion) = 0;
 
@@ -62,6 +69,7 @@ private:
     QPointF m_hotspot;
     QSizeF m_size;
     qreal m_scale = 1.0;
+    bool m_enabled = true;
 };
 
 } // namespace KWin
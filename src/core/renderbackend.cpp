@@ -22,6 +22,16 @@ OutputLayer *RenderBackend::cursorLayer(Output *output)
     return nullptr;
 }
 
+QVector<OutputLayer *> RenderBackend::overlayLayers(Output *output)
+{
+    return {};
+}
+
+bool RenderBackend::testOverlayLayers(Output *output)
+{
+    return true;
+}
+
 OverlayWindow *RenderBackend::overlayWindow() const
 {
     return nullptr;
@@ -46,6 +46,16 @@ public:
 
     virtual OutputLayer *primaryLayer(Output *output) = 0;
     virtual OutputLayer *cursorLayer(Output *output);
+    /**
+     * Returns the layers that can be used to put surfaces on hardware planes
+     * above the primary layer of the @a output.
+     */
+    virtual QVector<OutputLayer *> overlayLayers(Output *output);
+    /**
+     * Tests whether the enabled overlay layers of the @a output can be presented together
+     * with the buffer that has just been rendered into its primary layer.
+     */
+    virtual bool testOverlayLayers(Output *output);
     virtual void present(Output *output) = 0;
 
     virtual bool testImportBuffer(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
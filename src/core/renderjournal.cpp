@@ -6,9 +6,43 @@
 
 #include "renderjournal.h"
 
+#include <algorithm>
+#include <cmath>
+
 namespace KWin
 {
 
+// The weight of the newest sample, roughly equivalent to a window of 20 frames. The mean and
+// the variance share it so the variance is always measured around the mean it is paired with.
+static const qreal s_smoothingFactor = 0.1;
+
+/**
+ * Returns z such that a normally distributed variable exceeds mean + z * sigma with the
+ * probability @a p. Uses the rational approximation 26.2.23 from Abramowitz and Stegun,
+ * the absolute error is less than 4.5e-4.
+ */
+static qreal upperQuantile(qreal p)
+{
+    p = std::clamp(p, 1e-6, 0.5);
+    const qreal t = std::sqrt(-2.0 * std::log(p));
+    return t - (2.515517 + 0.802853 * t + 0.010328 * t * t) / (1.0 + 1.432788 * t + 0.189269 * t * t + 0.001308 * t * t * t);
+}
+
+void RenderJournal::Statistics::add(std::chrono::nanoseconds sample)
+{
+    // Use the plain cumulative average for the first samples so the estimate is not biased
+    // towards zero while the journal warms up.
+    count++;
+    const qreal factor = std::max(s_smoothingFactor, 1.0 / count);
+
+    // Exponentially weighted mean and variance, see Finch, "Incremental calculation of
+    // weighted mean and variance" (2009).
+    const qreal difference = sample.count() - mean;
+    const qreal increment = factor * difference;
+    mean += increment;
+    variance = (1.0 - factor) * (variance + difference * increment);
+}
+
 RenderJournal::RenderJournal()
 {
 }
@@ -20,11 +54,21 @@ void RenderJournal::beginFrame()
 
 void RenderJournal::endFrame()
 {
-    std::chrono::nanoseconds duration(m_timer.nsecsElapsed());
+    addCpuTime(std::chrono::nanoseconds(m_timer.nsecsElapsed()));
+}
+
+void RenderJournal::addCpuTime(std::chrono::nanoseconds duration)
+{
     if (m_log.count() >= m_size) {
         m_log.dequeue();
     }
     m_log.enqueue(duration);
+    m_cpu.add(duration);
+}
+
+void RenderJournal::addGpuTime(std::chrono::nanoseconds duration)
+{
+    m_gpu.add(duration);
 }
 
 std::chrono::nanoseconds RenderJournal::minimum() const
@@ -53,4 +97,28 @@ std::chrono::nanoseconds RenderJournal::average() const
     return result / m_log.count();
 }
 
+std::chrono::nanoseconds RenderJournal::estimate(qreal targetMissRate) const
+{
+    if (!m_cpu.count && !m_gpu.count) {
+        return std::chrono::nanoseconds::zero();
+    }
+
+    // The GPU starts executing commands while the CPU is still painting, so treating both
+    // as independent consecutive stages gives a slightly pessimistic estimate.
+    const qreal mean = m_cpu.mean + m_gpu.mean;
+    const qreal deviation = std::sqrt(m_cpu.variance + m_gpu.variance);
+
+    return std::chrono::nanoseconds(std::llround(mean + upperQuantile(targetMissRate) * deviation));
+}
+
+std::chrono::nanoseconds RenderJournal::cpuTime() const
+{
+    return std::chrono::nanoseconds(std::llround(m_cpu.mean));
+}
+
+std::chrono::nanoseconds RenderJournal::gpuTime() const
+{
+    return std::chrono::nanoseconds(std::llround(m_gpu.mean));
+}
+
 } // namespace KWin
@@ -17,6 +17,11 @@ namespace KWin
 /**
  * The RenderJournal class measures how long it takes to render frames and estimates how
  * long it will take to render the next frame.
+ *
+ * The time spent by the CPU painting a frame and the time spent by the GPU executing the
+ * submitted commands are tracked separately. For every kind of sample, an exponentially
+ * weighted moving average and variance are maintained, which allows predicting the render
+ * time of the next frame for a given probability of missing the deadline.
  */
 class KWIN_EXPORT RenderJournal
 {
@@ -33,6 +38,17 @@ public:
      */
     void endFrame();
 
+    /**
+     * Records the amount of time that it took the CPU to paint a frame.
+     */
+    void addCpuTime(std::chrono::nanoseconds duration);
+
+    /**
+     * Records the amount of time that it took the GPU to render a frame. GPU timings usually
+     * become available a couple of frames later, so they need not be paired with CPU timings.
+     */
+    void addGpuTime(std::chrono::nanoseconds duration);
+
     /**
      * Returns the maximum estimated amount of time that it takes to render a single frame.
      */
@@ -48,9 +64,36 @@ public:
      */
     std::chrono::nanoseconds average() const;
 
+    /**
+     * Returns the estimated amount of time that it takes to render the next frame so that
+     * the estimate is exceeded with a probability of at most @a targetMissRate.
+     */
+    std::chrono::nanoseconds estimate(qreal targetMissRate) const;
+
+    /**
+     * Returns the smoothed amount of time that the CPU spends painting a frame.
+     */
+    std::chrono::nanoseconds cpuTime() const;
+
+    /**
+     * Returns the smoothed amount of time that the GPU spends rendering a frame.
+     */
+    std::chrono::nanoseconds gpuTime() const;
+
 private:
+    struct Statistics
+    {
+        void add(std::chrono::nanoseconds sample);
+
+        qreal mean = 0;
+        qreal variance = 0;
+        int count = 0;
+    };
+
     QElapsedTimer m_timer;
     QQueue<std::chrono::nanoseconds> m_log;
+    Statistics m_cpu;
+    Statistics m_gpu;
     int m_size = 15;
 };
 
@@ -19,9 +19,9 @@ void RenderLayerDelegate::setLayer(RenderLayer *layer)
     m_layer = layer;
 }
 
-QRegion RenderLayerDelegate::repaints() const
+Region RenderLayerDelegate::repaints() const
 {
-    return QRegion();
+    return Region();
 }
 
 void RenderLayerDelegate::prePaint()
@@ -37,4 +37,9 @@ SurfaceItem *RenderLayerDelegate::scanoutCandidate() const
     return nullptr;
 }
 
+QVector<SurfaceItem *> RenderLayerDelegate::overlayCandidates() const
+{
+    return {};
+}
+
 } // namespace KWin
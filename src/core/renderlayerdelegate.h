@@ -7,8 +7,10 @@
 #pragma once
 
 #include "kwin_export.h"
+#include "utils/region.h"
 
 #include <QRegion>
+#include <QVector>
 
 namespace KWin
 {
@@ -32,7 +34,7 @@ public:
     /**
      * Returns the repaints schduled for the next frame.
      */
-    virtual QRegion repaints() const;
+    virtual Region repaints() const;
 
     /**
      * This function is called by the compositor before starting compositing. Reimplement
@@ -52,6 +54,13 @@ public:
      */
     virtual SurfaceItem *scanoutCandidate() const;
 
+    /**
+     * Returns the surfaces that could be put on overlay planes instead of being composited,
+     * sorted from top to bottom. The candidates are guaranteed to be opaque and to not be
+     * covered by any other content of the render layer.
+     */
+    virtual QVector<SurfaceItem *> overlayCandidates() const;
+
     /**
      * This function is called when the compositor wants the render layer delegate
      * to repaint its contents.
@@ -6,6 +6,7 @@
 
 #include "renderloop.h"
 #include "renderloop_p.h"
+#include "frametimeline.h"
 #include "scene/surfaceitem.h"
 #include "scene/surfaceitem_wayland.h"
 #include "utils/common.h"
@@ -29,6 +30,7 @@ RenderLoopPrivate::RenderLoopPrivate(RenderLoop *q)
     : q(q)
 {
     compositeTimer.setSingleShot(true);
+    compositeTimer.setTimerType(Qt::PreciseTimer);
     QObject::connect(&compositeTimer, &QTimer::timeout, q, [this]() {
         dispatch();
     });
@@ -39,6 +41,7 @@ void RenderLoopPrivate::scheduleRepaint()
     if (kwinApp()->isTerminating() || (compositeTimer.isActive() && !allowTearing)) {
         return;
     }
+    FrameTimeline::instant(FrameTimelineEvent::ScheduleRepaint, quintptr(q));
     if (vrrPolicy == RenderLoop::VrrPolicy::Always || (vrrPolicy == RenderLoop::VrrPolicy::Automatic && fullscreenItem != nullptr)) {
         presentMode = allowTearing ? SyncMode::AdaptiveAsync : SyncMode::Adaptive;
     } else {
@@ -55,25 +58,30 @@ void RenderLoopPrivate::scheduleRepaint()
     }
 
     // Estimate when it's a good time to perform the next compositing cycle.
-    const std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(3);
-
-    std::chrono::nanoseconds renderTime;
-    switch (q->latencyPolicy()) {
-    case LatencyExtremelyLow:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.1));
-        break;
-    case LatencyLow:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.25));
-        break;
-    case LatencyMedium:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.5));
-        break;
-    case LatencyHigh:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.75));
-        break;
-    case LatencyExtremelyHigh:
-        renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.9));
-        break;
+    std::chrono::nanoseconds safetyMargin = std::chrono::milliseconds(3);
+
+    std::chrono::nanoseconds renderTime = std::chrono::nanoseconds::zero();
+    // The adaptive estimator already accounts for the variance of the render time, so the
+    // latency policy only puts a floor on the render time if it has been forced, e.g. by a
+    // fullscreen effect. Otherwise, it tunes the estimate below.
+    if (options->renderTimeEstimator() != RenderTimeEstimatorAdaptive || latencyPolicy.has_value()) {
+        switch (q->latencyPolicy()) {
+        case LatencyExtremelyLow:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.1));
+            break;
+        case LatencyLow:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.25));
+            break;
+        case LatencyMedium:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.5));
+            break;
+        case LatencyHigh:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.75));
+            break;
+        case LatencyExtremelyHigh:
+            renderTime = std::chrono::nanoseconds(long(vblankInterval.count() * 0.9));
+            break;
+        }
     }
 
     switch (options->renderTimeEstimator()) {
@@ -86,6 +94,35 @@ void RenderLoopPrivate::scheduleRepaint()
     case RenderTimeEstimatorAverage:
         renderTime = std::max(renderTime, renderJournal.average());
         break;
+    case RenderTimeEstimatorAdaptive: {
+        // The latency policy trades latency for smoothness by scaling the chance of missing
+        // the deadline and the margin for the timer slack and the scheduling jitter.
+        qreal missRateScale = 1;
+        switch (q->latencyPolicy()) {
+        case LatencyExtremelyLow:
+            missRateScale = 4;
+            safetyMargin = std::chrono::microseconds(500);
+            break;
+        case LatencyLow:
+            missRateScale = 2;
+            safetyMargin = std::chrono::milliseconds(1);
+            break;
+        case LatencyMedium:
+            missRateScale = 1;
+            safetyMargin = std::chrono::milliseconds(1);
+            break;
+        case LatencyHigh:
+            missRateScale = 0.5;
+            safetyMargin = std::chrono::milliseconds(2);
+            break;
+        case LatencyExtremelyHigh:
+            missRateScale = 0.25;
+            safetyMargin = std::chrono::milliseconds(3);
+            break;
+        }
+        renderTime = std::max(renderTime, renderJournal.estimate(options->renderTimeTargetMissRate() * missRateScale));
+        break;
+    }
     }
 
     std::chrono::nanoseconds nextRenderTimestamp = nextPresentationTimestamp - renderTime - safetyMargin;
@@ -120,6 +157,9 @@ void RenderLoopPrivate::notifyFrameFailed()
 {
     Q_ASSERT(pendingFrameCount > 0);
     pendingFrameCount--;
+    if (!pendingFrames.isEmpty()) {
+        pendingFrames.dequeue();
+    }
 
     if (!inhibitCount) {
         maybeScheduleRepaint();
@@ -130,6 +170,7 @@ void RenderLoopPrivate::notifyFrameCompleted(std::chrono::nanoseconds timestamp)
 {
     Q_ASSERT(pendingFrameCount > 0);
     pendingFrameCount--;
+    FrameTimeline::instant(FrameTimelineEvent::PageFlip, quintptr(q), pendingFrames.isEmpty() ? 0 : pendingFrames.dequeue());
 
     if (lastPresentationTimestamp <= timestamp) {
         lastPresentationTimestamp = timestamp;
@@ -154,6 +195,9 @@ void RenderLoopPrivate::dispatch()
     // the Compositor starts repainting.
     pendingRepaint = true;
 
+    FrameTimeline::startFrame();
+    FrameTimeline::instant(FrameTimelineEvent::TimerFired, quintptr(q));
+
     Q_EMIT q->frameRequested(q);
 
     // The Compositor may decide to not repaint when the frameRequested() signal is
@@ -165,6 +209,7 @@ void RenderLoopPrivate::invalidate()
 {
     pendingReschedule = false;
     pendingFrameCount = 0;
+    pendingFrames.clear();
     compositeTimer.stop();
 }
 
@@ -200,6 +245,7 @@ void RenderLoop::beginFrame()
 {
     d->pendingRepaint = false;
     d->pendingFrameCount++;
+    d->pendingFrames.enqueue(FrameTimeline::currentFrame());
     d->renderJournal.beginFrame();
 }
 
@@ -208,6 +254,21 @@ void RenderLoop::endFrame()
     d->renderJournal.endFrame();
 }
 
+void RenderLoop::addGpuRenderTime(std::chrono::nanoseconds duration)
+{
+    d->renderJournal.addGpuTime(duration);
+}
+
+std::chrono::nanoseconds RenderLoop::cpuRenderTime() const
+{
+    return d->renderJournal.cpuTime();
+}
+
+std::chrono::nanoseconds RenderLoop::gpuRenderTime() const
+{
+    return d->renderJournal.gpuTime();
+}
+
 int RenderLoop::refreshRate() const
 {
     return d->refreshRate;
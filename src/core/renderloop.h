@@ -59,6 +59,23 @@ public:
      */
     void endFrame();
 
+    /**
+     * Reports the amount of time that it took the GPU to render a frame. GPU timings are
+     * usually known only a couple of frames later, so they are reported separately.
+     */
+    void addGpuRenderTime(std::chrono::nanoseconds duration);
+
+    /**
+     * Returns the smoothed amount of time that it takes the Compositor to paint a frame.
+     */
+    std::chrono::nanoseconds cpuRenderTime() const;
+
+    /**
+     * Returns the smoothed amount of time that it takes the GPU to render a frame, or zero
+     * if it is unknown.
+     */
+    std::chrono::nanoseconds gpuRenderTime() const;
+
     /**
      * Returns the refresh rate at which the output is being updated, in millihertz.
      */
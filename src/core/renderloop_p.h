@@ -9,6 +9,7 @@
 #include "renderjournal.h"
 #include "renderloop.h"
 
+#include <QQueue>
 #include <QTimer>
 
 #include <optional>
@@ -39,6 +40,7 @@ public:
     RenderJournal renderJournal;
     int refreshRate = 60000;
     int pendingFrameCount = 0;
+    QQueue<quint64> pendingFrames;
     int inhibitCount = 0;
     bool pendingReschedule = false;
     bool pendingRepaint = false;
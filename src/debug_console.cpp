@@ -8,7 +8,10 @@
 */
 #include "debug_console.h"
 #include "composite.h"
+#include "core/framearena.h"
 #include "core/inputdevice.h"
+#include "core/output.h"
+#include "core/renderloop.h"
 #include "input_event.h"
 #include "internalwindow.h"
 #include "keyboard_input.h"
@@ -16,6 +19,8 @@
 #include "libkwineffects/kwinglutils.h"
 #include "main.h"
 #include "platformsupport/scenes/opengl/openglbackend.h"
+#include "scene/itemrenderer_opengl.h"
+#include "scene/workspacescene.h"
 #include "utils/filedescriptor.h"
 #include "utils/subsurfacemonitor.h"
 #include "wayland/abstract_data_source.h"
@@ -47,6 +52,7 @@
 #include <QMouseEvent>
 #include <QScopeGuard>
 #include <QSortFilterProxyModel>
+#include <QTimer>
 #include <QtConcurrentRun>
 
 #include <wayland-server-core.h>
@@ -646,6 +652,7 @@ DebugConsole::DebugConsole()
     });
 
     initGLTab();
+    initRenderTimes();
 }
 
 DebugConsole::~DebugConsole() = default;
@@ -683,6 +690,50 @@ void DebugConsole::initGLTab()
     m_ui->openGLExtensionsLabel->setText(extensionsString(openGLExtensions()));
 }
 
+void DebugConsole::initRenderTimes()
+{
+    if (!effects || !effects->isOpenGLCompositing()) {
+        return;
+    }
+    auto timer = new QTimer(this);
+    connect(timer, &QTimer::timeout, this, &DebugConsole::updateRenderTimes);
+    timer->start(1000);
+    updateRenderTimes();
+}
+
+void DebugConsole::updateRenderTimes()
+{
+    auto toMilliseconds = [](std::chrono::nanoseconds duration) {
+        return QString::number(duration.count() / 1'000'000.0, 'f', 2);
+    };
+
+    QString text = QStringLiteral("<ul>");
+    const auto outputs = workspace()->outputs();
+    for (Output *output : outputs) {
+        const RenderLoop *renderLoop = output->renderLoop();
+        const std::chrono::nanoseconds gpuRenderTime = renderLoop->gpuRenderTime();
+        text.append(QStringLiteral("<li>%1: CPU %2 ms, GPU %3</li>")
+                        .arg(output->name(),
+                             toMilliseconds(renderLoop->cpuRenderTime()),
+                             gpuRenderTime.count() ? toMilliseconds(gpuRenderTime) + QStringLiteral(" ms") : i18n("n/a")));
+    }
+    text.append(QStringLiteral("</ul>"));
+
+    if (const WorkspaceScene *scene = Compositor::self()->scene()) {
+        const FrameArena *frameArena = scene->renderer()->frameArena();
+        text.append(i18n("Temporary allocations in the last frame: %1 (%2 of %3 KiB)",
+                         frameArena->lastFrameAllocationCount(),
+                         frameArena->lastFrameAllocatedBytes() / 1024,
+                         frameArena->capacity() / 1024));
+        text.append(QStringLiteral("<br>"));
+        if (const auto renderer = dynamic_cast<const ItemRendererOpenGL *>(scene->renderer())) {
+            text.append(i18n("Draw calls in the last frame: %1 for %2 render nodes", renderer->drawCallCount(), renderer->renderNodeCount()));
+        }
+    }
+
+    m_ui->renderTimesLabel->setText(text);
+}
+
 template<typename T>
 QString keymapComponentToString(xkb_keymap *map, const T &count, std::function<const char *(xkb_keymap *, T)> f)
 {
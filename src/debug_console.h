@@ -105,6 +105,8 @@ protected:
 
 private:
     void initGLTab();
+    void initRenderTimes();
+    void updateRenderTimes();
     void updateKeyboardTab();
 
     std::unique_ptr<Ui::DebugConsole> m_ui;
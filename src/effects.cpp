@@ -20,6 +20,7 @@
 #endif
 #include "core/renderbackend.h"
 #include "core/renderlayer.h"
+#include "core/renderloop.h"
 #include "cursor.h"
 #include "group.h"
 #include "input_event.h"
@@ -1448,6 +1449,11 @@ bool EffectsHandlerImpl::blocksDirectScanout() const
     });
 }
 
+bool EffectsHandlerImpl::hasActiveEffects() const
+{
+    return !m_activeEffects.isEmpty();
+}
+
 KWaylandServer::Display *EffectsHandlerImpl::waylandDisplay() const
 {
     if (waylandServer()) {
@@ -1829,6 +1835,16 @@ int EffectScreenImpl::refreshRate() const
     return m_platformOutput->refreshRate();
 }
 
+std::chrono::nanoseconds EffectScreenImpl::cpuRenderTime() const
+{
+    return m_platformOutput->renderLoop()->cpuRenderTime();
+}
+
+std::chrono::nanoseconds EffectScreenImpl::gpuRenderTime() const
+{
+    return m_platformOutput->renderLoop()->gpuRenderTime();
+}
+
 EffectScreen::Transform EffectScreenImpl::transform() const
 {
     return EffectScreen::Transform(m_platformOutput->transform());
@@ -187,6 +187,12 @@ public:
      */
     bool blocksDirectScanout() const;
 
+    /**
+     * @returns whether any effect takes part in the current painting pass. If not, the windows
+     * are painted by the scene without any effect drawing in between.
+     */
+    bool hasActiveEffects() const;
+
     KWaylandServer::Display *waylandDisplay() const override;
 
     bool animationsSupported() const override;
@@ -347,6 +353,8 @@ public:
     qreal devicePixelRatio() const override;
     QRect geometry() const override;
     int refreshRate() const override;
+    std::chrono::nanoseconds cpuRenderTime() const override;
+    std::chrono::nanoseconds gpuRenderTime() const override;
     Transform transform() const override;
 
     static EffectScreenImpl *get(Output *output);
@@ -11,6 +11,7 @@
 // KConfigSkeleton
 #include "blurconfig.h"
 
+#include "libkwineffects/kwingltexturepool.h"
 #include "libkwineffects/rendertarget.h"
 #include "libkwineffects/renderviewport.h"
 #include "utils/xcbutils.h"
@@ -137,8 +138,19 @@ void BlurEffect::screenGeometryChanged(EffectScreen *screen)
     effects->doneOpenGLContextCurrent();
 }
 
+BlurEffect::ScreenData::~ScreenData()
+{
+    renderTargets.clear();
+    for (auto &texture : renderTargetTextures) {
+        GLTexturePool::release(std::move(texture));
+    }
+}
+
 void BlurEffect::updateTexture(EffectScreen *screen)
 {
+    // Give the old textures back first, they can be reused if the screen has only been moved.
+    m_screenData.erase(screen);
+
     ScreenData data;
     /* Reserve memory for:
      *  - The original sized texture (1)
@@ -179,7 +191,10 @@ void BlurEffect::updateTexture(EffectScreen *screen)
     // anyway.
     const auto screenSize = screen ? screen->geometry().size() : effects->virtualScreenSize();
     for (int i = 0; i <= m_downSampleIterations; i++) {
-        data.renderTargetTextures.push_back(std::make_unique<GLTexture>(textureFormat, screenSize / (1 << i)));
+        data.renderTargetTextures.push_back(GLTexturePool::acquire(textureFormat, screenSize / (1 << i)));
+        if (!data.renderTargetTextures.back()) {
+            return;
+        }
         data.renderTargetTextures.back()->setFilter(GL_LINEAR);
         data.renderTargetTextures.back()->setWrapMode(GL_CLAMP_TO_EDGE);
 
@@ -187,7 +202,10 @@ void BlurEffect::updateTexture(EffectScreen *screen)
     }
 
     // This last set is used as a temporary helper texture
-    data.renderTargetTextures.push_back(std::make_unique<GLTexture>(textureFormat, screenSize));
+    data.renderTargetTextures.push_back(GLTexturePool::acquire(textureFormat, screenSize));
+    if (!data.renderTargetTextures.back()) {
+        return;
+    }
     data.renderTargetTextures.back()->setFilter(GL_LINEAR);
     data.renderTargetTextures.back()->setWrapMode(GL_CLAMP_TO_EDGE);
 
@@ -609,7 +627,7 @@ void BlurEffect::prePaintWindow(EffectWindow *w, WindowPrePaintData &data, std::
 
 bool BlurEffect::shouldBlur(const EffectWindow *w, int mask, const WindowPaintData &data) const
 {
-    if (m_screenData.empty() || !m_shader || !m_shader->isValid()) {
+    if (!m_screenData.contains(m_currentScreen) || !m_shader || !m_shader->isValid()) {
         return false;
     }
 
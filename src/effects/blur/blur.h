@@ -68,6 +68,7 @@ private:
         ScreenData() = default;
         ScreenData(const ScreenData &) = delete;
         ScreenData &operator=(ScreenData &&) = default;
+        ~ScreenData();
 
         std::vector<std::unique_ptr<GLTexture>> renderTargetTextures;
         std::vector<std::unique_ptr<GLFramebuffer>> renderTargets;
@@ -10,17 +10,32 @@
 */
 #include "screenshot.h"
 #include "screenshotdbusinterface2.h"
+#include "screenshotlogging.h"
 
+#include "libkwineffects/kwineglnativefence.h"
 #include "libkwineffects/kwinglplatform.h"
 #include "libkwineffects/kwinglutils.h"
 #include "libkwineffects/rendertarget.h"
 #include "libkwineffects/renderviewport.h"
 
 #include <QPainter>
+#include <QSocketNotifier>
+#include <QtConcurrentRun>
+
+#include <optional>
 
 namespace KWin
 {
 
+/**
+ * The cursor as it was when the screenshot has been taken, the pixels may be read back later.
+ */
+struct ScreenShotCursor
+{
+    QImage image;
+    QPointF position;
+};
+
 struct ScreenShotWindowData
 {
     QPromise<QImage> promise;
@@ -35,6 +50,8 @@ struct ScreenShotAreaData
     QRect area;
     QImage result;
     QList<EffectScreen *> screens;
+    std::optional<ScreenShotCursor> cursor;
+    int pendingReadbacks = 0;
 };
 
 struct ScreenShotScreenData
@@ -44,15 +61,54 @@ struct ScreenShotScreenData
     EffectScreen *screen = nullptr;
 };
 
-static void convertFromGLImage(QImage &img, int w, int h, const QMatrix4x4 &renderTargetTransformation)
+struct ScreenShotReadback
+{
+    GLuint buffer = 0;
+    std::unique_ptr<EGLNativeFence> fence;
+    std::unique_ptr<QSocketNotifier> notifier;
+    QSize size;
+    QMatrix4x4 renderTargetTransformation;
+    qreal devicePixelRatio = 1.0;
+    std::function<void(QImage &&)> callback;
+    QFuture<QImage> copy;
+};
+
+static std::optional<ScreenShotCursor> grabCursor(ScreenShotFlags flags)
+{
+    if (!(flags & ScreenShotIncludeCursor) || effects->isCursorHidden()) {
+        return std::nullopt;
+    }
+
+    const PlatformCursorImage cursor = effects->cursorImage();
+    if (cursor.image().isNull()) {
+        return std::nullopt;
+    }
+
+    return ScreenShotCursor{
+        .image = cursor.image(),
+        .position = effects->cursorPos() - cursor.hotSpot(),
+    };
+}
+
+static void drawCursor(QImage &snapshot, const std::optional<ScreenShotCursor> &cursor, int xOffset, int yOffset)
+{
+    if (!cursor) {
+        return;
+    }
+
+    QPainter painter(&snapshot);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+    painter.drawImage(cursor->position - QPointF(xOffset, yOffset), cursor->image);
+}
+
+static void convertRowFromGL(uint *p, int w)
 {
     // from QtOpenGL/qgl.cpp
     // SPDX-FileCopyrightText: 2010 Nokia Corporation and /or its subsidiary(-ies)
     // see https://github.com/qt/qtbase/blob/dev/src/opengl/qgl.cpp
     if (QSysInfo::ByteOrder == QSysInfo::BigEndian) {
         // OpenGL gives RGBA; Qt wants ARGB
-        uint *p = reinterpret_cast<uint *>(img.bits());
-        uint *end = p + w * h;
+        uint *end = p + w;
         while (p < end) {
             uint a = *p << 24;
             *p = (*p >> 8) | a;
@@ -60,24 +116,61 @@ static void convertFromGLImage(QImage &img, int w, int h, const QMatrix4x4 &rend
         }
     } else {
         // OpenGL gives ABGR (i.e. RGBA backwards); Qt wants ARGB
-        for (int y = 0; y < h; y++) {
-            uint *q = reinterpret_cast<uint *>(img.scanLine(y));
-            for (int x = 0; x < w; ++x) {
-                const uint pixel = *q;
-                *q = ((pixel << 16) & 0xff0000) | ((pixel >> 16) & 0xff)
-                    | (pixel & 0xff00ff00);
-
-                q++;
-            }
+        for (int x = 0; x < w; ++x) {
+            const uint pixel = *p;
+            *p = ((pixel << 16) & 0xff0000) | ((pixel >> 16) & 0xff)
+                | (pixel & 0xff00ff00);
+
+            p++;
         }
     }
+}
 
-    QMatrix4x4 matrix;
+static void applyRenderTargetTransformation(QImage &img, const QMatrix4x4 &renderTargetTransformation, bool flipped)
+{
+    QMatrix4x4 flip;
     // OpenGL textures are flipped vs QImage
-    matrix.scale(1, -1);
+    flip.scale(1, -1);
+
+    QMatrix4x4 matrix;
+    if (!flipped) {
+        matrix = flip;
+    }
     // apply render target transformation
     matrix *= renderTargetTransformation.inverted();
-    img = img.transformed(matrix.toTransform());
+    if (flipped) {
+        matrix = flip * matrix * flip;
+    }
+    if (!matrix.isIdentity()) {
+        img = img.transformed(matrix.toTransform());
+    }
+}
+
+static void convertFromGLImage(QImage &img, int w, int h, const QMatrix4x4 &renderTargetTransformation)
+{
+    for (int y = 0; y < h; y++) {
+        convertRowFromGL(reinterpret_cast<uint *>(img.scanLine(y)), w);
+    }
+    applyRenderTargetTransformation(img, renderTargetTransformation, false);
+}
+
+/**
+ * Copies the pixels from a mapped pixel buffer object to @a img. The rows are flipped on the
+ * way since OpenGL images are stored bottom-up.
+ */
+static void copyFromPixelBuffer(const uchar *pixels, QImage &img, bool convert)
+{
+    const int width = img.width();
+    const int height = img.height();
+    const qsizetype sourceStride = qsizetype(width) * 4;
+
+    for (int y = 0; y < height; ++y) {
+        uchar *row = img.scanLine(y);
+        memcpy(row, pixels + (height - y - 1) * sourceStride, sourceStride);
+        if (convert) {
+            convertRowFromGL(reinterpret_cast<uint *>(row), width);
+        }
+    }
 }
 
 bool ScreenShotEffect::supported()
@@ -98,6 +191,16 @@ ScreenShotEffect::~ScreenShotEffect()
     cancelWindowScreenShots();
     cancelAreaScreenShots();
     cancelScreenScreenShots();
+
+    // The pixel buffers may still be mapped and read by a worker thread.
+    for (const auto &readback : m_readbacks) {
+        readback->copy.waitForFinished();
+    }
+    if (!m_readbacks.empty() && effects->makeOpenGLContextCurrent()) {
+        for (const auto &readback : m_readbacks) {
+            glDeleteBuffers(1, &readback->buffer);
+        }
+    }
 }
 
 QFuture<QImage> ScreenShotEffect::scheduleScreenShot(EffectScreen *screen, ScreenShotFlags flags)
@@ -123,38 +226,38 @@ QFuture<QImage> ScreenShotEffect::scheduleScreenShot(EffectScreen *screen, Scree
 
 QFuture<QImage> ScreenShotEffect::scheduleScreenShot(const QRect &area, ScreenShotFlags flags)
 {
-    for (const ScreenShotAreaData &data : m_areaScreenShots) {
-        if (data.area == area && data.flags == flags) {
-            return data.promise.future();
+    for (const auto &data : m_areaScreenShots) {
+        if (data->area == area && data->flags == flags) {
+            return data->promise.future();
         }
     }
 
-    ScreenShotAreaData data;
-    data.area = area;
-    data.flags = flags;
+    auto data = std::make_shared<ScreenShotAreaData>();
+    data->area = area;
+    data->flags = flags;
 
     const QList<EffectScreen *> screens = effects->screens();
     for (EffectScreen *screen : screens) {
         if (screen->geometry().intersects(area)) {
-            data.screens.append(screen);
+            data->screens.append(screen);
         }
     }
 
     qreal devicePixelRatio = 1.0;
     if (flags & ScreenShotNativeResolution) {
-        for (const EffectScreen *screen : std::as_const(data.screens)) {
+        for (const EffectScreen *screen : std::as_const(data->screens)) {
             if (screen->devicePixelRatio() > devicePixelRatio) {
                 devicePixelRatio = screen->devicePixelRatio();
             }
         }
     }
 
-    data.result = QImage(area.size() * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
-    data.result.fill(Qt::transparent);
-    data.result.setDevicePixelRatio(devicePixelRatio);
+    data->result = QImage(area.size() * devicePixelRatio, QImage::Format_ARGB32_Premultiplied);
+    data->result.fill(Qt::transparent);
+    data->result.setDevicePixelRatio(devicePixelRatio);
 
-    data.promise.start();
-    QFuture<QImage> future = data.promise.future();
+    data->promise.start();
+    QFuture<QImage> future = data->promise.future();
 
     m_areaScreenShots.push_back(std::move(data));
     effects->addRepaint(area);
@@ -209,7 +312,7 @@ void ScreenShotEffect::paintScreen(const RenderTarget &renderTarget, const Rende
     m_windowScreenShots.clear();
 
     for (int i = m_areaScreenShots.size() - 1; i >= 0; --i) {
-        if (takeScreenShot(renderTarget, viewport, &m_areaScreenShots[i])) {
+        if (takeScreenShot(renderTarget, viewport, m_areaScreenShots[i])) {
             m_areaScreenShots.erase(m_areaScreenShots.begin() + i);
         }
     }
@@ -252,7 +355,6 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
 
         // render window into offscreen texture
         int mask = PAINT_WINDOW_TRANSFORMED | PAINT_WINDOW_TRANSLUCENT;
-        QImage img;
         if (effects->isOpenGLCompositing()) {
             RenderTarget renderTarget(target.get());
             RenderViewport viewport(geometry, devicePixelRatio, renderTarget);
@@ -268,33 +370,37 @@ void ScreenShotEffect::takeScreenShot(ScreenShotWindowData *screenshot)
             effects->drawWindow(renderTarget, viewport, window, mask, infiniteRegion(), d);
 
             // copy content from framebuffer into image
-            img = QImage(offscreenTexture->size(), QImage::Format_ARGB32);
-            img.setDevicePixelRatio(devicePixelRatio);
-            glReadnPixels(0, 0, img.width(), img.height(), GL_RGBA, GL_UNSIGNED_BYTE, img.sizeInBytes(),
-                          static_cast<GLvoid *>(img.bits()));
+            auto promise = std::make_shared<QPromise<QImage>>(std::move(screenshot->promise));
+            readPixels(offscreenTexture->size(), renderTarget.transformation(), devicePixelRatio,
+                       [promise, geometry, cursor = grabCursor(screenshot->flags)](QImage &&img) {
+                           drawCursor(img, cursor, geometry.x(), geometry.y());
+                           promise->addResult(img);
+                           promise->finish();
+                       });
             GLFramebuffer::popFramebuffer();
-            convertFromGLImage(img, img.width(), img.height(), renderTarget.transformation());
-        }
-
-        if (screenshot->flags & ScreenShotIncludeCursor) {
-            grabPointerImage(img, geometry.x(), geometry.y());
         }
+    }
+}
 
-        screenshot->promise.addResult(img);
+static void finishAreaScreenShot(ScreenShotAreaData *screenshot)
+{
+    if (screenshot->screens.isEmpty() && !screenshot->pendingReadbacks) {
+        drawCursor(screenshot->result, screenshot->cursor, screenshot->area.x(), screenshot->area.y());
+        screenshot->promise.addResult(screenshot->result);
         screenshot->promise.finish();
     }
 }
 
-bool ScreenShotEffect::takeScreenShot(const RenderTarget &renderTarget, const RenderViewport &viewport, ScreenShotAreaData *screenshot)
+bool ScreenShotEffect::takeScreenShot(const RenderTarget &renderTarget, const RenderViewport &viewport, const std::shared_ptr<ScreenShotAreaData> &screenshot)
 {
     if (!effects->waylandDisplay()) {
         // On X11, all screens are painted simultaneously and there is no native HiDPI support.
-        QImage snapshot = blitScreenshot(renderTarget, viewport, screenshot->area);
-        if (screenshot->flags & ScreenShotIncludeCursor) {
-            grabPointerImage(snapshot, screenshot->area.x(), screenshot->area.y());
-        }
-        screenshot->promise.addResult(snapshot);
-        screenshot->promise.finish();
+        blitScreenshot(renderTarget, viewport, screenshot->area, 1.0,
+                       [screenshot, cursor = grabCursor(screenshot->flags)](QImage &&snapshot) {
+                           drawCursor(snapshot, cursor, screenshot->area.x(), screenshot->area.y());
+                           screenshot->promise.addResult(snapshot);
+                           screenshot->promise.finish();
+                       });
         return true;
     } else {
         if (!screenshot->screens.contains(m_paintedScreen)) {
@@ -308,26 +414,27 @@ bool ScreenShotEffect::takeScreenShot(const RenderTarget &renderTarget, const Re
             sourceDevicePixelRatio = m_paintedScreen->devicePixelRatio();
         }
 
-        const QImage snapshot = blitScreenshot(renderTarget, viewport, sourceRect, sourceDevicePixelRatio);
-        const QRect nativeArea(screenshot->area.topLeft(),
-                               screenshot->area.size() * screenshot->result.devicePixelRatio());
-
-        QPainter painter(&screenshot->result);
-        painter.setWindow(nativeArea);
-        painter.drawImage(sourceRect, snapshot);
-        painter.end();
-
         if (screenshot->screens.isEmpty()) {
-            if (screenshot->flags & ScreenShotIncludeCursor) {
-                grabPointerImage(screenshot->result, screenshot->area.x(), screenshot->area.y());
-            }
-            screenshot->promise.addResult(screenshot->result);
-            screenshot->promise.finish();
-            return true;
+            screenshot->cursor = grabCursor(screenshot->flags);
         }
-    }
 
-    return false;
+        screenshot->pendingReadbacks++;
+        blitScreenshot(renderTarget, viewport, sourceRect, sourceDevicePixelRatio,
+                       [screenshot, sourceRect](QImage &&snapshot) {
+                           const QRect nativeArea(screenshot->area.topLeft(),
+                                                  screenshot->area.size() * screenshot->result.devicePixelRatio());
+
+                           QPainter painter(&screenshot->result);
+                           painter.setWindow(nativeArea);
+                           painter.drawImage(sourceRect, snapshot);
+                           painter.end();
+
+                           screenshot->pendingReadbacks--;
+                           finishAreaScreenShot(screenshot.get());
+                       });
+
+        return screenshot->screens.isEmpty();
+    }
 }
 
 bool ScreenShotEffect::takeScreenShot(const RenderTarget &renderTarget, const RenderViewport &viewport, ScreenShotScreenData *screenshot)
@@ -341,62 +448,157 @@ bool ScreenShotEffect::takeScreenShot(const RenderTarget &renderTarget, const Re
         devicePixelRatio = screenshot->screen->devicePixelRatio();
     }
 
-    QImage snapshot = blitScreenshot(renderTarget, viewport, screenshot->screen->geometry(), devicePixelRatio);
-    if (screenshot->flags & ScreenShotIncludeCursor) {
-        const int xOffset = screenshot->screen->geometry().x();
-        const int yOffset = screenshot->screen->geometry().y();
-        grabPointerImage(snapshot, xOffset, yOffset);
+    auto promise = std::make_shared<QPromise<QImage>>(std::move(screenshot->promise));
+    blitScreenshot(renderTarget, viewport, screenshot->screen->geometry(), devicePixelRatio,
+                   [promise, geometry = screenshot->screen->geometry(), cursor = grabCursor(screenshot->flags)](QImage &&snapshot) {
+                       drawCursor(snapshot, cursor, geometry.x(), geometry.y());
+                       promise->addResult(snapshot);
+                       promise->finish();
+                   });
+
+    return true;
+}
+
+void ScreenShotEffect::blitScreenshot(const RenderTarget &renderTarget, const RenderViewport &viewport, const QRect &geometry, qreal devicePixelRatio,
+                                      std::function<void(QImage &&)> &&callback)
+{
+    if (!effects->isOpenGLCompositing()) {
+        QImage image;
+        image.setDevicePixelRatio(devicePixelRatio);
+        callback(std::move(image));
+        return;
     }
 
-    screenshot->promise.addResult(snapshot);
-    screenshot->promise.finish();
+    const auto screenGeometry = m_paintedScreen ? m_paintedScreen->geometry() : effects->virtualScreenGeometry();
+    const QSize nativeSize = renderTarget.applyTransformation(geometry, screenGeometry).size() * devicePixelRatio;
 
-    return true;
+    if (GLFramebuffer::blitSupported()) {
+        GLTexture texture(GL_RGBA8, nativeSize.width(), nativeSize.height());
+        GLFramebuffer target(&texture);
+        target.blitFromFramebuffer(viewport.mapToRenderTarget(geometry));
+
+        // copy content from framebuffer into image
+        GLFramebuffer::pushFramebuffer(&target);
+        readPixels(nativeSize, renderTarget.transformation(), devicePixelRatio, std::move(callback));
+        GLFramebuffer::popFramebuffer();
+    } else {
+        readPixels(nativeSize, renderTarget.transformation(), devicePixelRatio, std::move(callback));
+    }
 }
 
-QImage ScreenShotEffect::blitScreenshot(const RenderTarget &renderTarget, const RenderViewport &viewport, const QRect &geometry, qreal devicePixelRatio) const
+void ScreenShotEffect::readPixels(const QSize &size, const QMatrix4x4 &renderTargetTransformation, qreal devicePixelRatio,
+                                  std::function<void(QImage &&)> &&callback)
 {
-    QImage image;
+    if (!hasGLVersion(3, 0)) {
+        QImage image(size, QImage::Format_ARGB32);
+        glReadnPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, image.sizeInBytes(),
+                      static_cast<GLvoid *>(image.bits()));
+        convertFromGLImage(image, size.width(), size.height(), renderTargetTransformation);
+        image.setDevicePixelRatio(devicePixelRatio);
+        callback(std::move(image));
+        return;
+    }
 
-    if (effects->isOpenGLCompositing()) {
-        const auto screenGeometry = m_paintedScreen ? m_paintedScreen->geometry() : effects->virtualScreenGeometry();
-        const QSize nativeSize = renderTarget.applyTransformation(geometry, screenGeometry).size() * devicePixelRatio;
-        image = QImage(nativeSize, QImage::Format_ARGB32);
-
-        if (GLFramebuffer::blitSupported() && !GLPlatform::instance()->isGLES()) {
-            GLTexture texture(GL_RGBA8, nativeSize.width(), nativeSize.height());
-            GLFramebuffer target(&texture);
-            target.blitFromFramebuffer(viewport.mapToRenderTarget(geometry));
-            // copy content from framebuffer into image
-            texture.bind();
-            glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                          static_cast<GLvoid *>(image.bits()));
-            texture.unbind();
-        } else {
-            glReadPixels(0, 0, nativeSize.width(), nativeSize.height(), GL_RGBA,
-                         GL_UNSIGNED_BYTE, static_cast<GLvoid *>(image.bits()));
+    // Read the pixels into a pixel buffer object, it will be mapped after the GPU is done.
+    auto readback = std::make_unique<ScreenShotReadback>(ScreenShotReadback{
+        .size = size,
+        .renderTargetTransformation = renderTargetTransformation,
+        .devicePixelRatio = devicePixelRatio,
+        .callback = std::move(callback),
+    });
+
+    glGenBuffers(1, &readback->buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, qsizetype(size.width()) * size.height() * 4, nullptr, GL_STREAM_READ);
+    if (GLPlatform::instance()->isGLES()) {
+        glReadPixels(0, 0, size.width(), size.height(), GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    } else {
+        // Matches QImage::Format_ARGB32 regardless of the byte order, no conversion is needed.
+        glReadPixels(0, 0, size.width(), size.height(), GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, nullptr);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    ScreenShotReadback *pending = readback.get();
+    m_readbacks.push_back(std::move(readback));
+
+    // The fence file descriptor becomes readable once the GPU is done copying the pixels.
+    if (GLPlatform::instance()->platformInterface() == EglPlatformInterface) {
+        const ::EGLDisplay display = eglGetCurrentDisplay();
+        if (display != EGL_NO_DISPLAY && epoxy_has_egl_extension(display, "EGL_ANDROID_native_fence_sync")) {
+            pending->fence = std::make_unique<EGLNativeFence>(display);
+            if (pending->fence->isValid()) {
+                pending->notifier = std::make_unique<QSocketNotifier>(pending->fence->fileDescriptor(), QSocketNotifier::Read);
+                connect(pending->notifier.get(), &QSocketNotifier::activated, this, [this, pending]() {
+                    pending->notifier->setEnabled(false);
+                    if (effects->makeOpenGLContextCurrent()) {
+                        finishReadback(pending);
+                    } else {
+                        qCWarning(KWIN_SCREENSHOT) << "Failed to make the OpenGL context current";
+                        cancelReadback(pending);
+                    }
+                });
+                return;
+            }
+            qCWarning(KWIN_SCREENSHOT) << "Failed to create a native EGL fence";
         }
-        convertFromGLImage(image, nativeSize.width(), nativeSize.height(), renderTarget.transformation());
     }
 
-    image.setDevicePixelRatio(devicePixelRatio);
-    return image;
+    // Without a fence, mapping the pixel buffer will wait for the GPU.
+    finishReadback(pending);
 }
 
-void ScreenShotEffect::grabPointerImage(QImage &snapshot, int xOffset, int yOffset) const
+void ScreenShotEffect::finishReadback(ScreenShotReadback *readback)
 {
-    if (effects->isCursorHidden()) {
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+    const auto pixels = static_cast<const uchar *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, qsizetype(readback->size.width()) * readback->size.height() * 4, GL_MAP_READ_BIT));
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (!pixels) {
+        qCWarning(KWIN_SCREENSHOT) << "Failed to map the screenshot pixel buffer";
+        cancelReadback(readback);
         return;
     }
 
-    const PlatformCursorImage cursor = effects->cursorImage();
-    if (cursor.image().isNull()) {
-        return;
+    // Copying the pixels of a large screen takes a while, it's done in a worker thread so the
+    // compositor isn't blocked. The buffer stays mapped until the copy is done.
+    readback->copy = QtConcurrent::run([pixels,
+                                        size = readback->size,
+                                        renderTargetTransformation = readback->renderTargetTransformation,
+                                        devicePixelRatio = readback->devicePixelRatio,
+                                        convert = GLPlatform::instance()->isGLES()]() {
+        QImage image(size, QImage::Format_ARGB32);
+        copyFromPixelBuffer(pixels, image, convert);
+        applyRenderTargetTransformation(image, renderTargetTransformation, true);
+        image.setDevicePixelRatio(devicePixelRatio);
+        return image;
+    });
+
+    readback->copy.then(this, [this, readback](QImage image) {
+        if (effects->makeOpenGLContextCurrent()) {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readback->buffer);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+            glDeleteBuffers(1, &readback->buffer);
+        }
+
+        const std::function<void(QImage &&)> callback = std::move(readback->callback);
+        std::erase_if(m_readbacks, [readback](const auto &other) {
+            return other.get() == readback;
+        });
+        callback(std::move(image));
+    });
+}
+
+void ScreenShotEffect::cancelReadback(ScreenShotReadback *readback)
+{
+    if (effects->makeOpenGLContextCurrent()) {
+        glDeleteBuffers(1, &readback->buffer);
     }
 
-    QPainter painter(&snapshot);
-    painter.setRenderHint(QPainter::SmoothPixmapTransform);
-    painter.drawImage(effects->cursorPos() - cursor.hotSpot() - QPoint(xOffset, yOffset), cursor.image());
+    // The callback holds the promise, releasing it cancels the screenshot, so the caller
+    // gets an error instead of waiting forever.
+    std::erase_if(m_readbacks, [readback](const auto &other) {
+        return other.get() == readback;
+    });
 }
 
 bool ScreenShotEffect::isActive() const
@@ -16,6 +16,9 @@
 #include <QImage>
 #include <QObject>
 
+#include <functional>
+#include <memory>
+
 namespace KWin
 {
 
@@ -33,6 +36,7 @@ class ScreenShotDBusInterface2;
 struct ScreenShotWindowData;
 struct ScreenShotAreaData;
 struct ScreenShotScreenData;
+struct ScreenShotReadback;
 
 /**
  * The ScreenShotEffect provides a convenient way to capture the contents of a given window,
@@ -41,6 +45,10 @@ struct ScreenShotScreenData;
  * Use the QFutureWatcher class to get notified when the requested screenshot is ready. Note
  * that the screenshot QFuture object can get cancelled if the captured window or the screen is
  * removed.
+ *
+ * If pixel buffer objects are supported, the pixels are read back asynchronously and the future
+ * is finished after the GPU is done copying them, so taking a screenshot doesn't stall the
+ * compositor.
  */
 class ScreenShotEffect : public Effect
 {
@@ -83,19 +91,24 @@ private Q_SLOTS:
 
 private:
     void takeScreenShot(ScreenShotWindowData *screenshot);
-    bool takeScreenShot(const RenderTarget &renderTarget, const RenderViewport &viewport, ScreenShotAreaData *screenshot);
+    bool takeScreenShot(const RenderTarget &renderTarget, const RenderViewport &viewport, const std::shared_ptr<ScreenShotAreaData> &screenshot);
     bool takeScreenShot(const RenderTarget &renderTarget, const RenderViewport &viewport, ScreenShotScreenData *screenshot);
 
     void cancelWindowScreenShots();
     void cancelAreaScreenShots();
     void cancelScreenScreenShots();
 
-    void grabPointerImage(QImage &snapshot, int xOffset, int yOffset) const;
-    QImage blitScreenshot(const RenderTarget &renderTarget, const RenderViewport &viewport, const QRect &geometry, qreal devicePixelRatio = 1.0) const;
+    void blitScreenshot(const RenderTarget &renderTarget, const RenderViewport &viewport, const QRect &geometry, qreal devicePixelRatio,
+                        std::function<void(QImage &&)> &&callback);
+    void readPixels(const QSize &size, const QMatrix4x4 &renderTargetTransformation, qreal devicePixelRatio,
+                    std::function<void(QImage &&)> &&callback);
+    void finishReadback(ScreenShotReadback *readback);
+    void cancelReadback(ScreenShotReadback *readback);
 
     std::vector<ScreenShotWindowData> m_windowScreenShots;
-    std::vector<ScreenShotAreaData> m_areaScreenShots;
+    std::vector<std::shared_ptr<ScreenShotAreaData>> m_areaScreenShots;
     std::vector<ScreenShotScreenData> m_screenScreenShots;
+    std::vector<std::unique_ptr<ScreenShotReadback>> m_readbacks;
 
     std::unique_ptr<ScreenShotDBusInterface2> m_dbusInterface2;
     EffectScreen *m_paintedScreen = nullptr;
@@ -10,6 +10,7 @@
 #include "screenshot2adaptor.h"
 #include "screenshotlogging.h"
 #include "utils/filedescriptor.h"
+#include "utils/ramfile.h"
 #include "utils/serviceutils.h"
 
 #include <KLocalizedString>
@@ -20,6 +21,7 @@
 
 #include <errno.h>
 #include <fcntl.h>
+#include <limits>
 #include <poll.h>
 #include <string.h>
 #include <unistd.h>
@@ -120,6 +122,11 @@ static ScreenShotFlags screenShotFlagsFromOptions(const QVariantMap &options)
     return flags;
 }
 
+static bool useMemFdFromOptions(const QVariantMap &options)
+{
+    return options.value(QStringLiteral("memfd")).toBool();
+}
+
 static const QString s_dbusServiceName = QStringLiteral("org.kde.KWin.ScreenShot2");
 static const QString s_dbusInterface = QStringLiteral("org.kde.KWin.ScreenShot2");
 static const QString s_dbusObjectPath = QStringLiteral("/org/kde/KWin/ScreenShot2");
@@ -198,7 +205,7 @@ class ScreenShotSinkPipe2 : public QObject
     Q_OBJECT
 
 public:
-    ScreenShotSinkPipe2(int fileDescriptor, QDBusMessage replyMessage);
+    ScreenShotSinkPipe2(int fileDescriptor, QDBusMessage replyMessage, bool useMemFd);
 
     void cancel();
     void flush(const QImage &image, const QVariantMap &attributes);
@@ -206,6 +213,7 @@ public:
 private:
     QDBusMessage m_replyMessage;
     FileDescriptor m_fileDescriptor;
+    bool m_useMemFd;
 };
 
 ScreenShotSource2::ScreenShotSource2(const QFuture<QImage> &future)
@@ -274,9 +282,10 @@ QVariantMap ScreenShotSourceWindow2::attributes() const
     };
 }
 
-ScreenShotSinkPipe2::ScreenShotSinkPipe2(int fileDescriptor, QDBusMessage replyMessage)
+ScreenShotSinkPipe2::ScreenShotSinkPipe2(int fileDescriptor, QDBusMessage replyMessage, bool useMemFd)
     : m_replyMessage(replyMessage)
     , m_fileDescriptor(fileDescriptor)
+    , m_useMemFd(useMemFd)
 {
 }
 
@@ -300,6 +309,31 @@ void ScreenShotSinkPipe2::flush(const QImage &image, const QVariantMap &attribut
     results.insert(QStringLiteral("height"), quint32(image.height()));
     results.insert(QStringLiteral("stride"), quint32(image.bytesPerLine()));
     results.insert(QStringLiteral("scale"), double(image.devicePixelRatio()));
+
+    if (m_useMemFd) {
+        // The image is copied into the memfd in a worker thread and the reply is sent from
+        // there, the pipe is closed without any data written to it.
+        m_fileDescriptor = FileDescriptor();
+        const qsizetype size = image.sizeInBytes();
+        if (size > std::numeric_limits<int>::max()) {
+            qCWarning(KWIN_SCREENSHOT) << "The screenshot is too big to be passed in a memfd:" << size << "bytes";
+            QDBusConnection::sessionBus().send(m_replyMessage.createErrorReply(s_errorFileDescriptor,
+                                                                               s_errorFileDescriptorMessage));
+            return;
+        }
+        QThreadPool::globalInstance()->start([image, size, results, replyMessage = m_replyMessage]() mutable {
+            const RamFile file("kwin-screenshot", image.constBits(), int(size), RamFile::Flag::SealWrite);
+            if (!file.isValid()) {
+                QDBusConnection::sessionBus().send(replyMessage.createErrorReply(s_errorFileDescriptor,
+                                                                                 s_errorFileDescriptorMessage));
+                return;
+            }
+            results.insert(QStringLiteral("fd"), QVariant::fromValue(QDBusUnixFileDescriptor(file.fd())));
+            QDBusConnection::sessionBus().send(replyMessage.createReply(results));
+        });
+        return;
+    }
+
     QDBusConnection::sessionBus().send(m_replyMessage.createReply(results));
 
     auto writer = new ScreenShotWriter2(std::move(m_fileDescriptor), image);
@@ -325,7 +359,7 @@ ScreenShotDBusInterface2::~ScreenShotDBusInterface2()
 
 int ScreenShotDBusInterface2::version() const
 {
-    return 4;
+    return 5;
 }
 
 bool ScreenShotDBusInterface2::checkPermissions() const
@@ -374,7 +408,7 @@ QVariantMap ScreenShotDBusInterface2::CaptureActiveWindow(const QVariantMap &opt
     }
 
     takeScreenShot(window, screenShotFlagsFromOptions(options),
-                   new ScreenShotSinkPipe2(fileDescriptor, message()));
+                   new ScreenShotSinkPipe2(fileDescriptor, message(), useMemFdFromOptions(options)));
 
     setDelayedReply(true);
     return QVariantMap();
@@ -410,7 +444,7 @@ QVariantMap ScreenShotDBusInterface2::CaptureWindow(const QString &handle,
     }
 
     takeScreenShot(window, screenShotFlagsFromOptions(options),
-                   new ScreenShotSinkPipe2(fileDescriptor, message()));
+                   new ScreenShotSinkPipe2(fileDescriptor, message(), useMemFdFromOptions(options)));
 
     setDelayedReply(true);
     return QVariantMap();
@@ -437,7 +471,7 @@ QVariantMap ScreenShotDBusInterface2::CaptureArea(int x, int y, int width, int h
     }
 
     takeScreenShot(area, screenShotFlagsFromOptions(options),
-                   new ScreenShotSinkPipe2(fileDescriptor, message()));
+                   new ScreenShotSinkPipe2(fileDescriptor, message(), useMemFdFromOptions(options)));
 
     setDelayedReply(true);
     return QVariantMap();
@@ -464,7 +498,7 @@ QVariantMap ScreenShotDBusInterface2::CaptureScreen(const QString &name,
     }
 
     takeScreenShot(screen, screenShotFlagsFromOptions(options),
-                   new ScreenShotSinkPipe2(fileDescriptor, message()));
+                   new ScreenShotSinkPipe2(fileDescriptor, message(), useMemFdFromOptions(options)));
 
     setDelayedReply(true);
     return QVariantMap();
@@ -490,7 +524,7 @@ QVariantMap ScreenShotDBusInterface2::CaptureActiveScreen(const QVariantMap &opt
     }
 
     takeScreenShot(screen, screenShotFlagsFromOptions(options),
-                   new ScreenShotSinkPipe2(fileDescriptor, message()));
+                   new ScreenShotSinkPipe2(fileDescriptor, message(), useMemFdFromOptions(options)));
 
     setDelayedReply(true);
     return QVariantMap();
@@ -519,7 +553,7 @@ QVariantMap ScreenShotDBusInterface2::CaptureInteractive(uint kind,
                 bus.send(replyMessage.createErrorReply(s_errorCancelled, s_errorCancelledMessage));
             } else {
                 takeScreenShot(window, screenShotFlagsFromOptions(options),
-                               new ScreenShotSinkPipe2(fileDescriptor, replyMessage));
+                               new ScreenShotSinkPipe2(fileDescriptor, replyMessage, useMemFdFromOptions(options)));
             }
         });
         effects->showOnScreenMessage(i18n("Select window to screen shot with left click or enter.\n"
@@ -537,7 +571,7 @@ QVariantMap ScreenShotDBusInterface2::CaptureInteractive(uint kind,
             } else {
                 EffectScreen *screen = effects->screenAt(point.toPoint());
                 takeScreenShot(screen, screenShotFlagsFromOptions(options),
-                               new ScreenShotSinkPipe2(fileDescriptor, replyMessage));
+                               new ScreenShotSinkPipe2(fileDescriptor, replyMessage, useMemFdFromOptions(options)));
             }
         });
         effects->showOnScreenMessage(i18n("Create screen shot with left click or enter.\n"
@@ -562,7 +596,7 @@ QVariantMap ScreenShotDBusInterface2::CaptureWorkspace(const QVariantMap &option
     }
 
     takeScreenShot(effects->virtualScreenGeometry(), screenShotFlagsFromOptions(options),
-                   new ScreenShotSinkPipe2(fileDescriptor, message()));
+                   new ScreenShotSinkPipe2(fileDescriptor, message(), useMemFdFromOptions(options)));
 
     setDelayedReply(true);
     return QVariantMap();
@@ -187,6 +187,28 @@ Rectangle {
             }
         }
 
+        RowLayout {
+            Layout.fillWidth: true
+
+            ChartControls.LegendDelegate {
+                Layout.fillWidth: true
+                Layout.preferredWidth: 0
+
+                name: i18nc("@label", "CPU Render Time")
+                value: i18nc("@label duration in milliseconds", "%1 ms", root.effect.cpuRenderTime.toFixed(2))
+                color: Kirigami.Theme.positiveTextColor
+            }
+
+            ChartControls.LegendDelegate {
+                Layout.fillWidth: true
+                Layout.preferredWidth: 0
+
+                name: i18nc("@label", "GPU Render Time")
+                value: root.effect.gpuRenderTime > 0 ? i18nc("@label duration in milliseconds", "%1 ms", root.effect.gpuRenderTime.toFixed(2)) : i18nc("@label GPU render time is not known", "n/a")
+                color: Kirigami.Theme.negativeTextColor
+            }
+        }
+
         Label {
             Layout.fillWidth: true
             text: i18nc("@label", "This effect is not a benchmark")
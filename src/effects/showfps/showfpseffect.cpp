@@ -46,6 +46,16 @@ QColor ShowFpsEffect::paintColor() const
     return QColor::fromHsvF(0.3 - (0.3 * normalizedDuration), 1.0, 1.0);
 }
 
+qreal ShowFpsEffect::cpuRenderTime() const
+{
+    return m_cpuRenderTime;
+}
+
+qreal ShowFpsEffect::gpuRenderTime() const
+{
+    return m_gpuRenderTime;
+}
+
 void ShowFpsEffect::prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime)
 {
     effects->prePaintScreen(data, presentTime);
@@ -85,10 +95,15 @@ void ShowFpsEffect::paintScreen(const RenderTarget &renderTarget, const RenderVi
         m_newFps = 0;
         m_lastFpsTime = now;
         Q_EMIT fpsChanged();
+
+        // Convert from nanoseconds to milliseconds.
+        m_cpuRenderTime = screen->cpuRenderTime().count() / 1'000'000.0;
+        m_gpuRenderTime = screen->gpuRenderTime().count() / 1'000'000.0;
+        Q_EMIT renderTimeChanged();
     }
 
     const auto rect = viewport.renderRect();
-    m_scene->setGeometry(QRect(rect.x() + rect.width() - 300, 0, 300, 150));
+    m_scene->setGeometry(QRect(rect.x() + rect.width() - 300, 0, 300, 180));
     effects->renderOffscreenQuickView(renderTarget, viewport, m_scene.get());
 }
 
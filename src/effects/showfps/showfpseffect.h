@@ -24,6 +24,8 @@ class ShowFpsEffect : public Effect
     Q_PROPERTY(int paintDuration READ paintDuration NOTIFY paintChanged)
     Q_PROPERTY(int paintAmount READ paintAmount NOTIFY paintChanged)
     Q_PROPERTY(QColor paintColor READ paintColor NOTIFY paintChanged)
+    Q_PROPERTY(qreal cpuRenderTime READ cpuRenderTime NOTIFY renderTimeChanged)
+    Q_PROPERTY(qreal gpuRenderTime READ gpuRenderTime NOTIFY renderTimeChanged)
 
 public:
     ShowFpsEffect();
@@ -34,6 +36,8 @@ public:
     int paintDuration() const;
     int paintAmount() const;
     QColor paintColor() const;
+    qreal cpuRenderTime() const;
+    qreal gpuRenderTime() const;
 
     void prePaintScreen(ScreenPrePaintData &data, std::chrono::milliseconds presentTime) override;
     void paintScreen(const RenderTarget &renderTarget, const RenderViewport &viewport, int mask, const QRegion &region, EffectScreen *screen) override;
@@ -46,6 +50,7 @@ Q_SIGNALS:
     void fpsChanged();
     void maximumFpsChanged();
     void paintChanged();
+    void renderTimeChanged();
 
 private:
     std::unique_ptr<OffscreenQuickScene> m_scene;
@@ -59,6 +64,9 @@ private:
     int m_paintDuration = 0;
     int m_paintAmount = 0;
     QElapsedTimer m_paintDurationTimer;
+
+    qreal m_cpuRenderTime = 0;
+    qreal m_gpuRenderTime = 0;
 };
 
 } // namespace KWin
@@ -0,0 +1,322 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "frametimeline.h"
+
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStandardPaths>
+#include <QThread>
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+namespace KWin
+{
+KWIN_SINGLETON_FACTORY(KWin::FrameTimeline)
+
+namespace
+{
+
+/**
+ * A single entry in the ring buffer. The entry is protected by a sequence lock, the writer
+ * makes the sequence number odd while updating the entry, which lets a concurrent reader
+ * detect and skip torn entries.
+ */
+struct FrameTimelineEntry
+{
+    std::atomic<quint64> sequence{0};
+    std::atomic<qint64> start{0};
+    std::atomic<qint64> duration{0};
+    std::atomic<quint64> frame{0};
+    std::atomic<quint64> object{0};
+    std::atomic<quint8> event{0};
+    std::atomic<bool> instant{false};
+};
+
+struct FrameTimelineRing
+{
+    static constexpr quint64 capacity = 16384;
+
+    int threadId = 0;
+    QString threadName;
+    std::atomic<quint64> head{0};
+    std::array<FrameTimelineEntry, capacity> entries;
+};
+
+struct FrameTimelineRegistry
+{
+    QMutex mutex;
+    std::vector<std::shared_ptr<FrameTimelineRing>> rings;
+    int nextThreadId = 1;
+};
+
+}
+
+static std::atomic<bool> s_enabled{true};
+static std::atomic<quint64> s_frameCounter{0};
+static thread_local quint64 s_currentFrame = 0;
+static thread_local std::shared_ptr<FrameTimelineRing> s_ring;
+
+static FrameTimelineRegistry *registry()
+{
+    static FrameTimelineRegistry registry;
+    return &registry;
+}
+
+static FrameTimelineRing *threadRing()
+{
+    if (Q_UNLIKELY(!s_ring)) {
+        auto ring = std::make_shared<FrameTimelineRing>();
+
+        FrameTimelineRegistry *reg = registry();
+        QMutexLocker locker(&reg->mutex);
+        ring->threadId = reg->nextThreadId++;
+        if (QThread *thread = QThread::currentThread()) {
+            ring->threadName = thread->objectName();
+        }
+        // Forget about threads that have finished, otherwise short-lived worker threads would
+        // keep accumulating buffers.
+        std::erase_if(reg->rings, [](const std::shared_ptr<FrameTimelineRing> &other) {
+            return other.use_count() == 1;
+        });
+        reg->rings.push_back(ring);
+
+        s_ring = ring;
+    }
+    return s_ring.get();
+}
+
+static void record(FrameTimelineEvent event, std::chrono::nanoseconds start, std::chrono::nanoseconds duration, quint64 object, quint64 frame, bool instant)
+{
+    FrameTimelineRing *ring = threadRing();
+
+    const quint64 index = ring->head.load(std::memory_order_relaxed);
+    FrameTimelineEntry &entry = ring->entries[index % FrameTimelineRing::capacity];
+
+    const quint64 sequence = entry.sequence.load(std::memory_order_relaxed);
+    entry.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    entry.start.store(start.count(), std::memory_order_relaxed);
+    entry.duration.store(duration.count(), std::memory_order_relaxed);
+    entry.frame.store(frame, std::memory_order_relaxed);
+    entry.object.store(object, std::memory_order_relaxed);
+    entry.event.store(quint8(event), std::memory_order_relaxed);
+    entry.instant.store(instant, std::memory_order_relaxed);
+
+    entry.sequence.store(sequence + 2, std::memory_order_release);
+    ring->head.store(index + 1, std::memory_order_release);
+}
+
+FrameTimeline::FrameTimeline(QObject *parent)
+    : QObject(parent)
+{
+    bool ok = false;
+    const int enabled = qEnvironmentVariableIntValue("KWIN_FRAME_TIMELINE", &ok);
+    if (ok) {
+        s_enabled = enabled;
+    }
+    QDBusConnection::sessionBus().registerObject(QStringLiteral("/FrameTimeline"), this, QDBusConnection::ExportScriptableContents);
+}
+
+FrameTimeline::~FrameTimeline()
+{
+    QDBusConnection::sessionBus().unregisterObject(QStringLiteral("/FrameTimeline"));
+    s_self = nullptr;
+}
+
+bool FrameTimeline::isEnabled()
+{
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+void FrameTimeline::setEnabled(bool enabled)
+{
+    if (s_enabled.exchange(enabled) != enabled) {
+        Q_EMIT enabledChanged();
+    }
+}
+
+void FrameTimeline::instant(FrameTimelineEvent event, quint64 object)
+{
+    if (isEnabled()) {
+        record(event, now(), std::chrono::nanoseconds::zero(), object, s_currentFrame, true);
+    }
+}
+
+void FrameTimeline::instant(FrameTimelineEvent event, quint64 object, quint64 frame)
+{
+    if (isEnabled()) {
+        record(event, now(), std::chrono::nanoseconds::zero(), object, frame, true);
+    }
+}
+
+void FrameTimeline::complete(FrameTimelineEvent event, std::chrono::nanoseconds start, quint64 object)
+{
+    if (isEnabled()) {
+        record(event, start, now() - start, object, s_currentFrame, false);
+    }
+}
+
+quint64 FrameTimeline::startFrame()
+{
+    s_currentFrame = ++s_frameCounter;
+    return s_currentFrame;
+}
+
+quint64 FrameTimeline::currentFrame()
+{
+    return s_currentFrame;
+}
+
+void FrameTimeline::setCurrentFrame(quint64 frame)
+{
+    s_currentFrame = frame;
+}
+
+QString FrameTimeline::eventName(FrameTimelineEvent event)
+{
+    switch (event) {
+    case FrameTimelineEvent::ScheduleRepaint:
+        return QStringLiteral("ScheduleRepaint");
+    case FrameTimelineEvent::TimerFired:
+        return QStringLiteral("TimerFired");
+    case FrameTimelineEvent::Composite:
+        return QStringLiteral("Composite");
+    case FrameTimelineEvent::PrePaint:
+        return QStringLiteral("PrePaint");
+    case FrameTimelineEvent::EffectChain:
+        return QStringLiteral("EffectChain");
+    case FrameTimelineEvent::RenderNodeBuild:
+        return QStringLiteral("RenderNodeBuild");
+    case FrameTimelineEvent::GLSubmit:
+        return QStringLiteral("GLSubmit");
+    case FrameTimelineEvent::AtomicCommit:
+        return QStringLiteral("AtomicCommit");
+    case FrameTimelineEvent::PageFlip:
+        return QStringLiteral("PageFlip");
+    case FrameTimelineEvent::ClientCommit:
+        return QStringLiteral("ClientCommit");
+    case FrameTimelineEvent::FrameCallback:
+        return QStringLiteral("FrameCallback");
+    }
+    return QStringLiteral("Unknown");
+}
+
+QByteArray FrameTimeline::toTraceEventJson()
+{
+    std::vector<std::shared_ptr<FrameTimelineRing>> rings;
+    {
+        FrameTimelineRegistry *reg = registry();
+        QMutexLocker locker(&reg->mutex);
+        rings = reg->rings;
+    }
+
+    // Chrome trace events use microseconds.
+    auto toMicroseconds = [](qint64 nanoseconds) {
+        return nanoseconds / 1000.0;
+    };
+
+    const qint64 pid = QCoreApplication::applicationPid();
+
+    QJsonArray events;
+    for (const auto &ring : rings) {
+        events.append(QJsonObject{
+            {QStringLiteral("name"), QStringLiteral("thread_name")},
+            {QStringLiteral("ph"), QStringLiteral("M")},
+            {QStringLiteral("pid"), pid},
+            {QStringLiteral("tid"), ring->threadId},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), ring->threadName.isEmpty() ? QStringLiteral("Thread %1").arg(ring->threadId) : ring->threadName}}},
+        });
+
+        const quint64 head = ring->head.load(std::memory_order_acquire);
+        const quint64 first = head > FrameTimelineRing::capacity ? head - FrameTimelineRing::capacity : 0;
+        for (quint64 index = first; index < head; ++index) {
+            const FrameTimelineEntry &entry = ring->entries[index % FrameTimelineRing::capacity];
+
+            const quint64 sequence = entry.sequence.load(std::memory_order_acquire);
+            const qint64 start = entry.start.load(std::memory_order_relaxed);
+            const qint64 duration = entry.duration.load(std::memory_order_relaxed);
+            const quint64 frame = entry.frame.load(std::memory_order_relaxed);
+            const quint64 object = entry.object.load(std::memory_order_relaxed);
+            const auto event = FrameTimelineEvent(entry.event.load(std::memory_order_relaxed));
+            const bool instant = entry.instant.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            // Skip entries that are being written or that have been overwritten meanwhile.
+            if (sequence % 2 || sequence != entry.sequence.load(std::memory_order_relaxed) || sequence / 2 != index / FrameTimelineRing::capacity + 1) {
+                continue;
+            }
+
+            QJsonObject traceEvent{
+                {QStringLiteral("name"), eventName(event)},
+                {QStringLiteral("cat"), QStringLiteral("frame")},
+                {QStringLiteral("pid"), pid},
+                {QStringLiteral("tid"), ring->threadId},
+                {QStringLiteral("ts"), toMicroseconds(start)},
+                {QStringLiteral("args"), QJsonObject{
+                                             {QStringLiteral("frame"), QString::number(frame)},
+                                             {QStringLiteral("object"), QStringLiteral("0x%1").arg(object, 0, 16)},
+                                         }},
+            };
+            if (instant) {
+                traceEvent.insert(QStringLiteral("ph"), QStringLiteral("i"));
+                traceEvent.insert(QStringLiteral("s"), QStringLiteral("t"));
+            } else {
+                traceEvent.insert(QStringLiteral("ph"), QStringLiteral("X"));
+                traceEvent.insert(QStringLiteral("dur"), toMicroseconds(duration));
+            }
+            events.append(traceEvent);
+        }
+    }
+
+    const QJsonObject trace{
+        {QStringLiteral("traceEvents"), events},
+        {QStringLiteral("displayTimeUnit"), QStringLiteral("ns")},
+    };
+    return QJsonDocument(trace).toJson(QJsonDocument::Compact);
+}
+
+QString FrameTimeline::dump() const
+{
+    return QString::fromUtf8(toTraceEventJson());
+}
+
+QString FrameTimeline::dumpToFile() const
+{
+    const QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (directory.isEmpty() || !QDir().mkpath(directory)) {
+        return QString();
+    }
+
+    const QString fileName = directory + QLatin1String("/frametimeline-")
+        + QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss-zzz")) + QLatin1String(".json");
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return QString();
+    }
+    if (file.write(toTraceEventJson()) == -1) {
+        file.remove();
+        return QString();
+    }
+    return fileName;
+}
+
+} // namespace KWin
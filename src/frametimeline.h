@@ -0,0 +1,154 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "libkwineffects/kwinglobals.h"
+
+#include <QObject>
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The types of events recorded in the frame timeline.
+ */
+enum class FrameTimelineEvent : quint8 {
+    ScheduleRepaint,
+    TimerFired,
+    Composite,
+    PrePaint,
+    EffectChain,
+    RenderNodeBuild,
+    GLSubmit,
+    AtomicCommit,
+    PageFlip,
+    ClientCommit,
+    FrameCallback,
+};
+
+/**
+ * FrameTimeline records what happens during every compositing cycle so that stutter can be
+ * investigated after the fact.
+ *
+ * Events are stored in a fixed size ring buffer per thread, recording an event doesn't take
+ * any locks nor allocate memory. Every event is tagged with the frame that is currently
+ * being produced, which allows to relate, for example, a page flip to the compositing cycle
+ * that started it.
+ *
+ * The recorded events can be retrieved in the Chrome trace event format, which is understood
+ * by Perfetto and chrome://tracing, by calling on DBus /FrameTimeline org.kde.kwin.FrameTimeline.dump
+ * or org.kde.kwin.FrameTimeline.dumpToFile
+ *
+ * Recording is enabled by default and can be turned off by setting the KWIN_FRAME_TIMELINE
+ * environment variable to 0, or by calling org.kde.kwin.FrameTimeline.setEnabled false
+ */
+class KWIN_EXPORT FrameTimeline : public QObject
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "org.kde.kwin.FrameTimeline")
+    Q_PROPERTY(bool isEnabled READ isEnabled NOTIFY enabledChanged)
+
+public:
+    ~FrameTimeline() override;
+
+    static bool isEnabled();
+
+    /**
+     * Records an event without duration that happened just now.
+     */
+    static void instant(FrameTimelineEvent event, quint64 object = 0);
+
+    /**
+     * Records an event without duration that happened just now and belongs to @a frame.
+     */
+    static void instant(FrameTimelineEvent event, quint64 object, quint64 frame);
+
+    /**
+     * Records an event that started at @a start and ended just now.
+     */
+    static void complete(FrameTimelineEvent event, std::chrono::nanoseconds start, quint64 object = 0);
+
+    /**
+     * Allocates a new frame identifier and makes it the current frame of the calling thread.
+     */
+    static quint64 startFrame();
+
+    /**
+     * Returns the frame that is currently being produced by the calling thread.
+     */
+    static quint64 currentFrame();
+
+    /**
+     * Makes @a frame the current frame of the calling thread.
+     */
+    static void setCurrentFrame(quint64 frame);
+
+    /**
+     * Returns all recorded events in the Chrome trace event format.
+     */
+    static QByteArray toTraceEventJson();
+
+    static QString eventName(FrameTimelineEvent event);
+
+    /**
+     * Returns the current monotonic time, the clock that is used for all event timestamps.
+     */
+    static std::chrono::nanoseconds now()
+    {
+        return std::chrono::steady_clock::now().time_since_epoch();
+    }
+
+Q_SIGNALS:
+    void enabledChanged();
+
+public Q_SLOTS:
+    Q_SCRIPTABLE void setEnabled(bool enabled);
+    Q_SCRIPTABLE QString dump() const;
+    /**
+     * Writes the recorded events to a new file in the cache directory of the compositor
+     * and returns its path, or an empty string if the file could not be written.
+     */
+    Q_SCRIPTABLE QString dumpToFile() const;
+
+private:
+    KWIN_SINGLETON(FrameTimeline)
+};
+
+/**
+ * Records an event that spans the lifetime of the FrameTimelineScope object.
+ */
+class FrameTimelineScope
+{
+public:
+    explicit FrameTimelineScope(FrameTimelineEvent event, quint64 object = 0)
+        : m_start(FrameTimeline::isEnabled() ? FrameTimeline::now() : std::chrono::nanoseconds::zero())
+        , m_object(object)
+        , m_event(event)
+    {
+    }
+
+    ~FrameTimelineScope()
+    {
+        if (m_start.count()) {
+            FrameTimeline::complete(m_event, m_start, m_object);
+        }
+    }
+
+private:
+    Q_DISABLE_COPY(FrameTimelineScope)
+
+    const std::chrono::nanoseconds m_start;
+    const quint64 m_object;
+    const FrameTimelineEvent m_event;
+};
+
+} // namespace KWin
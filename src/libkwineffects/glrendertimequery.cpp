@@ -0,0 +1,95 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "libkwineffects/glrendertimequery.h"
+#include "libkwineffects/kwinglplatform.h"
+#include "libkwineffects/kwinglutils.h"
+
+namespace KWin
+{
+
+GLRenderTimeQuery::GLRenderTimeQuery()
+{
+}
+
+GLRenderTimeQuery::~GLRenderTimeQuery()
+{
+    if (m_initialized) {
+        glDeleteQueries(m_queries.size(), m_queries.data());
+    }
+}
+
+bool GLRenderTimeQuery::supported()
+{
+    if (GLPlatform::instance()->isGLES()) {
+        return hasGLVersion(3, 0) && hasGLExtension(QByteArrayLiteral("GL_EXT_disjoint_timer_query"));
+    }
+    return hasGLVersion(3, 3) || hasGLExtension(QByteArrayLiteral("GL_ARB_timer_query"));
+}
+
+void GLRenderTimeQuery::begin()
+{
+    if (!m_initialized) {
+        glGenQueries(m_queries.size(), m_queries.data());
+        m_initialized = true;
+    }
+    if (m_pendingCount == s_queryCount) {
+        return;
+    }
+
+    const int index = (m_head + m_pendingCount) % s_queryCount;
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[index]);
+    m_active = true;
+}
+
+void GLRenderTimeQuery::end()
+{
+    if (!m_active) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    m_active = false;
+    m_pendingCount++;
+}
+
+std::optional<std::chrono::nanoseconds> GLRenderTimeQuery::takeResult()
+{
+    while (m_pendingCount > 0) {
+        const GLuint query = m_queries[m_head];
+
+        GLuint available = GL_FALSE;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            return std::nullopt;
+        }
+
+        m_head = (m_head + 1) % s_queryCount;
+        m_pendingCount--;
+
+        if (GLPlatform::instance()->isGLES()) {
+            // The timer may have been disrupted, e.g. by a GPU frequency change, in which case
+            // the results of all pending queries are undefined.
+            GLint disjoint = GL_FALSE;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+            if (disjoint) {
+                continue;
+            }
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64vEXT(query, GL_QUERY_RESULT, &elapsed);
+            return std::chrono::nanoseconds(elapsed);
+        }
+
+        GLuint64 elapsed = 0;
+        glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+        return std::chrono::nanoseconds(elapsed);
+    }
+    return std::nullopt;
+}
+
+} // namespace KWin
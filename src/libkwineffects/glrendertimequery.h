@@ -0,0 +1,70 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "libkwineffects/kwinglutils_export.h"
+
+#include <epoxy/gl.h>
+
+#include <array>
+#include <chrono>
+#include <optional>
+
+namespace KWin
+{
+
+/**
+ * The GLRenderTimeQuery class measures how long it takes the GPU to execute the commands
+ * issued between begin() and end().
+ *
+ * The results of timer queries become available only after the GPU has finished the work,
+ * so a small ring of queries is kept in flight and finished results are collected with
+ * takeResult() a couple of frames later without stalling the pipeline.
+ *
+ * The OpenGL context that was current when the first query was started must be current
+ * whenever any method is called, including the destructor.
+ */
+class KWINGLUTILS_EXPORT GLRenderTimeQuery
+{
+public:
+    GLRenderTimeQuery();
+    ~GLRenderTimeQuery();
+
+    /**
+     * Returns @c true if the current OpenGL context supports timer queries.
+     */
+    static bool supported();
+
+    /**
+     * Starts measuring the GPU time. If all queries are still in flight, the frame is not measured.
+     */
+    void begin();
+
+    /**
+     * Stops measuring the GPU time.
+     */
+    void end();
+
+    /**
+     * Returns the oldest available result, or @c std::nullopt if no query has finished yet.
+     */
+    std::optional<std::chrono::nanoseconds> takeResult();
+
+private:
+    static constexpr int s_queryCount = 4;
+
+    std::array<GLuint, s_queryCount> m_queries = {};
+    int m_head = 0;
+    int m_pendingCount = 0;
+    bool m_active = false;
+    bool m_initialized = false;
+};
+
+} // namespace KWin
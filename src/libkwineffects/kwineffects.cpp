@@ -938,6 +938,28 @@ WindowQuadList WindowQuadList::makeRegularGrid(int xSubdivisions, int ySubdivisi
     return ret;
 }
 
+/***************************************************************
+ CompactWindowQuadList
+***************************************************************/
+
+CompactWindowQuadList::CompactWindowQuadList(const WindowQuadList &quads)
+{
+    reserve(quads.count());
+    for (const WindowQuad &quad : quads) {
+        append(CompactWindowQuad(quad));
+    }
+}
+
+WindowQuadList CompactWindowQuadList::toWindowQuadList() const
+{
+    WindowQuadList quads;
+    quads.reserve(count());
+    for (const CompactWindowQuad &quad : *this) {
+        quads.append(quad.toWindowQuad());
+    }
+    return quads;
+}
+
 void RenderGeometry::copy(std::span<GLVertex2D> destination)
 {
     Q_ASSERT(int(destination.size()) >= size());
@@ -975,7 +997,32 @@ void RenderGeometry::appendWindowQuad(const WindowQuad &quad, qreal deviceScale)
     appendWindowVertex(quad[2], deviceScale);
 }
 
-void RenderGeometry::appendSubQuad(const WindowQuad &quad, const QRectF &subquad, qreal deviceScale)
+void RenderGeometry::appendWindowQuad(const CompactWindowQuad &quad, qreal deviceScale)
+{
+    std::array<GLVertex2D, 4> vertices;
+    for (int i = 0; i < 4; ++i) {
+        switch (m_vertexSnappingMode) {
+        case VertexSnappingMode::None:
+            vertices[i].position = QVector2D(quad.x(i), quad.y(i)) * deviceScale;
+            break;
+        case VertexSnappingMode::Round:
+            vertices[i].position = roundVector(QVector2D(quad.x(i), quad.y(i)) * deviceScale);
+            break;
+        }
+        vertices[i].texcoord = QVector2D(quad.u(i), quad.v(i));
+    }
+
+    append(vertices[0]);
+    append(vertices[3]);
+    append(vertices[1]);
+
+    append(vertices[1]);
+    append(vertices[3]);
+    append(vertices[2]);
+}
+
+template<typename Quad>
+static void appendSubQuadHelper(RenderGeometry *geometry, const Quad &quad, const std::array<double, 4> &u, const std::array<double, 4> &v, const QRectF &subquad, qreal deviceScale)
 {
     std::array<GLVertex2D, 4> vertices;
     vertices[0].position = QVector2D(subquad.topLeft());
@@ -996,20 +1043,34 @@ void RenderGeometry::appendSubQuad(const WindowQuad &quad, const QRectF &subquad
         const double oneMinW1 = 1.0 - weight1;
         const double oneMinW2 = 1.0 - weight2;
 
-        const float u = oneMinW1 * oneMinW2 * quad[0].u() + weight1 * oneMinW2 * quad[1].u()
-            + weight1 * weight2 * quad[2].u() + oneMinW1 * weight2 * quad[3].u();
-        const float v = oneMinW1 * oneMinW2 * quad[0].v() + weight1 * oneMinW2 * quad[1].v()
-            + weight1 * weight2 * quad[2].v() + oneMinW1 * weight2 * quad[3].v();
-        vertices[i].texcoord = QVector2D(u, v);
+        const float tu = oneMinW1 * oneMinW2 * u[0] + weight1 * oneMinW2 * u[1]
+            + weight1 * weight2 * u[2] + oneMinW1 * weight2 * u[3];
+        const float tv = oneMinW1 * oneMinW2 * v[0] + weight1 * oneMinW2 * v[1]
+            + weight1 * weight2 * v[2] + oneMinW1 * weight2 * v[3];
+        vertices[i].texcoord = QVector2D(tu, tv);
     }
 
-    append(vertices[0]);
-    append(vertices[3]);
-    append(vertices[1]);
+    geometry->append(vertices[0]);
+    geometry->append(vertices[3]);
+    geometry->append(vertices[1]);
 
-    append(vertices[1]);
-    append(vertices[3]);
-    append(vertices[2]);
+    geometry->append(vertices[1]);
+    geometry->append(vertices[3]);
+    geometry->append(vertices[2]);
+}
+
+void RenderGeometry::appendSubQuad(const WindowQuad &quad, const QRectF &subquad, qreal deviceScale)
+{
+    const std::array<double, 4> u{quad[0].u(), quad[1].u(), quad[2].u(), quad[3].u()};
+    const std::array<double, 4> v{quad[0].v(), quad[1].v(), quad[2].v(), quad[3].v()};
+    appendSubQuadHelper(this, quad, u, v, subquad, deviceScale);
+}
+
+void RenderGeometry::appendSubQuad(const CompactWindowQuad &quad, const QRectF &subquad, qreal deviceScale)
+{
+    const std::array<double, 4> u{quad.u(0), quad.u(1), quad.u(2), quad.u(3)};
+    const std::array<double, 4> v{quad.v(0), quad.v(1), quad.v(2), quad.v(3)};
+    appendSubQuadHelper(this, quad, u, v, subquad, deviceScale);
 }
 
 void RenderGeometry::postProcessTextureCoordinates(const QMatrix4x4 &textureMatrix)
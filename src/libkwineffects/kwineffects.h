@@ -161,7 +161,7 @@ typedef QList<KWin::EffectWindow *> EffectWindowList;
 
 #define KWIN_EFFECT_API_MAKE_VERSION(major, minor) ((major) << 8 | (minor))
 #define KWIN_EFFECT_API_VERSION_MAJOR 0
-#define KWIN_EFFECT_API_VERSION_MINOR 236
+#define KWIN_EFFECT_API_VERSION_MINOR 237
 #define KWIN_EFFECT_API_VERSION KWIN_EFFECT_API_MAKE_VERSION( \
     KWIN_EFFECT_API_VERSION_MAJOR, KWIN_EFFECT_API_VERSION_MINOR)
 
@@ -1954,6 +1954,17 @@ public:
      */
     virtual int refreshRate() const = 0;
 
+    /**
+     * Returns the smoothed amount of time that it takes to paint a frame for this screen.
+     */
+    virtual std::chrono::nanoseconds cpuRenderTime() const = 0;
+
+    /**
+     * Returns the smoothed amount of time that it takes the GPU to render a frame for this
+     * screen, or zero if the GPU time is not known.
+     */
+    virtual std::chrono::nanoseconds gpuRenderTime() const = 0;
+
     enum class Transform {
         Normal,
         Rotated90,
@@ -2848,6 +2859,51 @@ public:
     WindowQuadList makeRegularGrid(int xSubdivisions, int ySubdivisions) const;
 };
 
+/**
+ * @short Compact representation of one area of a window.
+ *
+ * CompactWindowQuad holds the same vertices as WindowQuad, but in single precision, which
+ * makes it half as big. The coordinates are stored per component, so the quad is 16 byte
+ * aligned and each component of all four vertices can be loaded at once.
+ *
+ * The vertices are expected to be in the clockwise order starting from top-left.
+ */
+class KWINEFFECTS_EXPORT CompactWindowQuad
+{
+public:
+    CompactWindowQuad() = default;
+    CompactWindowQuad(const WindowQuad &quad);
+
+    void setVertex(int index, const QPointF &position, const QPointF &textureCoordinate);
+    WindowQuad toWindowQuad() const;
+
+    float x(int index) const;
+    float y(int index) const;
+    float u(int index) const;
+    float v(int index) const;
+    float left() const;
+    float right() const;
+    float top() const;
+    float bottom() const;
+    QRectF bounds() const;
+
+private:
+    alignas(16) float m_x[4] = {};
+    alignas(16) float m_y[4] = {};
+    alignas(16) float m_u[4] = {};
+    alignas(16) float m_v[4] = {};
+};
+
+class KWINEFFECTS_EXPORT CompactWindowQuadList
+    : public QVector<CompactWindowQuad>
+{
+public:
+    CompactWindowQuadList() = default;
+    explicit CompactWindowQuadList(const WindowQuadList &quads);
+
+    WindowQuadList toWindowQuadList() const;
+};
+
 /**
  * A helper class for render geometry in device coordinates.
  *
@@ -2931,6 +2987,10 @@ public:
      *                    coordinates.
      */
     void appendWindowQuad(const WindowQuad &quad, qreal deviceScale);
+    /**
+     * @overload
+     */
+    void appendWindowQuad(const CompactWindowQuad &quad, qreal deviceScale);
     /**
      * Append a sub-quad of a WindowQuad as two triangles.
      *
@@ -2947,6 +3007,10 @@ public:
      *                    device coordinates.
      */
     void appendSubQuad(const WindowQuad &quad, const QRectF &subquad, qreal deviceScale);
+    /**
+     * @overload
+     */
+    void appendSubQuad(const CompactWindowQuad &quad, const QRectF &subquad, qreal deviceScale);
     /**
      * Modify this geometry's texture coordinates based on a matrix.
      *
@@ -4059,6 +4123,87 @@ inline QRectF WindowQuad::bounds() const
     return QRectF(QPointF(left(), top()), QPointF(right(), bottom()));
 }
 
+/***************************************************************
+ CompactWindowQuad
+***************************************************************/
+
+inline CompactWindowQuad::CompactWindowQuad(const WindowQuad &quad)
+{
+    for (int i = 0; i < 4; ++i) {
+        m_x[i] = quad[i].x();
+        m_y[i] = quad[i].y();
+        m_u[i] = quad[i].u();
+        m_v[i] = quad[i].v();
+    }
+}
+
+inline void CompactWindowQuad::setVertex(int index, const QPointF &position, const QPointF &textureCoordinate)
+{
+    Q_ASSERT(index >= 0 && index < 4);
+    m_x[index] = position.x();
+    m_y[index] = position.y();
+    m_u[index] = textureCoordinate.x();
+    m_v[index] = textureCoordinate.y();
+}
+
+inline WindowQuad CompactWindowQuad::toWindowQuad() const
+{
+    WindowQuad quad;
+    for (int i = 0; i < 4; ++i) {
+        quad[i] = WindowVertex(m_x[i], m_y[i], m_u[i], m_v[i]);
+    }
+    return quad;
+}
+
+inline float CompactWindowQuad::x(int index) const
+{
+    Q_ASSERT(index >= 0 && index < 4);
+    return m_x[index];
+}
+
+inline float CompactWindowQuad::y(int index) const
+{
+    Q_ASSERT(index >= 0 && index < 4);
+    return m_y[index];
+}
+
+inline float CompactWindowQuad::u(int index) const
+{
+    Q_ASSERT(index >= 0 && index < 4);
+    return m_u[index];
+}
+
+inline float CompactWindowQuad::v(int index) const
+{
+    Q_ASSERT(index >= 0 && index < 4);
+    return m_v[index];
+}
+
+inline float CompactWindowQuad::left() const
+{
+    return std::min(std::min(m_x[0], m_x[1]), std::min(m_x[2], m_x[3]));
+}
+
+inline float CompactWindowQuad::right() const
+{
+    return std::max(std::max(m_x[0], m_x[1]), std::max(m_x[2], m_x[3]));
+}
+
+inline float CompactWindowQuad::top() const
+{
+    return std::min(std::min(m_y[0], m_y[1]), std::min(m_y[2], m_y[3]));
+}
+
+inline float CompactWindowQuad::bottom() const
+{
+    return std::max(std::max(m_y[0], m_y[1]), std::max(m_y[2], m_y[3]));
+}
+
+inline QRectF CompactWindowQuad::bounds() const
+{
+    return QRectF(QPointF(left(), top()), QPointF(right(), bottom()));
+}
+
 /***************************************************************
  Motion
 ***************************************************************/
@@ -4,7 +4,7 @@
     SPDX-License-Identifier: GPL-2.0-or-later
 */
 
-#include "eglnativefence.h"
+#include "libkwineffects/kwineglnativefence.h"
 
 #include <unistd.h>
 
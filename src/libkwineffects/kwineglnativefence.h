@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "libkwineffects/kwinglutils_export.h"
+
 #include <QtGlobal>
 
 #include <epoxy/egl.h>
@@ -13,7 +15,7 @@
 namespace KWin
 {
 
-class EGLNativeFence
+class KWINGLUTILS_EXPORT EGLNativeFence
 {
 public:
     explicit EGLNativeFence(::EGLDisplay display);
@@ -12,6 +12,7 @@
 #include "libkwineffects/kwinconfig.h" // KWIN_HAVE_OPENGL
 #include "libkwineffects/kwineffects.h"
 #include "libkwineffects/kwinglplatform.h"
+#include "libkwineffects/kwingltexturepool.h"
 #include "libkwineffects/kwinglutils.h"
 #include "libkwineffects/kwinglutils_funcs.h"
 
@@ -22,6 +23,11 @@
 #include <QVector2D>
 #include <QVector3D>
 #include <QVector4D>
+#include <QtMath>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
 
 namespace KWin
 {
@@ -38,6 +44,7 @@ bool GLTexturePrivate::s_supportsTextureSwizzle = false;
 bool GLTexturePrivate::s_supportsTextureFormatRG = false;
 bool GLTexturePrivate::s_supportsTexture16Bit = false;
 uint GLTexturePrivate::s_fbo = 0;
+std::unique_ptr<GLStreamingUnpackBuffer> GLTexturePrivate::s_unpackBuffer;
 
 // Table of GL formats/types associated with different values of QImage::Format.
 // Zero values indicate a direct upload is not feasible.
@@ -289,6 +296,8 @@ GLTexturePrivate::GLTexturePrivate()
     , m_wrapModeChanged(false)
     , m_immutable(false)
     , m_foreign(false)
+    , m_pooled(false)
+    , m_swizzled(false)
     , m_mipLevels(1)
     , m_unnormalizeActive(0)
     , m_normalizeActive(0)
@@ -327,18 +336,168 @@ void GLTexturePrivate::initStatic()
 
         s_supportsUnpack = hasGLExtension(QByteArrayLiteral("GL_EXT_unpack_subimage"));
     }
+
+    bool supportsStreamingUpload;
+    if (!GLPlatform::instance()->isGLES()) {
+        supportsStreamingUpload = (hasGLVersion(4, 4) || hasGLExtension(QByteArrayLiteral("GL_ARB_buffer_storage")))
+            && (hasGLVersion(3, 2) || hasGLExtension(QByteArrayLiteral("GL_ARB_sync")));
+    } else {
+        supportsStreamingUpload = hasGLVersion(3, 0) && hasGLExtension(QByteArrayLiteral("GL_EXT_buffer_storage"));
+    }
+    if (supportsStreamingUpload && qgetenv("KWIN_PERSISTENT_PBO") != QByteArrayLiteral("0")) {
+        s_unpackBuffer = std::make_unique<GLStreamingUnpackBuffer>();
+    }
+
+    GLTexturePool::initStatic();
 }
 
 void GLTexturePrivate::cleanup()
 {
     s_supportsFramebufferObjects = false;
     s_supportsARGB32 = false;
+    GLTexturePool::cleanup();
+    s_unpackBuffer.reset();
     if (s_fbo) {
         glDeleteFramebuffers(1, &s_fbo);
         s_fbo = 0;
     }
 }
 
+GLTexturePrivate::UploadFormat GLTexturePrivate::uploadFormat(QImage::Format format)
+{
+    if (!GLPlatform::instance()->isGLES()) {
+        if (format < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[format].internalFormat
+            && !(formatTable[format].type == GL_UNSIGNED_SHORT && !s_supportsTexture16Bit)) {
+            return UploadFormat{formatTable[format].format, formatTable[format].type, format};
+        } else {
+            return UploadFormat{GL_BGRA, GL_UNSIGNED_INT_8_8_8_8_REV, QImage::Format_ARGB32_Premultiplied};
+        }
+    } else {
+        if (s_supportsARGB32) {
+            return UploadFormat{GL_BGRA_EXT, GL_UNSIGNED_BYTE, QImage::Format_ARGB32_Premultiplied};
+        } else {
+            return UploadFormat{GL_RGBA, GL_UNSIGNED_BYTE, QImage::Format_RGBA8888_Premultiplied};
+        }
+    }
+}
+
+GLenum GLTexturePrivate::imageInternalFormat(QImage::Format format)
+{
+    if (!GLPlatform::instance()->isGLES()) {
+        if (format < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[format].internalFormat
+            && !(formatTable[format].type == GL_UNSIGNED_SHORT && !s_supportsTexture16Bit)) {
+            return formatTable[format].internalFormat;
+        }
+    }
+    return GL_RGBA8;
+}
+
+GLStreamingUnpackBuffer::~GLStreamingUnpackBuffer()
+{
+    for (GLsync fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+        }
+    }
+    if (m_buffer) {
+        // This also unmaps the buffer
+        glDeleteBuffers(1, &m_buffer);
+    }
+}
+
+GLuint GLStreamingUnpackBuffer::buffer() const
+{
+    return m_buffer;
+}
+
+uchar *GLStreamingUnpackBuffer::map() const
+{
+    return m_map;
+}
+
+qsizetype GLStreamingUnpackBuffer::allocate(qsizetype size)
+{
+    // Keep the ranges aligned, some drivers take a slow path for unaligned offsets.
+    size = (size + 63) & ~qsizetype(63);
+
+    if (size > m_segmentSize) {
+        if (size > s_maxSegmentSize) {
+            return -1;
+        }
+        reallocate(std::max(s_minSegmentSize, qsizetype(qNextPowerOfTwo(quint64(size)))));
+    }
+    if (!m_map) {
+        return -1;
+    }
+
+    if (m_offset + size > m_segmentSize && !advance()) {
+        return -1;
+    }
+
+    const qsizetype offset = m_segment * m_segmentSize + m_offset;
+    m_offset += size;
+    return offset;
+}
+
+bool GLStreamingUnpackBuffer::advance()
+{
+    const int next = (m_segment + 1) % s_segmentCount;
+
+    // Don't wait for the GPU if it's still reading the next segment, the caller uploads the
+    // pixels directly instead.
+    if (GLsync fence = m_fences[next]) {
+        const GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+            return false;
+        }
+        glDeleteSync(fence);
+        m_fences[next] = nullptr;
+    }
+
+    m_fences[m_segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_segment = next;
+    m_offset = 0;
+    return true;
+}
+
+int GLStreamingUnpackBuffer::segment() const
+{
+    return m_segment;
+}
+
+qsizetype GLStreamingUnpackBuffer::segmentSize() const
+{
+    return m_segmentSize;
+}
+
+void GLStreamingUnpackBuffer::reallocate(qsizetype segmentSize)
+{
+    for (GLsync &fence : m_fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (m_buffer) {
+        // The buffer is released by the driver after the pending uploads have completed.
+        glDeleteBuffers(1, &m_buffer);
+        m_buffer = 0;
+        m_map = nullptr;
+    }
+
+    m_segmentSize = segmentSize;
+    m_segment = 0;
+    m_offset = 0;
+
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glGenBuffers(1, &m_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, m_segmentSize * s_segmentCount, nullptr, access);
+    m_map = static_cast<uchar *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, m_segmentSize * s_segmentCount, access));
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 bool GLTexture::isNull() const
 {
     Q_D(const GLTexture);
@@ -370,33 +529,7 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
     Q_D(GLTexture);
     Q_ASSERT(!d->m_foreign);
 
-    GLenum glFormat;
-    GLenum type;
-    QImage::Format uploadFormat;
-    if (!GLPlatform::instance()->isGLES()) {
-        const QImage::Format index = image.format();
-
-        if (index < sizeof(formatTable) / sizeof(formatTable[0]) && formatTable[index].internalFormat
-            && !(formatTable[index].type == GL_UNSIGNED_SHORT && !d->s_supportsTexture16Bit)) {
-            glFormat = formatTable[index].format;
-            type = formatTable[index].type;
-            uploadFormat = index;
-        } else {
-            glFormat = GL_BGRA;
-            type = GL_UNSIGNED_INT_8_8_8_8_REV;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        }
-    } else {
-        if (d->s_supportsARGB32) {
-            glFormat = GL_BGRA_EXT;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_ARGB32_Premultiplied;
-        } else {
-            glFormat = GL_RGBA;
-            type = GL_UNSIGNED_BYTE;
-            uploadFormat = QImage::Format_RGBA8888_Premultiplied;
-        }
-    }
+    const auto [glFormat, type, uploadFormat] = GLTexturePrivate::uploadFormat(image.format());
     bool useUnpack = d->s_supportsUnpack && image.format() == uploadFormat && !src.isNull();
 
     QImage im;
@@ -437,6 +570,78 @@ void GLTexture::update(const QImage &image, const QPoint &offset, const QRect &s
     }
 }
 
+QVector<QRect> GLTexturePrivate::mergeUploadRects(const QRegion &region)
+{
+    const QRect bounds = region.boundingRect();
+    if (region.rectCount() == 1) {
+        return {bounds};
+    }
+
+    qsizetype area = 0;
+    for (const QRect &rect : region) {
+        area += qsizetype(rect.width()) * rect.height();
+    }
+    if (region.rectCount() > 16 || qsizetype(bounds.width()) * bounds.height() <= 2 * area) {
+        return {bounds};
+    }
+    return QVector<QRect>(region.begin(), region.end());
+}
+
+void GLTexture::update(const QImage &image, const QRegion &region)
+{
+    if (image.isNull() || isNull()) {
+        return;
+    }
+
+    const QRegion clipped = region & QRect(QPoint(0, 0), image.size());
+    if (clipped.isEmpty()) {
+        return;
+    }
+
+    GLStreamingUnpackBuffer *unpackBuffer = GLTexturePrivate::s_unpackBuffer.get();
+    if (!unpackBuffer) {
+        for (const QRect &rect : GLTexturePrivate::mergeUploadRects(clipped)) {
+            update(image, rect.topLeft(), rect);
+        }
+        return;
+    }
+
+    Q_D(GLTexture);
+    Q_ASSERT(!d->m_foreign);
+
+    const auto [glFormat, type, uploadFormat] = GLTexturePrivate::uploadFormat(image.format());
+
+    for (const QRect &rect : GLTexturePrivate::mergeUploadRects(clipped)) {
+        QImage source = image;
+        QRect sourceRect = rect;
+        if (image.format() != uploadFormat) {
+            source = image.copy(rect).convertToFormat(uploadFormat);
+            sourceRect = QRect(QPoint(0, 0), rect.size());
+        }
+
+        // The rows are packed with the default unpack alignment of 4 bytes.
+        const int bytesPerPixel = source.depth() / 8;
+        const qsizetype rowSize = qsizetype(rect.width()) * bytesPerPixel;
+        const qsizetype stride = (rowSize + 3) & ~qsizetype(3);
+        const qsizetype offset = unpackBuffer->allocate(stride * rect.height());
+        if (offset < 0) {
+            update(source, rect.topLeft(), sourceRect);
+            continue;
+        }
+
+        uchar *destination = unpackBuffer->map() + offset;
+        for (int y = 0; y < rect.height(); ++y) {
+            memcpy(destination + y * stride, source.constScanLine(sourceRect.y() + y) + sourceRect.x() * bytesPerPixel, rowSize);
+        }
+
+        bind();
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, unpackBuffer->buffer());
+        glTexSubImage2D(d->m_target, 0, rect.x(), rect.y(), rect.width(), rect.height(), glFormat, type, reinterpret_cast<const void *>(offset));
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        unbind();
+    }
+}
+
 void GLTexture::discard()
 {
     d_ptr = new GLTexturePrivate();
@@ -728,6 +933,7 @@ QMatrix4x4 GLTexture::contentTransformMatrix() const
 void GLTexture::setSwizzle(GLenum red, GLenum green, GLenum blue, GLenum alpha)
 {
     Q_D(GLTexture);
+    d->m_swizzled = true;
 
     if (!GLPlatform::instance()->isGLES()) {
         const GLuint swizzle[] = {red, green, blue, alpha};
@@ -114,6 +114,14 @@ public:
     QMatrix4x4 matrix(TextureCoordinateType type) const;
 
     void update(const QImage &image, const QPoint &offset = QPoint(0, 0), const QRect &src = QRect());
+    /**
+     * Uploads the parts of @a image covered by @a region to the same position in the texture.
+     *
+     * Nearby rectangles are merged into fewer uploads. If persistently mapped buffers are
+     * supported, the pixels are staged in a pixel unpack buffer, so the transfer to the GPU
+     * overlaps with rendering rather than being done synchronously by the driver.
+     */
+    void update(const QImage &image, const QRegion &region);
     virtual void discard();
     void bind();
     void unbind();
@@ -168,6 +176,7 @@ protected:
 
 private:
     Q_DECLARE_PRIVATE(GLTexture)
+    friend class GLTexturePool;
 };
 
 } // namespace
@@ -17,15 +17,64 @@
 
 #include <QImage>
 #include <QMatrix4x4>
+#include <QRegion>
 #include <QSharedData>
 #include <QSize>
+#include <array>
 #include <epoxy/gl.h>
+#include <memory>
 
 namespace KWin
 {
 // forward declarations
 class GLVertexBuffer;
 
+/**
+ * The GLStreamingUnpackBuffer class is a persistently mapped pixel unpack buffer that is used
+ * to stream texture uploads.
+ *
+ * The buffer is split in a few segments that are used in turn. A fence is inserted after the
+ * uploads that use a segment, and the segment is reused only after the fence has signalled,
+ * which normally happens long before the ring wraps around. If it hasn't, the uploads fall back
+ * to glTexSubImage2D() from client memory until it has.
+ */
+class KWINGLUTILS_EXPORT GLStreamingUnpackBuffer
+{
+public:
+    ~GLStreamingUnpackBuffer();
+
+    /**
+     * Reserves @a size bytes in the buffer and returns the offset of the reserved range, or -1
+     * if the range can't be reserved. The reserved range can be written through map() until
+     * the uploads that use it are submitted.
+     *
+     * If the GPU hasn't finished reading the next segment yet, -1 is returned rather than
+     * waiting for it, and the pixels should be uploaded directly.
+     */
+    qsizetype allocate(qsizetype size);
+
+    GLuint buffer() const;
+    uchar *map() const;
+
+    int segment() const;
+    qsizetype segmentSize() const;
+
+private:
+    void reallocate(qsizetype segmentSize);
+    bool advance();
+
+    static constexpr int s_segmentCount = 3;
+    static constexpr qsizetype s_minSegmentSize = 4 * 1024 * 1024;
+    static constexpr qsizetype s_maxSegmentSize = 64 * 1024 * 1024;
+
+    GLuint m_buffer = 0;
+    uchar *m_map = nullptr;
+    qsizetype m_segmentSize = 0;
+    qsizetype m_offset = 0;
+    int m_segment = 0;
+    std::array<GLsync, s_segmentCount> m_fences = {};
+};
+
 class KWINGLUTILS_EXPORT GLTexturePrivate
     : public QSharedData
 {
@@ -53,6 +102,8 @@ public:
     bool m_wrapModeChanged;
     bool m_immutable;
     bool m_foreign;
+    bool m_pooled;
+    bool m_swizzled;
     int m_mipLevels;
 
     int m_unnormalizeActive; // 0 - no, otherwise refcount
@@ -61,6 +112,22 @@ public:
     QSizeF m_cachedSize;
     QRectF m_cachedSource;
 
+    struct UploadFormat
+    {
+        GLenum format;
+        GLenum type;
+        QImage::Format imageFormat;
+    };
+    static UploadFormat uploadFormat(QImage::Format format);
+    static GLenum imageInternalFormat(QImage::Format format);
+
+    /**
+     * Returns the rectangles in which the given @a region is uploaded. Uploading a few more
+     * pixels is cheaper than issuing lots of small uploads, so the rectangles are merged if
+     * they cover most of their bounding rectangle or if there are too many of them.
+     */
+    static QVector<QRect> mergeUploadRects(const QRegion &region);
+
     static void initStatic();
 
     static bool s_supportsFramebufferObjects;
@@ -71,6 +138,7 @@ public:
     static bool s_supportsTextureFormatRG;
     static bool s_supportsTexture16Bit;
     static GLuint s_fbo;
+    static std::unique_ptr<GLStreamingUnpackBuffer> s_unpackBuffer;
 
 private:
     friend void KWin::cleanupGL();
@@ -0,0 +1,261 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "libkwineffects/kwingltexturepool.h"
+#include "libkwineffects/kwinglplatform.h"
+#include "libkwineffects/kwingltexture.h"
+
+#include "kwingltexture_p.h"
+
+#include <QHash>
+#include <QImage>
+
+#include <algorithm>
+#include <iterator>
+#include <list>
+
+namespace KWin
+{
+
+namespace
+{
+
+struct GLTexturePoolKey
+{
+    GLenum internalFormat;
+    QSize size;
+    int levels;
+
+    bool operator==(const GLTexturePoolKey &other) const = default;
+};
+
+size_t qHash(const GLTexturePoolKey &key, size_t seed = 0)
+{
+    return qHashMulti(seed, key.internalFormat, key.size.width(), key.size.height(), key.levels);
+}
+
+struct GLTexturePoolEntry
+{
+    GLTexturePoolKey key;
+    std::unique_ptr<GLTexture> texture;
+    qint64 bytes;
+    std::chrono::steady_clock::time_point releaseTime;
+};
+
+struct GLTexturePoolState
+{
+    // The most recently released textures are at the front.
+    std::list<GLTexturePoolEntry> entries;
+    QMultiHash<GLTexturePoolKey, std::list<GLTexturePoolEntry>::iterator> index;
+    qint64 usage = 0;
+};
+
+}
+
+static qint64 defaultBudget()
+{
+    bool ok = false;
+    const int megabytes = qEnvironmentVariableIntValue("KWIN_TEXTURE_POOL_BUDGET", &ok);
+    if (ok) {
+        return qint64(std::max(megabytes, 0)) * 1024 * 1024;
+    }
+    return 64 * 1024 * 1024;
+}
+
+static qint64 s_budget = defaultBudget();
+
+// The pooled textures belong to the compositor's context, so the state only exists between
+// GLTexturePrivate::initStatic() and GLTexturePrivate::cleanup().
+static GLTexturePoolState *s_state = nullptr;
+
+static int bytesPerPixel(GLenum internalFormat)
+{
+    switch (internalFormat) {
+    case GL_R8:
+        return 1;
+    case GL_R16:
+    case GL_RG8:
+    case GL_RGB5:
+    case GL_RGB4:
+    case GL_RGBA4:
+        return 2;
+    case GL_RGBA16:
+    case GL_RGBA16F:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+static qint64 textureBytes(const GLTexturePoolKey &key)
+{
+    const qint64 bytes = qint64(key.size.width()) * key.size.height() * bytesPerPixel(key.internalFormat);
+    // A full mipmap chain takes an extra third of the base level.
+    return key.levels > 1 ? bytes * 4 / 3 : bytes;
+}
+
+static GLenum poolFormat(GLenum internalFormat)
+{
+    // Textures are always allocated as GL_RGBA8 on GLES, see GLTexture::GLTexture().
+    return GLPlatform::instance()->isGLES() ? GL_RGBA8 : internalFormat;
+}
+
+static void evictLast()
+{
+    const auto last = std::prev(s_state->entries.end());
+    s_state->index.remove(last->key, last);
+    s_state->usage -= last->bytes;
+    s_state->entries.erase(last);
+}
+
+static void trim(qint64 budget)
+{
+    while (s_state->usage > budget) {
+        evictLast();
+    }
+}
+
+std::unique_ptr<GLTexture> GLTexturePool::acquire(GLenum internalFormat, const QSize &size, int levels)
+{
+    if (size.isEmpty()) {
+        return nullptr;
+    }
+
+    if (s_state) {
+        const GLTexturePoolKey key{poolFormat(internalFormat), size, levels};
+        if (const auto it = s_state->index.find(key); it != s_state->index.end()) {
+            const auto entry = it.value();
+            std::unique_ptr<GLTexture> texture = std::move(entry->texture);
+            s_state->usage -= entry->bytes;
+            s_state->index.erase(it);
+            s_state->entries.erase(entry);
+
+            // Make the texture look like a newly created one.
+            GLTexturePrivate *d = texture->d_func();
+            d->m_filter = levels > 1 ? GL_NEAREST_MIPMAP_LINEAR : GL_NEAREST;
+            d->m_filterChanged = true;
+            d->m_wrapMode = GL_REPEAT;
+            d->m_wrapModeChanged = true;
+            d->m_markedDirty = false;
+            texture->setContentTransform(TextureTransforms());
+            return texture;
+        }
+    }
+
+    auto texture = std::make_unique<GLTexture>(internalFormat, size, levels);
+    if (texture->isNull()) {
+        return nullptr;
+    }
+    texture->d_func()->m_pooled = true;
+    return texture;
+}
+
+std::unique_ptr<GLTexture> GLTexturePool::acquire(const QImage &image)
+{
+    if (image.isNull()) {
+        return nullptr;
+    }
+
+    auto texture = acquire(GLTexturePrivate::imageInternalFormat(image.format()), image.size());
+    if (!texture) {
+        return nullptr;
+    }
+    texture->update(image);
+    texture->setFilter(GL_LINEAR);
+    texture->setContentTransform(TextureTransform::MirrorY);
+    return texture;
+}
+
+void GLTexturePool::release(std::unique_ptr<GLTexture> &&texture)
+{
+    if (!texture) {
+        return;
+    }
+
+    // Textures that are not pooled are deleted when going out of scope.
+    std::unique_ptr<GLTexture> candidate = std::move(texture);
+    if (!s_state || !s_budget) {
+        return;
+    }
+
+    const GLTexturePrivate *d = candidate->d_func();
+    if (!d->m_pooled || d->m_swizzled || d->ref.loadRelaxed() != 1) {
+        return;
+    }
+
+    const GLTexturePoolKey key{d->m_internalFormat, d->m_size, d->m_mipLevels};
+    const qint64 bytes = textureBytes(key);
+    if (bytes > s_budget) {
+        return;
+    }
+
+    s_state->entries.push_front(GLTexturePoolEntry{
+        .key = key,
+        .texture = std::move(candidate),
+        .bytes = bytes,
+        .releaseTime = std::chrono::steady_clock::now(),
+    });
+    s_state->index.insert(key, s_state->entries.begin());
+    s_state->usage += bytes;
+
+    trim(s_budget);
+}
+
+void GLTexturePool::clear()
+{
+    if (s_state) {
+        trim(0);
+    }
+}
+
+void GLTexturePool::trimIdle(std::chrono::milliseconds maxAge)
+{
+    if (!s_state) {
+        return;
+    }
+
+    // The entries are sorted by release time, the oldest ones are at the back.
+    const auto deadline = std::chrono::steady_clock::now() - maxAge;
+    while (!s_state->entries.empty() && s_state->entries.back().releaseTime <= deadline) {
+        evictLast();
+    }
+}
+
+qint64 GLTexturePool::budget()
+{
+    return s_budget;
+}
+
+void GLTexturePool::setBudget(qint64 bytes)
+{
+    s_budget = std::max<qint64>(bytes, 0);
+    if (s_state) {
+        trim(s_budget);
+    }
+}
+
+qint64 GLTexturePool::usage()
+{
+    return s_state ? s_state->usage : 0;
+}
+
+void GLTexturePool::initStatic()
+{
+    if (!s_state) {
+        s_state = new GLTexturePoolState();
+    }
+}
+
+void GLTexturePool::cleanup()
+{
+    delete s_state;
+    s_state = nullptr;
+}
+
+} // namespace KWin
@@ -0,0 +1,101 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "libkwineffects/kwinglutils_export.h"
+
+#include <QSize>
+
+#include <chrono>
+#include <epoxy/gl.h>
+#include <memory>
+
+class QImage;
+
+/** @addtogroup kwineffects */
+/** @{ */
+
+namespace KWin
+{
+
+class GLTexture;
+
+/**
+ * The GLTexturePool class keeps the storage of recently released textures around so that it
+ * can be handed out again instead of allocating new storage from the driver.
+ *
+ * Textures are matched by their internal format, size and number of mipmap levels. Released
+ * textures are kept in least recently used order, the oldest ones are deleted as soon as the
+ * pooled textures take more memory than the budget.
+ *
+ * The budget is 64 MiB by default, it can be changed with the KWIN_TEXTURE_POOL_BUDGET
+ * environment variable, which specifies the budget in MiB. Setting it to 0 disables pooling.
+ * Textures that stay unused for a while are deleted by trimIdle().
+ *
+ * The pool is only active while the compositor has an OpenGL context, otherwise textures are
+ * simply allocated and deleted.
+ *
+ * @since 6.0
+ */
+class KWINGLUTILS_EXPORT GLTexturePool
+{
+public:
+    /**
+     * Returns a texture with the specified @a internalFormat, @a size and number of mipmap
+     * @a levels. The contents of the texture are undefined. Its filter, wrap mode and content
+     * transform are the same as the ones of a newly created GLTexture.
+     *
+     * Returns @c nullptr if the texture can't be allocated.
+     */
+    static std::unique_ptr<GLTexture> acquire(GLenum internalFormat, const QSize &size, int levels = 1);
+
+    /**
+     * Returns a texture that contains a copy of the given @a image, the same way as
+     * GLTexture(const QImage &) would create it.
+     */
+    static std::unique_ptr<GLTexture> acquire(const QImage &image);
+
+    /**
+     * Gives the @a texture back to the pool. Textures that haven't been obtained with
+     * acquire(), or that are still shared with other GLTexture objects, are deleted.
+     *
+     * The texture must not be attached to any framebuffer when it is released.
+     */
+    static void release(std::unique_ptr<GLTexture> &&texture);
+
+    /**
+     * Deletes all pooled textures.
+     */
+    static void clear();
+
+    /**
+     * Deletes the pooled textures that have not been reused within @a maxAge since they
+     * were released. The compositor calls it periodically, so the pool gives its memory
+     * back once the textures stop being requested.
+     */
+    static void trimIdle(std::chrono::milliseconds maxAge);
+
+    static qint64 budget();
+    static void setBudget(qint64 bytes);
+
+    /**
+     * Returns the amount of memory taken by the pooled textures, in bytes.
+     */
+    static qint64 usage();
+
+private:
+    friend class GLTexturePrivate;
+    static void initStatic();
+    static void cleanup();
+};
+
+} // namespace KWin
+
+/** @} */
@@ -6,6 +6,7 @@
 
 #include "libkwineffects/kwinoffscreeneffect.h"
 #include "libkwineffects/kwingltexture.h"
+#include "libkwineffects/kwingltexturepool.h"
 #include "libkwineffects/kwinglutils.h"
 #include "libkwineffects/rendertarget.h"
 #include "libkwineffects/renderviewport.h"
@@ -97,7 +98,12 @@ void OffscreenData::maybeRender(EffectWindow *window)
     QSize textureSize = logicalGeometry.toAlignedRect().size();
 
     if (!m_texture || m_texture->size() != textureSize) {
-        m_texture.reset(new GLTexture(GL_RGBA8, textureSize));
+        m_fbo.reset();
+        GLTexturePool::release(std::move(m_texture));
+        m_texture = GLTexturePool::acquire(GL_RGBA8, textureSize);
+        if (!m_texture) {
+            return;
+        }
         m_texture->setFilter(GL_LINEAR);
         m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
         m_fbo.reset(new GLFramebuffer(m_texture.get()));
@@ -130,6 +136,8 @@ void OffscreenData::maybeRender(EffectWindow *window)
 
 OffscreenData::~OffscreenData()
 {
+    m_fbo.reset();
+    GLTexturePool::release(std::move(m_texture));
 }
 
 void OffscreenData::setDirty()
@@ -150,6 +158,10 @@ void OffscreenData::setVertexSnappingMode(RenderGeometry::VertexSnappingMode mod
 void OffscreenData::paint(const RenderTarget &renderTarget, const RenderViewport &viewport, EffectWindow *window, const QRegion &region,
                           const WindowPaintData &data, const WindowQuadList &quads)
 {
+    if (!m_texture) {
+        return;
+    }
+
     GLShader *shader = m_shader ? m_shader : ShaderManager::instance()->shader(ShaderTrait::MapTexture | ShaderTrait::Modulate | ShaderTrait::AdjustSaturation);
     ShaderBinder binder(shader);
 
@@ -9,6 +9,7 @@
 
 #include "libkwineffects/kwinoffscreenquickview.h"
 
+#include "libkwineffects/kwingltexturepool.h"
 #include "libkwineffects/kwinglutils.h"
 #include "logging_p.h"
 
@@ -41,6 +42,9 @@ public:
     std::unique_ptr<QOffscreenSurface> m_offscreenSurface;
     std::unique_ptr<QOpenGLContext> m_glcontext;
     std::unique_ptr<QOpenGLFramebufferObject> m_fbo;
+    // the texture that is rendered into when exporting textures, the depth and stencil
+    // buffers are managed by QtQuick
+    std::unique_ptr<GLTexture> m_texture;
 
     std::unique_ptr<QTimer> m_repaintTimer;
     QImage m_image;
@@ -162,6 +166,7 @@ OffscreenQuickView::~OffscreenQuickView()
     // Always delete render control first.
     d->m_renderControl.reset();
     d->m_view.reset();
+    GLTexturePool::release(std::move(d->m_texture));
 }
 
 bool OffscreenQuickView::automaticRepaint() const
@@ -215,20 +220,36 @@ void OffscreenQuickView::update()
         }
 
         const QSize nativeSize = d->m_view->size() * d->m_view->effectiveDevicePixelRatio();
-        if (!d->m_fbo || d->m_fbo->size() != nativeSize) {
-            d->m_textureExport.reset(nullptr);
-            d->m_fbo.reset(new QOpenGLFramebufferObject(nativeSize, QOpenGLFramebufferObject::CombinedDepthStencil));
-            if (!d->m_fbo->isValid()) {
-                d->m_fbo.reset();
-                d->m_glcontext->doneCurrent();
-                return;
+        QQuickRenderTarget renderTarget;
+        std::unique_ptr<GLTexture> previousTexture;
+        if (d->m_useBlit) {
+            if (!d->m_fbo || d->m_fbo->size() != nativeSize) {
+                d->m_fbo.reset(new QOpenGLFramebufferObject(nativeSize, QOpenGLFramebufferObject::CombinedDepthStencil));
+                if (!d->m_fbo->isValid()) {
+                    d->m_fbo.reset();
+                    d->m_glcontext->doneCurrent();
+                    return;
+                }
             }
+            renderTarget = QQuickRenderTarget::fromOpenGLTexture(d->m_fbo->texture(), d->m_fbo->size());
+        } else {
+            if (!d->m_texture || d->m_texture->size() != nativeSize) {
+                // The old texture can go back to the pool only after the view stops rendering into it.
+                previousTexture = std::move(d->m_texture);
+                d->m_texture = GLTexturePool::acquire(GL_RGBA8, nativeSize);
+                if (!d->m_texture) {
+                    d->m_view->setRenderTarget(QQuickRenderTarget());
+                    GLTexturePool::release(std::move(previousTexture));
+                    d->m_glcontext->doneCurrent();
+                    return;
+                }
+            }
+            renderTarget = QQuickRenderTarget::fromOpenGLTexture(d->m_texture->texture(), nativeSize);
         }
-
-        QQuickRenderTarget renderTarget = QQuickRenderTarget::fromOpenGLTexture(d->m_fbo->texture(), d->m_fbo->size());
         renderTarget.setDevicePixelRatio(d->m_view->devicePixelRatio());
 
         d->m_view->setRenderTarget(renderTarget);
+        GLTexturePool::release(std::move(previousTexture));
     }
 
     d->m_renderControl->polishItems();
@@ -411,15 +432,10 @@ GLTexture *OffscreenQuickView::bufferAsTexture()
             return nullptr;
         }
         d->m_textureExport.reset(new GLTexture(d->m_image));
+        return d->m_textureExport.get();
     } else {
-        if (!d->m_fbo) {
-            return nullptr;
-        }
-        if (!d->m_textureExport) {
-            d->m_textureExport.reset(new GLTexture(d->m_fbo->texture(), d->m_fbo->format().internalTextureFormat(), d->m_fbo->size()));
-        }
+        return d->m_texture.get();
     }
-    return d->m_textureExport.get();
 }
 
 QImage OffscreenQuickView::bufferAsImage() const
@@ -0,0 +1,276 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "libkwineffects/windowquadclipper.h"
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(__x86_64__) && (defined(Q_CC_GNU) || defined(Q_CC_CLANG))
+#define KWIN_HAVE_AVX_KERNEL 1
+#endif
+
+namespace KWin
+{
+
+enum ClipFlag : quint8 {
+    Intersects = 1 << 0,
+    Contained = 1 << 1,
+};
+
+// The number of quads whose clip flags are computed in one go. Every kernel processes a
+// multiple of 8 quads, the bounds are padded with empty quads accordingly.
+static const int s_blockSize = 64;
+static const int s_laneAlignment = 8;
+
+/**
+ * Computes the clip flags of @a count quads against the clip rectangle @a clip, which is
+ * given as left, top, right, bottom.
+ */
+using ClipKernel = void (*)(const float *left, const float *top, const float *right, const float *bottom, const float *clip, quint8 *flags, int count);
+
+static void clipKernelScalar(const float *left, const float *top, const float *right, const float *bottom, const float *clip, quint8 *flags, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        const float intersectedLeft = std::max(left[i], clip[0]);
+        const float intersectedTop = std::max(top[i], clip[1]);
+        const float intersectedRight = std::min(right[i], clip[2]);
+        const float intersectedBottom = std::min(bottom[i], clip[3]);
+
+        quint8 flag = 0;
+        if (intersectedLeft < intersectedRight && intersectedTop < intersectedBottom) {
+            flag |= Intersects;
+            if (clip[0] <= left[i] && clip[1] <= top[i] && clip[2] >= right[i] && clip[3] >= bottom[i]) {
+                flag |= Contained;
+            }
+        }
+        flags[i] = flag;
+    }
+}
+
+#if defined(__SSE2__)
+static void clipKernelSse2(const float *left, const float *top, const float *right, const float *bottom, const float *clip, quint8 *flags, int count)
+{
+    const __m128 clipLeft = _mm_set1_ps(clip[0]);
+    const __m128 clipTop = _mm_set1_ps(clip[1]);
+    const __m128 clipRight = _mm_set1_ps(clip[2]);
+    const __m128 clipBottom = _mm_set1_ps(clip[3]);
+
+    for (int i = 0; i < count; i += 4) {
+        const __m128 l = _mm_loadu_ps(left + i);
+        const __m128 t = _mm_loadu_ps(top + i);
+        const __m128 r = _mm_loadu_ps(right + i);
+        const __m128 b = _mm_loadu_ps(bottom + i);
+
+        const __m128 intersects = _mm_and_ps(_mm_cmplt_ps(_mm_max_ps(l, clipLeft), _mm_min_ps(r, clipRight)),
+                                             _mm_cmplt_ps(_mm_max_ps(t, clipTop), _mm_min_ps(b, clipBottom)));
+        const __m128 contained = _mm_and_ps(_mm_and_ps(_mm_cmple_ps(clipLeft, l), _mm_cmple_ps(clipTop, t)),
+                                            _mm_and_ps(_mm_cmpge_ps(clipRight, r), _mm_cmpge_ps(clipBottom, b)));
+
+        const int intersectsMask = _mm_movemask_ps(intersects);
+        const int containedMask = _mm_movemask_ps(_mm_and_ps(intersects, contained));
+        for (int lane = 0; lane < 4; ++lane) {
+            flags[i + lane] = ((intersectsMask >> lane) & 1) * Intersects | ((containedMask >> lane) & 1) * Contained;
+        }
+    }
+}
+#endif
+
+#if KWIN_HAVE_AVX_KERNEL
+__attribute__((target("avx"))) static void clipKernelAvx(const float *left, const float *top, const float *right, const float *bottom, const float *clip, quint8 *flags, int count)
+{
+    const __m256 clipLeft = _mm256_set1_ps(clip[0]);
+    const __m256 clipTop = _mm256_set1_ps(clip[1]);
+    const __m256 clipRight = _mm256_set1_ps(clip[2]);
+    const __m256 clipBottom = _mm256_set1_ps(clip[3]);
+
+    for (int i = 0; i < count; i += 8) {
+        const __m256 l = _mm256_loadu_ps(left + i);
+        const __m256 t = _mm256_loadu_ps(top + i);
+        const __m256 r = _mm256_loadu_ps(right + i);
+        const __m256 b = _mm256_loadu_ps(bottom + i);
+
+        const __m256 intersects = _mm256_and_ps(_mm256_cmp_ps(_mm256_max_ps(l, clipLeft), _mm256_min_ps(r, clipRight), _CMP_LT_OQ),
+                                                _mm256_cmp_ps(_mm256_max_ps(t, clipTop), _mm256_min_ps(b, clipBottom), _CMP_LT_OQ));
+        const __m256 contained = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(clipLeft, l, _CMP_LE_OQ), _mm256_cmp_ps(clipTop, t, _CMP_LE_OQ)),
+                                               _mm256_and_ps(_mm256_cmp_ps(clipRight, r, _CMP_GE_OQ), _mm256_cmp_ps(clipBottom, b, _CMP_GE_OQ)));
+
+        const int intersectsMask = _mm256_movemask_ps(intersects);
+        const int containedMask = _mm256_movemask_ps(_mm256_and_ps(intersects, contained));
+        for (int lane = 0; lane < 8; ++lane) {
+            flags[i + lane] = ((intersectsMask >> lane) & 1) * Intersects | ((containedMask >> lane) & 1) * Contained;
+        }
+    }
+}
+#endif
+
+#if defined(__ARM_NEON)
+static void clipKernelNeon(const float *left, const float *top, const float *right, const float *bottom, const float *clip, quint8 *flags, int count)
+{
+    const float32x4_t clipLeft = vdupq_n_f32(clip[0]);
+    const float32x4_t clipTop = vdupq_n_f32(clip[1]);
+    const float32x4_t clipRight = vdupq_n_f32(clip[2]);
+    const float32x4_t clipBottom = vdupq_n_f32(clip[3]);
+    const uint32x4_t intersectsBit = vdupq_n_u32(Intersects);
+    const uint32x4_t containedBit = vdupq_n_u32(Contained);
+
+    for (int i = 0; i < count; i += 4) {
+        const float32x4_t l = vld1q_f32(left + i);
+        const float32x4_t t = vld1q_f32(top + i);
+        const float32x4_t r = vld1q_f32(right + i);
+        const float32x4_t b = vld1q_f32(bottom + i);
+
+        const uint32x4_t intersects = vandq_u32(vcltq_f32(vmaxq_f32(l, clipLeft), vminq_f32(r, clipRight)),
+                                                vcltq_f32(vmaxq_f32(t, clipTop), vminq_f32(b, clipBottom)));
+        const uint32x4_t contained = vandq_u32(vandq_u32(vcleq_f32(clipLeft, l), vcleq_f32(clipTop, t)),
+                                               vandq_u32(vcgeq_f32(clipRight, r), vcgeq_f32(clipBottom, b)));
+
+        const uint32x4_t laneFlags = vorrq_u32(vandq_u32(intersects, intersectsBit),
+                                               vandq_u32(vandq_u32(intersects, contained), containedBit));
+        const uint8x8_t narrowed = vmovn_u16(vcombine_u16(vmovn_u32(laneFlags), vdup_n_u16(0)));
+        flags[i + 0] = vget_lane_u8(narrowed, 0);
+        flags[i + 1] = vget_lane_u8(narrowed, 1);
+        flags[i + 2] = vget_lane_u8(narrowed, 2);
+        flags[i + 3] = vget_lane_u8(narrowed, 3);
+    }
+}
+#endif
+
+struct ClipKernelInfo
+{
+    ClipKernel kernel;
+    QString name;
+};
+
+static ClipKernelInfo detectClipKernel()
+{
+#if KWIN_HAVE_AVX_KERNEL
+    if (__builtin_cpu_supports("avx")) {
+        return ClipKernelInfo{clipKernelAvx, QStringLiteral("AVX")};
+    }
+#endif
+#if defined(__SSE2__)
+    return ClipKernelInfo{clipKernelSse2, QStringLiteral("SSE2")};
+#elif defined(__ARM_NEON)
+    return ClipKernelInfo{clipKernelNeon, QStringLiteral("NEON")};
+#else
+    return ClipKernelInfo{clipKernelScalar, QStringLiteral("None")};
+#endif
+}
+
+static const ClipKernelInfo &autoClipKernel()
+{
+    static const ClipKernelInfo info = detectClipKernel();
+    return info;
+}
+
+WindowQuadClipper::WindowQuadClipper(Kernel kernel)
+    : m_kernel(kernel)
+{
+}
+
+QString WindowQuadClipper::instructionSet()
+{
+    return autoClipKernel().name;
+}
+
+template<typename QuadList>
+void WindowQuadClipper::loadBounds(const QuadList &quads, qreal deviceScale)
+{
+    const int count = quads.count();
+    const int paddedCount = (count + s_laneAlignment - 1) / s_laneAlignment * s_laneAlignment;
+
+    // Empty quads never intersect anything, so the kernels can run over the padding.
+    m_left.assign(paddedCount, 0);
+    m_top.assign(paddedCount, 0);
+    m_right.assign(paddedCount, 0);
+    m_bottom.assign(paddedCount, 0);
+
+    for (int i = 0; i < count; ++i) {
+        const auto &quad = quads[i];
+        m_left[i] = std::round(quad.left() * deviceScale);
+        m_top[i] = std::round(quad.top() * deviceScale);
+        m_right[i] = std::round(quad.right() * deviceScale);
+        m_bottom[i] = std::round(quad.bottom() * deviceScale);
+    }
+}
+
+void WindowQuadClipper::clip(const WindowQuadList &quads, const QVector<QRectF> &deviceClipRects, qreal deviceScale, RenderGeometry &geometry)
+{
+    clipQuads(quads, deviceClipRects, deviceScale, geometry);
+}
+
+void WindowQuadClipper::clip(const CompactWindowQuadList &quads, const QVector<QRectF> &deviceClipRects, qreal deviceScale, RenderGeometry &geometry)
+{
+    clipQuads(quads, deviceClipRects, deviceScale, geometry);
+}
+
+template<typename QuadList>
+void WindowQuadClipper::clipQuads(const QuadList &quads, const QVector<QRectF> &deviceClipRects, qreal deviceScale, RenderGeometry &geometry)
+{
+    if (deviceClipRects.isEmpty()) {
+        for (const auto &quad : quads) {
+            geometry.appendWindowQuad(quad, deviceScale);
+        }
+        return;
+    }
+
+    const ClipKernel kernel = m_kernel == Kernel::Scalar ? clipKernelScalar : autoClipKernel().kernel;
+    const int rectCount = deviceClipRects.count();
+
+    m_clipRects.resize(rectCount * 4);
+    for (int i = 0; i < rectCount; ++i) {
+        const QRectF &rect = deviceClipRects[i];
+        m_clipRects[i * 4 + 0] = rect.left();
+        m_clipRects[i * 4 + 1] = rect.top();
+        m_clipRects[i * 4 + 2] = rect.right();
+        m_clipRects[i * 4 + 3] = rect.bottom();
+    }
+
+    loadBounds(quads, deviceScale);
+    m_flags.resize(rectCount * s_blockSize);
+
+    const int count = quads.count();
+    for (int blockStart = 0; blockStart < count; blockStart += s_blockSize) {
+        const int blockCount = std::min(s_blockSize, count - blockStart);
+        const int paddedBlockCount = (blockCount + s_laneAlignment - 1) / s_laneAlignment * s_laneAlignment;
+
+        for (int rect = 0; rect < rectCount; ++rect) {
+            kernel(m_left.data() + blockStart,
+                   m_top.data() + blockStart,
+                   m_right.data() + blockStart,
+                   m_bottom.data() + blockStart,
+                   m_clipRects.data() + rect * 4,
+                   m_flags.data() + rect * s_blockSize,
+                   paddedBlockCount);
+        }
+
+        // Emit the geometry quad by quad in the order of the clip rectangles, a quad that is
+        // fully inside a clip rectangle can't intersect any other clip rectangle.
+        for (int i = 0; i < blockCount; ++i) {
+            const auto &quad = quads[blockStart + i];
+            for (int rect = 0; rect < rectCount; ++rect) {
+                const quint8 flags = m_flags[rect * s_blockSize + i];
+                if (flags & Contained) {
+                    geometry.appendWindowQuad(quad, deviceScale);
+                    break;
+                } else if (flags & Intersects) {
+                    const QRectF deviceBounds(QPointF(m_left[blockStart + i], m_top[blockStart + i]),
+                                              QPointF(m_right[blockStart + i], m_bottom[blockStart + i]));
+                    geometry.appendSubQuad(quad, deviceClipRects[rect].intersected(deviceBounds), deviceScale);
+                }
+            }
+        }
+    }
+}
+
+} // namespace KWin
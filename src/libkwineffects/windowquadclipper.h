@@ -0,0 +1,67 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "libkwineffects/kwineffects.h"
+
+#include <vector>
+
+namespace KWin
+{
+
+/**
+ * The WindowQuadClipper class splits window quads along a list of clip rectangles.
+ *
+ * The device bounds of the quads are stored as a structure of arrays of floats, which lets
+ * the clipper test several quads against a clip rectangle at once with SSE2, AVX or NEON,
+ * whichever is available. On other CPUs, a scalar implementation is used instead.
+ *
+ * The clipper keeps its buffers between calls, so reusing a clipper avoids allocating
+ * memory for every item that is painted.
+ */
+class KWINEFFECTS_EXPORT WindowQuadClipper
+{
+public:
+    enum class Kernel {
+        Auto,
+        Scalar,
+    };
+
+    explicit WindowQuadClipper(Kernel kernel = Kernel::Auto);
+
+    /**
+     * Appends the parts of the @a quads that are inside the @a deviceClipRects to the @a geometry.
+     * The clip rectangles must be in the device coordinate space of the quads, they must not
+     * overlap each other. If no clip rectangles are given, the quads are appended as is.
+     */
+    void clip(const WindowQuadList &quads, const QVector<QRectF> &deviceClipRects, qreal deviceScale, RenderGeometry &geometry);
+    void clip(const CompactWindowQuadList &quads, const QVector<QRectF> &deviceClipRects, qreal deviceScale, RenderGeometry &geometry);
+
+    /**
+     * Returns the name of the instruction set used by the Auto kernel.
+     */
+    static QString instructionSet();
+
+private:
+    template<typename QuadList>
+    void clipQuads(const QuadList &quads, const QVector<QRectF> &deviceClipRects, qreal deviceScale, RenderGeometry &geometry);
+    template<typename QuadList>
+    void loadBounds(const QuadList &quads, qreal deviceScale);
+
+    Kernel m_kernel;
+    std::vector<float> m_clipRects;
+    std::vector<float> m_left;
+    std::vector<float> m_top;
+    std::vector<float> m_right;
+    std::vector<float> m_bottom;
+    std::vector<quint8> m_flags;
+};
+
+} // namespace KWin
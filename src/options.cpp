@@ -59,6 +59,7 @@ Options::Options(QObject *parent)
     , m_xwaylandEavesdrops(Options::defaultXwaylandEavesdrops())
     , m_latencyPolicy(Options::defaultLatencyPolicy())
     , m_renderTimeEstimator(Options::defaultRenderTimeEstimator())
+    , m_renderTimeTargetMissRate(Options::defaultRenderTimeTargetMissRate())
     , m_compositingMode(Options::defaultCompositingMode())
     , m_useCompositing(Options::defaultUseCompositing())
     , m_hiddenPreviews(Options::defaultHiddenPreviews())
@@ -657,6 +658,20 @@ void Options::setRenderTimeEstimator(RenderTimeEstimator estimator)
     Q_EMIT renderTimeEstimatorChanged();
 }
 
+qreal Options::renderTimeTargetMissRate() const
+{
+    return m_renderTimeTargetMissRate;
+}
+
+void Options::setRenderTimeTargetMissRate(qreal rate)
+{
+    if (qFuzzyCompare(m_renderTimeTargetMissRate, rate)) {
+        return;
+    }
+    m_renderTimeTargetMissRate = rate;
+    Q_EMIT renderTimeTargetMissRateChanged();
+}
+
 bool Options::allowTearing() const
 {
     return m_allowTearing;
@@ -810,6 +825,7 @@ void Options::syncFromKcfgc()
     setWindowsBlockCompositing(m_settings->windowsBlockCompositing());
     setLatencyPolicy(m_settings->latencyPolicy());
     setRenderTimeEstimator(m_settings->renderTimeEstimator());
+    setRenderTimeTargetMissRate(m_settings->renderTimeTargetMissRate());
     setAllowTearing(m_settings->allowTearing());
 }
 
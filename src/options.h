@@ -65,6 +65,7 @@ enum RenderTimeEstimator {
     RenderTimeEstimatorMinimum,
     RenderTimeEstimatorMaximum,
     RenderTimeEstimatorAverage,
+    RenderTimeEstimatorAdaptive,
 };
 
 /**
@@ -220,6 +221,10 @@ class KWIN_EXPORT Options : public QObject
     Q_PROPERTY(bool windowsBlockCompositing READ windowsBlockCompositing WRITE setWindowsBlockCompositing NOTIFY windowsBlockCompositingChanged)
     Q_PROPERTY(LatencyPolicy latencyPolicy READ latencyPolicy WRITE setLatencyPolicy NOTIFY latencyPolicyChanged)
     Q_PROPERTY(RenderTimeEstimator renderTimeEstimator READ renderTimeEstimator WRITE setRenderTimeEstimator NOTIFY renderTimeEstimatorChanged)
+    /**
+     * The fraction of frames that the adaptive render time estimator is allowed to underestimate.
+     */
+    Q_PROPERTY(qreal renderTimeTargetMissRate READ renderTimeTargetMissRate WRITE setRenderTimeTargetMissRate NOTIFY renderTimeTargetMissRateChanged)
     Q_PROPERTY(bool allowTearing READ allowTearing WRITE setAllowTearing NOTIFY allowTearingChanged)
 public:
     explicit Options(QObject *parent = nullptr);
@@ -711,6 +716,7 @@ public:
     QStringList modifierOnlyDBusShortcut(Qt::KeyboardModifier mod) const;
     LatencyPolicy latencyPolicy() const;
     RenderTimeEstimator renderTimeEstimator() const;
+    qreal renderTimeTargetMissRate() const;
     bool allowTearing() const;
 
     // setters
@@ -771,6 +777,7 @@ public:
     void setWindowsBlockCompositing(bool set);
     void setLatencyPolicy(LatencyPolicy policy);
     void setRenderTimeEstimator(RenderTimeEstimator estimator);
+    void setRenderTimeTargetMissRate(qreal rate);
     void setAllowTearing(bool allow);
 
     // default values
@@ -906,6 +913,10 @@ public:
     {
         return RenderTimeEstimatorMaximum;
     }
+    static qreal defaultRenderTimeTargetMissRate()
+    {
+        return 0.01;
+    }
     static ActivationDesktopPolicy defaultActivationDesktopPolicy()
     {
         return ActivationDesktopPolicy::SwitchToOtherDesktop;
@@ -983,6 +994,7 @@ Q_SIGNALS:
     void latencyPolicyChanged();
     void configChanged();
     void renderTimeEstimatorChanged();
+    void renderTimeTargetMissRateChanged();
     void allowTearingChanged();
 
 private:
@@ -1016,6 +1028,7 @@ private:
     XwaylandEavesdropsMode m_xwaylandEavesdrops;
     LatencyPolicy m_latencyPolicy;
     RenderTimeEstimator m_renderTimeEstimator;
+    qreal m_renderTimeTargetMissRate;
 
     CompositingType m_compositingMode;
     bool m_useCompositing;
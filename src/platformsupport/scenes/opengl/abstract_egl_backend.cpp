@@ -22,6 +22,7 @@
 // Qt
 #include <QOpenGLContext>
 
+#include <chrono>
 #include <memory>
 
 #include <drm_fourcc.h>
@@ -80,9 +81,12 @@ void AbstractEglBackend::teardown()
 
 void AbstractEglBackend::cleanup()
 {
-    for (const EGLImageKHR &image : m_importedBuffers) {
-        eglDestroyImageKHR(m_display->handle(), image);
+    for (const auto &[buffer, imported] : m_importedBuffers) {
+        if (imported.image != EGL_NO_IMAGE_KHR) {
+            eglDestroyImageKHR(m_display->handle(), imported.image);
+        }
     }
+    m_importedBuffers.clear();
 
     cleanupSurfaces();
     cleanupGL();
@@ -280,22 +284,90 @@ bool AbstractEglBackend::prefer10bpc() const
     return false;
 }
 
+AbstractEglBackend::ImportedBuffer *AbstractEglBackend::importBuffer(KWaylandServer::ClientBuffer *buffer, const DmaBufAttributes &attributes)
+{
+    if (auto it = m_importedBuffers.find(buffer); Q_LIKELY(it != m_importedBuffers.end())) {
+        return it->second.image != EGL_NO_IMAGE_KHR ? &it->second : nullptr;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    EGLImageKHR image = importDmaBufAsImage(attributes);
+
+    // Failed imports are kept as well so the driver is not asked again every time the buffer
+    // is attached.
+    ImportedBuffer &imported = m_importedBuffers[buffer];
+    imported.image = image;
+    imported.importTime = std::chrono::steady_clock::now() - start;
+    connect(buffer, &QObject::destroyed, this, [this, buffer]() {
+        destroyImportedBuffer(buffer);
+    });
+
+    return image != EGL_NO_IMAGE_KHR ? &imported : nullptr;
+}
+
+void AbstractEglBackend::destroyImportedBuffer(KWaylandServer::ClientBuffer *buffer)
+{
+    const auto it = m_importedBuffers.find(buffer);
+    if (it == m_importedBuffers.end()) {
+        return;
+    }
+
+    const ImportedBuffer &imported = it->second;
+    if (imported.image == EGL_NO_IMAGE_KHR) {
+        m_importedBuffers.erase(it);
+        return;
+    }
+
+    qCDebug(KWIN_OPENGL) << "Releasing dmabuf buffer" << buffer << "imported in"
+                         << std::chrono::duration_cast<std::chrono::microseconds>(imported.importTime).count() << "us and attached"
+                         << imported.useCount << "times";
+
+    eglDestroyImageKHR(m_display->handle(), imported.image);
+    if (imported.texture) {
+        makeCurrent();
+    }
+    m_importedBuffers.erase(it);
+}
+
 EGLImageKHR AbstractEglBackend::importBufferAsImage(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer)
 {
-    auto it = m_importedBuffers.constFind(buffer);
-    if (Q_LIKELY(it != m_importedBuffers.constEnd())) {
-        return *it;
+    const ImportedBuffer *imported = importBuffer(buffer, buffer->attributes());
+    return imported ? imported->image : EGL_NO_IMAGE_KHR;
+}
+
+GLTexture *AbstractEglBackend::importBufferAsTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer)
+{
+    return importBufferAsTexture(buffer, buffer->attributes());
+}
+
+GLTexture *AbstractEglBackend::importBufferAsTexture(KWaylandServer::ClientBuffer *buffer, const DmaBufAttributes &attributes)
+{
+    ImportedBuffer *imported = importBuffer(buffer, attributes);
+    if (!imported) {
+        return nullptr;
     }
 
-    EGLImageKHR image = importDmaBufAsImage(buffer->attributes());
-    if (image != EGL_NO_IMAGE_KHR) {
-        m_importedBuffers[buffer] = image;
-        connect(buffer, &QObject::destroyed, this, [this, buffer]() {
-            eglDestroyImageKHR(m_display->handle(), m_importedBuffers.take(buffer));
-        });
+    if (!imported->texture) {
+        const auto start = std::chrono::steady_clock::now();
+
+        auto texture = std::make_unique<GLTexture>(GL_TEXTURE_2D);
+        texture->setSize(buffer->size());
+        texture->create();
+        texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        texture->setFilter(GL_NEAREST);
+        texture->bind();
+        glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(imported->image));
+        texture->unbind();
+        // The origin in a dmabuf-buffer is at the upper-left corner, so the meaning
+        // of Y-inverted is the inverse of OpenGL.
+        texture->setContentTransform(buffer->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft ? TextureTransform::MirrorY : TextureTransforms());
+
+        imported->texture = std::move(texture);
+        imported->importTime += std::chrono::steady_clock::now() - start;
     }
 
-    return image;
+    ++imported->useCount;
+    return imported->texture.get();
 }
 
 EGLImageKHR AbstractEglBackend::importDmaBufAsImage(const DmaBufAttributes &dmabuf) const
@@ -13,7 +13,10 @@
 #include "wayland/linuxdmabufv1clientbuffer.h"
 
 #include <QObject>
+#include <chrono>
 #include <epoxy/egl.h>
+#include <memory>
+#include <unordered_map>
 
 struct wl_display;
 struct wl_resource;
@@ -49,6 +52,19 @@ public:
     std::shared_ptr<GLTexture> importDmaBufAsTexture(const DmaBufAttributes &attributes) const;
     EGLImageKHR importDmaBufAsImage(const DmaBufAttributes &attributes) const;
     EGLImageKHR importBufferAsImage(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
+    /**
+     * Returns the texture for the given dmabuf @a buffer. The buffer is imported only once, the
+     * texture is kept until the buffer is destroyed, so attaching a buffer that has already been
+     * used doesn't need to go through the driver again.
+     */
+    GLTexture *importBufferAsTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
+    /**
+     * Returns the texture for the given client @a buffer whose memory is described by the dmabuf
+     * @a attributes, for example a shm buffer that is backed by a udmabuf. The texture is cached
+     * the same way as for dmabuf buffers. Returns @c nullptr if the buffer can't be imported,
+     * failed imports are remembered as well.
+     */
+    GLTexture *importBufferAsTexture(KWaylandServer::ClientBuffer *buffer, const DmaBufAttributes &attributes);
 
 protected:
     AbstractEglBackend(dev_t deviceId = 0);
@@ -64,6 +80,17 @@ protected:
     bool createContext(EGLConfig config);
 
 private:
+    struct ImportedBuffer
+    {
+        EGLImageKHR image = EGL_NO_IMAGE_KHR;
+        std::unique_ptr<GLTexture> texture;
+        // the time it took to import the buffer and to create the texture
+        std::chrono::nanoseconds importTime = std::chrono::nanoseconds::zero();
+        quint64 useCount = 0;
+    };
+
+    ImportedBuffer *importBuffer(KWaylandServer::ClientBuffer *buffer, const DmaBufAttributes &attributes);
+    void destroyImportedBuffer(KWaylandServer::ClientBuffer *buffer);
     bool ensureGlobalShareContext(EGLConfig config);
     void destroyGlobalShareContext();
     ::EGLContext createContextInternal(::EGLContext sharedContext);
@@ -76,7 +103,7 @@ private:
     QList<QByteArray> m_clientExtensions;
     const dev_t m_deviceId;
     QVector<KWaylandServer::LinuxDmaBufV1Feedback::Tranche> m_tranches;
-    QHash<KWaylandServer::LinuxDmaBufV1ClientBuffer *, EGLImageKHR> m_importedBuffers;
+    std::unordered_map<KWaylandServer::ClientBuffer *, ImportedBuffer> m_importedBuffers;
 };
 
 }
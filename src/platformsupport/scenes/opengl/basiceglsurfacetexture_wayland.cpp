@@ -6,6 +6,7 @@
 
 #include "platformsupport/scenes/opengl/basiceglsurfacetexture_wayland.h"
 #include "libkwineffects/kwingltexture.h"
+#include "libkwineffects/kwingltexturepool.h"
 #include "platformsupport/scenes/opengl/abstract_egl_backend.h"
 #include "scene/surfaceitem_wayland.h"
 #include "utils/common.h"
@@ -46,7 +47,7 @@ bool BasicEGLSurfaceTextureWayland::create()
 
 void BasicEGLSurfaceTextureWayland::destroy()
 {
-    m_texture.reset();
+    GLTexturePool::release(std::move(m_texture));
     m_bufferType = BufferType::None;
 }
 
@@ -59,14 +60,34 @@ void BasicEGLSurfaceTextureWayland::update(const QRegion &region)
     }
 }
 
+GLTexture *BasicEGLSurfaceTextureWayland::importShmBuffer(KWaylandServer::ShmClientBuffer *buffer)
+{
+    // Only available if the shm buffer is backed by a udmabuf, see ShmClientBufferIntegration.
+    const DmaBufAttributes *attributes = buffer->dmabufAttributes();
+    if (!attributes) {
+        return nullptr;
+    }
+    return backend()->importBufferAsTexture(buffer, *attributes);
+}
+
 bool BasicEGLSurfaceTextureWayland::loadShmTexture(KWaylandServer::ShmClientBuffer *buffer)
 {
+    if (GLTexture *texture = importShmBuffer(buffer)) {
+        m_texture = std::make_unique<GLTexture>(*texture);
+        m_bufferType = BufferType::ImportedShm;
+        return true;
+    }
+
     const QImage &image = buffer->data();
     if (Q_UNLIKELY(image.isNull())) {
         return false;
     }
 
-    m_texture.reset(new GLTexture(image));
+    // Surfaces such as popups and tooltips come and go with the same sizes, reuse their storage.
+    m_texture = GLTexturePool::acquire(image);
+    if (Q_UNLIKELY(!m_texture)) {
+        return false;
+    }
     m_texture->setFilter(GL_LINEAR);
     m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
     m_texture->setContentTransform(TextureTransform::MirrorY);
@@ -77,40 +98,38 @@ bool BasicEGLSurfaceTextureWayland::loadShmTexture(KWaylandServer::ShmClientBuff
 
 void BasicEGLSurfaceTextureWayland::updateShmTexture(KWaylandServer::ShmClientBuffer *buffer, const QRegion &region)
 {
-    if (Q_UNLIKELY(m_bufferType != BufferType::Shm)) {
+    // Buffers that can't be imported, e.g. because their pool isn't sealed, are copied instead.
+    GLTexture *imported = importShmBuffer(buffer);
+    const BufferType bufferType = imported ? BufferType::ImportedShm : BufferType::Shm;
+    if (Q_UNLIKELY(m_bufferType != bufferType)) {
         destroy();
         create();
         return;
     }
 
+    if (imported) {
+        *m_texture = *imported;
+        return;
+    }
+
     const QImage &image = buffer->data();
     if (Q_UNLIKELY(image.isNull())) {
         return;
     }
 
-    const QRegion damage = mapRegion(m_pixmap->item()->surfaceToBufferMatrix(), region);
-    for (const QRect &rect : damage) {
-        m_texture->update(image, rect.topLeft(), rect);
-    }
+    m_texture->update(image, mapRegion(m_pixmap->item()->surfaceToBufferMatrix(), region));
 }
 
 bool BasicEGLSurfaceTextureWayland::loadDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer)
 {
-    EGLImageKHR image = backend()->importBufferAsImage(buffer);
-    if (Q_UNLIKELY(image == EGL_NO_IMAGE_KHR)) {
+    GLTexture *texture = backend()->importBufferAsTexture(buffer);
+    if (Q_UNLIKELY(!texture)) {
         qCritical(KWIN_OPENGL) << "Invalid dmabuf-based wl_buffer";
         return false;
     }
 
-    m_texture.reset(new GLTexture(GL_TEXTURE_2D));
-    m_texture->setSize(buffer->size());
-    m_texture->create();
-    m_texture->setWrapMode(GL_CLAMP_TO_EDGE);
-    m_texture->setFilter(GL_NEAREST);
-    m_texture->bind();
-    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(image));
-    m_texture->unbind();
-    m_texture->setContentTransform(buffer->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft ? TextureTransform::MirrorY : TextureTransforms());
+    // The texture is owned by the buffer, share it rather than binding the image again.
+    m_texture = std::make_unique<GLTexture>(*texture);
     m_bufferType = BufferType::DmaBuf;
 
     return true;
@@ -124,12 +143,10 @@ void BasicEGLSurfaceTextureWayland::updateDmabufTexture(KWaylandServer::LinuxDma
         return;
     }
 
-    m_texture->bind();
-    glEGLImageTargetTexture2DOES(GL_TEXTURE_2D, static_cast<GLeglImageOES>(backend()->importBufferAsImage(buffer)));
-    m_texture->unbind();
-    // The origin in a dmabuf-buffer is at the upper-left corner, so the meaning
-    // of Y-inverted is the inverse of OpenGL.
-    m_texture->setContentTransform(buffer->origin() == KWaylandServer::ClientBuffer::Origin::TopLeft ? TextureTransform::MirrorY : TextureTransforms());
+    // Clients usually cycle through the same few buffers, whose textures already exist.
+    if (GLTexture *texture = backend()->importBufferAsTexture(buffer)) {
+        *m_texture = *texture;
+    }
 }
 
 } // namespace KWin
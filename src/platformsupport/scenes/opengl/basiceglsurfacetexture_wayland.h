@@ -31,6 +31,7 @@ public:
     void update(const QRegion &region) override;
 
 private:
+    GLTexture *importShmBuffer(KWaylandServer::ShmClientBuffer *buffer);
     bool loadShmTexture(KWaylandServer::ShmClientBuffer *buffer);
     void updateShmTexture(KWaylandServer::ShmClientBuffer *buffer, const QRegion &region);
     bool loadDmabufTexture(KWaylandServer::LinuxDmaBufV1ClientBuffer *buffer);
@@ -40,6 +41,7 @@ private:
     enum class BufferType {
         None,
         Shm,
+        ImportedShm,
         DmaBuf,
     };
 
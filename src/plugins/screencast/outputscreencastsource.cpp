@@ -72,7 +72,7 @@ void OutputScreenCastSource::render(GLFramebuffer *target)
 
 std::chrono::nanoseconds OutputScreenCastSource::clock() const
 {
-    return m_output->renderLoop()->lastPresentationTimestamp();
+    return m_output->renderLoop()->nextPresentationTimestamp();
 }
 
 uint OutputScreenCastSource::refreshRate() const
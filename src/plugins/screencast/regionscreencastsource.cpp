@@ -46,7 +46,7 @@ quint32 RegionScreenCastSource::drmFormat() const
 
 void RegionScreenCastSource::updateOutput(Output *output)
 {
-    m_last = output->renderLoop()->lastPresentationTimestamp();
+    m_last = output->renderLoop()->nextPresentationTimestamp();
 
     if (m_renderedTexture) {
         const std::shared_ptr<GLTexture> outputTexture = Compositor::self()->scene()->textureForOutput(output);
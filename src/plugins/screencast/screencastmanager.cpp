@@ -193,7 +193,7 @@ void ScreencastManager::streamRegion(KWaylandServer::ScreencastStreamV1Interface
                     const QRect streamRegion = source->region();
                     const QRegion region = output->pixelSize() != output->modeSize() ? output->geometry() : damagedRegion;
                     source->updateOutput(output);
-                    stream->recordFrame(scaleRegion(region.translated(-streamRegion.topLeft()).intersected(streamRegion), source->scale()));
+                    stream->recordFrame(scaleRegion(region.intersected(streamRegion).translated(-streamRegion.topLeft()), source->scale()));
                 };
                 connect(output, &Output::outputChange, stream, bufferToStream);
                 found |= true;
@@ -0,0 +1,68 @@
+/*
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "screencastpacer.h"
+
+namespace KWin
+{
+
+void ScreenCastPacer::setFrameInterval(std::chrono::nanoseconds interval)
+{
+    if (m_frameInterval != interval) {
+        m_frameInterval = interval;
+        reset();
+    }
+}
+
+std::chrono::nanoseconds ScreenCastPacer::frameInterval() const
+{
+    return m_frameInterval;
+}
+
+void ScreenCastPacer::setRefreshInterval(std::chrono::nanoseconds interval)
+{
+    m_refreshInterval = interval;
+}
+
+bool ScreenCastPacer::shouldRecord(std::chrono::nanoseconds timestamp) const
+{
+    if (m_frameInterval == std::chrono::nanoseconds::zero() || m_nextFrameTime == std::chrono::nanoseconds::zero()) {
+        return true;
+    }
+    return timestamp + m_refreshInterval / 2 >= m_nextFrameTime;
+}
+
+void ScreenCastPacer::frameRecorded(std::chrono::nanoseconds timestamp)
+{
+    if (m_frameInterval == std::chrono::nanoseconds::zero()) {
+        return;
+    }
+
+    // If the stream has fallen behind by more than a frame, e.g. because nothing has been
+    // presented for a while, start over rather than record a burst of frames to catch up.
+    if (m_nextFrameTime == std::chrono::nanoseconds::zero() || timestamp - m_nextFrameTime >= m_frameInterval) {
+        m_nextFrameTime = timestamp + m_frameInterval;
+    } else {
+        m_nextFrameTime += m_frameInterval;
+    }
+}
+
+std::chrono::nanoseconds ScreenCastPacer::nextFrameTime() const
+{
+    return m_nextFrameTime;
+}
+
+std::chrono::nanoseconds ScreenCastPacer::deadline() const
+{
+    return m_nextFrameTime + m_refreshInterval / 2;
+}
+
+void ScreenCastPacer::reset()
+{
+    m_nextFrameTime = std::chrono::nanoseconds::zero();
+}
+
+} // namespace KWin
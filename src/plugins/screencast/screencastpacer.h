@@ -0,0 +1,68 @@
+/*
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include <chrono>
+
+namespace KWin
+{
+
+/**
+ * The ScreenCastPacer class decides which frames of an output are recorded when a stream has
+ * a lower frame rate than the output.
+ *
+ * Frames are chosen by their presentation timestamps rather than by the time they arrive. The
+ * target time of the next frame is advanced by the frame interval every time a frame is
+ * recorded, so the frame rate averages out to the requested one. A frame is recorded if it's
+ * presented at most half an output refresh before the target time, so the presentation that
+ * is closest to the target time is picked and timer jitter doesn't cause frames to be dropped.
+ */
+class ScreenCastPacer
+{
+public:
+    /**
+     * Sets the interval between two recorded frames to @a interval. If the interval is zero,
+     * every frame is recorded.
+     */
+    void setFrameInterval(std::chrono::nanoseconds interval);
+    std::chrono::nanoseconds frameInterval() const;
+
+    /**
+     * Sets the refresh interval of the output that is being recorded to @a interval.
+     */
+    void setRefreshInterval(std::chrono::nanoseconds interval);
+
+    /**
+     * Returns @c true if the frame presented at @a timestamp should be recorded.
+     */
+    bool shouldRecord(std::chrono::nanoseconds timestamp) const;
+
+    /**
+     * Notifies the pacer that the frame presented at @a timestamp has been recorded.
+     */
+    void frameRecorded(std::chrono::nanoseconds timestamp);
+
+    /**
+     * Returns the time when the next frame should be presented to be recorded.
+     */
+    std::chrono::nanoseconds nextFrameTime() const;
+
+    /**
+     * Returns the time after which the last presented frame should be recorded if no other
+     * frame has been presented until then.
+     */
+    std::chrono::nanoseconds deadline() const;
+
+    void reset();
+
+private:
+    std::chrono::nanoseconds m_frameInterval = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds m_refreshInterval = std::chrono::nanoseconds::zero();
+    std::chrono::nanoseconds m_nextFrameTime = std::chrono::nanoseconds::zero();
+};
+
+} // namespace KWin
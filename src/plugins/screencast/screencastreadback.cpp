@@ -0,0 +1,488 @@
+/*
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "screencastreadback.h"
+#include "composite.h"
+#include "core/outputbackend.h"
+#include "kwinscreencast_logging.h"
+#include "libkwineffects/kwineglnativefence.h"
+#include "libkwineffects/kwinglplatform.h"
+#include "libkwineffects/kwingltexture.h"
+#include "libkwineffects/kwinglutils.h"
+#include "main.h"
+#include "platformsupport/scenes/opengl/openglbackend.h"
+#include "scene/workspacescene.h"
+#include "screencastutils.h"
+
+#include <QSocketNotifier>
+#include <QTextStream>
+#include <QVector2D>
+#include <QVector4D>
+
+#include <cstring>
+
+namespace KWin
+{
+
+// Reading back a lot of small rectangles is slower than reading their bounding rectangle.
+static const int s_maxReadbackRects = 16;
+
+static int bytesPerPixel(spa_video_format format)
+{
+    switch (format) {
+    case SPA_VIDEO_FORMAT_RGB:
+    case SPA_VIDEO_FORMAT_BGR:
+        return 3;
+    default:
+        return 4;
+    }
+}
+
+/**
+ * Returns the rectangle in the given @a plane that is affected by the @a rect in the frame.
+ */
+static QRect planeRect(const QRect &rect, const ScreenCastReadback::Plane &plane)
+{
+    if (plane.subsampling == 1) {
+        return rect;
+    }
+    // The chroma filter also samples the neighbor columns and rows.
+    const QRect expanded = rect.adjusted(-1, -1, 1, 1);
+    const QRect scaled(QPoint(expanded.left() / plane.subsampling, expanded.top() / plane.subsampling),
+                       QPoint(expanded.right() / plane.subsampling, expanded.bottom() / plane.subsampling));
+    return scaled & QRect(QPoint(), plane.size);
+}
+
+/**
+ * Returns the matrix that converts non-linear RGB to Y'CbCr according to BT.709. The first
+ * row produces Y', the second Cb, and the third Cr.
+ */
+static QMatrix4x4 bt709Matrix(bool fullRange)
+{
+    const float kr = 0.2126;
+    const float kb = 0.0722;
+    const float kg = 1.0 - kr - kb;
+
+    const float yScale = fullRange ? 1.0 : 219.0 / 255.0;
+    const float yOffset = fullRange ? 0.0 : 16.0 / 255.0;
+    const float cScale = fullRange ? 1.0 : 224.0 / 255.0;
+    const float cOffset = 128.0 / 255.0;
+
+    QMatrix4x4 matrix;
+    matrix.setRow(0, QVector4D(kr, kg, kb, 0) * yScale + QVector4D(0, 0, 0, yOffset));
+    matrix.setRow(1, QVector4D(-kr / (2 * (1 - kb)), -kg / (2 * (1 - kb)), 0.5, 0) * cScale + QVector4D(0, 0, 0, cOffset));
+    matrix.setRow(2, QVector4D(0.5, -kg / (2 * (1 - kr)), -kb / (2 * (1 - kr)), 0) * cScale + QVector4D(0, 0, 0, cOffset));
+    matrix.setRow(3, QVector4D(0, 0, 0, 1));
+    return matrix;
+}
+
+ScreenCastReadback::ScreenCastReadback(QObject *parent)
+    : QObject(parent)
+{
+    // PipeWire streams have at most 16 buffers.
+    m_damageJournal.setCapacity(16);
+}
+
+ScreenCastReadback::~ScreenCastReadback()
+{
+    static_cast<OpenGLBackend *>(Compositor::self()->backend())->makeCurrent();
+    for (Slot &slot : m_slots) {
+        if (slot.pixelBuffer) {
+            glDeleteBuffers(1, &slot.pixelBuffer);
+        }
+    }
+}
+
+bool ScreenCastReadback::isSupported()
+{
+    // Pixel buffer objects and glMapBufferRange() are part of both OpenGL 3.0 and OpenGL ES 3.0.
+    return hasGLVersion(3, 0);
+}
+
+/**
+ * Returns @c true if glReadPixels() accepts @a format for a framebuffer with the given
+ * @a internalFormat. OpenGL ES only guarantees RGBA, other formats have to be queried.
+ */
+static bool canReadPixels(GLenum internalFormat, GLenum format)
+{
+    GLTexture texture(internalFormat, QSize(1, 1));
+    GLFramebuffer framebuffer(&texture);
+    if (!framebuffer.valid()) {
+        return false;
+    }
+
+    GLint readFormat = 0;
+    GLint readType = 0;
+    GLFramebuffer::pushFramebuffer(&framebuffer);
+    glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_FORMAT, &readFormat);
+    glGetIntegerv(GL_IMPLEMENTATION_COLOR_READ_TYPE, &readType);
+    GLFramebuffer::popFramebuffer();
+    return GLenum(readFormat) == format && GLenum(readType) == GL_UNSIGNED_BYTE;
+}
+
+bool ScreenCastReadback::isYuvSupported()
+{
+    if (!isSupported()) {
+        return false;
+    }
+    // Desktop OpenGL can read any format, OpenGL ES only the one chosen by the driver.
+    if (!GLPlatform::instance()->isGLES()) {
+        return true;
+    }
+    static_cast<OpenGLBackend *>(Compositor::self()->backend())->makeCurrent();
+    return canReadPixels(GL_R8, GL_RED) && canReadPixels(GL_RG8, GL_RG);
+}
+
+bool ScreenCastReadback::isYuvFormat(spa_video_format format)
+{
+    return format == SPA_VIDEO_FORMAT_NV12 || format == SPA_VIDEO_FORMAT_I420;
+}
+
+std::vector<ScreenCastReadback::Plane> ScreenCastReadback::planes(spa_video_format format, const QSize &size)
+{
+    const QSize chromaSize((size.width() + 1) / 2, (size.height() + 1) / 2);
+    const int lumaStride = SPA_ROUND_UP_N(size.width(), 4);
+    const qsizetype lumaSize = qsizetype(lumaStride) * SPA_ROUND_UP_N(size.height(), 2);
+
+    switch (format) {
+    case SPA_VIDEO_FORMAT_NV12:
+        return {
+            Plane{.offset = 0, .stride = lumaStride, .size = size, .bytesPerPixel = 1, .subsampling = 1},
+            Plane{.offset = lumaSize, .stride = lumaStride, .size = chromaSize, .bytesPerPixel = 2, .subsampling = 2},
+        };
+    case SPA_VIDEO_FORMAT_I420: {
+        const int chromaStride = SPA_ROUND_UP_N(chromaSize.width(), 4);
+        return {
+            Plane{.offset = 0, .stride = lumaStride, .size = size, .bytesPerPixel = 1, .subsampling = 1},
+            Plane{.offset = lumaSize, .stride = chromaStride, .size = chromaSize, .bytesPerPixel = 1, .subsampling = 2},
+            Plane{.offset = lumaSize + qsizetype(chromaStride) * chromaSize.height(), .stride = chromaStride, .size = chromaSize, .bytesPerPixel = 1, .subsampling = 2},
+        };
+    }
+    default: {
+        const int bpp = bytesPerPixel(format);
+        return {
+            Plane{.offset = 0, .stride = SPA_ROUND_UP_N(size.width() * bpp, 4), .size = size, .bytesPerPixel = bpp, .subsampling = 1},
+        };
+    }
+    }
+}
+
+qsizetype ScreenCastReadback::frameSize(spa_video_format format, const QSize &size)
+{
+    const Plane last = planes(format, size).back();
+    return last.offset + qsizetype(last.stride) * last.size.height();
+}
+
+bool ScreenCastReadback::isBusy() const
+{
+    return m_pending == s_slotCount;
+}
+
+GLFramebuffer *ScreenCastReadback::beginFrame(const QSize &size)
+{
+    if (isBusy()) {
+        return nullptr;
+    }
+
+    if (m_size != size) {
+        // The PipeWire buffers are going to be reallocated anyway.
+        m_size = size;
+        m_bufferFrames.clear();
+        m_damageJournal.clear();
+    }
+
+    Slot &slot = m_slots[(m_oldest + m_pending) % s_slotCount];
+    if (!slot.texture || slot.texture->size() != size) {
+        slot.framebuffer.reset();
+        slot.texture = std::make_unique<GLTexture>(GL_RGBA8, size);
+        slot.texture->setFilter(GL_LINEAR);
+        slot.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        slot.framebuffer = std::make_unique<GLFramebuffer>(slot.texture.get());
+    }
+    return slot.framebuffer.get();
+}
+
+bool ScreenCastReadback::ensureConversionShader()
+{
+    if (m_conversionShader) {
+        return m_conversionShader->isValid();
+    }
+
+    const bool gles = GLPlatform::instance()->isGLES();
+    const bool core = gles ? GLPlatform::instance()->glslVersion() >= Version(3, 0) : GLPlatform::instance()->glslVersion() >= Version(1, 40);
+
+    QByteArray source;
+    QTextStream stream(&source);
+    if (gles) {
+        if (core) {
+            stream << "#version 300 es\n\n";
+        }
+        stream << "precision highp float;\n\n";
+    } else if (core) {
+        stream << "#version 140\n\n";
+    }
+
+    const QByteArray varying = core ? "in" : "varying";
+    const QByteArray textureLookup = core ? "texture" : "texture2D";
+    const QByteArray output = core ? "fragColor" : "gl_FragColor";
+
+    stream << "uniform sampler2D sampler;\n";
+    stream << "uniform mat4 colorMatrix;\n";
+    stream << "uniform vec2 firstTap;\n";
+    stream << "uniform vec2 secondTap;\n";
+    stream << varying << " vec2 texcoord0;\n";
+    if (core) {
+        stream << "out vec4 fragColor;\n";
+    }
+    stream << "\nvoid main(void)\n{\n";
+    // Both taps are bilinear samples, together they make up the chroma filter.
+    stream << "    vec4 color = 0.5 * (" << textureLookup << "(sampler, texcoord0 + firstTap) + " << textureLookup << "(sampler, texcoord0 + secondTap));\n";
+    stream << "    " << output << " = colorMatrix * vec4(color.rgb, 1.0);\n";
+    stream << "}\n";
+    stream.flush();
+
+    m_conversionShader = ShaderManager::instance()->generateCustomShader(ShaderTrait::MapTexture, QByteArray(), source);
+    if (!m_conversionShader->isValid()) {
+        qCWarning(KWIN_SCREENCAST) << "Failed to compile the YUV conversion shader";
+        return false;
+    }
+
+    m_colorMatrixLocation = m_conversionShader->uniformLocation("colorMatrix");
+    m_firstTapLocation = m_conversionShader->uniformLocation("firstTap");
+    m_secondTapLocation = m_conversionShader->uniformLocation("secondTap");
+    return true;
+}
+
+GLFramebuffer *ScreenCastReadback::convert(Slot &slot, const spa_video_info_raw &format, int planeIndex)
+{
+    const Plane &plane = slot.planes[planeIndex];
+    PlaneTarget &target = slot.planeTargets[planeIndex];
+
+    // NV12 stores both chroma components in the second plane, I420 in separate planes.
+    const GLenum internalFormat = plane.bytesPerPixel == 2 ? GL_RG8 : GL_R8;
+    if (!target.texture || target.texture->size() != plane.size || target.texture->internalFormat() != internalFormat) {
+        target.framebuffer.reset();
+        target.texture = std::make_unique<GLTexture>(internalFormat, plane.size);
+        target.framebuffer = std::make_unique<GLFramebuffer>(target.texture.get());
+    }
+
+    QMatrix4x4 colorMatrix = bt709Matrix(format.color_range == SPA_VIDEO_COLOR_RANGE_0_255);
+    if (format.format == SPA_VIDEO_FORMAT_I420 && planeIndex == 2) {
+        // The V plane takes the Cr component.
+        colorMatrix.setRow(0, colorMatrix.row(2));
+    } else if (planeIndex > 0) {
+        colorMatrix.setRow(0, colorMatrix.row(1));
+        colorMatrix.setRow(1, colorMatrix.row(2));
+    }
+
+    // A chroma sample covers 2x2 pixels, the texture coordinate of the fragment points at their
+    // center. With the MPEG-2 siting, which is used by most video codecs, chroma samples are
+    // co-sited with the left column of pixels, so a [1/4, 1/2, 1/4] filter is applied
+    // horizontally. With the JPEG siting, the pixels are simply averaged.
+    QVector2D firstTap;
+    if (plane.subsampling != 1 && format.chroma_site != SPA_VIDEO_CHROMA_SITE_JPEG) {
+        firstTap = QVector2D(-1.0 / m_size.width(), 0);
+    }
+
+    ShaderManager::instance()->pushShader(m_conversionShader.get());
+    m_conversionShader->setUniform(GLShader::ModelViewProjectionMatrix, QMatrix4x4());
+    m_conversionShader->setUniform(m_colorMatrixLocation, colorMatrix);
+    m_conversionShader->setUniform(m_firstTapLocation, firstTap);
+    m_conversionShader->setUniform(m_secondTapLocation, QVector2D());
+
+    // The first row of the plane corresponds to the first row of the frame.
+    const float vertices[] = {-1, -1, 1, -1, -1, 1, 1, 1};
+    const float texcoords[] = {0, 0, 1, 0, 0, 1, 1, 1};
+    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+    vbo->reset();
+    vbo->setData(4, 2, vertices, texcoords);
+
+    GLFramebuffer::pushFramebuffer(target.framebuffer.get());
+    slot.texture->bind();
+    vbo->render(GL_TRIANGLE_STRIP);
+    slot.texture->unbind();
+    GLFramebuffer::popFramebuffer();
+
+    ShaderManager::instance()->popShader();
+    return target.framebuffer.get();
+}
+
+void ScreenCastReadback::endFrame(pw_buffer *buffer, const spa_video_info_raw &format, const QRegion &damage)
+{
+    Q_ASSERT(!isBusy());
+
+    const int index = (m_oldest + m_pending) % s_slotCount;
+    Slot &slot = m_slots[index];
+    const spa_data *spa = buffer->buffer->datas;
+    const QSize size = slot.texture->size();
+    const bool yuv = isYuvFormat(format.format);
+
+    slot.planes = planes(format.format, size);
+    if (!yuv) {
+        slot.planes[0].stride = spa->chunk->stride;
+    }
+
+    if (yuv && !ensureConversionShader()) {
+        // The damage still has to be recorded, the next frames build on it. The contents of
+        // the buffer are unknown, so it has to be filled completely next time.
+        m_frame++;
+        m_damageJournal.add(damage);
+        m_bufferFrames.remove(buffer);
+
+        spa->chunk->flags = SPA_CHUNK_FLAG_CORRUPTED;
+        slot.region = QRegion();
+        slot.buffer = buffer;
+        m_pending++;
+        finish(index);
+        return;
+    }
+
+    if (!slot.pixelBuffer) {
+        glGenBuffers(1, &slot.pixelBuffer);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+    if (slot.pixelBufferSize < qsizetype(spa->chunk->size)) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, spa->chunk->size, nullptr, GL_STREAM_READ);
+        slot.pixelBufferSize = spa->chunk->size;
+    }
+
+    // Only the parts that have changed since the buffer has been filled need to be updated.
+    m_frame++;
+    const auto lastFrame = m_bufferFrames.constFind(buffer);
+    const int bufferAge = lastFrame != m_bufferFrames.constEnd() ? m_frame - *lastFrame : 0;
+    QRegion region = (m_damageJournal.accumulate(bufferAge, infiniteRegion()) | damage) & QRect(QPoint(), size);
+    if (region.rectCount() > s_maxReadbackRects) {
+        region = region.boundingRect();
+    }
+    m_damageJournal.add(damage);
+    m_bufferFrames[buffer] = m_frame;
+
+    // The pixel buffer has the same layout as the PipeWire buffer. The rows are padded to
+    // 4 bytes, the default pack alignment.
+    for (int i = 0; i < int(slot.planes.size()); ++i) {
+        const Plane &plane = slot.planes[i];
+        GLFramebuffer *framebuffer = yuv ? convert(slot, format, i) : slot.framebuffer.get();
+        const GLenum glFormat = !yuv ? closestGLType(format.format) : plane.bytesPerPixel == 2 ? GL_RG : GL_RED;
+
+        glPixelStorei(GL_PACK_ROW_LENGTH, plane.size.width());
+        GLFramebuffer::pushFramebuffer(framebuffer);
+        for (const QRect &frameRect : region) {
+            const QRect rect = planeRect(frameRect, plane);
+            const qintptr offset = plane.offset + qsizetype(rect.y()) * plane.stride + rect.x() * plane.bytesPerPixel;
+            glReadPixels(rect.x(), rect.y(), rect.width(), rect.height(), glFormat, GL_UNSIGNED_BYTE, reinterpret_cast<void *>(offset));
+        }
+        GLFramebuffer::popFramebuffer();
+    }
+    glPixelStorei(GL_PACK_ROW_LENGTH, 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    slot.buffer = buffer;
+    slot.region = region;
+    m_pending++;
+
+    if (Compositor::self()->scene()->supportsNativeFence()) {
+        slot.fence = std::make_unique<EGLNativeFence>(kwinApp()->outputBackend()->sceneEglDisplay());
+        if (slot.fence->isValid()) {
+            slot.notifier = std::make_unique<QSocketNotifier>(slot.fence->fileDescriptor(), QSocketNotifier::Read);
+            connect(slot.notifier.get(), &QSocketNotifier::activated, this, [this, index]() {
+                finish(index);
+            });
+            return;
+        }
+        qCWarning(KWIN_SCREENCAST) << "Failed to create a native EGL fence";
+    }
+
+    // Without a fence, mapping the pixel buffer will wait for the GPU.
+    finish(index);
+}
+
+void ScreenCastReadback::cancel(pw_buffer *buffer)
+{
+    for (int i = 0; i < m_pending; ++i) {
+        Slot &slot = m_slots[(m_oldest + i) % s_slotCount];
+        if (slot.buffer == buffer) {
+            // The slot is still retired in order, just nothing is copied.
+            slot.buffer = nullptr;
+        }
+    }
+    m_bufferFrames.remove(buffer);
+}
+
+void ScreenCastReadback::finish(int index)
+{
+    // The GPU executes commands in order, so the readbacks that have been started earlier
+    // have finished as well.
+    while (m_pending) {
+        const int oldest = m_oldest;
+        Slot &slot = m_slots[oldest];
+        pw_buffer *buffer = slot.buffer;
+        if (buffer) {
+            download(slot);
+        }
+        release(slot);
+
+        m_oldest = (m_oldest + 1) % s_slotCount;
+        m_pending--;
+
+        if (buffer) {
+            Q_EMIT readyRead(buffer);
+        }
+        if (oldest == index) {
+            break;
+        }
+    }
+}
+
+void ScreenCastReadback::download(Slot &slot)
+{
+    if (slot.region.isEmpty()) {
+        return;
+    }
+
+    spa_data *spa = slot.buffer->buffer->datas;
+    auto data = static_cast<uchar *>(spa->data);
+
+    static_cast<OpenGLBackend *>(Compositor::self()->backend())->makeCurrent();
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pixelBuffer);
+
+    for (const Plane &plane : slot.planes) {
+        const QRect bounds = planeRect(slot.region.boundingRect(), plane);
+        const qsizetype offset = plane.offset + qsizetype(bounds.y()) * plane.stride;
+
+        const auto pixels = static_cast<const uchar *>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, offset, qsizetype(bounds.height()) * plane.stride, GL_MAP_READ_BIT));
+        if (!pixels) {
+            qCWarning(KWIN_SCREENCAST) << "Failed to map the screencast pixel buffer";
+            spa->chunk->flags = SPA_CHUNK_FLAG_CORRUPTED;
+            m_bufferFrames.remove(slot.buffer);
+            break;
+        }
+
+        for (const QRect &frameRect : slot.region) {
+            const QRect rect = planeRect(frameRect, plane);
+            const qsizetype rectOffset = qsizetype(rect.y() - bounds.y()) * plane.stride + rect.x() * plane.bytesPerPixel;
+            if (rect.width() == plane.size.width()) {
+                memcpy(data + offset + rectOffset, pixels + rectOffset, qsizetype(rect.height()) * plane.stride);
+            } else {
+                const qsizetype rowSize = rect.width() * plane.bytesPerPixel;
+                for (int row = 0; row < rect.height(); ++row) {
+                    memcpy(data + offset + rectOffset + row * plane.stride, pixels + rectOffset + row * plane.stride, rowSize);
+                }
+            }
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+
+void ScreenCastReadback::release(Slot &slot)
+{
+    slot.notifier.reset();
+    slot.fence.reset();
+    slot.buffer = nullptr;
+}
+
+} // namespace KWin
@@ -0,0 +1,169 @@
+/*
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "utils/damagejournal.h"
+
+#include <QHash>
+#include <QObject>
+#include <QRegion>
+#include <QSize>
+
+#include <array>
+#include <memory>
+#include <vector>
+
+#include <epoxy/gl.h>
+#include <pipewire/pipewire.h>
+#include <spa/param/video/raw.h>
+
+class QSocketNotifier;
+
+namespace KWin
+{
+
+class EGLNativeFence;
+class GLFramebuffer;
+class GLShader;
+class GLTexture;
+
+/**
+ * The ScreenCastReadback class copies frames from the GPU to memfd PipeWire buffers without
+ * stalling the compositor.
+ *
+ * The frame is rendered into an offscreen framebuffer, which is then read into a pixel
+ * buffer object. The pixel buffer object is mapped and copied into the PipeWire buffer only
+ * after a fence signals that the GPU has finished with it, usually during the next frame.
+ * Several frames can be in flight at the same time.
+ *
+ * PipeWire buffers keep their contents between frames, so only the parts of the frame that
+ * have changed since a buffer has been filled last time are read back and copied, similar
+ * to how the buffer age is used when repainting outputs.
+ *
+ * Besides RGB formats, frames can be converted to NV12 and I420 on the GPU, using the BT.709
+ * matrix with either full or limited range.
+ */
+class ScreenCastReadback : public QObject
+{
+    Q_OBJECT
+
+public:
+    /**
+     * Describes how a plane of a frame is laid out in the PipeWire buffer.
+     */
+    struct Plane
+    {
+        qsizetype offset = 0;
+        int stride = 0;
+        QSize size;
+        int bytesPerPixel = 0;
+        int subsampling = 1;
+    };
+
+    explicit ScreenCastReadback(QObject *parent = nullptr);
+    ~ScreenCastReadback() override;
+
+    /**
+     * Returns @c true if @a format is one of the YUV formats the frames can be converted to.
+     */
+    static bool isYuvFormat(spa_video_format format);
+
+    /**
+     * Returns the planes of a frame with the given @a format and @a size. The layout matches
+     * the default layout used by GStreamer and libav, the rows are padded to 4 bytes.
+     */
+    static std::vector<Plane> planes(spa_video_format format, const QSize &size);
+
+    /**
+     * Returns the number of bytes needed to store a frame with the given @a format and @a size.
+     */
+    static qsizetype frameSize(spa_video_format format, const QSize &size);
+
+    /**
+     * Returns @c true if the OpenGL implementation supports reading pixels asynchronously.
+     */
+    static bool isSupported();
+
+    /**
+     * Returns @c true if the OpenGL implementation can read back the single and dual channel
+     * planes of the YUV formats.
+     */
+    static bool isYuvSupported();
+
+    /**
+     * Returns @c true if all readback slots are in flight and no new frame can be started.
+     */
+    bool isBusy() const;
+
+    /**
+     * Returns the framebuffer the next frame of the given @a size should be rendered into,
+     * or @c nullptr if all readback slots are busy. The frame will appear in the memory in
+     * the same row order as it's stored in the framebuffer.
+     */
+    GLFramebuffer *beginFrame(const QSize &size);
+
+    /**
+     * Starts reading the frame rendered since beginFrame() into the memfd @a buffer. The
+     * @a damage specifies the area that has changed since the previous frame. The readyRead()
+     * signal will be emitted once the buffer contains the frame.
+     */
+    void endFrame(pw_buffer *buffer, const spa_video_info_raw &format, const QRegion &damage);
+
+    /**
+     * Forgets about the pending readback into @a buffer, if any. This must be called when
+     * the PipeWire buffer is removed.
+     */
+    void cancel(pw_buffer *buffer);
+
+Q_SIGNALS:
+    void readyRead(pw_buffer *buffer);
+
+private:
+    struct PlaneTarget
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> framebuffer;
+    };
+
+    struct Slot
+    {
+        std::unique_ptr<GLTexture> texture;
+        std::unique_ptr<GLFramebuffer> framebuffer;
+        std::array<PlaneTarget, 3> planeTargets;
+        GLuint pixelBuffer = 0;
+        qsizetype pixelBufferSize = 0;
+        pw_buffer *buffer = nullptr;
+        std::vector<Plane> planes;
+        QRegion region;
+        std::unique_ptr<EGLNativeFence> fence;
+        std::unique_ptr<QSocketNotifier> notifier;
+    };
+
+    GLFramebuffer *convert(Slot &slot, const spa_video_info_raw &format, int planeIndex);
+    bool ensureConversionShader();
+    void finish(int index);
+    void download(Slot &slot);
+    void release(Slot &slot);
+
+    static constexpr int s_slotCount = 3;
+    std::array<Slot, s_slotCount> m_slots;
+    int m_oldest = 0;
+    int m_pending = 0;
+
+    // The frame that has been read into each PipeWire buffer last time.
+    QHash<pw_buffer *, quint64> m_bufferFrames;
+    DamageJournal m_damageJournal;
+    quint64 m_frame = 0;
+    QSize m_size;
+
+    std::unique_ptr<GLShader> m_conversionShader;
+    int m_colorMatrixLocation = -1;
+    int m_firstTapLocation = -1;
+    int m_secondTapLocation = -1;
+};
+
+} // namespace KWin
@@ -12,9 +12,9 @@
 #include "core/renderbackend.h"
 #include "cursor.h"
 #include "dmabuftexture.h"
-#include "eglnativefence.h"
 #include "kwinscreencast_logging.h"
 #include "libkwineffects/kwineffects.h"
+#include "libkwineffects/kwineglnativefence.h"
 #include "libkwineffects/kwinglplatform.h"
 #include "libkwineffects/kwingltexture.h"
 #include "libkwineffects/kwinglutils.h"
@@ -22,6 +22,7 @@
 #include "pipewirecore.h"
 #include "platformsupport/scenes/opengl/openglbackend.h"
 #include "scene/workspacescene.h"
+#include "screencastreadback.h"
 #include "screencastsource.h"
 #include "utils/common.h"
 
@@ -111,12 +112,17 @@ void ScreenCastStream::newStreamParams()
     spa_pod_builder pod_builder = SPA_POD_BUILDER_INIT(paramsBuffer, sizeof(paramsBuffer));
     const int buffertypes = m_dmabufParams ? (1 << SPA_DATA_DmaBuf) | (1 << SPA_DATA_MemFd) : (1 << SPA_DATA_MemFd);
     const int bpp = videoFormat.format == SPA_VIDEO_FORMAT_RGB || videoFormat.format == SPA_VIDEO_FORMAT_BGR ? 3 : 4;
-    const int stride = SPA_ROUND_UP_N(m_resolution.width() * bpp, 4);
+    int stride = SPA_ROUND_UP_N(m_resolution.width() * bpp, 4);
+    int size = stride * m_resolution.height();
+    if (ScreenCastReadback::isYuvFormat(videoFormat.format)) {
+        stride = ScreenCastReadback::planes(videoFormat.format, m_resolution).front().stride;
+        size = ScreenCastReadback::frameSize(videoFormat.format, m_resolution);
+    }
 
     struct spa_pod_frame f;
     spa_pod_builder_push_object(&pod_builder, &f, SPA_TYPE_OBJECT_ParamBuffers, SPA_PARAM_Buffers);
     spa_pod_builder_add(&pod_builder,
-                        SPA_PARAM_BUFFERS_size, SPA_POD_Int(stride * m_resolution.height()),
+                        SPA_PARAM_BUFFERS_size, SPA_POD_Int(size),
                         SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(16, 2, 16),
                         SPA_PARAM_BUFFERS_stride, SPA_POD_Int(stride),
                         SPA_PARAM_BUFFERS_dataType, SPA_POD_CHOICE_FLAGS_Int(buffertypes), 0);
@@ -239,9 +245,13 @@ void ScreenCastStream::onStreamAddBuffer(void *data, pw_buffer *buffer)
             return;
         }
 
-        const int bytesPerPixel = stream->m_source->hasAlphaChannel() ? 4 : 3;
-        const int stride = SPA_ROUND_UP_N(stream->m_resolution.width() * bytesPerPixel, 4);
-        spa_data->maxsize = stride * stream->m_resolution.height();
+        if (ScreenCastReadback::isYuvFormat(stream->videoFormat.format)) {
+            spa_data->maxsize = ScreenCastReadback::frameSize(stream->videoFormat.format, stream->m_resolution);
+        } else {
+            const int bytesPerPixel = stream->m_source->hasAlphaChannel() ? 4 : 3;
+            const int stride = SPA_ROUND_UP_N(stream->m_resolution.width() * bytesPerPixel, 4);
+            spa_data->maxsize = stride * stream->m_resolution.height();
+        }
         spa_data->type = SPA_DATA_MemFd;
         spa_data->fd = memfd_create("kwin-screencast-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
         if (spa_data->fd == -1) {
@@ -281,6 +291,9 @@ void ScreenCastStream::onStreamRemoveBuffer(void *data, pw_buffer *buffer)
 {
     ScreenCastStream *stream = static_cast<ScreenCastStream *>(data);
     stream->m_dmabufDataForPwBuffer.remove(buffer);
+    if (stream->m_readback) {
+        stream->m_readback->cancel(buffer);
+    }
 
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
@@ -316,9 +329,9 @@ ScreenCastStream::ScreenCastStream(ScreenCastSource *source, QObject *parent)
     pwStreamEvents.state_changed = &ScreenCastStream::onStreamStateChanged;
     pwStreamEvents.param_changed = &ScreenCastStream::onStreamParamChanged;
 
-    connect(&m_pendingFrame, &QTimer::timeout, this, [this] {
-        recordFrame(m_pendingDamages);
-    });
+    m_pendingFrame.setSingleShot(true);
+    m_pendingFrame.setTimerType(Qt::PreciseTimer);
+    connect(&m_pendingFrame, &QTimer::timeout, this, &ScreenCastStream::recordPendingFrame);
 }
 
 ScreenCastStream::~ScreenCastStream()
@@ -428,27 +441,66 @@ void ScreenCastStream::stop()
 
 void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
 {
-    QRegion damagedRegion = _damagedRegion;
     Q_ASSERT(!m_stopped);
 
-    if (videoFormat.max_framerate.num != 0 && !m_lastSent.isNull()) {
-        auto frameInterval = (1000. * videoFormat.max_framerate.denom / videoFormat.max_framerate.num);
-        auto lastSentAgo = m_lastSent.msecsTo(QDateTime::currentDateTimeUtc());
-        if (lastSentAgo < frameInterval) {
-            m_pendingDamages |= damagedRegion;
-            if (!m_pendingFrame.isActive()) {
-                m_pendingFrame.start(frameInterval - lastSentAgo);
-            }
-            return;
-        }
+    // The damage is kept until a frame is actually recorded, buffers may be updated partially.
+    m_pendingDamages.unite(Region(_damagedRegion));
+
+    updatePacing();
+    if (!m_pacer.shouldRecord(m_source->clock())) {
+        // Record the frame when it's due if nothing else is presented until then.
+        schedulePendingFrame();
+        return;
     }
 
-    m_pendingDamages = {};
+    recordPendingFrame();
+}
+
+void ScreenCastStream::schedulePendingFrame()
+{
+    if (m_pendingFrame.isActive()) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now().time_since_epoch();
+    const auto delay = m_pacer.deadline() - now;
+    m_pendingFrame.start(std::max(std::chrono::ceil<std::chrono::milliseconds>(delay), std::chrono::milliseconds::zero()));
+}
+
+void ScreenCastStream::updatePacing()
+{
+    static const int decimation = std::max(1, qEnvironmentVariableIntValue("KWIN_SCREENCAST_FRAME_DECIMATION"));
+
+    std::chrono::nanoseconds refreshInterval = std::chrono::nanoseconds::zero();
+    if (const uint refreshRate = m_source->refreshRate()) {
+        refreshInterval = std::chrono::nanoseconds(1'000'000'000'000ll / refreshRate);
+    }
+
+    std::chrono::nanoseconds frameInterval = std::chrono::nanoseconds::zero();
+    if (videoFormat.max_framerate.num != 0) {
+        frameInterval = std::chrono::nanoseconds(1'000'000'000ll * videoFormat.max_framerate.denom / videoFormat.max_framerate.num);
+    }
+    if (decimation > 1) {
+        frameInterval = std::max(frameInterval, refreshInterval * decimation);
+    }
+
+    m_pacer.setRefreshInterval(refreshInterval);
+    m_pacer.setFrameInterval(frameInterval);
+}
+
+void ScreenCastStream::recordPendingFrame()
+{
+    Q_ASSERT(!m_stopped);
+
     if (m_pendingBuffer) {
         qCWarning(KWIN_SCREENCAST) << "Dropping a screencast frame because the compositor is slow";
         return;
     }
 
+    if (m_readback && m_readback->isBusy()) {
+        qCWarning(KWIN_SCREENCAST) << "Dropping a screencast frame because the readback is slow";
+        return;
+    }
+
     if (m_waitForNewBuffers) {
         qCWarning(KWIN_SCREENCAST) << "Waiting for new buffers to be created";
         return;
@@ -478,6 +530,13 @@ void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
         return;
     }
 
+    QRegion damagedRegion = m_pendingDamages.toQRegion();
+    m_pendingDamages.clear();
+    m_pendingFrame.stop();
+
+    const auto timestamp = m_source->clock();
+    m_pacer.frameRecorded(timestamp);
+
     struct spa_buffer *spa_buffer = buffer->buffer;
     struct spa_data *spa_data = spa_buffer->datas;
 
@@ -491,28 +550,52 @@ void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
     spa_data->chunk->offset = 0;
     spa_data->chunk->flags = SPA_CHUNK_FLAG_NONE;
     static_cast<OpenGLBackend *>(Compositor::self()->backend())->makeCurrent();
+    bool readback = false;
     if (data || spa_data[0].type == SPA_DATA_MemFd) {
         const bool hasAlpha = m_source->hasAlphaChannel();
+        const bool yuv = ScreenCastReadback::isYuvFormat(videoFormat.format);
         const int bpp = data && !hasAlpha ? 3 : 4;
-        const uint stride = SPA_ROUND_UP_N(size.width() * bpp, 4);
+        const uint stride = yuv ? ScreenCastReadback::planes(videoFormat.format, size).front().stride : SPA_ROUND_UP_N(size.width() * bpp, 4);
+        const uint frameSize = yuv ? ScreenCastReadback::frameSize(videoFormat.format, size) : stride * size.height();
 
-        if ((stride * size.height()) > spa_data->maxsize) {
+        if (frameSize > spa_data->maxsize) {
             qCDebug(KWIN_SCREENCAST) << "Failed to record frame: frame is too big";
             pw_stream_queue_buffer(pwStream, buffer);
             return;
         }
 
         spa_data->chunk->stride = stride;
-        spa_data->chunk->size = stride * size.height();
+        spa_data->chunk->size = frameSize;
 
-        m_source->render(spa_data, videoFormat.format);
+        if (!m_readback && ScreenCastReadback::isSupported()) {
+            m_readback = std::make_unique<ScreenCastReadback>();
+            connect(m_readback.get(), &ScreenCastReadback::readyRead, this, [this](pw_buffer *buffer) {
+                pw_stream_queue_buffer(pwStream, buffer);
 
-        auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && exclusiveContains(m_cursor.viewport, cursor->pos())) {
-            QImage dest(data, size.width(), size.height(), stride, hasAlpha ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGB888);
-            QPainter painter(&dest);
-            const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
-            painter.drawImage(QRect{position.toPoint(), cursor->image().size()}, cursor->image());
+                // Record the damage of the frames that have been dropped while the readback was busy.
+                if (!m_pendingDamages.isEmpty()) {
+                    schedulePendingFrame();
+                }
+            });
+        }
+
+        if (m_readback) {
+            // Render the frame and the cursor on the GPU in the orientation expected by the
+            // consumer, then read it back asynchronously.
+            GLFramebuffer *framebuffer = m_readback->beginFrame(size);
+            m_source->render(framebuffer);
+            renderCursor(framebuffer, &damagedRegion);
+            readback = true;
+        } else {
+            m_source->render(spa_data, videoFormat.format);
+
+            auto cursor = Cursors::self()->currentCursor();
+            if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && exclusiveContains(m_cursor.viewport, cursor->pos())) {
+                QImage dest(data, size.width(), size.height(), stride, hasAlpha ? QImage::Format_RGBA8888_Premultiplied : QImage::Format_RGB888);
+                QPainter painter(&dest);
+                const auto position = (cursor->pos() - m_cursor.viewport.topLeft() - cursor->hotspot()) * m_cursor.scale;
+                painter.drawImage(QRect{position.toPoint(), cursor->image().size()}, cursor->image());
+            }
         }
     } else {
         auto &buf = m_dmabufDataForPwBuffer[buffer];
@@ -527,56 +610,64 @@ void ScreenCastStream::recordFrame(const QRegion &_damagedRegion)
         spa_data->chunk->size = spa_data->maxsize;
 
         m_source->render(buf->framebuffer());
+        renderCursor(buf->framebuffer(), &damagedRegion);
+    }
 
-        auto cursor = Cursors::self()->currentCursor();
-        if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && exclusiveContains(m_cursor.viewport, cursor->pos())) {
-            if (!cursor->image().isNull()) {
-                GLFramebuffer::pushFramebuffer(buf->framebuffer());
+    if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Metadata) {
+        sendCursorData(Cursors::self()->currentCursor(),
+                       (spa_meta_cursor *)spa_buffer_find_meta_data(spa_buffer, SPA_META_Cursor, sizeof(spa_meta_cursor)));
+    }
 
-                QRect r(QPoint(), size);
-                auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
+    addDamage(spa_buffer, damagedRegion);
+    addHeader(spa_buffer, timestamp);
+    if (readback) {
+        m_readback->endFrame(buffer, videoFormat, damagedRegion);
+    } else {
+        tryEnqueue(buffer);
+    }
+}
 
-                QMatrix4x4 mvp;
-                mvp.ortho(r);
-                shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+void ScreenCastStream::renderCursor(GLFramebuffer *target, QRegion *damagedRegion)
+{
+    auto cursor = Cursors::self()->currentCursor();
+    if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Embedded && exclusiveContains(m_cursor.viewport, cursor->pos())) {
+        if (!cursor->image().isNull()) {
+            GLFramebuffer::pushFramebuffer(target);
 
-                if (!m_cursor.texture || m_cursor.lastKey != cursor->image().cacheKey()) {
-                    m_cursor.texture.reset(new GLTexture(cursor->image()));
-                }
+            QRect r(QPoint(), target->size());
+            auto shader = ShaderManager::instance()->pushShader(ShaderTrait::MapTexture);
 
-                m_cursor.texture->setContentTransform(TextureTransforms());
-                const auto cursorRect = cursorGeometry(cursor);
-                mvp.translate(cursorRect.left(), r.height() - cursorRect.top() - cursor->image().height());
-                shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
+            QMatrix4x4 mvp;
+            mvp.ortho(r);
+            shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
 
-                glEnable(GL_BLEND);
-                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-                m_cursor.texture->render(cursorRect.size(), m_cursor.scale);
-                glDisable(GL_BLEND);
+            if (!m_cursor.texture || m_cursor.lastKey != cursor->image().cacheKey()) {
+                m_cursor.texture.reset(new GLTexture(cursor->image()));
+            }
 
-                ShaderManager::instance()->popShader();
-                GLFramebuffer::popFramebuffer();
+            m_cursor.texture->setContentTransform(TextureTransforms());
+            const auto cursorRect = cursorGeometry(cursor);
+            mvp.translate(cursorRect.left(), r.height() - cursorRect.top() - cursor->image().height());
+            shader->setUniform(GLShader::ModelViewProjectionMatrix, mvp);
 
-                damagedRegion += QRegion{m_cursor.lastRect.toAlignedRect()} | cursorRect.toAlignedRect();
-                m_cursor.lastRect = cursorRect;
-            } else {
-                damagedRegion |= m_cursor.lastRect.toAlignedRect();
-                m_cursor.lastRect = {};
-            }
-        }
-    }
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            m_cursor.texture->render(cursorRect.size(), m_cursor.scale);
+            glDisable(GL_BLEND);
 
-    if (m_cursor.mode == KWaylandServer::ScreencastV1Interface::Metadata) {
-        sendCursorData(Cursors::self()->currentCursor(),
-                       (spa_meta_cursor *)spa_buffer_find_meta_data(spa_buffer, SPA_META_Cursor, sizeof(spa_meta_cursor)));
-    }
+            ShaderManager::instance()->popShader();
+            GLFramebuffer::popFramebuffer();
 
-    addDamage(spa_buffer, damagedRegion);
-    addHeader(spa_buffer);
-    tryEnqueue(buffer);
+            *damagedRegion += QRegion{m_cursor.lastRect.toAlignedRect()} | cursorRect.toAlignedRect();
+            m_cursor.lastRect = cursorRect;
+        } else {
+            *damagedRegion |= m_cursor.lastRect.toAlignedRect();
+            m_cursor.lastRect = {};
+        }
+    }
 }
 
-void ScreenCastStream::addHeader(spa_buffer *spaBuffer)
+void ScreenCastStream::addHeader(spa_buffer *spaBuffer, std::chrono::nanoseconds timestamp)
 {
     spa_meta_header *spaHeader = (spa_meta_header *)spa_buffer_find_meta_data(spaBuffer, SPA_META_Header, sizeof(spaHeader));
     if (spaHeader) {
@@ -584,11 +675,19 @@ void ScreenCastStream::addHeader(spa_buffer *spaBuffer)
         spaHeader->dts_offset = 0;
         spaHeader->seq = m_sequential++;
 
-        const auto timestamp = m_source->clock();
         if (!m_start) {
             m_start = timestamp;
         }
-        spaHeader->pts = (timestamp - m_start.value()).count();
+
+        // The timestamp is the time when the frame was presented. Buffers that don't carry a new
+        // frame, e.g. cursor updates, may share it with the previous buffer, but the consumers
+        // expect the timestamps to increase.
+        auto pts = timestamp - m_start.value();
+        if (m_lastPts && pts <= *m_lastPts) {
+            pts = *m_lastPts + std::chrono::nanoseconds(1);
+        }
+        m_lastPts = pts;
+        spaHeader->pts = pts.count();
     }
 }
 
@@ -654,7 +753,7 @@ void ScreenCastStream::recordCursor()
 
     sendCursorData(Cursors::self()->currentCursor(),
                    (spa_meta_cursor *)spa_buffer_find_meta_data(spa_buffer, SPA_META_Cursor, sizeof(spa_meta_cursor)));
-    addHeader(spa_buffer);
+    addHeader(spa_buffer, m_source->clock());
     addDamage(spa_buffer, {});
     enqueue();
 }
@@ -694,11 +793,6 @@ void ScreenCastStream::enqueue()
     m_pendingNotifier.reset();
 
     pw_stream_queue_buffer(pwStream, m_pendingBuffer);
-
-    if (m_pendingBuffer->buffer->datas[0].chunk->flags != SPA_CHUNK_FLAG_CORRUPTED) {
-        m_lastSent = QDateTime::currentDateTimeUtc();
-    }
-
     m_pendingBuffer = nullptr;
 }
 
@@ -713,7 +807,7 @@ QVector<const spa_pod *> ScreenCastStream::buildFormats(bool fixate, char buffer
     spa_rectangle resolution = SPA_RECTANGLE(uint32_t(m_resolution.width()), uint32_t(m_resolution.height()));
 
     QVector<const spa_pod *> params;
-    params.reserve(fixate + m_hasDmaBuf + 1);
+    params.reserve(fixate + m_hasDmaBuf + 3);
     if (fixate) {
         params.append(buildFormat(&podBuilder, SPA_VIDEO_FORMAT_BGRA, &resolution, &defFramerate, &minFramerate, &maxFramerate, {m_dmabufParams->modifier}, SPA_POD_PROP_FLAG_MANDATORY));
     }
@@ -721,6 +815,11 @@ QVector<const spa_pod *> ScreenCastStream::buildFormats(bool fixate, char buffer
         params.append(buildFormat(&podBuilder, SPA_VIDEO_FORMAT_BGRA, &resolution, &defFramerate, &minFramerate, &maxFramerate, m_modifiers, SPA_POD_PROP_FLAG_MANDATORY | SPA_POD_PROP_FLAG_DONT_FIXATE));
     }
     params.append(buildFormat(&podBuilder, format, &resolution, &defFramerate, &minFramerate, &maxFramerate, {}, SPA_POD_PROP_FLAG_MANDATORY | SPA_POD_PROP_FLAG_DONT_FIXATE));
+    if (ScreenCastReadback::isYuvSupported()) {
+        // Converting to YUV on the GPU saves encoders from doing it on the CPU.
+        params.append(buildFormat(&podBuilder, SPA_VIDEO_FORMAT_NV12, &resolution, &defFramerate, &minFramerate, &maxFramerate, {}, 0));
+        params.append(buildFormat(&podBuilder, SPA_VIDEO_FORMAT_I420, &resolution, &defFramerate, &minFramerate, &maxFramerate, {}, 0));
+    }
     return params;
 }
 
@@ -751,6 +850,14 @@ spa_pod *ScreenCastStream::buildFormat(struct spa_pod_builder *b, enum spa_video
         spa_pod_builder_add(b, SPA_FORMAT_VIDEO_format, SPA_POD_Id(format), 0);
     }
 
+    if (ScreenCastReadback::isYuvFormat(format)) {
+        spa_pod_builder_add(b, SPA_FORMAT_VIDEO_colorMatrix, SPA_POD_Id(SPA_VIDEO_COLOR_MATRIX_BT709), 0);
+        spa_pod_builder_add(b, SPA_FORMAT_VIDEO_colorRange,
+                            SPA_POD_CHOICE_ENUM_Id(3, SPA_VIDEO_COLOR_RANGE_16_235, SPA_VIDEO_COLOR_RANGE_16_235, SPA_VIDEO_COLOR_RANGE_0_255), 0);
+        spa_pod_builder_add(b, SPA_FORMAT_VIDEO_chromaSite,
+                            SPA_POD_CHOICE_ENUM_Id(3, SPA_VIDEO_CHROMA_SITE_MPEG2, SPA_VIDEO_CHROMA_SITE_MPEG2, SPA_VIDEO_CHROMA_SITE_JPEG), 0);
+    }
+
     if (!modifiers.isEmpty()) {
         spa_pod_builder_prop(b, SPA_FORMAT_VIDEO_modifier, modifiersFlags);
         spa_pod_builder_push_choice(b, &f[1], SPA_CHOICE_Enum, 0);
@@ -11,10 +11,11 @@
 #include "config-kwin.h"
 
 #include "dmabuftexture.h"
+#include "screencastpacer.h"
 #include "libkwineffects/kwinglobals.h"
+#include "utils/region.h"
 #include "wayland/screencast_v1_interface.h"
 
-#include <QDateTime>
 #include <QHash>
 #include <QObject>
 #include <QSize>
@@ -35,7 +36,9 @@ namespace KWin
 class Cursor;
 class EGLNativeFence;
 class GLTexture;
+class GLFramebuffer;
 class PipeWireCore;
+class ScreenCastReadback;
 class ScreenCastSource;
 
 class KWIN_EXPORT ScreenCastStream : public QObject
@@ -83,7 +86,11 @@ private:
     void updateParams();
     void coreFailed(const QString &errorMessage);
     void sendCursorData(Cursor *cursor, spa_meta_cursor *spa_cursor);
-    void addHeader(spa_buffer *spaBuffer);
+    void renderCursor(GLFramebuffer *target, QRegion *damagedRegion);
+    void recordPendingFrame();
+    void updatePacing();
+    void schedulePendingFrame();
+    void addHeader(spa_buffer *spaBuffer, std::chrono::nanoseconds timestamp);
     void addDamage(spa_buffer *spaBuffer, const QRegion &damagedRegion);
     void newStreamParams();
     void tryEnqueue(pw_buffer *buffer);
@@ -127,14 +134,16 @@ private:
     pw_buffer *m_pendingBuffer = nullptr;
     std::unique_ptr<QSocketNotifier> m_pendingNotifier;
     std::unique_ptr<EGLNativeFence> m_pendingFence;
+    std::unique_ptr<ScreenCastReadback> m_readback;
     std::optional<std::chrono::nanoseconds> m_start;
+    std::optional<std::chrono::nanoseconds> m_lastPts;
     quint64 m_sequential = 0;
     bool m_hasDmaBuf = false;
     bool m_waitForNewBuffers = false;
     quint32 m_drmFormat = 0;
 
-    QDateTime m_lastSent;
-    QRegion m_pendingDamages;
+    ScreenCastPacer m_pacer;
+    Region m_pendingDamages;
     QTimer m_pendingFrame;
 };
 
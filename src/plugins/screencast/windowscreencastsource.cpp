@@ -77,7 +77,7 @@ void WindowScreenCastSource::render(GLFramebuffer *target)
 
 std::chrono::nanoseconds WindowScreenCastSource::clock() const
 {
-    return m_window->output()->renderLoop()->lastPresentationTimestamp();
+    return m_window->output()->renderLoop()->nextPresentationTimestamp();
 }
 
 uint WindowScreenCastSource::refreshRate() const
@@ -37,6 +37,9 @@ void CursorScene::initialize()
 
 static void resetRepaintsHelper(Item *item, SceneDelegate *delegate)
 {
+    if (!item->hasRepaints(delegate)) {
+        return;
+    }
     item->resetRepaints(delegate);
 
     const auto childItems = item->childItems();
@@ -47,6 +50,7 @@ static void resetRepaintsHelper(Item *item, SceneDelegate *delegate)
 
 void CursorScene::prePaint(SceneDelegate *delegate)
 {
+    m_renderer->frameArena()->reset();
     resetRepaintsHelper(m_rootItem.get(), delegate);
     m_paintedOutput = delegate->output();
 }
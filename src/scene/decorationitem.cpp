@@ -209,10 +209,10 @@ WindowQuad buildQuad(const QRectF &partRect, const QPoint &textureOffset,
     return quad;
 }
 
-WindowQuadList DecorationItem::buildQuads() const
+CompactWindowQuadList DecorationItem::buildQuads() const
 {
     if (m_window->frameMargins().isNull()) {
-        return WindowQuadList();
+        return CompactWindowQuadList();
     }
 
     QRectF left, top, right, bottom;
@@ -230,7 +230,7 @@ WindowQuadList DecorationItem::buildQuads() const
     const QPoint leftPosition(0, bottomPosition.y() + bottomHeight + (2 * texturePad));
     const QPoint rightPosition(0, leftPosition.y() + leftWidth + (2 * texturePad));
 
-    WindowQuadList list;
+    CompactWindowQuadList list;
     if (left.isValid()) {
         list.append(buildQuad(left, leftPosition, devicePixelRatio, true));
     }
@@ -92,7 +92,7 @@ private Q_SLOTS:
 
 protected:
     void preprocess() override;
-    WindowQuadList buildQuads() const override;
+    CompactWindowQuadList buildQuads() const override;
 
 private:
     Window *m_window;
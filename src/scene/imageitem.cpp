@@ -56,20 +56,20 @@ void ImageItemOpenGL::preprocess()
     }
 }
 
-WindowQuadList ImageItemOpenGL::buildQuads() const
+CompactWindowQuadList ImageItemOpenGL::buildQuads() const
 {
     const QRectF geometry = boundingRect();
     if (geometry.isEmpty()) {
-        return WindowQuadList{};
+        return CompactWindowQuadList{};
     }
 
-    WindowQuad quad;
-    quad[0] = WindowVertex(geometry.topLeft(), QPointF(0, 0));
-    quad[1] = WindowVertex(geometry.topRight(), QPointF(1, 0));
-    quad[2] = WindowVertex(geometry.bottomRight(), QPointF(1, 1));
-    quad[3] = WindowVertex(geometry.bottomLeft(), QPointF(0, 1));
+    CompactWindowQuad quad;
+    quad.setVertex(0, geometry.topLeft(), QPointF(0, 0));
+    quad.setVertex(1, geometry.topRight(), QPointF(1, 0));
+    quad.setVertex(2, geometry.bottomRight(), QPointF(1, 1));
+    quad.setVertex(3, geometry.bottomLeft(), QPointF(0, 1));
 
-    WindowQuadList ret;
+    CompactWindowQuadList ret;
     ret.append(quad);
     return ret;
 }
@@ -39,7 +39,7 @@ public:
 
 protected:
     void preprocess() override;
-    WindowQuadList buildQuads() const override;
+    CompactWindowQuadList buildQuads() const override;
 
 private:
     std::unique_ptr<GLTexture> m_texture;
@@ -13,8 +13,11 @@
 namespace KWin
 {
 
+static quint64 s_nextSubtreeVersion = 1;
+
 Item::Item(Scene *scene, Item *parent)
     : m_scene(scene)
+    , m_subtreeVersion(s_nextSubtreeVersion++)
 {
     setParentItem(parent);
     connect(m_scene, &Scene::delegateRemoved, this, &Item::removeRepaints);
@@ -25,7 +28,7 @@ Item::~Item()
     setParentItem(nullptr);
     for (const auto &dirty : std::as_const(m_repaints)) {
         if (!dirty.isEmpty()) {
-            m_scene->addRepaint(dirty);
+            m_scene->addRepaint(dirty.toQRegion());
         }
     }
 }
@@ -44,6 +47,7 @@ void Item::setOpacity(qreal opacity)
 {
     if (m_opacity != opacity) {
         m_opacity = opacity;
+        markSubtreeChanged();
         scheduleRepaint(boundingRect());
     }
 }
@@ -62,7 +66,9 @@ void Item::setZ(int z)
     if (m_parentItem) {
         m_parentItem->markSortedChildItemsDirty();
     }
+    markSubtreeChanged();
     scheduleRepaint(boundingRect());
+    Q_EMIT zChanged();
 }
 
 Item *Item::parentItem() const
@@ -92,6 +98,11 @@ void Item::addChild(Item *item)
 
     m_childItems.append(item);
     markSortedChildItemsDirty();
+    markSubtreeChanged();
+
+    for (SceneDelegate *delegate : std::as_const(item->m_dirtyDelegates)) {
+        markRepaintsDirty(delegate);
+    }
 
     updateBoundingRect();
     scheduleRepaint(item->boundingRect().translated(item->position()));
@@ -106,8 +117,11 @@ void Item::removeChild(Item *item)
 
     m_childItems.removeOne(item);
     markSortedChildItemsDirty();
+    markSubtreeChanged();
 
     updateBoundingRect();
+
+    Q_EMIT childRemoved(item);
 }
 
 QList<Item *> Item::childItems() const
@@ -125,6 +139,7 @@ void Item::setPosition(const QPointF &point)
     if (m_position != point) {
         scheduleRepaint(boundingRect());
         m_position = point;
+        markSubtreeChanged();
         if (m_parentItem) {
             m_parentItem->updateBoundingRect();
         }
@@ -205,7 +220,10 @@ QMatrix4x4 Item::transform() const
 
 void Item::setTransform(const QMatrix4x4 &transform)
 {
-    m_transform = transform;
+    if (m_transform != transform) {
+        m_transform = transform;
+        markSubtreeChanged();
+    }
 }
 
 QRegion Item::mapToGlobal(const QRegion &region) const
@@ -255,6 +273,7 @@ void Item::stackBefore(Item *sibling)
 
     m_parentItem->m_childItems.move(selfIndex, selfIndex > siblingIndex ? siblingIndex : siblingIndex - 1);
     markSortedChildItemsDirty();
+    markSubtreeChanged();
 
     scheduleRepaint(boundingRect());
     sibling->scheduleRepaint(sibling->boundingRect());
@@ -283,6 +302,7 @@ void Item::stackAfter(Item *sibling)
 
     m_parentItem->m_childItems.move(selfIndex, selfIndex > siblingIndex ? siblingIndex + 1 : siblingIndex);
     markSortedChildItemsDirty();
+    markSubtreeChanged();
 
     scheduleRepaint(boundingRect());
     sibling->scheduleRepaint(sibling->boundingRect());
@@ -295,14 +315,32 @@ void Item::scheduleRepaint(const QRegion &region)
     }
 }
 
+void Item::scheduleRepaintInternal(const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    const QRect globalRect = rect.translated(rootPosition().toPoint());
+    const QList<SceneDelegate *> delegates = m_scene->delegates();
+    for (SceneDelegate *delegate : delegates) {
+        const QRect dirtyRect = globalRect & delegate->viewport();
+        if (!dirtyRect.isEmpty()) {
+            m_repaints[delegate].unite(dirtyRect);
+            markRepaintsDirty(delegate);
+            delegate->layer()->loop()->scheduleRepaint(this);
+        }
+    }
+}
+
 void Item::scheduleRepaintInternal(const QRegion &region)
 {
-    const QRegion globalRegion = mapToGlobal(region);
+    Region globalRegion(mapToGlobal(region));
     const QList<SceneDelegate *> delegates = m_scene->delegates();
     for (SceneDelegate *delegate : delegates) {
-        const QRegion dirtyRegion = globalRegion & delegate->viewport();
+        const Region dirtyRegion = globalRegion.intersected(delegate->viewport());
         if (!dirtyRegion.isEmpty()) {
-            m_repaints[delegate] += dirtyRegion;
+            m_repaints[delegate].unite(dirtyRegion);
+            markRepaintsDirty(delegate);
             delegate->layer()->loop()->scheduleRepaint(this);
         }
     }
@@ -326,17 +364,30 @@ void Item::preprocess()
 {
 }
 
-WindowQuadList Item::buildQuads() const
+CompactWindowQuadList Item::buildQuads() const
 {
-    return WindowQuadList();
+    return CompactWindowQuadList();
 }
 
 void Item::discardQuads()
 {
     m_quads.reset();
+    markSubtreeChanged();
 }
 
-WindowQuadList Item::quads() const
+quint64 Item::subtreeVersion() const
+{
+    return m_subtreeVersion;
+}
+
+void Item::markSubtreeChanged()
+{
+    for (Item *item = this; item; item = item->m_parentItem) {
+        item->m_subtreeVersion = s_nextSubtreeVersion++;
+    }
+}
+
+CompactWindowQuadList Item::quads() const
 {
     if (!m_quads.has_value()) {
         m_quads = buildQuads();
@@ -344,19 +395,34 @@ WindowQuadList Item::quads() const
     return m_quads.value();
 }
 
-QRegion Item::repaints(SceneDelegate *delegate) const
+Region Item::repaints(SceneDelegate *delegate) const
 {
     return m_repaints.value(delegate);
 }
 
 void Item::resetRepaints(SceneDelegate *delegate)
 {
-    m_repaints.insert(delegate, QRegion());
+    m_repaints[delegate].clear();
+    m_dirtyDelegates.removeOne(delegate);
+}
+
+bool Item::hasRepaints(SceneDelegate *delegate) const
+{
+    return m_dirtyDelegates.contains(delegate);
+}
+
+void Item::markRepaintsDirty(SceneDelegate *delegate)
+{
+    // The ancestors of a dirty item are dirty too, so stop as soon as a dirty item is found.
+    for (Item *item = this; item && !item->m_dirtyDelegates.contains(delegate); item = item->m_parentItem) {
+        item->m_dirtyDelegates.append(delegate);
+    }
 }
 
 void Item::removeRepaints(SceneDelegate *delegate)
 {
     m_repaints.remove(delegate);
+    m_dirtyDelegates.removeOne(delegate);
 }
 
 bool Item::explicitVisible() const
@@ -373,13 +439,16 @@ void Item::setVisible(bool visible)
 {
     if (m_explicitVisible != visible) {
         m_explicitVisible = visible;
+        markSubtreeChanged();
         updateEffectiveVisibility();
     }
 }
 
 void Item::scheduleRepaint(const QRectF &region)
 {
-    scheduleRepaint(QRegion(region.toAlignedRect()));
+    if (isVisible()) {
+        scheduleRepaintInternal(region.toAlignedRect());
+    }
 }
 
 bool Item::computeEffectiveVisibility() const
@@ -404,6 +473,8 @@ void Item::updateEffectiveVisibility()
     for (Item *childItem : std::as_const(m_childItems)) {
         childItem->updateEffectiveVisibility();
     }
+
+    Q_EMIT visibleChanged();
 }
 
 static bool compareZ(const Item *a, const Item *b)
@@ -8,6 +8,7 @@
 
 #include "libkwineffects/kwineffects.h"
 #include "libkwineffects/kwinglobals.h"
+#include "utils/region.h"
 
 #include <QMatrix4x4>
 #include <QObject>
@@ -105,14 +106,40 @@ public:
     void scheduleRepaint(const QRectF &region);
     void scheduleRepaint(const QRegion &region);
     void scheduleFrame();
-    QRegion repaints(SceneDelegate *delegate) const;
+    Region repaints(SceneDelegate *delegate) const;
+    /**
+     * Resets the repaints of this item for the specified @a delegate. The child items are
+     * not touched, the caller is expected to visit the children that still have repaints.
+     */
     void resetRepaints(SceneDelegate *delegate);
+    /**
+     * Returns @c true if this item or any of its descendants has pending repaints for the
+     * specified @a delegate. This can be used to skip clean sub-trees when collecting repaints.
+     */
+    bool hasRepaints(SceneDelegate *delegate) const;
 
-    WindowQuadList quads() const;
+    CompactWindowQuadList quads() const;
     virtual void preprocess();
 
+    /**
+     * Returns a number that changes whenever something that affects the geometry of this item
+     * or one of its descendants changes, e.g. the position, the transform or the quads. Every
+     * change produces a number that has never been used before.
+     */
+    quint64 subtreeVersion() const;
+
 Q_SIGNALS:
     void childAdded(Item *item);
+    void childRemoved(Item *item);
+    /**
+     * This signal is emitted when the stacking order of this item relative to its siblings
+     * has changed.
+     */
+    void zChanged();
+    /**
+     * This signal is emitted when the effective visibility of this item has changed.
+     */
+    void visibleChanged();
     /**
      * This signal is emitted when the position of this item has changed.
      */
@@ -129,15 +156,18 @@ Q_SIGNALS:
     void boundingRectChanged();
 
 protected:
-    virtual WindowQuadList buildQuads() const;
+    virtual CompactWindowQuadList buildQuads() const;
     void discardQuads();
 
 private:
     void addChild(Item *item);
     void removeChild(Item *item);
     void updateBoundingRect();
+    void scheduleRepaintInternal(const QRect &rect);
     void scheduleRepaintInternal(const QRegion &region);
     void markSortedChildItemsDirty();
+    void markRepaintsDirty(SceneDelegate *delegate);
+    void markSubtreeChanged();
 
     bool computeEffectiveVisibility() const;
     void updateEffectiveVisibility();
@@ -154,8 +184,10 @@ private:
     int m_z = 0;
     bool m_explicitVisible = true;
     bool m_effectiveVisible = true;
-    QMap<SceneDelegate *, QRegion> m_repaints;
-    mutable std::optional<WindowQuadList> m_quads;
+    QMap<SceneDelegate *, Region> m_repaints;
+    QVector<SceneDelegate *> m_dirtyDelegates;
+    quint64 m_subtreeVersion;
+    mutable std::optional<CompactWindowQuadList> m_quads;
     mutable std::optional<QList<Item *>> m_sortedChildItems;
 };
 
@@ -32,4 +32,17 @@ void ItemRenderer::endFrame()
 {
 }
 
+void ItemRenderer::beginBatch()
+{
+}
+
+void ItemRenderer::endBatch()
+{
+}
+
+FrameArena *ItemRenderer::frameArena()
+{
+    return &m_frameArena;
+}
+
 } // namespace KWin
@@ -6,6 +6,8 @@
 
 #pragma once
 
+#include "core/framearena.h"
+
 #include <kwin_export.h>
 
 #include <QMatrix4x4>
@@ -33,10 +35,26 @@ public:
     virtual void beginFrame(const RenderTarget &renderTarget, const RenderViewport &viewport);
     virtual void endFrame();
 
+    /**
+     * Starts collecting the items painted with renderItem() so they can be submitted together
+     * in endBatch(). Nothing else may be painted until the batch has ended.
+     */
+    virtual void beginBatch();
+    virtual void endBatch();
+
     virtual void renderBackground(const RenderTarget &renderTarget, const RenderViewport &viewport, const QRegion &region) = 0;
     virtual void renderItem(const RenderTarget &renderTarget, const RenderViewport &viewport, Item *item, int mask, const QRegion &region, const WindowPaintData &data) = 0;
 
     virtual ImageItem *createImageItem(Scene *scene, Item *parent = nullptr) = 0;
+
+    /**
+     * Returns the arena for the temporary data of the frame that is being painted. The scene
+     * rewinds the arena when it starts preparing the next frame.
+     */
+    FrameArena *frameArena();
+
+private:
+    FrameArena m_frameArena;
 };
 
 } // namespace KWin
@@ -5,6 +5,7 @@
 */
 
 #include "scene/itemrenderer_opengl.h"
+#include "frametimeline.h"
 #include "libkwineffects/rendertarget.h"
 #include "libkwineffects/renderviewport.h"
 #include "platformsupport/scenes/opengl/openglsurfacetexture.h"
@@ -26,18 +27,31 @@ ImageItem *ItemRendererOpenGL::createImageItem(Scene *scene, Item *parent)
     return new ImageItemOpenGL(scene, parent);
 }
 
+// The number of frames after which the render nodes of an item that hasn't been painted are dropped.
+static const quint64 s_renderNodeCacheLifetime = 120;
+
 void ItemRendererOpenGL::beginFrame(const RenderTarget &renderTarget, const RenderViewport &viewport)
 {
     GLFramebuffer *fbo = renderTarget.framebuffer();
     GLFramebuffer::pushFramebuffer(fbo);
 
     GLVertexBuffer::streamingBuffer()->beginFrame();
+    m_frameCounter++;
+    m_drawCallCount = 0;
+    m_renderNodeCount = 0;
 }
 
 void ItemRendererOpenGL::endFrame()
 {
     GLVertexBuffer::streamingBuffer()->endOfFrame();
     GLFramebuffer::popFramebuffer();
+
+    m_lastFrameDrawCallCount = m_drawCallCount;
+    m_lastFrameRenderNodeCount = m_renderNodeCount;
+
+    std::erase_if(m_renderNodeCache, [this](const auto &entry) {
+        return !entry.second.item || m_frameCounter - entry.second.lastUsedFrame > s_renderNodeCacheLifetime;
+    });
 }
 
 QVector4D ItemRendererOpenGL::modulate(float opacity, float brightness) const
@@ -88,49 +102,71 @@ static GLTexture *bindSurfaceTexture(SurfaceItem *surfaceItem)
     return platformSurfaceTexture->texture();
 }
 
-static QRectF logicalRectToDeviceRect(const QRectF &logical, qreal deviceScale)
+static bool bindRenderNodeTexture(ItemRendererOpenGL::RenderNode &renderNode)
 {
-    return QRectF(QPointF(std::round(logical.left() * deviceScale), std::round(logical.top() * deviceScale)),
-                  QPointF(std::round(logical.right() * deviceScale), std::round(logical.bottom() * deviceScale)));
+    if (auto shadowItem = qobject_cast<ShadowItem *>(renderNode.item)) {
+        OpenGLShadowTextureProvider *textureProvider = static_cast<OpenGLShadowTextureProvider *>(shadowItem->textureProvider());
+        renderNode.texture = textureProvider->shadowTexture();
+        renderNode.hasAlpha = true;
+        renderNode.coordinateType = UnnormalizedCoordinates;
+    } else if (auto decorationItem = qobject_cast<DecorationItem *>(renderNode.item)) {
+        auto renderer = static_cast<const SceneOpenGLDecorationRenderer *>(decorationItem->renderer());
+        renderNode.texture = renderer->texture();
+        renderNode.hasAlpha = true;
+        renderNode.coordinateType = UnnormalizedCoordinates;
+    } else if (auto surfaceItem = qobject_cast<SurfaceItem *>(renderNode.item)) {
+        if (!surfaceItem->pixmap()) {
+            return false;
+        }
+        renderNode.texture = bindSurfaceTexture(surfaceItem);
+        renderNode.hasAlpha = surfaceItem->pixmap()->hasAlphaChannel();
+        renderNode.coordinateType = NormalizedCoordinates;
+    } else if (auto imageItem = qobject_cast<ImageItemOpenGL *>(renderNode.item)) {
+        renderNode.texture = imageItem->texture();
+        renderNode.hasAlpha = imageItem->image().hasAlphaChannel();
+        renderNode.coordinateType = NormalizedCoordinates;
+    }
+    return true;
 }
 
-static RenderGeometry clipQuads(const Item *item, const ItemRendererOpenGL::RenderContext *context)
+static void preprocessItem(Item *item)
 {
-    const WindowQuadList quads = item->quads();
+    const QList<Item *> sortedChildItems = item->sortedChildItems();
 
-    // Item to world translation.
-    const QPointF worldTranslation = context->transformStack.top().map(QPointF(0., 0.));
-    const qreal scale = context->renderTargetScale;
-
-    RenderGeometry geometry;
-    geometry.reserve(quads.count() * 6);
-
-    // split all quads in bounding rect with the actual rects in the region
-    for (const WindowQuad &quad : std::as_const(quads)) {
-        if (context->clip != infiniteRegion() && !context->hardwareClipping) {
-            // Scale to device coordinates, rounding as needed.
-            QRectF deviceBounds = logicalRectToDeviceRect(quad.bounds(), scale);
-
-            for (const QRect &clipRect : std::as_const(context->clip)) {
-                QRectF deviceClipRect = logicalRectToDeviceRect(clipRect, scale).translated(-worldTranslation);
-
-                const QRectF &intersected = deviceClipRect.intersected(deviceBounds);
-                if (intersected.isValid()) {
-                    if (deviceBounds == intersected) {
-                        // case 1: completely contains, include and do not check other rects
-                        geometry.appendWindowQuad(quad, scale);
-                        break;
-                    }
-                    // case 2: intersection
-                    geometry.appendSubQuad(quad, intersected, scale);
-                }
-            }
-        } else {
-            geometry.appendWindowQuad(quad, scale);
+    for (Item *childItem : sortedChildItems) {
+        if (childItem->z() >= 0) {
+            break;
+        }
+        if (childItem->explicitVisible()) {
+            preprocessItem(childItem);
         }
     }
 
-    return geometry;
+    item->preprocess();
+
+    for (Item *childItem : sortedChildItems) {
+        if (childItem->z() < 0) {
+            continue;
+        }
+        if (childItem->explicitVisible()) {
+            preprocessItem(childItem);
+        }
+    }
+}
+
+static bool isTranslation(const QMatrix4x4 &matrix)
+{
+    QMatrix4x4 translation;
+    translation.translate(matrix(0, 3), matrix(1, 3), matrix(2, 3));
+    return matrix == translation;
+}
+
+static void translateGeometry(RenderGeometry &geometry, const QPointF &translation)
+{
+    const QVector2D offset(translation);
+    for (GLVertex2D &vertex : geometry) {
+        vertex.position += offset;
+    }
 }
 
 void ItemRendererOpenGL::createRenderNode(Item *item, RenderContext *context)
@@ -142,9 +178,9 @@ void ItemRendererOpenGL::createRenderNode(Item *item, RenderContext *context)
     const auto scale = context->renderTargetScale;
     matrix.translate(roundVector(logicalPosition * scale).toVector3D());
     matrix *= item->transform();
-    context->transformStack.push(context->transformStack.top() * matrix);
+    context->transformStack.push_back(context->transformStack.back() * matrix);
 
-    context->opacityStack.push(context->opacityStack.top() * item->opacity());
+    context->opacityStack.push_back(context->opacityStack.back() * item->opacity());
 
     for (Item *childItem : sortedChildItems) {
         if (childItem->z() >= 0) {
@@ -155,62 +191,42 @@ void ItemRendererOpenGL::createRenderNode(Item *item, RenderContext *context)
         }
     }
 
-    item->preprocess();
-
-    RenderGeometry geometry = clipQuads(item, context);
-
-    if (auto shadowItem = qobject_cast<ShadowItem *>(item)) {
-        if (!geometry.isEmpty()) {
-            OpenGLShadowTextureProvider *textureProvider = static_cast<OpenGLShadowTextureProvider *>(shadowItem->textureProvider());
-            context->renderNodes.append(RenderNode{
-                .texture = textureProvider->shadowTexture(),
-                .geometry = geometry,
-                .transformMatrix = context->transformStack.top(),
-                .opacity = context->opacityStack.top(),
-                .hasAlpha = true,
-                .coordinateType = UnnormalizedCoordinates,
-                .scale = scale,
-            });
-        }
-    } else if (auto decorationItem = qobject_cast<DecorationItem *>(item)) {
-        if (!geometry.isEmpty()) {
-            auto renderer = static_cast<const SceneOpenGLDecorationRenderer *>(decorationItem->renderer());
-            context->renderNodes.append(RenderNode{
-                .texture = renderer->texture(),
-                .geometry = geometry,
-                .transformMatrix = context->transformStack.top(),
-                .opacity = context->opacityStack.top(),
-                .hasAlpha = true,
-                .coordinateType = UnnormalizedCoordinates,
-                .scale = scale,
-            });
-        }
+    bool hasContents = false;
+    if (qobject_cast<ShadowItem *>(item) || qobject_cast<DecorationItem *>(item) || qobject_cast<ImageItemOpenGL *>(item)) {
+        hasContents = true;
     } else if (auto surfaceItem = qobject_cast<SurfaceItem *>(item)) {
-        SurfacePixmap *pixmap = surfaceItem->pixmap();
-        if (pixmap) {
-            if (!geometry.isEmpty()) {
-                context->renderNodes.append(RenderNode{
-                    .texture = bindSurfaceTexture(surfaceItem),
-                    .geometry = geometry,
-                    .transformMatrix = context->transformStack.top(),
-                    .opacity = context->opacityStack.top(),
-                    .hasAlpha = pixmap->hasAlphaChannel(),
-                    .coordinateType = NormalizedCoordinates,
-                    .scale = scale,
-                });
+        hasContents = surfaceItem->pixmap();
+    }
+    if (hasContents) {
+        RenderNode renderNode{
+            .item = item,
+            .quads = item->quads(),
+            .transformMatrix = context->transformStack.back(),
+            .opacity = context->opacityStack.back(),
+            .scale = scale,
+        };
+        if (!renderNode.quads.isEmpty() && bindRenderNodeTexture(renderNode)) {
+            // The geometry is not clipped so that it stays valid when the repaint region changes,
+            // the region is applied with the scissor test when the node is painted.
+            renderNode.geometry.reserve(renderNode.quads.count() * 6);
+            QRectF bounds;
+            for (const CompactWindowQuad &quad : std::as_const(renderNode.quads)) {
+                renderNode.geometry.appendWindowQuad(quad, scale);
+                bounds |= quad.bounds();
             }
-        }
-    } else if (auto imageItem = qobject_cast<ImageItemOpenGL *>(item)) {
-        if (!geometry.isEmpty()) {
-            context->renderNodes.append(RenderNode{
-                .texture = imageItem->texture(),
-                .geometry = geometry,
-                .transformMatrix = context->transformStack.top(),
-                .opacity = context->opacityStack.top(),
-                .hasAlpha = imageItem->image().hasAlphaChannel(),
-                .coordinateType = NormalizedCoordinates,
-                .scale = scale,
-            });
+            // Item to world translation.
+            const QPointF worldTranslation = renderNode.transformMatrix.map(QPointF(0., 0.));
+            renderNode.bounds = bounds.translated(worldTranslation / scale);
+
+            // Without the translation in the transform matrix, the nodes of all windows can be
+            // painted with the same matrix and merged into fewer draw calls.
+            if (isTranslation(renderNode.transformMatrix)) {
+                translateGeometry(renderNode.geometry, worldTranslation);
+                renderNode.translation = worldTranslation;
+                renderNode.transformMatrix = QMatrix4x4();
+            }
+
+            context->renderNodes.append(std::move(renderNode));
         }
     }
 
@@ -223,8 +239,8 @@ void ItemRendererOpenGL::createRenderNode(Item *item, RenderContext *context)
         }
     }
 
-    context->transformStack.pop();
-    context->opacityStack.pop();
+    context->transformStack.pop_back();
+    context->opacityStack.pop_back();
 }
 
 void ItemRendererOpenGL::renderBackground(const RenderTarget &renderTarget, const RenderViewport &viewport, const QRegion &region)
@@ -248,123 +264,387 @@ void ItemRendererOpenGL::renderBackground(const RenderTarget &renderTarget, cons
     }
 }
 
-void ItemRendererOpenGL::renderItem(const RenderTarget &renderTarget, const RenderViewport &viewport, Item *item, int mask, const QRegion &region, const WindowPaintData &data)
+void ItemRendererOpenGL::buildRenderNodes(Item *item, RenderContext *context, CachedRenderNodes *cache)
 {
-    if (region.isEmpty()) {
+    createRenderNode(item, context);
+
+    int totalVertexCount = 0;
+    for (RenderNode &renderNode : context->renderNodes) {
+        if (!renderNode.texture) {
+            continue;
+        }
+
+        renderNode.firstVertex = totalVertexCount;
+        renderNode.vertexCount = renderNode.geometry.count();
+        totalVertexCount += renderNode.vertexCount;
+
+        renderNode.textureMatrix = renderNode.texture->matrix(renderNode.coordinateType);
+        renderNode.geometry.postProcessTextureCoordinates(renderNode.textureMatrix);
+    }
+
+    cache->item = item;
+    cache->subtreeVersion = item->subtreeVersion();
+    cache->renderTargetScale = context->renderTargetScale;
+    cache->opacity = context->opacityStack.back();
+    cache->renderNodes = std::move(context->renderNodes);
+    cache->totalVertexCount = totalVertexCount;
+    cache->vbo.reset();
+}
+
+void ItemRendererOpenGL::reuseRenderNodes(CachedRenderNodes *cache)
+{
+    // The geometry is going to be reused at least twice, keep it in a buffer of its own.
+    if (cache->vbo || !cache->totalVertexCount) {
         return;
     }
 
-    RenderContext renderContext{
-        .clip = region,
-        .hardwareClipping = region != infiniteRegion() && ((mask & Scene::PAINT_WINDOW_TRANSFORMED) || (mask & Scene::PAINT_SCREEN_TRANSFORMED)),
-        .renderTargetScale = viewport.scale(),
-    };
+    auto vbo = std::make_unique<GLVertexBuffer>(GLVertexBuffer::Static);
+    vbo->setAttribLayout(GLVertexBuffer::GLVertex2DLayout, 2, sizeof(GLVertex2D));
 
-    renderContext.transformStack.push(QMatrix4x4());
-    renderContext.opacityStack.push(data.opacity());
+    GLVertex2D *map = (GLVertex2D *)vbo->map(cache->totalVertexCount * sizeof(GLVertex2D));
+    for (RenderNode &renderNode : cache->renderNodes) {
+        if (renderNode.vertexCount) {
+            renderNode.geometry.copy(std::span(&map[renderNode.firstVertex], renderNode.vertexCount));
+        }
+        renderNode.geometry = RenderGeometry();
+    }
+    vbo->unmap();
 
-    item->setTransform(data.toMatrix(renderContext.renderTargetScale));
+    cache->vbo = std::move(vbo);
+}
 
-    createRenderNode(item, &renderContext);
+static bool canReuseRenderNodes(ItemRendererOpenGL::CachedRenderNodes &cache, Item *item, const ItemRendererOpenGL::RenderContext &context)
+{
+    if (cache.item != item || cache.subtreeVersion != item->subtreeVersion()) {
+        return false;
+    }
+    if (cache.renderTargetScale != context.renderTargetScale || cache.opacity != context.opacityStack.back()) {
+        return false;
+    }
 
-    int totalVertexCount = 0;
-    for (const RenderNode &node : std::as_const(renderContext.renderNodes)) {
-        totalVertexCount += node.geometry.count();
+    // The textures have to be bound in every frame to upload the damaged contents, the
+    // texture coordinates are only valid as long as the textures stay the same.
+    for (ItemRendererOpenGL::RenderNode &renderNode : cache.renderNodes) {
+        GLTexture *texture = renderNode.texture;
+        if (!bindRenderNodeTexture(renderNode) || renderNode.texture != texture) {
+            return false;
+        }
+        if (texture && renderNode.vertexCount && texture->matrix(renderNode.coordinateType) != renderNode.textureMatrix) {
+            return false;
+        }
     }
-    if (totalVertexCount == 0) {
-        return;
+
+    return true;
+}
+
+static void appendGeometry(const QVector<ItemRendererOpenGL::RenderNode> &renderNodes, RenderGeometry *geometry)
+{
+    for (const ItemRendererOpenGL::RenderNode &renderNode : renderNodes) {
+        if (renderNode.vertexCount) {
+            geometry->append(renderNode.geometry);
+        }
     }
+}
 
-    const size_t size = totalVertexCount * sizeof(GLVertex2D);
+static QRectF logicalRectToDeviceRect(const QRectF &logical, qreal deviceScale)
+{
+    return QRectF(QPointF(std::round(logical.left() * deviceScale), std::round(logical.top() * deviceScale)),
+                  QPointF(std::round(logical.right() * deviceScale), std::round(logical.bottom() * deviceScale)));
+}
 
-    ShaderTraits shaderTraits = ShaderTrait::MapTexture;
+int ItemRendererOpenGL::clipRenderNode(const RenderNode &renderNode, const QRegion &region)
+{
+    // Item to world translation.
+    const QPointF worldTranslation = renderNode.translation + renderNode.transformMatrix.map(QPointF(0., 0.));
 
-    if (data.brightness() != 1.0) {
-        shaderTraits |= ShaderTrait::Modulate;
+    m_deviceClipRects.clear();
+    for (const QRect &rect : region) {
+        m_deviceClipRects.append(logicalRectToDeviceRect(rect, renderNode.scale).translated(-worldTranslation));
     }
-    if (data.saturation() != 1.0) {
-        shaderTraits |= ShaderTrait::AdjustSaturation;
+
+    m_clipGeometry.clear();
+    m_clipper.clip(renderNode.quads, m_deviceClipRects, renderNode.scale, m_clipGeometry);
+    m_clipGeometry.postProcessTextureCoordinates(renderNode.textureMatrix);
+    if (!renderNode.translation.isNull()) {
+        translateGeometry(m_clipGeometry, renderNode.translation);
     }
+    m_batchGeometry.append(m_clipGeometry);
 
-    GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
-    vbo->reset();
-    vbo->setAttribLayout(GLVertexBuffer::GLVertex2DLayout, 2, sizeof(GLVertex2D));
+    return m_clipGeometry.count();
+}
 
-    GLVertex2D *map = (GLVertex2D *)vbo->map(size);
+void ItemRendererOpenGL::beginBatch()
+{
+    m_batching = true;
+}
 
-    for (int i = 0, v = 0; i < renderContext.renderNodes.count(); i++) {
-        RenderNode &renderNode = renderContext.renderNodes[i];
-        if (renderNode.geometry.isEmpty() || !renderNode.texture) {
-            continue;
+void ItemRendererOpenGL::endBatch()
+{
+    m_batching = false;
+    flushDraws();
+}
+
+void ItemRendererOpenGL::flushDraws()
+{
+    if (!m_batchGeometry.isEmpty()) {
+        GLVertexBuffer *vbo = GLVertexBuffer::streamingBuffer();
+        vbo->reset();
+        vbo->setAttribLayout(GLVertexBuffer::GLVertex2DLayout, 2, sizeof(GLVertex2D));
+
+        GLVertex2D *map = (GLVertex2D *)vbo->map(m_batchGeometry.count() * sizeof(GLVertex2D));
+        m_batchGeometry.copy(std::span(map, m_batchGeometry.count()));
+        vbo->unmap();
+    }
+
+    submitDraws(std::span(m_batchDraws.constData(), m_batchDraws.size()));
+
+    m_batchDraws.clear();
+    m_batchGeometry.clear();
+}
+
+void ItemRendererOpenGL::submitDraws(std::span<const DrawCommand> draws)
+{
+    GLShader *shader = nullptr;
+    ShaderTraits shaderTraits;
+    GLVertexBuffer *vbo = nullptr;
+    bool hardwareClipping = false;
+
+    // The uniforms that have been last set on the current shader.
+    std::optional<float> saturation;
+    std::optional<QVector4D> modulation;
+    std::optional<QMatrix4x4> modelViewProjectionMatrix;
+
+    // Make sure the blend function is set up correctly in case we will be doing blending
+    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+    for (size_t i = 0; i < draws.size(); ++i) {
+        const DrawCommand &draw = draws[i];
+
+        // Adjacent vertex ranges that are drawn the same way can be merged into one draw call.
+        int vertexCount = draw.vertexCount;
+        while (i + 1 < draws.size() && draws[i + 1].canMerge(draws[i])) {
+            ++i;
+            vertexCount += draws[i].vertexCount;
         }
 
-        if (renderNode.opacity != 1.0) {
-            shaderTraits |= ShaderTrait::Modulate;
+        if (!shader || shaderTraits != draw.shaderTraits) {
+            if (shader) {
+                ShaderManager::instance()->popShader();
+            }
+            shaderTraits = draw.shaderTraits;
+            shader = ShaderManager::instance()->pushShader(shaderTraits);
+            saturation.reset();
+            modulation.reset();
+            modelViewProjectionMatrix.reset();
+        }
+        if (saturation != draw.saturation) {
+            shader->setUniform(GLShader::Saturation, draw.saturation);
+            saturation = draw.saturation;
+        }
+        if (modulation != draw.modulation) {
+            shader->setUniform(GLShader::ModulationConstant, draw.modulation);
+            modulation = draw.modulation;
+        }
+        if (modelViewProjectionMatrix != draw.modelViewProjectionMatrix) {
+            shader->setUniform(GLShader::ModelViewProjectionMatrix, draw.modelViewProjectionMatrix);
+            modelViewProjectionMatrix = draw.modelViewProjectionMatrix;
         }
 
-        renderNode.firstVertex = v;
-        renderNode.vertexCount = renderNode.geometry.count();
+        GLVertexBuffer *drawVbo = draw.vbo ? draw.vbo : GLVertexBuffer::streamingBuffer();
+        if (vbo != drawVbo) {
+            if (vbo) {
+                vbo->unbindArrays();
+            }
+            vbo = drawVbo;
+            vbo->bindArrays();
+        }
+
+        if (hardwareClipping != draw.hardwareClipping) {
+            hardwareClipping = draw.hardwareClipping;
+            if (hardwareClipping) {
+                glEnable(GL_SCISSOR_TEST);
+            } else {
+                glDisable(GL_SCISSOR_TEST);
+            }
+        }
+
+        setBlendEnabled(draw.blend);
 
-        renderNode.geometry.postProcessTextureCoordinates(renderNode.texture->matrix(renderNode.coordinateType));
+        draw.texture->setFilter(GL_LINEAR);
+        draw.texture->setWrapMode(GL_CLAMP_TO_EDGE);
+        draw.texture->bind();
 
-        renderNode.geometry.copy(std::span(&map[v], renderNode.geometry.count()));
-        v += renderNode.geometry.count();
+        vbo->draw(draw.scissorRegion, GL_TRIANGLES, draw.firstVertex, vertexCount, draw.hardwareClipping);
+        m_drawCallCount += draw.hardwareClipping ? draw.scissorRegion.rectCount() : 1;
     }
 
-    vbo->unmap();
-    vbo->bindArrays();
+    if (vbo) {
+        vbo->unbindArrays();
+    }
+    if (shader) {
+        ShaderManager::instance()->popShader();
+    }
+    if (hardwareClipping) {
+        glDisable(GL_SCISSOR_TEST);
+    }
 
-    GLShader *shader = ShaderManager::instance()->pushShader(shaderTraits);
-    shader->setUniform(GLShader::Saturation, data.saturation());
+    setBlendEnabled(false);
+}
 
-    if (renderContext.hardwareClipping) {
-        glEnable(GL_SCISSOR_TEST);
+void ItemRendererOpenGL::renderItem(const RenderTarget &renderTarget, const RenderViewport &viewport, Item *item, int mask, const QRegion &region, const WindowPaintData &data)
+{
+    if (region.isEmpty()) {
+        return;
     }
 
-    // Make sure the blend function is set up correctly in case we will be doing blending
-    glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    RenderContext renderContext{
+        .transformStack = std::pmr::vector<QMatrix4x4>(frameArena()),
+        .opacityStack = std::pmr::vector<qreal>(frameArena()),
+        .renderTargetScale = viewport.scale(),
+    };
+
+    renderContext.transformStack.push_back(QMatrix4x4());
+    renderContext.opacityStack.push_back(data.opacity());
+
+    item->setTransform(data.toMatrix(renderContext.renderTargetScale));
 
-    float opacity = -1.0;
+    CachedRenderNodes &cache = m_renderNodeCache[item];
+    cache.lastUsedFrame = m_frameCounter;
+
+    {
+        FrameTimelineScope timelineScope(FrameTimelineEvent::RenderNodeBuild, quintptr(item));
+        preprocessItem(item);
+        if (canReuseRenderNodes(cache, item, renderContext)) {
+            reuseRenderNodes(&cache);
+        } else {
+            buildRenderNodes(item, &renderContext, &cache);
+        }
+    }
+
+    if (cache.totalVertexCount == 0) {
+        return;
+    }
+
+    FrameTimelineScope timelineScope(FrameTimelineEvent::GLSubmit, quintptr(item));
+
+    // Freshly built geometry is streamed together with the rest of the batch. Without batching,
+    // the draws of the item are flushed on their own.
+    GLVertexBuffer *vbo = cache.vbo.get();
+    int baseVertex = 0;
+    if (!vbo) {
+        baseVertex = m_batchGeometry.count();
+        appendGeometry(cache.renderNodes, &m_batchGeometry);
+    }
+
+    ShaderTraits shaderTraits = ShaderTrait::MapTexture;
+
+    if (data.brightness() != 1.0) {
+        shaderTraits |= ShaderTrait::Modulate;
+    }
+    if (data.saturation() != 1.0) {
+        shaderTraits |= ShaderTrait::AdjustSaturation;
+    }
+    for (const RenderNode &renderNode : std::as_const(cache.renderNodes)) {
+        if (renderNode.vertexCount && renderNode.opacity != 1.0) {
+            shaderTraits |= ShaderTrait::Modulate;
+            break;
+        }
+    }
 
-    // The scissor region must be in the render target local coordinate system.
-    QRegion scissorRegion = infiniteRegion();
-    if (renderContext.hardwareClipping) {
-        scissorRegion = viewport.mapToRenderTarget(region);
+    // The bounds of the render nodes are only known if the item is painted without a transform,
+    // otherwise every node is scissored with the whole region. The scissor region must be in the
+    // render target local coordinate system.
+    const bool clipped = region != infiniteRegion();
+    const bool transformed = (mask & Scene::PAINT_WINDOW_TRANSFORMED) || (mask & Scene::PAINT_SCREEN_TRANSFORMED);
+    QRegion transformedScissorRegion;
+    if (clipped && transformed) {
+        transformedScissorRegion = viewport.mapToRenderTarget(region);
     }
 
     const QMatrix4x4 projectionMatrix = data.projectionMatrix();
-    for (int i = 0; i < renderContext.renderNodes.count(); i++) {
-        const RenderNode &renderNode = renderContext.renderNodes[i];
+    for (const RenderNode &renderNode : std::as_const(cache.renderNodes)) {
         if (renderNode.vertexCount == 0) {
             continue;
         }
 
-        setBlendEnabled(renderNode.hasAlpha || renderNode.opacity < 1.0);
-
-        shader->setUniform(GLShader::ModelViewProjectionMatrix, projectionMatrix * renderNode.transformMatrix);
-        if (opacity != renderNode.opacity) {
-            shader->setUniform(GLShader::ModulationConstant,
-                               modulate(renderNode.opacity, data.brightness()));
-            opacity = renderNode.opacity;
+        GLVertexBuffer *nodeVbo = vbo;
+        int firstVertex = baseVertex + renderNode.firstVertex;
+        int vertexCount = renderNode.vertexCount;
+        QRegion scissorRegion = infiniteRegion();
+        bool scissored = false;
+        if (clipped) {
+            if (transformed) {
+                scissorRegion = transformedScissorRegion;
+                scissored = true;
+            } else {
+                // Leave some room for the vertices being snapped to the device pixel grid.
+                const QRect bounds = renderNode.bounds.toAlignedRect().adjusted(-1, -1, 1, 1);
+                const QRegion nodeRegion = region.intersected(bounds);
+                if (nodeRegion.isEmpty()) {
+                    continue;
+                }
+                if (nodeRegion.rectCount() == 1) {
+                    if (*nodeRegion.begin() != bounds) {
+                        scissorRegion = viewport.mapToRenderTarget(nodeRegion);
+                        scissored = true;
+                    }
+                } else {
+                    // Scissoring would draw the whole node once per rectangle, clip the quads instead.
+                    // The region can't be widened to its bounding rect, the parts that are left out
+                    // may belong to windows above that are not repainted.
+                    vertexCount = clipRenderNode(renderNode, nodeRegion);
+                    if (!vertexCount) {
+                        continue;
+                    }
+                    nodeVbo = nullptr;
+                    firstVertex = m_batchGeometry.count() - vertexCount;
+                }
+            }
         }
 
-        renderNode.texture->setFilter(GL_LINEAR);
-        renderNode.texture->setWrapMode(GL_CLAMP_TO_EDGE);
-        renderNode.texture->bind();
-
-        vbo->draw(scissorRegion, GL_TRIANGLES, renderNode.firstVertex,
-                  renderNode.vertexCount, renderContext.hardwareClipping);
+        m_batchDraws.append(DrawCommand{
+            .vbo = nodeVbo,
+            .texture = renderNode.texture,
+            .modelViewProjectionMatrix = projectionMatrix * renderNode.transformMatrix,
+            .modulation = modulate(renderNode.opacity, data.brightness()),
+            .saturation = float(data.saturation()),
+            .scissorRegion = scissorRegion,
+            .shaderTraits = shaderTraits,
+            .firstVertex = firstVertex,
+            .vertexCount = vertexCount,
+            .blend = renderNode.hasAlpha || renderNode.opacity < 1.0,
+            .hardwareClipping = scissored,
+        });
+        m_renderNodeCount++;
     }
 
-    vbo->unbindArrays();
+    if (!m_batching) {
+        flushDraws();
+    }
+}
 
-    setBlendEnabled(false);
+bool ItemRendererOpenGL::DrawCommand::canMerge(const DrawCommand &previous) const
+{
+    return vbo == previous.vbo
+        && texture == previous.texture
+        && firstVertex == previous.firstVertex + previous.vertexCount
+        && blend == previous.blend
+        && hardwareClipping == previous.hardwareClipping
+        && (!hardwareClipping || scissorRegion == previous.scissorRegion)
+        && shaderTraits == previous.shaderTraits
+        && saturation == previous.saturation
+        && modulation == previous.modulation
+        && modelViewProjectionMatrix == previous.modelViewProjectionMatrix;
+}
 
-    ShaderManager::instance()->popShader();
+int ItemRendererOpenGL::drawCallCount() const
+{
+    return m_lastFrameDrawCallCount;
+}
 
-    if (renderContext.hardwareClipping) {
-        glDisable(GL_SCISSOR_TEST);
-    }
+int ItemRendererOpenGL::renderNodeCount() const
+{
+    return m_lastFrameRenderNodeCount;
 }
 
 } // namespace KWin
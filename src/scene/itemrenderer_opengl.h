@@ -8,8 +8,16 @@
 
 #include "libkwineffects/kwineffects.h"
 #include "libkwineffects/kwinglutils.h"
+#include "libkwineffects/windowquadclipper.h"
 #include "scene/itemrenderer.h"
 
+#include <QPointer>
+
+#include <memory_resource>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
 namespace KWin
 {
 
@@ -18,43 +26,119 @@ class KWIN_EXPORT ItemRendererOpenGL : public ItemRenderer
 public:
     struct RenderNode
     {
+        Item *item = nullptr;
+        CompactWindowQuadList quads;
         GLTexture *texture = nullptr;
+        QMatrix4x4 textureMatrix;
         RenderGeometry geometry;
         QMatrix4x4 transformMatrix;
+        QPointF translation; // the device translation that is baked into the geometry
         int firstVertex = 0;
         int vertexCount = 0;
         qreal opacity = 1;
         bool hasAlpha = false;
         TextureCoordinateType coordinateType = UnnormalizedCoordinates;
         qreal scale = 1.0;
+        QRectF bounds; // in the logical world coordinate system, ignoring the item transform
     };
 
     struct RenderContext
     {
         QVector<RenderNode> renderNodes;
-        QStack<QMatrix4x4> transformStack;
-        QStack<qreal> opacityStack;
-        const QRegion clip;
-        const bool hardwareClipping;
+        std::pmr::vector<QMatrix4x4> transformStack;
+        std::pmr::vector<qreal> opacityStack;
         const qreal renderTargetScale;
     };
 
+    /**
+     * The render nodes of an item that has been painted recently. The cached nodes are reused
+     * as long as the item tree, the scale, the opacity and the textures stay the same. The
+     * geometry is not clipped, the repaint region is applied when the nodes are painted. Once
+     * the nodes have been reused, their geometry is kept in a vertex buffer of its own so it
+     * doesn't need to be uploaded again. The quads are kept around for clipping the nodes on
+     * the CPU when the repaint region consists of several rectangles.
+     */
+    struct CachedRenderNodes
+    {
+        QPointer<Item> item;
+        quint64 subtreeVersion = 0;
+        qreal renderTargetScale = 1;
+        qreal opacity = 1;
+        QVector<RenderNode> renderNodes;
+        std::unique_ptr<GLVertexBuffer> vbo;
+        int totalVertexCount = 0;
+        quint64 lastUsedFrame = 0;
+    };
+
+    /**
+     * A draw call that has been prepared by renderItem(). Render nodes that are only translated
+     * have the translation baked into their vertices, so their draws share the projection matrix
+     * and adjacent draws with the same texture, shader and state are merged.
+     */
+    struct DrawCommand
+    {
+        bool canMerge(const DrawCommand &previous) const;
+
+        GLVertexBuffer *vbo = nullptr; // the streaming buffer if null
+        GLTexture *texture = nullptr;
+        QMatrix4x4 modelViewProjectionMatrix;
+        QVector4D modulation;
+        float saturation = 1;
+        QRegion scissorRegion;
+        ShaderTraits shaderTraits;
+        int firstVertex = 0;
+        int vertexCount = 0;
+        bool blend = false;
+        bool hardwareClipping = false;
+    };
+
     ItemRendererOpenGL();
 
     void beginFrame(const RenderTarget &renderTarget, const RenderViewport &viewport) override;
     void endFrame() override;
+    void beginBatch() override;
+    void endBatch() override;
 
     void renderBackground(const RenderTarget &renderTarget, const RenderViewport &viewport, const QRegion &region) override;
     void renderItem(const RenderTarget &renderTarget, const RenderViewport &viewport, Item *item, int mask, const QRegion &region, const WindowPaintData &data) override;
 
     ImageItem *createImageItem(Scene *scene, Item *parent = nullptr) override;
 
+    /**
+     * Returns the number of draw calls issued in the last frame.
+     */
+    int drawCallCount() const;
+    /**
+     * Returns the number of render nodes painted in the last frame.
+     */
+    int renderNodeCount() const;
+
 private:
     QVector4D modulate(float opacity, float brightness) const;
     void setBlendEnabled(bool enabled);
     void createRenderNode(Item *item, RenderContext *context);
+    void buildRenderNodes(Item *item, RenderContext *context, CachedRenderNodes *cache);
+    void reuseRenderNodes(CachedRenderNodes *cache);
+    int clipRenderNode(const RenderNode &renderNode, const QRegion &region);
+    void flushDraws();
+    void submitDraws(std::span<const DrawCommand> draws);
 
     bool m_blendingEnabled = false;
+    std::unordered_map<Item *, CachedRenderNodes> m_renderNodeCache;
+    quint64 m_frameCounter = 0;
+
+    bool m_batching = false;
+    QVector<DrawCommand> m_batchDraws;
+    RenderGeometry m_batchGeometry;
+
+    WindowQuadClipper m_clipper;
+    QVector<QRectF> m_deviceClipRects;
+    RenderGeometry m_clipGeometry;
+
+    int m_drawCallCount = 0;
+    int m_renderNodeCount = 0;
+    int m_lastFrameDrawCallCount = 0;
+    int m_lastFrameRenderNodeCount = 0;
 };
 
 } // namespace KWin
@@ -24,9 +24,11 @@ SceneDelegate::~SceneDelegate()
     m_scene->removeDelegate(this);
 }
 
-QRegion SceneDelegate::repaints() const
+Region SceneDelegate::repaints() const
 {
-    return m_scene->damage().translated(-viewport().topLeft());
+    Region repaints = m_scene->damage();
+    repaints.translate(-viewport().topLeft());
+    return repaints;
 }
 
 SurfaceItem *SceneDelegate::scanoutCandidate() const
@@ -34,6 +36,11 @@ SurfaceItem *SceneDelegate::scanoutCandidate() const
     return m_scene->scanoutCandidate();
 }
 
+QVector<SurfaceItem *> SceneDelegate::overlayCandidates() const
+{
+    return m_scene->overlayCandidates();
+}
+
 void SceneDelegate::prePaint()
 {
     m_scene->prePaint(this);
@@ -95,9 +102,9 @@ void Scene::addRepaint(const QRegion &region)
     }
 }
 
-QRegion Scene::damage() const
+Region Scene::damage() const
 {
-    return QRegion();
+    return Region();
 }
 
 QRect Scene::geometry() const
@@ -134,4 +141,9 @@ SurfaceItem *Scene::scanoutCandidate() const
     return nullptr;
 }
 
+QVector<SurfaceItem *> Scene::overlayCandidates() const
+{
+    return {};
+}
+
 } // namespace KWin
@@ -28,8 +28,9 @@ public:
     Output *output() const;
     QRect viewport() const;
 
-    QRegion repaints() const override;
+    Region repaints() const override;
     SurfaceItem *scanoutCandidate() const override;
+    QVector<SurfaceItem *> overlayCandidates() const override;
     void prePaint() override;
     void postPaint() override;
     void paint(const RenderTarget &renderTarget, const QRegion &region) override;
@@ -71,7 +72,7 @@ public:
     void addRepaint(const QRegion &region);
     void addRepaint(int x, int y, int width, int height);
     void addRepaintFull();
-    virtual QRegion damage() const;
+    virtual Region damage() const;
 
     QRect geometry() const;
     void setGeometry(const QRect &rect);
@@ -81,6 +82,7 @@ public:
     void removeDelegate(SceneDelegate *delegate);
 
     virtual SurfaceItem *scanoutCandidate() const;
+    virtual QVector<SurfaceItem *> overlayCandidates() const;
     virtual void prePaint(SceneDelegate *delegate) = 0;
     virtual void postPaint() = 0;
     virtual void paint(const RenderTarget &renderTarget, const QRegion &region) = 0;
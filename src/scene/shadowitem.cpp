@@ -87,11 +87,11 @@ static inline void distributeVertically(QRectF &topRect, QRectF &bottomRect)
     }
 }
 
-WindowQuadList ShadowItem::buildQuads() const
+CompactWindowQuadList ShadowItem::buildQuads() const
 {
     // Do not draw shadows if window width or window height is less than 5 px. 5 is an arbitrary choice.
     if (!m_window->wantsShadowToBeRendered() || m_window->width() < 5 || m_window->height() < 5) {
-        return WindowQuadList();
+        return CompactWindowQuadList();
     }
 
     const QSizeF top(m_shadow->elementSize(Shadow::ShadowElementTop));
@@ -167,7 +167,7 @@ WindowQuadList ShadowItem::buildQuads() const
           ty1 = 0.0,
           ty2 = 0.0;
 
-    WindowQuadList quads;
+    CompactWindowQuadList quads;
     quads.reserve(8);
 
     if (topLeftRect.isValid()) {
@@ -43,7 +43,7 @@ public:
     ShadowTextureProvider *textureProvider() const;
 
 protected:
-    WindowQuadList buildQuads() const override;
+    CompactWindowQuadList buildQuads() const override;
     void preprocess() override;
 
 private Q_SLOTS:
@@ -114,7 +114,7 @@ void SurfaceItem::preprocess()
     updatePixmap();
 }
 
-WindowQuadList SurfaceItem::buildQuads() const
+CompactWindowQuadList SurfaceItem::buildQuads() const
 {
     if (!pixmap()) {
         return {};
@@ -123,11 +123,11 @@ WindowQuadList SurfaceItem::buildQuads() const
     const QVector<QRectF> region = shape();
     const auto size = pixmap()->size();
 
-    WindowQuadList quads;
+    CompactWindowQuadList quads;
     quads.reserve(region.count());
 
     for (const QRectF rect : region) {
-        WindowQuad quad;
+        CompactWindowQuad quad;
 
         // Use toPoint to round the device position to match what we eventually
         // do for the geometry, otherwise we end up with mismatched UV
@@ -138,10 +138,10 @@ WindowQuadList SurfaceItem::buildQuads() const
         const QPointF bufferBottomRight = m_surfaceToBufferMatrix.map(rect.bottomRight()).toPoint();
         const QPointF bufferBottomLeft = m_surfaceToBufferMatrix.map(rect.bottomLeft()).toPoint();
 
-        quad[0] = WindowVertex(rect.topLeft(), QPointF{bufferTopLeft.x() / size.width(), bufferTopLeft.y() / size.height()});
-        quad[1] = WindowVertex(rect.topRight(), QPointF{bufferTopRight.x() / size.width(), bufferTopRight.y() / size.height()});
-        quad[2] = WindowVertex(rect.bottomRight(), QPointF{bufferBottomRight.x() / size.width(), bufferBottomRight.y() / size.height()});
-        quad[3] = WindowVertex(rect.bottomLeft(), QPointF{bufferBottomLeft.x() / size.width(), bufferBottomLeft.y() / size.height()});
+        quad.setVertex(0, rect.topLeft(), QPointF{bufferTopLeft.x() / size.width(), bufferTopLeft.y() / size.height()});
+        quad.setVertex(1, rect.topRight(), QPointF{bufferTopRight.x() / size.width(), bufferTopRight.y() / size.height()});
+        quad.setVertex(2, rect.bottomRight(), QPointF{bufferBottomRight.x() / size.width(), bufferBottomRight.y() / size.height()});
+        quad.setVertex(3, rect.bottomLeft(), QPointF{bufferBottomLeft.x() / size.width(), bufferBottomLeft.y() / size.height()});
 
         quads << quad;
     }
@@ -50,7 +50,7 @@ protected:
 
     virtual std::unique_ptr<SurfacePixmap> createPixmap() = 0;
     void preprocess() override;
-    WindowQuadList buildQuads() const override;
+    CompactWindowQuadList buildQuads() const override;
 
     QRegion m_damage;
     std::unique_ptr<SurfacePixmap> m_pixmap;
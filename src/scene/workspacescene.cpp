@@ -58,6 +58,7 @@
 #include "core/renderlayer.h"
 #include "core/renderloop.h"
 #include "effects.h"
+#include "frametimeline.h"
 #include "internalwindow.h"
 #include "libkwineffects/renderviewport.h"
 #include "scene/dndiconitem.h"
@@ -66,6 +67,7 @@
 #include "scene/surfaceitem.h"
 #include "scene/windowitem.h"
 #include "shadow.h"
+#include "utils/region.h"
 #include "wayland/seat_interface.h"
 #include "wayland/surface_interface.h"
 #include "wayland_server.h"
@@ -84,8 +86,11 @@ namespace KWin
 
 WorkspaceScene::WorkspaceScene(std::unique_ptr<ItemRenderer> renderer)
     : Scene(std::move(renderer))
+    , m_paintContext{.phase2Data = std::pmr::vector<Phase2Data>(m_renderer->frameArena())}
     , m_containerItem(std::make_unique<Item>(this))
 {
+    connect(m_containerItem.get(), &Item::childAdded, this, &WorkspaceScene::handleWindowItemAdded);
+    connect(m_containerItem.get(), &Item::childRemoved, this, &WorkspaceScene::invalidateStackingOrder);
 }
 
 WorkspaceScene::~WorkspaceScene()
@@ -98,6 +103,10 @@ void WorkspaceScene::initialize()
     connect(workspace(), &Workspace::geometryChanged, this, [this]() {
         setGeometry(workspace()->geometry());
     });
+    connect(workspace(), &Workspace::stackingOrderChanged, this, &WorkspaceScene::invalidateStackingOrder);
+    connect(workspace(), &Workspace::outputRemoved, this, [this](Output *output) {
+        m_outputStackingOrders.remove(output);
+    });
 
     if (waylandServer()) {
         connect(waylandServer()->seat(), &KWaylandServer::SeatInterface::dragStarted, this, &WorkspaceScene::createDndIconItem);
@@ -135,7 +144,7 @@ Item *WorkspaceScene::containerItem() const
     return m_containerItem.get();
 }
 
-QRegion WorkspaceScene::damage() const
+Region WorkspaceScene::damage() const
 {
     return m_paintContext.damage;
 }
@@ -157,8 +166,9 @@ SurfaceItem *WorkspaceScene::scanoutCandidate() const
     }
     SurfaceItem *candidate = nullptr;
     if (!static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
-        for (int i = stacking_order.count() - 1; i >= 0; i--) {
-            WindowItem *windowItem = stacking_order[i];
+        const QVector<WindowItem *> &outputStackingOrder = outputStackingOrder(painted_screen);
+        for (int i = outputStackingOrder.count() - 1; i >= 0; i--) {
+            WindowItem *windowItem = outputStackingOrder[i];
             Window *window = windowItem->window();
             if (window->isOnOutput(painted_screen) && window->opacity() > 0) {
                 if (!window->isClient() || !window->isFullScreen() || window->opacity() != 1.0) {
@@ -184,9 +194,73 @@ SurfaceItem *WorkspaceScene::scanoutCandidate() const
     return candidate;
 }
 
+static void collectOverlayCandidates(SurfaceItem *item, const QRect &screen, QRegion *occluded, QVector<SurfaceItem *> *candidates)
+{
+    const QList<Item *> children = item->sortedChildItems();
+    for (auto it = children.crbegin(); it != children.crend(); ++it) {
+        if ((*it)->z() >= 0 && (*it)->explicitVisible()) {
+            collectOverlayCandidates(static_cast<SurfaceItem *>(*it), screen, occluded, candidates);
+        }
+    }
+
+    const QRect rect = item->mapToGlobal(item->rect()).toAlignedRect();
+    if (!rect.isEmpty() && screen.contains(rect) && !occluded->intersects(rect)) {
+        // the surface has to be completely opaque, the content below it won't be painted
+        if (item->opacity() == 1.0 && item->opaque().contains(item->rect().toAlignedRect())) {
+            candidates->append(item);
+        }
+    }
+    *occluded += rect;
+
+    for (auto it = children.crbegin(); it != children.crend(); ++it) {
+        if ((*it)->z() < 0 && (*it)->explicitVisible()) {
+            collectOverlayCandidates(static_cast<SurfaceItem *>(*it), screen, occluded, candidates);
+        }
+    }
+}
+
+QVector<SurfaceItem *> WorkspaceScene::overlayCandidates() const
+{
+    if (!waylandServer() || static_cast<EffectsHandlerImpl *>(effects)->blocksDirectScanout()) {
+        return {};
+    }
+    if (m_paintContext.mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
+        return {};
+    }
+
+    const QRect screen = painted_screen->geometry();
+    QVector<SurfaceItem *> candidates;
+    QRegion occluded;
+    if (m_dndIcon) {
+        occluded += m_dndIcon->mapToGlobal(m_dndIcon->boundingRect()).toAlignedRect();
+    }
+
+    for (int i = m_paintContext.phase2Data.size() - 1; i >= 0; --i) {
+        const Phase2Data &paintData = m_paintContext.phase2Data.at(i);
+        WindowItem *windowItem = paintData.item;
+        Window *window = windowItem->window();
+        const QRect bounds = windowItem->mapToGlobal(windowItem->boundingRect()).toAlignedRect();
+        if (!bounds.intersects(screen)) {
+            continue;
+        }
+        if ((paintData.mask & (PAINT_WINDOW_TRANSLUCENT | PAINT_WINDOW_TRANSFORMED)) || !window->isClient() || window->opacity() != 1.0 || !windowItem->surfaceItem()) {
+            occluded += bounds;
+            continue;
+        }
+        if (windowItem->decorationItem()) {
+            occluded += QRegion(window->frameGeometry().toAlignedRect()) - window->clientGeometry().toAlignedRect();
+        }
+        collectOverlayCandidates(windowItem->surfaceItem(), screen, &occluded, &candidates);
+        // shadows and anything else that is attached to the window
+        occluded += bounds;
+    }
+
+    return candidates;
+}
+
 void WorkspaceScene::prePaint(SceneDelegate *delegate)
 {
-    createStackingOrder();
+    updateStackingOrder();
 
     painted_delegate = delegate;
     if (kwinApp()->operationMode() == Application::OperationModeX11) {
@@ -208,6 +282,11 @@ void WorkspaceScene::prePaint(SceneDelegate *delegate)
         m_expectedPresentTimestamp = presentTime;
     }
 
+    // The paint data of the previous frame lives in the arena, release it before rewinding.
+    FrameArena *frameArena = m_renderer->frameArena();
+    m_paintContext.phase2Data = std::pmr::vector<Phase2Data>(frameArena);
+    frameArena->reset();
+
     // preparation step
     auto effectsImpl = static_cast<EffectsHandlerImpl *>(effects);
     effectsImpl->startPaint();
@@ -220,9 +299,8 @@ void WorkspaceScene::prePaint(SceneDelegate *delegate)
     Q_EMIT preFrameRender();
 
     effects->prePaintScreen(prePaintData, m_expectedPresentTimestamp);
-    m_paintContext.damage = prePaintData.paint;
+    m_paintContext.damage = Region(prePaintData.paint);
     m_paintContext.mask = prePaintData.mask;
-    m_paintContext.phase2Data.clear();
 
     if (m_paintContext.mask & (PAINT_SCREEN_TRANSFORMED | PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
         preparePaintGenericScreen();
@@ -233,6 +311,9 @@ void WorkspaceScene::prePaint(SceneDelegate *delegate)
 
 static void resetRepaintsHelper(Item *item, SceneDelegate *delegate)
 {
+    if (!item->hasRepaints(delegate)) {
+        return;
+    }
     item->resetRepaints(delegate);
 
     const auto childItems = item->childItems();
@@ -241,9 +322,12 @@ static void resetRepaintsHelper(Item *item, SceneDelegate *delegate)
     }
 }
 
-static void accumulateRepaints(Item *item, SceneDelegate *delegate, QRegion *repaints)
+void WorkspaceScene::accumulateRepaints(Item *item, SceneDelegate *delegate, Region *repaints)
 {
-    *repaints += item->repaints(delegate);
+    if (!item->hasRepaints(delegate)) {
+        return;
+    }
+    repaints->unite(item->repaints(delegate));
     item->resetRepaints(delegate);
 
     const auto childItems = item->childItems();
@@ -252,9 +336,28 @@ static void accumulateRepaints(Item *item, SceneDelegate *delegate, QRegion *rep
     }
 }
 
+void WorkspaceScene::accumulateDepartedRepaints(Region *repaints)
+{
+    if (kwinApp()->operationMode() == Application::OperationModeX11) {
+        return;
+    }
+    outputStackingOrder(painted_screen);
+    OutputStackingOrder &index = m_outputStackingOrders[painted_screen];
+    for (const QPointer<WindowItem> &windowItem : std::as_const(index.departed)) {
+        if (windowItem) {
+            accumulateRepaints(windowItem, painted_delegate, repaints);
+        }
+    }
+    index.departed.clear();
+}
+
 void WorkspaceScene::preparePaintGenericScreen()
 {
-    for (WindowItem *windowItem : std::as_const(stacking_order)) {
+    // The whole screen is repainted, the repaints of windows that left the output are not needed.
+    Region departedRepaints;
+    accumulateDepartedRepaints(&departedRepaints);
+
+    for (WindowItem *windowItem : paintedStackingOrder()) {
         resetRepaintsHelper(windowItem, painted_delegate);
 
         WindowPrePaintData data;
@@ -262,10 +365,10 @@ void WorkspaceScene::preparePaintGenericScreen()
         data.paint = infiniteRegion(); // no clipping, so doesn't really matter
 
         effects->prePaintWindow(windowItem->window()->effectWindow(), data, m_expectedPresentTimestamp);
-        m_paintContext.phase2Data.append(Phase2Data{
+        m_paintContext.phase2Data.push_back(Phase2Data{
             .item = windowItem,
             .region = infiniteRegion(),
-            .opaque = data.opaque,
+            .opaque = Region(data.opaque),
             .mask = data.mask,
         });
     }
@@ -275,41 +378,72 @@ void WorkspaceScene::preparePaintGenericScreen()
 
 void WorkspaceScene::preparePaintSimpleScreen()
 {
-    for (WindowItem *windowItem : std::as_const(stacking_order)) {
+    // The area left behind by windows that moved to other outputs still has to be repainted.
+    accumulateDepartedRepaints(&m_paintContext.damage);
+
+    // Without active effects prePaintWindow() is a no-op, the damage stays in Region form then.
+    const bool hasActiveEffects = static_cast<EffectsHandlerImpl *>(effects)->hasActiveEffects();
+
+    for (WindowItem *windowItem : paintedStackingOrder()) {
         Window *window = windowItem->window();
-        WindowPrePaintData data;
-        data.mask = m_paintContext.mask;
-        accumulateRepaints(windowItem, painted_delegate, &data.paint);
+        Region paint;
+        accumulateRepaints(windowItem, painted_delegate, &paint);
 
         // Clip out the decoration for opaque windows; the decoration is drawn in the second pass.
+        Region opaque;
         if (window->opacity() == 1.0) {
             const SurfaceItem *surfaceItem = windowItem->surfaceItem();
             if (Q_LIKELY(surfaceItem)) {
-                data.opaque = surfaceItem->mapToGlobal(surfaceItem->opaque());
+                opaque = Region(surfaceItem->opaque());
+                opaque.translate(surfaceItem->rootPosition().toPoint());
             }
 
             const DecorationItem *decorationItem = windowItem->decorationItem();
             if (decorationItem) {
-                data.opaque |= decorationItem->mapToGlobal(decorationItem->opaque());
+                Region decorationOpaque(decorationItem->opaque());
+                decorationOpaque.translate(decorationItem->rootPosition().toPoint());
+                opaque.unite(decorationOpaque);
             }
         }
 
-        effects->prePaintWindow(window->effectWindow(), data, m_expectedPresentTimestamp);
-        m_paintContext.phase2Data.append(Phase2Data{
+        int mask = m_paintContext.mask;
+        if (hasActiveEffects) {
+            WindowPrePaintData data;
+            data.mask = mask;
+            data.paint = paint.toQRegion();
+            data.opaque = opaque.toQRegion();
+
+            // Convert back only what the effects have changed, the comparison is cheap
+            // as long as the regions still share their data.
+            const QRegion passedPaint = data.paint;
+            const QRegion passedOpaque = data.opaque;
+            effects->prePaintWindow(window->effectWindow(), data, m_expectedPresentTimestamp);
+            if (data.paint != passedPaint) {
+                paint = Region(data.paint);
+            }
+            if (data.opaque != passedOpaque) {
+                opaque = Region(data.opaque);
+            }
+            mask = data.mask;
+        }
+
+        m_paintContext.phase2Data.push_back(Phase2Data{
             .item = windowItem,
-            .region = data.paint,
-            .opaque = data.opaque,
-            .mask = data.mask,
+            .region = std::move(paint),
+            .opaque = std::move(opaque),
+            .mask = mask,
         });
     }
 
     // Perform an occlusion cull pass, remove surface damage occluded by opaque windows.
-    QRegion opaque;
+    Region opaque;
     for (int i = m_paintContext.phase2Data.size() - 1; i >= 0; --i) {
         const auto &paintData = m_paintContext.phase2Data.at(i);
-        m_paintContext.damage += paintData.region - opaque;
+        if (!paintData.region.isEmpty()) {
+            m_paintContext.damage.unite(paintData.region.subtracted(opaque));
+        }
         if (!(paintData.mask & (PAINT_WINDOW_TRANSLUCENT | PAINT_WINDOW_TRANSFORMED))) {
-            opaque += paintData.opaque;
+            opaque.unite(paintData.opaque);
         }
     }
 
@@ -324,12 +458,13 @@ void WorkspaceScene::postPaint()
         const std::chrono::milliseconds frameTime =
             std::chrono::duration_cast<std::chrono::milliseconds>(painted_screen->renderLoop()->lastPresentationTimestamp());
 
-        for (WindowItem *windowItem : std::as_const(stacking_order)) {
+        for (WindowItem *windowItem : outputStackingOrder(painted_screen)) {
             Window *window = windowItem->window();
             if (!window->isOnOutput(painted_screen)) {
                 continue;
             }
             if (auto surface = window->surface()) {
+                FrameTimeline::instant(FrameTimelineEvent::FrameCallback, quintptr(surface));
                 surface->frameRendered(frameTime.count());
             }
         }
@@ -339,13 +474,11 @@ void WorkspaceScene::postPaint()
         }
     }
 
-    for (WindowItem *w : std::as_const(stacking_order)) {
-        effects->postPaintWindow(w->window()->effectWindow());
+    for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
+        effects->postPaintWindow(paintData.item->window()->effectWindow());
     }
 
     effects->postPaintScreen();
-
-    clearStackingOrder();
 }
 
 void WorkspaceScene::paint(const RenderTarget &renderTarget, const QRegion &region)
@@ -355,7 +488,10 @@ void WorkspaceScene::paint(const RenderTarget &renderTarget, const QRegion &regi
 
     m_renderer->beginFrame(renderTarget, viewport);
 
-    effects->paintScreen(renderTarget, viewport, m_paintContext.mask, region, EffectScreenImpl::get(painted_screen));
+    {
+        FrameTimelineScope timelineScope(FrameTimelineEvent::EffectChain, quintptr(painted_screen));
+        effects->paintScreen(renderTarget, viewport, m_paintContext.mask, region, EffectScreenImpl::get(painted_screen));
+    }
     m_paintScreenCount = 0;
     Q_EMIT frameRendered();
 
@@ -386,7 +522,7 @@ void WorkspaceScene::paintGenericScreen(const RenderTarget &renderTarget, const
     }
 
     for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
-        paintWindow(renderTarget, viewport, paintData.item, paintData.mask, paintData.region);
+        paintWindow(renderTarget, viewport, paintData.item, paintData.mask, paintData.region.toQRegion());
     }
 }
 
@@ -396,24 +532,34 @@ void WorkspaceScene::paintGenericScreen(const RenderTarget &renderTarget, const
 void WorkspaceScene::paintSimpleScreen(const RenderTarget &renderTarget, const RenderViewport &viewport, int, const QRegion &region)
 {
     // This is the occlusion culling pass
-    QRegion visible = region;
+    Region visible(region);
     for (int i = m_paintContext.phase2Data.size() - 1; i >= 0; --i) {
         Phase2Data *data = &m_paintContext.phase2Data[i];
         data->region = visible;
 
         if (!(data->mask & PAINT_WINDOW_TRANSFORMED)) {
-            data->region &= data->item->mapToGlobal(data->item->boundingRect()).toAlignedRect();
+            data->region.intersect(data->item->mapToGlobal(data->item->boundingRect()).toAlignedRect());
 
             if (!(data->mask & PAINT_WINDOW_TRANSLUCENT)) {
-                visible -= data->opaque;
+                visible.subtract(data->opaque);
             }
         }
     }
 
-    m_renderer->renderBackground(renderTarget, viewport, visible);
+    m_renderer->renderBackground(renderTarget, viewport, visible.toQRegion());
+
+    // Without effects nothing else is painted between the windows, so they can be batched.
+    const bool batch = !static_cast<EffectsHandlerImpl *>(effects)->hasActiveEffects();
+    if (batch) {
+        m_renderer->beginBatch();
+    }
 
     for (const Phase2Data &paintData : std::as_const(m_paintContext.phase2Data)) {
-        paintWindow(renderTarget, viewport, paintData.item, paintData.mask, paintData.region);
+        paintWindow(renderTarget, viewport, paintData.item, paintData.mask, paintData.region.toQRegion());
+    }
+
+    if (batch) {
+        m_renderer->endBatch();
     }
 
     if (m_dndIcon) {
@@ -424,20 +570,73 @@ void WorkspaceScene::paintSimpleScreen(const RenderTarget &renderTarget, const R
     }
 }
 
-void WorkspaceScene::createStackingOrder()
+void WorkspaceScene::handleWindowItemAdded(Item *item)
 {
-    QList<Item *> items = m_containerItem->sortedChildItems();
-    for (Item *item : std::as_const(items)) {
+    // The item is still being constructed, only the Item part can be used here.
+    connect(item, &Item::zChanged, this, &WorkspaceScene::invalidateStackingOrder);
+    connect(item, &Item::visibleChanged, this, &WorkspaceScene::invalidateStackingOrder);
+    connect(item, &Item::positionChanged, this, &WorkspaceScene::invalidateOutputStackingOrder);
+    connect(item, &Item::boundingRectChanged, this, &WorkspaceScene::invalidateOutputStackingOrder);
+    invalidateStackingOrder();
+}
+
+void WorkspaceScene::invalidateStackingOrder()
+{
+    m_stackingOrderVersion++;
+}
+
+void WorkspaceScene::invalidateOutputStackingOrder()
+{
+    m_geometryVersion++;
+}
+
+void WorkspaceScene::updateStackingOrder()
+{
+    if (m_stackingOrderSnapshotVersion == m_stackingOrderVersion) {
+        return;
+    }
+
+    stacking_order.clear();
+    const QList<Item *> items = m_containerItem->sortedChildItems();
+    for (Item *item : items) {
         WindowItem *windowItem = static_cast<WindowItem *>(item);
         if (windowItem->isVisible()) {
             stacking_order.append(windowItem);
         }
     }
+    m_stackingOrderSnapshotVersion = m_stackingOrderVersion;
 }
 
-void WorkspaceScene::clearStackingOrder()
+const QVector<WindowItem *> &WorkspaceScene::outputStackingOrder(Output *output) const
 {
-    stacking_order.clear();
+    OutputStackingOrder &index = m_outputStackingOrders[output];
+    const QRect geometry = output->geometry();
+    if (index.stackingOrderVersion != m_stackingOrderVersion || index.geometryVersion != m_geometryVersion || index.geometry != geometry) {
+        QVector<WindowItem *> previous;
+        previous.swap(index.items);
+        for (WindowItem *windowItem : std::as_const(stacking_order)) {
+            const QRectF bounds = windowItem->mapToGlobal(windowItem->boundingRect()) | windowItem->window()->frameGeometry();
+            if (bounds.toAlignedRect().intersects(geometry)) {
+                index.items.append(windowItem);
+            } else if (previous.contains(windowItem)) {
+                index.departed.append(windowItem);
+            }
+        }
+        index.geometry = geometry;
+        index.stackingOrderVersion = m_stackingOrderVersion;
+        index.geometryVersion = m_geometryVersion;
+    }
+    return index.items;
+}
+
+const QVector<WindowItem *> &WorkspaceScene::paintedStackingOrder() const
+{
+    // On X11 all outputs are painted in one pass, and effects that transform windows can
+    // bring any window onto the painted output, so every window has to be considered then.
+    if (kwinApp()->operationMode() == Application::OperationModeX11 || (m_paintContext.mask & PAINT_SCREEN_WITH_TRANSFORMED_WINDOWS)) {
+        return stacking_order;
+    }
+    return outputStackingOrder(painted_screen);
 }
 
 void WorkspaceScene::paintWindow(const RenderTarget &renderTarget, const RenderViewport &viewport, WindowItem *item, int mask, const QRegion &region)
@@ -15,10 +15,13 @@
 #include "utils/common.h"
 #include "window.h"
 
+#include <memory_resource>
 #include <optional>
+#include <vector>
 
 #include <QElapsedTimer>
 #include <QMatrix4x4>
+#include <QPointer>
 
 namespace KWin
 {
@@ -54,8 +57,9 @@ public:
 
     Item *containerItem() const;
 
-    QRegion damage() const override;
+    Region damage() const override;
     SurfaceItem *scanoutCandidate() const override;
+    QVector<SurfaceItem *> overlayCandidates() const override;
     void prePaint(SceneDelegate *delegate) override;
     void postPaint() override;
     void paint(const RenderTarget &renderTarget, const QRegion &region) override;
@@ -75,6 +79,12 @@ public:
      */
     virtual bool animationsSupported() const = 0;
 
+    /**
+     * Moves the repaints of the given @a item and its descendants for the @a delegate to
+     * @a repaints. Sub-trees without repaints for the @a delegate are skipped.
+     */
+    static void accumulateRepaints(Item *item, SceneDelegate *delegate, Region *repaints);
+
     virtual std::shared_ptr<GLTexture> textureForOutput(Output *output) const
     {
         return {};
@@ -85,8 +95,15 @@ Q_SIGNALS:
     void frameRendered();
 
 protected:
-    void createStackingOrder();
-    void clearStackingOrder();
+    void updateStackingOrder();
+    void invalidateStackingOrder();
+    void invalidateOutputStackingOrder();
+    // windows that can be seen on the given output, valid only after prePaint()
+    const QVector<WindowItem *> &outputStackingOrder(Output *output) const;
+    // windows that have to be considered when painting painted_screen
+    const QVector<WindowItem *> &paintedStackingOrder() const;
+    // collects the repaints of windows that have left the painted output since the last frame
+    void accumulateDepartedRepaints(Region *repaints);
     friend class EffectsHandlerImpl;
     // called after all effects had their paintScreen() called
     void finalPaintScreen(const RenderTarget &renderTarget, const RenderViewport &viewport, int mask, const QRegion &region, EffectScreen *screen);
@@ -108,28 +125,45 @@ protected:
     struct Phase2Data
     {
         WindowItem *item = nullptr;
-        QRegion region;
-        QRegion opaque;
+        Region region;
+        Region opaque;
         int mask = 0;
     };
 
     struct PaintContext
     {
-        QRegion damage;
+        Region damage;
         int mask = 0;
-        QVector<Phase2Data> phase2Data;
+        std::pmr::vector<Phase2Data> phase2Data; // allocated in the frame arena of the renderer
     };
 
     // The screen that is being currently painted
     Output *painted_screen = nullptr;
     SceneDelegate *painted_delegate = nullptr;
 
-    // windows in their stacking order
+    // windows in their stacking order, retained between frames
     QVector<WindowItem *> stacking_order;
 
 private:
     void createDndIconItem();
     void destroyDndIconItem();
+    void handleWindowItemAdded(Item *item);
+
+    // the windows that intersect an output, in their stacking order
+    struct OutputStackingOrder
+    {
+        QVector<WindowItem *> items;
+        // windows that stopped intersecting the output, they may still have repaints for it
+        QVector<QPointer<WindowItem>> departed;
+        QRect geometry;
+        quint64 stackingOrderVersion = 0;
+        quint64 geometryVersion = 0;
+    };
+
+    quint64 m_stackingOrderVersion = 1;
+    quint64 m_stackingOrderSnapshotVersion = 0;
+    quint64 m_geometryVersion = 1;
+    mutable QHash<Output *, OutputStackingOrder> m_outputStackingOrders;
 
     std::chrono::milliseconds m_expectedPresentTimestamp = std::chrono::milliseconds::zero();
     // how many times finalPaintScreen() has been called
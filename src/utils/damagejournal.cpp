@@ -0,0 +1,139 @@
+/*
+    SPDX-FileCopyrightText: 2022 Vlad Zahorodnii <vlad.zahorodnii@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/damagejournal.h"
+
+#include <algorithm>
+
+namespace KWin
+{
+
+// The maximum number of rectangles in the accumulated damage in the coarse mode.
+static const int s_coarseRectLimit = 32;
+
+void DamageJournal::setCapacity(int capacity)
+{
+    capacity = std::max(capacity, 1);
+    if (m_capacity == capacity) {
+        return;
+    }
+
+    // Keep the most recent damage regions.
+    const int count = std::min(m_count, capacity);
+    std::vector<Region> log(capacity);
+    for (int age = 1; age <= count; ++age) {
+        log[count - age] = entry(age);
+    }
+
+    m_log = std::move(log);
+    m_head = count ? count - 1 : 0;
+    m_count = count;
+    m_capacity = capacity;
+    m_windowSize = 0;
+}
+
+void DamageJournal::setMode(Mode mode)
+{
+    if (m_mode != mode) {
+        m_mode = mode;
+        m_windowSize = 0;
+    }
+}
+
+void DamageJournal::add(const QRegion &region)
+{
+    if (int(m_log.size()) != m_capacity) {
+        m_log.resize(m_capacity);
+    }
+
+    m_head = (m_head + 1) % m_capacity;
+    m_log[m_head] = Region(region);
+    m_count = std::min(m_count + 1, m_capacity);
+
+    if (!m_windowSize) {
+        return;
+    }
+
+    m_back.unite(m_log[m_head]);
+    simplify(&m_back);
+
+    // Drop the oldest damage region from the window. If all older regions are gone, the
+    // running unions are built again, which happens once every m_windowSize frames.
+    if (m_frontIndex < m_windowSize) {
+        m_frontIndex++;
+    } else {
+        rebuildWindow();
+    }
+}
+
+void DamageJournal::clear()
+{
+    m_head = 0;
+    m_count = 0;
+    m_windowSize = 0;
+}
+
+QRegion DamageJournal::accumulate(int bufferAge, const QRegion &fallback) const
+{
+    if (bufferAge <= 0 || bufferAge > m_count) {
+        return fallback;
+    }
+
+    const int windowSize = bufferAge - 1;
+    if (!windowSize) {
+        return QRegion();
+    }
+
+    if (m_windowSize != windowSize) {
+        m_windowSize = windowSize;
+        rebuildWindow();
+    }
+
+    if (m_frontIndex == m_windowSize) {
+        return m_back.toQRegion();
+    }
+
+    Region region = m_front[m_frontIndex].united(m_back);
+    simplify(&region);
+    return region.toQRegion();
+}
+
+QRegion DamageJournal::lastDamage() const
+{
+    if (!m_count) {
+        return QRegion();
+    }
+    return entry(1).toQRegion();
+}
+
+const Region &DamageJournal::entry(int age) const
+{
+    return m_log[(m_head - age + 1 + m_capacity) % m_capacity];
+}
+
+void DamageJournal::rebuildWindow() const
+{
+    m_front.resize(m_windowSize);
+
+    Region region;
+    for (int age = 1; age <= m_windowSize; ++age) {
+        region.unite(entry(age));
+        simplify(&region);
+        m_front[m_windowSize - age] = region;
+    }
+
+    m_frontIndex = 0;
+    m_back.clear();
+}
+
+void DamageJournal::simplify(Region *region) const
+{
+    if (m_mode == Mode::Coarse && region->rectCount() > s_coarseRectLimit) {
+        *region = Region(region->boundingRect());
+    }
+}
+
+} // namespace KWin
@@ -7,19 +7,39 @@
 #pragma once
 
 #include "kwin_export.h"
+#include "utils/region.h"
 
-#include <QList>
 #include <QRegion>
 
+#include <vector>
+
 namespace KWin
 {
 
 /**
  * The DamageJournal class is a helper that tracks last N damage regions.
+ *
+ * The damage regions are stored in a fixed size ring buffer. The journal also keeps the
+ * union of the most recent damage regions for the last requested buffer age up to date as
+ * new damage is added, so if the buffer age doesn't change between frames, which is the
+ * common case, the accumulated damage is available without uniting all regions again.
  */
 class KWIN_EXPORT DamageJournal
 {
 public:
+    enum class Mode {
+        /**
+         * The accumulated damage is exact.
+         */
+        Exact,
+        /**
+         * The accumulated damage is replaced by its bounding rectangle if it consists of
+         * too many rectangles. It's cheaper to repaint a bit more than to process lots of
+         * tiny rectangles.
+         */
+        Coarse,
+    };
+
     /**
      * Returns the maximum number of damage regions that can be stored in the journal.
      */
@@ -32,30 +52,29 @@ public:
      * Sets the maximum number of damage regions that can be stored in the journal
      * to @a capacity.
      */
-    void setCapacity(int capacity)
+    void setCapacity(int capacity);
+
+    Mode mode() const
     {
-        m_capacity = capacity;
+        return m_mode;
     }
 
+    /**
+     * Sets the mode in which the damage is accumulated to @a mode. The default mode
+     * is Mode::Exact.
+     */
+    void setMode(Mode mode);
+
     /**
      * Adds the specified @a region to the journal.
      */
-    void add(const QRegion &region)
-    {
-        while (m_log.size() >= m_capacity) {
-            m_log.takeLast();
-        }
-        m_log.prepend(region);
-    }
+    void add(const QRegion &region);
 
     /**
      * Clears the damage journal. Typically, one would want to clear the damage journal
      * if a buffer swap fails for some reason.
      */
-    void clear()
-    {
-        m_log.clear();
-    }
+    void clear();
 
     /**
      * Accumulates the damage regions in the log up to the specified @a bufferAge.
@@ -63,27 +82,28 @@ public:
      * If the specified buffer age value refers to a damage region older than the last
      * one in the journal, @a fallback will be returned.
      */
-    QRegion accumulate(int bufferAge, const QRegion &fallback = QRegion()) const
-    {
-        QRegion region;
-        if (bufferAge > 0 && bufferAge <= m_log.size()) {
-            for (int i = 0; i < bufferAge - 1; ++i) {
-                region |= m_log[i];
-            }
-        } else {
-            region = fallback;
-        }
-        return region;
-    }
+    QRegion accumulate(int bufferAge, const QRegion &fallback = QRegion()) const;
 
-    QRegion lastDamage() const
-    {
-        return m_log.first();
-    }
+    QRegion lastDamage() const;
 
 private:
-    QList<QRegion> m_log;
+    const Region &entry(int age) const;
+    void rebuildWindow() const;
+    void simplify(Region *region) const;
+
+    std::vector<Region> m_log;
+    int m_head = 0;
+    int m_count = 0;
     int m_capacity = 10;
+    Mode m_mode = Mode::Exact;
+
+    // The union of the m_windowSize most recent damage regions, maintained as a queue made of
+    // two parts. m_front contains the running unions of the older regions in the window, from
+    // the newest one, m_back is the union of the regions added after m_front has been built.
+    mutable int m_windowSize = 0;
+    mutable std::vector<Region> m_front;
+    mutable int m_frontIndex = 0;
+    mutable Region m_back;
 };
 
 } // namespace KWin
@@ -0,0 +1,432 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#include "utils/region.h"
+
+#include <algorithm>
+#include <bit>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace KWin
+{
+
+// The SIMD code loads rectangles directly, QRect stores x1, y1, x2 and y2 in this order.
+static_assert(sizeof(QRect) == 4 * sizeof(int));
+
+static bool rectsIntersect(const QRect &a, const QRect &b)
+{
+    return a.left() <= b.right() && b.left() <= a.right() && a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+/**
+ * Returns a bit mask of the rectangles among rects[0], ..., rects[3] that intersect @a rect.
+ */
+static int intersectionMask4(const QRect *rects, const QRect &rect)
+{
+#if defined(__SSE2__)
+    __m128 x1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rects + 0)));
+    __m128 y1 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rects + 1)));
+    __m128 x2 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rects + 2)));
+    __m128 y2 = _mm_castsi128_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(rects + 3)));
+    _MM_TRANSPOSE4_PS(x1, y1, x2, y2);
+
+    const __m128i disjoint = _mm_or_si128(_mm_or_si128(_mm_cmpgt_epi32(_mm_castps_si128(x1), _mm_set1_epi32(rect.right())),
+                                                       _mm_cmpgt_epi32(_mm_set1_epi32(rect.left()), _mm_castps_si128(x2))),
+                                          _mm_or_si128(_mm_cmpgt_epi32(_mm_castps_si128(y1), _mm_set1_epi32(rect.bottom())),
+                                                       _mm_cmpgt_epi32(_mm_set1_epi32(rect.top()), _mm_castps_si128(y2))));
+    return ~_mm_movemask_ps(_mm_castsi128_ps(disjoint)) & 0xf;
+#elif defined(__ARM_NEON)
+    const int32x4x4_t coordinates = vld4q_s32(reinterpret_cast<const int32_t *>(rects));
+    const uint32x4_t disjoint = vorrq_u32(vorrq_u32(vcgtq_s32(coordinates.val[0], vdupq_n_s32(rect.right())),
+                                                    vcgtq_s32(vdupq_n_s32(rect.left()), coordinates.val[2])),
+                                          vorrq_u32(vcgtq_s32(coordinates.val[1], vdupq_n_s32(rect.bottom())),
+                                                    vcgtq_s32(vdupq_n_s32(rect.top()), coordinates.val[3])));
+    return (vgetq_lane_u32(disjoint, 0) ? 0 : 1)
+        | (vgetq_lane_u32(disjoint, 1) ? 0 : 2)
+        | (vgetq_lane_u32(disjoint, 2) ? 0 : 4)
+        | (vgetq_lane_u32(disjoint, 3) ? 0 : 8);
+#else
+    int mask = 0;
+    for (int i = 0; i < 4; ++i) {
+        if (rectsIntersect(rects[i], rect)) {
+            mask |= 1 << i;
+        }
+    }
+    return mask;
+#endif
+}
+
+using IndexList = QVarLengthArray<int, 16>;
+
+/**
+ * Returns the indices of the rectangles in @a rects that intersect @a rect, in ascending order.
+ */
+static IndexList findIntersecting(const QVarLengthArray<QRect, 8> &rects, const QRect &rect)
+{
+    IndexList indices;
+
+    const int count = rects.size();
+    int i = 0;
+    for (; i + 4 <= count; i += 4) {
+        int mask = intersectionMask4(rects.constData() + i, rect);
+        while (mask) {
+            const int bit = std::countr_zero(unsigned(mask));
+            indices.append(i + bit);
+            mask &= mask - 1;
+        }
+    }
+    for (; i < count; ++i) {
+        if (rectsIntersect(rects[i], rect)) {
+            indices.append(i);
+        }
+    }
+
+    return indices;
+}
+
+/**
+ * Appends the parts of @a rect that are not covered by @a hole to @a pieces. The rectangles
+ * must intersect.
+ */
+template<typename Container>
+static void appendDifference(const QRect &rect, const QRect &hole, Container *pieces)
+{
+    if (rect.top() < hole.top()) {
+        pieces->append(QRect(QPoint(rect.left(), rect.top()), QPoint(rect.right(), hole.top() - 1)));
+    }
+    const int top = std::max(rect.top(), hole.top());
+    const int bottom = std::min(rect.bottom(), hole.bottom());
+    if (rect.left() < hole.left()) {
+        pieces->append(QRect(QPoint(rect.left(), top), QPoint(hole.left() - 1, bottom)));
+    }
+    if (rect.right() > hole.right()) {
+        pieces->append(QRect(QPoint(hole.right() + 1, top), QPoint(rect.right(), bottom)));
+    }
+    if (rect.bottom() > hole.bottom()) {
+        pieces->append(QRect(QPoint(rect.left(), hole.bottom() + 1), QPoint(rect.right(), rect.bottom())));
+    }
+}
+
+Region::Region(const QRect &rect)
+{
+    if (!rect.isEmpty()) {
+        m_rects.append(rect);
+        m_boundingRect = rect;
+    }
+}
+
+Region::Region(const QRegion &region)
+{
+    m_rects.append(region.begin(), region.rectCount());
+    m_boundingRect = region.boundingRect();
+}
+
+bool Region::isEmpty() const
+{
+    return m_rects.isEmpty();
+}
+
+QRect Region::boundingRect() const
+{
+    return m_boundingRect;
+}
+
+int Region::rectCount() const
+{
+    return m_rects.size();
+}
+
+const QRect *Region::begin() const
+{
+    return m_rects.constData();
+}
+
+const QRect *Region::end() const
+{
+    return m_rects.constData() + m_rects.size();
+}
+
+bool Region::intersects(const QRect &rect) const
+{
+    if (rect.isEmpty() || !m_boundingRect.intersects(rect)) {
+        return false;
+    }
+    return !findIntersecting(m_rects, rect).isEmpty();
+}
+
+bool Region::contains(const QRect &rect) const
+{
+    if (rect.isEmpty() || !m_boundingRect.contains(rect)) {
+        return false;
+    }
+    Region uncovered(rect);
+    uncovered.subtract(*this);
+    return uncovered.isEmpty();
+}
+
+void Region::clear()
+{
+    m_rects.clear();
+    m_boundingRect = QRect();
+}
+
+void Region::unite(const QRect &rect)
+{
+    if (rect.isEmpty()) {
+        return;
+    }
+    if (m_rects.isEmpty() || rect.contains(m_boundingRect)) {
+        m_rects.clear();
+        m_rects.append(rect);
+        m_boundingRect = rect;
+        return;
+    }
+    if (!m_boundingRect.intersects(rect)) {
+        m_rects.append(rect);
+        m_boundingRect |= rect;
+        coalesce();
+        return;
+    }
+
+    const IndexList indices = findIntersecting(m_rects, rect);
+
+    // The rectangles that are inside the new one are replaced by it, the new rectangle is cut
+    // along all other rectangles that it overlaps.
+    QVarLengthArray<QRect, 16> pieces{rect};
+    for (int i = indices.size() - 1; i >= 0; --i) {
+        const QRect &existing = m_rects[indices[i]];
+        if (existing.contains(rect)) {
+            return;
+        }
+        if (rect.contains(existing)) {
+            m_rects[indices[i]] = m_rects.back();
+            m_rects.removeLast();
+            continue;
+        }
+
+        QVarLengthArray<QRect, 16> remaining;
+        for (const QRect &piece : std::as_const(pieces)) {
+            if (rectsIntersect(piece, existing)) {
+                appendDifference(piece, existing, &remaining);
+            } else {
+                remaining.append(piece);
+            }
+        }
+        pieces = remaining;
+    }
+
+    m_rects.append(pieces.constData(), pieces.size());
+    m_boundingRect |= rect;
+    coalesce();
+}
+
+void Region::unite(const Region &region)
+{
+    if (region.isEmpty()) {
+        return;
+    }
+    if (isEmpty()) {
+        *this = region;
+        return;
+    }
+    for (const QRect &rect : region) {
+        unite(rect);
+    }
+}
+
+void Region::subtract(const QRect &rect)
+{
+    if (rect.isEmpty() || !m_boundingRect.intersects(rect)) {
+        return;
+    }
+    if (rect.contains(m_boundingRect)) {
+        clear();
+        return;
+    }
+
+    const IndexList indices = findIntersecting(m_rects, rect);
+    if (indices.isEmpty()) {
+        return;
+    }
+
+    QVarLengthArray<QRect, 16> pieces;
+    for (int i = indices.size() - 1; i >= 0; --i) {
+        appendDifference(m_rects[indices[i]], rect, &pieces);
+        m_rects[indices[i]] = m_rects.back();
+        m_rects.removeLast();
+    }
+
+    m_rects.append(pieces.constData(), pieces.size());
+    updateBoundingRect();
+    coalesce();
+}
+
+void Region::subtract(const Region &region)
+{
+    if (region.isEmpty() || !m_boundingRect.intersects(region.boundingRect())) {
+        return;
+    }
+    for (const QRect &rect : region) {
+        subtract(rect);
+        if (isEmpty()) {
+            break;
+        }
+    }
+}
+
+void Region::intersect(const QRect &rect)
+{
+    if (rect.contains(m_boundingRect)) {
+        return;
+    }
+    if (rect.isEmpty() || !m_boundingRect.intersects(rect)) {
+        clear();
+        return;
+    }
+
+    int count = 0;
+    for (const QRect &existing : std::as_const(m_rects)) {
+        const QRect intersected = existing & rect;
+        if (!intersected.isEmpty()) {
+            m_rects[count++] = intersected;
+        }
+    }
+    m_rects.resize(count);
+    updateBoundingRect();
+}
+
+void Region::translate(const QPoint &offset)
+{
+    for (QRect &rect : m_rects) {
+        rect.translate(offset);
+    }
+    m_boundingRect.translate(offset);
+}
+
+Region Region::united(const Region &region) const
+{
+    Region result = *this;
+    result.unite(region);
+    return result;
+}
+
+Region Region::subtracted(const Region &region) const
+{
+    Region result = *this;
+    result.subtract(region);
+    return result;
+}
+
+Region Region::intersected(const QRect &rect) const
+{
+    Region result = *this;
+    result.intersect(rect);
+    return result;
+}
+
+Region &Region::operator|=(const Region &region)
+{
+    unite(region);
+    return *this;
+}
+
+Region &Region::operator-=(const Region &region)
+{
+    subtract(region);
+    return *this;
+}
+
+Region &Region::operator&=(const QRect &rect)
+{
+    intersect(rect);
+    return *this;
+}
+
+QRegion Region::toQRegion() const
+{
+    if (m_rects.isEmpty()) {
+        return QRegion();
+    } else if (m_rects.size() == 1) {
+        return QRegion(m_rects.constFirst());
+    }
+
+    // QRegion can append rectangles that come after all others in the y-x order cheaply.
+    QVarLengthArray<QRect, 8> rects = m_rects;
+    std::sort(rects.begin(), rects.end(), [](const QRect &a, const QRect &b) {
+        return a.top() < b.top() || (a.top() == b.top() && a.left() < b.left());
+    });
+
+    QRegion region;
+    for (const QRect &rect : std::as_const(rects)) {
+        region += rect;
+    }
+    return region;
+}
+
+void Region::updateBoundingRect()
+{
+    if (m_rects.isEmpty()) {
+        m_boundingRect = QRect();
+        return;
+    }
+
+    int left = m_rects[0].left();
+    int top = m_rects[0].top();
+    int right = m_rects[0].right();
+    int bottom = m_rects[0].bottom();
+    for (int i = 1; i < m_rects.size(); ++i) {
+        const QRect &rect = m_rects[i];
+        left = std::min(left, rect.left());
+        top = std::min(top, rect.top());
+        right = std::max(right, rect.right());
+        bottom = std::max(bottom, rect.bottom());
+    }
+    m_boundingRect = QRect(QPoint(left, top), QPoint(right, bottom));
+}
+
+void Region::coalesce()
+{
+    if (m_rects.size() < m_coalesceThreshold) {
+        return;
+    }
+
+    // Merge the rectangles that share an edge, so cutting rectangles doesn't fragment the
+    // region more and more.
+    bool merged = true;
+    while (merged) {
+        merged = false;
+        for (int i = 0; i < m_rects.size(); ++i) {
+            for (int j = i + 1; j < m_rects.size(); ++j) {
+                QRect &a = m_rects[i];
+                const QRect &b = m_rects[j];
+                const bool sameColumn = a.left() == b.left() && a.right() == b.right()
+                    && (a.bottom() + 1 == b.top() || b.bottom() + 1 == a.top());
+                const bool sameRow = a.top() == b.top() && a.bottom() == b.bottom()
+                    && (a.right() + 1 == b.left() || b.right() + 1 == a.left());
+                if (sameColumn || sameRow) {
+                    a |= b;
+                    m_rects[j] = m_rects.back();
+                    m_rects.removeLast();
+                    merged = true;
+                    --j;
+                }
+            }
+        }
+    }
+
+    m_coalesceThreshold = std::max<int>(16, m_rects.size() * 2);
+}
+
+} // namespace KWin
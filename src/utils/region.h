@@ -0,0 +1,77 @@
+/*
+    KWin - the KDE window manager
+    This file is part of the KDE project.
+
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: GPL-2.0-or-later
+*/
+
+#pragma once
+
+#include "kwin_export.h"
+
+#include <QRect>
+#include <QRegion>
+#include <QVarLengthArray>
+
+namespace KWin
+{
+
+/**
+ * The Region class is a set of pixels, like QRegion, optimized for accumulating damage.
+ *
+ * The region is stored as a list of non-overlapping rectangles, unlike QRegion the rectangles
+ * are not split into bands. Uniting a rectangle only adds the parts of it that are not in the
+ * region yet, which is cheap if the region consists of a few rectangles, the common case for
+ * damage. Small regions are stored inline, without allocating memory. Operations check the
+ * bounding rectangles first, and the rectangles that overlap a given rectangle are found
+ * using SSE2 or NEON, if available.
+ *
+ * Region is meant to be used internally, convert it to QRegion at API boundaries.
+ */
+class KWIN_EXPORT Region
+{
+public:
+    Region() = default;
+    Region(const QRect &rect);
+    explicit Region(const QRegion &region);
+
+    bool isEmpty() const;
+    QRect boundingRect() const;
+    int rectCount() const;
+
+    const QRect *begin() const;
+    const QRect *end() const;
+
+    bool intersects(const QRect &rect) const;
+    bool contains(const QRect &rect) const;
+
+    void clear();
+    void unite(const QRect &rect);
+    void unite(const Region &region);
+    void subtract(const QRect &rect);
+    void subtract(const Region &region);
+    void intersect(const QRect &rect);
+    void translate(const QPoint &offset);
+
+    Region united(const Region &region) const;
+    Region subtracted(const Region &region) const;
+    Region intersected(const QRect &rect) const;
+
+    Region &operator|=(const Region &region);
+    Region &operator-=(const Region &region);
+    Region &operator&=(const QRect &rect);
+
+    QRegion toQRegion() const;
+
+private:
+    void updateBoundingRect();
+    void coalesce();
+
+    QVarLengthArray<QRect, 8> m_rects;
+    QRect m_boundingRect;
+    int m_coalesceThreshold = 16;
+};
+
+} // namespace KWin
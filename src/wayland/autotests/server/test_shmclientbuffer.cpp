@@ -0,0 +1,414 @@
+/*
+    SPDX-FileCopyrightText: 2023 KWin contributors <kwin@kde.org>
+
+    SPDX-License-Identifier: LGPL-2.1-only OR LGPL-3.0-only OR LicenseRef-KDE-Accepted-LGPL
+*/
+
+#include <QThread>
+#include <QtTest>
+
+#include "utils/filedescriptor.h"
+#include "wayland/clientconnection.h"
+#include "wayland/display.h"
+#include "wayland/shmclientbuffer.h"
+
+#include "KWayland/Client/connection_thread.h"
+#include "KWayland/Client/event_queue.h"
+#include "KWayland/Client/registry.h"
+
+#include <wayland-client-protocol.h>
+#include <wayland-server-core.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace KWaylandServer;
+
+class TestShmClientBuffer : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void initTestCase_data();
+    void init();
+    void cleanup();
+
+    void testData();
+    void testSealedPool();
+    void testInvalidBuffer_data();
+    void testInvalidBuffer();
+    void testShrinkPool();
+    void testResizeWhileAccessed();
+    void testTruncatedFile();
+    void testImageOutlivesBuffer();
+
+private:
+    ShmClientBuffer *serverBuffer(wl_buffer *buffer) const;
+    uint32_t protocolError(const wl_interface **interface) const;
+
+    KWaylandServer::Display *m_display = nullptr;
+    KWayland::Client::ConnectionThread *m_connection = nullptr;
+    QThread *m_thread = nullptr;
+    KWayland::Client::EventQueue *m_queue = nullptr;
+    wl_shm *m_shm = nullptr;
+};
+
+static const QString s_socketName = QStringLiteral("kwin-wayland-server-shmclientbuffer-test-0");
+
+static const QSize s_bufferSize(64, 64);
+static const int s_stride = s_bufferSize.width() * 4;
+static const qint64 s_bufferBytes = qint64(s_stride) * s_bufferSize.height();
+
+static KWin::FileDescriptor createMemfd(qint64 size)
+{
+    KWin::FileDescriptor fd(memfd_create("kwin-test-shm", MFD_CLOEXEC | MFD_ALLOW_SEALING));
+    if (!fd.isValid() || ftruncate(fd.get(), size) != 0) {
+        return KWin::FileDescriptor{};
+    }
+    return fd;
+}
+
+static bool fill(const KWin::FileDescriptor &fd, qint64 offset, qint64 size, quint32 color)
+{
+    void *data = mmap(nullptr, offset + size, PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    std::fill_n(static_cast<quint32 *>(data) + offset / 4, size / 4, color);
+    munmap(data, offset + size);
+    return true;
+}
+
+void TestShmClientBuffer::initTestCase_data()
+{
+    QTest::addColumn<bool>("udmabuf");
+
+    QTest::addRow("libwayland") << false;
+    QTest::addRow("KWIN_WAYLAND_SHM_UDMABUF=1") << true;
+}
+
+void TestShmClientBuffer::init()
+{
+    QFETCH_GLOBAL(bool, udmabuf);
+    if (udmabuf) {
+        qputenv("KWIN_WAYLAND_SHM_UDMABUF", "1");
+    } else {
+        qunsetenv("KWIN_WAYLAND_SHM_UDMABUF");
+    }
+
+    m_display = new KWaylandServer::Display(this);
+    m_display->addSocketName(s_socketName);
+    m_display->start();
+    QVERIFY(m_display->isRunning());
+    m_display->createShm();
+
+    m_connection = new KWayland::Client::ConnectionThread;
+    QSignalSpy connectedSpy(m_connection, &KWayland::Client::ConnectionThread::connected);
+    m_connection->setSocketName(s_socketName);
+
+    m_thread = new QThread(this);
+    m_connection->moveToThread(m_thread);
+    m_thread->start();
+
+    m_connection->initConnection();
+    QVERIFY(connectedSpy.wait());
+
+    m_queue = new KWayland::Client::EventQueue(this);
+    m_queue->setup(m_connection);
+
+    KWayland::Client::Registry registry;
+    QSignalSpy interfacesAnnouncedSpy(&registry, &KWayland::Client::Registry::interfacesAnnounced);
+    registry.setEventQueue(m_queue);
+    registry.create(m_connection);
+    QVERIFY(registry.isValid());
+    registry.setup();
+    QVERIFY(interfacesAnnouncedSpy.wait());
+
+    const auto shm = registry.interface(KWayland::Client::Registry::Interface::Shm);
+    m_shm = registry.bindShm(shm.name, shm.version);
+    QVERIFY(m_shm);
+    QCOMPARE(m_display->connections().count(), 1);
+}
+
+void TestShmClientBuffer::cleanup()
+{
+    if (m_shm) {
+        wl_shm_destroy(m_shm);
+        m_shm = nullptr;
+    }
+    delete m_queue;
+    m_queue = nullptr;
+    if (m_connection) {
+        m_connection->deleteLater();
+        m_connection = nullptr;
+    }
+    if (m_thread) {
+        m_thread->quit();
+        m_thread->wait();
+        delete m_thread;
+        m_thread = nullptr;
+    }
+    delete m_display;
+    m_display = nullptr;
+    qunsetenv("KWIN_WAYLAND_SHM_UDMABUF");
+}
+
+ShmClientBuffer *TestShmClientBuffer::serverBuffer(wl_buffer *buffer) const
+{
+    ClientConnection *connection = m_display->connections().constFirst();
+    wl_resource *resource = wl_client_get_object(connection->client(), wl_proxy_get_id(reinterpret_cast<wl_proxy *>(buffer)));
+    if (!resource) {
+        return nullptr;
+    }
+    return qobject_cast<ShmClientBuffer *>(m_display->clientBufferForResource(resource));
+}
+
+uint32_t TestShmClientBuffer::protocolError(const wl_interface **interface) const
+{
+    uint32_t id = 0;
+    return wl_display_get_protocol_error(m_connection->display(), interface, &id);
+}
+
+void TestShmClientBuffer::testData()
+{
+    KWin::FileDescriptor fd = createMemfd(s_bufferBytes);
+    QVERIFY(fd.isValid());
+    QVERIFY(fill(fd, 0, s_bufferBytes, 0xffff0000));
+
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd.get(), s_bufferBytes);
+    wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, s_bufferSize.width(), s_bufferSize.height(), s_stride, WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    m_connection->flush();
+
+    ShmClientBuffer *shmBuffer = nullptr;
+    QTRY_VERIFY((shmBuffer = serverBuffer(buffer)));
+    QCOMPARE(shmBuffer->size(), s_bufferSize);
+    QVERIFY(!shmBuffer->hasAlphaChannel());
+
+    // The pool has been destroyed, but the buffer keeps its memory alive.
+    const QImage image = shmBuffer->data();
+    QCOMPARE(image.size(), s_bufferSize);
+    QCOMPARE(image.format(), QImage::Format_RGB32);
+    QCOMPARE(image.pixel(0, 0), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(63, 63), qRgb(255, 0, 0));
+
+    // A file that can shrink can't be shared with the GPU.
+    QVERIFY(!shmBuffer->dmabufAttributes());
+
+    wl_buffer_destroy(buffer);
+}
+
+void TestShmClientBuffer::testSealedPool()
+{
+    KWin::FileDescriptor fd = createMemfd(s_bufferBytes * 2);
+    QVERIFY(fd.isValid());
+    QVERIFY(fill(fd, s_bufferBytes, s_bufferBytes, 0xff00ff00));
+    QCOMPARE(fcntl(fd.get(), F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_SEAL), 0);
+
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd.get(), s_bufferBytes * 2);
+    wl_buffer *buffer = wl_shm_pool_create_buffer(pool, s_bufferBytes, s_bufferSize.width(), s_bufferSize.height(), s_stride, WL_SHM_FORMAT_ARGB8888);
+    m_connection->flush();
+
+    ShmClientBuffer *shmBuffer = nullptr;
+    QTRY_VERIFY((shmBuffer = serverBuffer(buffer)));
+    QVERIFY(shmBuffer->hasAlphaChannel());
+    QCOMPARE(shmBuffer->data().pixel(0, 0), qRgb(0, 255, 0));
+
+    // The buffer can only be imported by the GPU with the compositor's own wl_shm implementation
+    // and if /dev/udmabuf is available, otherwise its data is copied.
+    QFETCH_GLOBAL(bool, udmabuf);
+    const KWin::DmaBufAttributes *attributes = shmBuffer->dmabufAttributes();
+    if (!udmabuf) {
+        QVERIFY(!attributes);
+    } else if (attributes) {
+        QCOMPARE(attributes->planeCount, 1);
+        QCOMPARE(attributes->width, s_bufferSize.width());
+        QCOMPARE(attributes->height, s_bufferSize.height());
+        QCOMPARE(attributes->offset[0], int(s_bufferBytes));
+        QCOMPARE(attributes->pitch[0], s_stride);
+    }
+
+    wl_buffer_destroy(buffer);
+    wl_shm_pool_destroy(pool);
+}
+
+void TestShmClientBuffer::testInvalidBuffer_data()
+{
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("height");
+    QTest::addColumn<int>("stride");
+    QTest::addColumn<uint32_t>("format");
+    QTest::addColumn<uint32_t>("error");
+
+    QTest::addRow("negative offset") << -4 << 16 << 16 << 64 << uint32_t(WL_SHM_FORMAT_XRGB8888) << uint32_t(WL_SHM_ERROR_INVALID_STRIDE);
+    QTest::addRow("offset past the end") << int(s_bufferBytes) - 1020 << 16 << 16 << 64 << uint32_t(WL_SHM_FORMAT_XRGB8888) << uint32_t(WL_SHM_ERROR_INVALID_STRIDE);
+    QTest::addRow("zero width") << 0 << 0 << 16 << 64 << uint32_t(WL_SHM_FORMAT_XRGB8888) << uint32_t(WL_SHM_ERROR_INVALID_STRIDE);
+    QTest::addRow("zero height") << 0 << 16 << 0 << 64 << uint32_t(WL_SHM_FORMAT_XRGB8888) << uint32_t(WL_SHM_ERROR_INVALID_STRIDE);
+    QTest::addRow("stride smaller than width") << 0 << 16 << 16 << 8 << uint32_t(WL_SHM_FORMAT_XRGB8888) << uint32_t(WL_SHM_ERROR_INVALID_STRIDE);
+    QTest::addRow("stride smaller than a row") << 0 << 16 << 16 << 32 << uint32_t(WL_SHM_FORMAT_XRGB8888) << uint32_t(WL_SHM_ERROR_INVALID_STRIDE);
+    QTest::addRow("stride smaller than a 64 bit row") << 0 << 16 << 16 << 64 << uint32_t(WL_SHM_FORMAT_ABGR16161616) << uint32_t(WL_SHM_ERROR_INVALID_STRIDE);
+    QTest::addRow("height overflow") << 0 << 16 << INT32_MAX / 64 + 1 << 64 << uint32_t(WL_SHM_FORMAT_XRGB8888) << uint32_t(WL_SHM_ERROR_INVALID_STRIDE);
+    QTest::addRow("unsupported format") << 0 << 16 << 16 << 64 << uint32_t(WL_SHM_FORMAT_C8) << uint32_t(WL_SHM_ERROR_INVALID_FORMAT);
+}
+
+void TestShmClientBuffer::testInvalidBuffer()
+{
+    QFETCH(int, offset);
+    QFETCH(int, width);
+    QFETCH(int, height);
+    QFETCH(int, stride);
+    QFETCH(uint32_t, format);
+    QFETCH(uint32_t, error);
+
+    QFETCH_GLOBAL(bool, udmabuf);
+    const int bytesPerPixel = format == WL_SHM_FORMAT_ABGR16161616 ? 8 : 4;
+    if (!udmabuf && stride >= width && stride < width * bytesPerPixel) {
+        QSKIP("libwayland only checks the stride against the width in pixels");
+    }
+
+    KWin::FileDescriptor fd = createMemfd(s_bufferBytes);
+    QVERIFY(fd.isValid());
+
+    QSignalSpy errorSpy(m_connection, &KWayland::Client::ConnectionThread::errorOccurred);
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd.get(), s_bufferBytes);
+    wl_buffer *buffer = wl_shm_pool_create_buffer(pool, offset, width, height, stride, format);
+    m_connection->flush();
+    QVERIFY(errorSpy.wait());
+
+    const wl_interface *interface = nullptr;
+    QCOMPARE(protocolError(&interface), error);
+    QCOMPARE(interface, &wl_shm_pool_interface);
+
+    wl_buffer_destroy(buffer);
+    wl_shm_pool_destroy(pool);
+}
+
+void TestShmClientBuffer::testShrinkPool()
+{
+    KWin::FileDescriptor fd = createMemfd(s_bufferBytes);
+    QVERIFY(fd.isValid());
+
+    QSignalSpy errorSpy(m_connection, &KWayland::Client::ConnectionThread::errorOccurred);
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd.get(), s_bufferBytes);
+    wl_shm_pool_resize(pool, s_bufferBytes / 2);
+    m_connection->flush();
+    QVERIFY(errorSpy.wait());
+
+    const wl_interface *interface = nullptr;
+    QCOMPARE(protocolError(&interface), uint32_t(WL_SHM_ERROR_INVALID_FD));
+    QCOMPARE(interface, &wl_shm_pool_interface);
+
+    wl_shm_pool_destroy(pool);
+}
+
+void TestShmClientBuffer::testResizeWhileAccessed()
+{
+    KWin::FileDescriptor fd = createMemfd(s_bufferBytes);
+    QVERIFY(fd.isValid());
+    QVERIFY(fill(fd, 0, s_bufferBytes, 0xffff0000));
+
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd.get(), s_bufferBytes);
+    wl_buffer *buffer1 = wl_shm_pool_create_buffer(pool, 0, s_bufferSize.width(), s_bufferSize.height(), s_stride, WL_SHM_FORMAT_XRGB8888);
+    m_connection->flush();
+
+    ShmClientBuffer *shmBuffer1 = nullptr;
+    QTRY_VERIFY((shmBuffer1 = serverBuffer(buffer1)));
+    QImage image = shmBuffer1->data();
+    QCOMPARE(image.pixel(0, 0), qRgb(255, 0, 0));
+
+    // Grow the pool while its memory is being accessed, the new buffer proves that the resize
+    // request has been processed.
+    QCOMPARE(ftruncate(fd.get(), s_bufferBytes * 2), 0);
+    QVERIFY(fill(fd, s_bufferBytes, s_bufferBytes, 0xff0000ff));
+    wl_shm_pool_resize(pool, s_bufferBytes * 2);
+    wl_buffer *buffer2 = wl_shm_pool_create_buffer(pool, s_bufferBytes, s_bufferSize.width(), s_bufferSize.height(), s_stride, WL_SHM_FORMAT_XRGB8888);
+    m_connection->flush();
+
+    ShmClientBuffer *shmBuffer2 = nullptr;
+    QTRY_VERIFY((shmBuffer2 = serverBuffer(buffer2)));
+
+    // The memory that is being accessed must stay where it is.
+    QCOMPARE(image.pixel(0, 0), qRgb(255, 0, 0));
+    QCOMPARE(image.pixel(63, 63), qRgb(255, 0, 0));
+
+    // Only one buffer can be accessed at a time.
+    QVERIFY(shmBuffer2->data().isNull());
+
+    image = QImage();
+    QCOMPARE(shmBuffer2->data().pixel(0, 0), qRgb(0, 0, 255));
+    QCOMPARE(shmBuffer2->data().pixel(63, 63), qRgb(0, 0, 255));
+    QCOMPARE(shmBuffer1->data().pixel(63, 63), qRgb(255, 0, 0));
+    QVERIFY(!m_connection->hasError());
+
+    wl_buffer_destroy(buffer2);
+    wl_buffer_destroy(buffer1);
+    wl_shm_pool_destroy(pool);
+}
+
+void TestShmClientBuffer::testTruncatedFile()
+{
+    KWin::FileDescriptor fd = createMemfd(s_bufferBytes);
+    QVERIFY(fd.isValid());
+    QVERIFY(fill(fd, 0, s_bufferBytes, 0xffff0000));
+
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd.get(), s_bufferBytes);
+    wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, s_bufferSize.width(), s_bufferSize.height(), s_stride, WL_SHM_FORMAT_XRGB8888);
+    m_connection->flush();
+
+    ShmClientBuffer *shmBuffer = nullptr;
+    QTRY_VERIFY((shmBuffer = serverBuffer(buffer)));
+
+    // The file isn't sealed, so the client can truncate it behind the compositor's back.
+    QCOMPARE(ftruncate(fd.get(), 0), 0);
+
+    QSignalSpy errorSpy(m_connection, &KWayland::Client::ConnectionThread::errorOccurred);
+    {
+        const QImage image = shmBuffer->data();
+        QVERIFY(!image.isNull());
+        QCOMPARE(image.pixel(0, 0), qRgb(0, 0, 0));
+    }
+    QVERIFY(errorSpy.wait());
+
+    const wl_interface *interface = nullptr;
+    QCOMPARE(protocolError(&interface), uint32_t(WL_SHM_ERROR_INVALID_FD));
+    QCOMPARE(interface, &wl_buffer_interface);
+
+    wl_buffer_destroy(buffer);
+    wl_shm_pool_destroy(pool);
+}
+
+void TestShmClientBuffer::testImageOutlivesBuffer()
+{
+    QFETCH_GLOBAL(bool, udmabuf);
+    if (!udmabuf) {
+        QSKIP("Only the compositor's own wl_shm implementation keeps the pool of a destroyed buffer");
+    }
+
+    KWin::FileDescriptor fd = createMemfd(s_bufferBytes);
+    QVERIFY(fd.isValid());
+    QVERIFY(fill(fd, 0, s_bufferBytes, 0xffff0000));
+
+    wl_shm_pool *pool = wl_shm_create_pool(m_shm, fd.get(), s_bufferBytes);
+    wl_buffer *buffer = wl_shm_pool_create_buffer(pool, 0, s_bufferSize.width(), s_bufferSize.height(), s_stride, WL_SHM_FORMAT_XRGB8888);
+    wl_shm_pool_destroy(pool);
+    m_connection->flush();
+
+    ShmClientBuffer *shmBuffer = nullptr;
+    QTRY_VERIFY((shmBuffer = serverBuffer(buffer)));
+    QPointer<ShmClientBuffer> guard(shmBuffer);
+    QImage image = shmBuffer->data();
+
+    // Destroying the buffer releases the last reference to the pool on the client side.
+    wl_buffer_destroy(buffer);
+    m_connection->flush();
+    QTRY_VERIFY(!guard);
+
+    QCOMPARE(image.pixel(63, 63), qRgb(255, 0, 0));
+    image = QImage();
+    QVERIFY(!m_connection->hasError());
+}
+
+QTEST_GUILESS_MAIN(TestShmClientBuffer)
+#include "test_shmclientbuffer.moc"
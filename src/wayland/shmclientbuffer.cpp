@@ -7,16 +7,101 @@
 #include "shmclientbuffer.h"
 #include "clientbuffer_p.h"
 #include "display.h"
+#include "display_p.h"
+#include "utils/common.h"
+#include "utils/filedescriptor.h"
 
+#include "qwayland-server-wayland.h"
+
+#include <QPointer>
+
+#include <drm_fourcc.h>
+#include <fcntl.h>
+#include <optional>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
 #include <wayland-server-core.h>
 #include <wayland-server-protocol.h>
 
+#if __has_include(<linux/udmabuf.h>)
+#include <linux/udmabuf.h>
+#define KWIN_HAVE_UDMABUF 1
+#else
+#define KWIN_HAVE_UDMABUF 0
+#endif
+
 namespace KWaylandServer
 {
 static const ShmClientBuffer *s_accessedBuffer = nullptr;
 static int s_accessCounter = 0;
+// Referenced while a buffer created by libwayland-server is accessed, so the pool isn't remapped.
+static wl_shm_pool *s_accessedShmPool = nullptr;
+
+/**
+ * The ShmPool class represents the memory of a wl_shm_pool created by the compositor's own
+ * wl_shm implementation. It is shared by the pool and the buffers created from it, so buffer
+ * data can still be accessed after the client has destroyed the pool.
+ */
+class ShmPool
+{
+public:
+    ShmPool(ShmClientBufferIntegrationPrivate *integration, KWin::FileDescriptor &&fd, uchar *data, qint64 size);
+    ~ShmPool();
+
+    bool resize(qint64 size);
+    bool finishResize();
+    KWin::FileDescriptor udmabuf(qint64 size);
+
+    ShmClientBufferIntegrationPrivate *integration;
+    KWin::FileDescriptor fd;
+    uchar *data;
+    qint64 size;
+    // Lags behind the size while a resize is deferred until the pool is no longer accessed.
+    qint64 mappedSize;
+    bool sigbusImpossible = false;
+    bool sigbusFault = false;
+
+private:
+    void updateSeals();
+
+    KWin::FileDescriptor m_udmabuf;
+    qint64 m_udmabufSize = 0;
+    bool m_udmabufSupported = false;
+};
 
-class ShmClientBufferPrivate : public ClientBufferPrivate
+class ShmPoolResource : public QtWaylandServer::wl_shm_pool
+{
+public:
+    ShmPoolResource(const std::shared_ptr<ShmPool> &pool, wl_client *client, int id, int version);
+
+protected:
+    void shm_pool_destroy_resource(Resource *resource) override;
+    void shm_pool_create_buffer(Resource *resource, uint32_t id, int32_t offset, int32_t width, int32_t height, int32_t stride, uint32_t format) override;
+    void shm_pool_destroy(Resource *resource) override;
+    void shm_pool_resize(Resource *resource, int32_t size) override;
+
+private:
+    std::shared_ptr<ShmPool> m_pool;
+};
+
+class ShmClientBufferIntegrationPrivate : public QtWaylandServer::wl_shm
+{
+public:
+    ShmClientBufferIntegrationPrivate(ShmClientBufferIntegration *q, Display *display, KWin::FileDescriptor &&udmabufDevice);
+
+    ShmClientBufferIntegration *q;
+    KWin::FileDescriptor udmabufDevice;
+
+protected:
+    void shm_bind_resource(Resource *resource) override;
+    void shm_create_pool(Resource *resource, uint32_t id, int32_t fd, int32_t size) override;
+};
+
+class ShmClientBufferPrivate : public ClientBufferPrivate, public QtWaylandServer::wl_buffer
 {
 public:
     ShmClientBufferPrivate(ShmClientBuffer *q);
@@ -30,12 +115,23 @@ public:
     bool hasAlphaChannel = false;
     QImage savedData;
 
+    // Only set if the buffer has been created by ShmClientBufferIntegrationPrivate.
+    std::shared_ptr<ShmPool> pool;
+    qint64 offset = 0;
+    uint32_t stride = 0;
+    uint32_t shmFormat = 0;
+    mutable std::optional<KWin::DmaBufAttributes> dmabufAttributes;
+    mutable bool dmabufFailed = false;
+
     struct DestroyListener
     {
         wl_listener listener;
         ShmClientBufferPrivate *receiver;
     };
     DestroyListener destroyListener;
+
+protected:
+    void buffer_destroy(Resource *resource) override;
 };
 
 ShmClientBufferPrivate::ShmClientBufferPrivate(ShmClientBuffer *q)
@@ -43,6 +139,11 @@ ShmClientBufferPrivate::ShmClientBufferPrivate(ShmClientBuffer *q)
 {
 }
 
+void ShmClientBufferPrivate::buffer_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
 static void cleanupShmPool(void *poolHandle)
 {
     wl_shm_pool_unref(static_cast<wl_shm_pool *>(poolHandle));
@@ -109,6 +210,278 @@ static QImage::Format imageFormatForShmFormat(uint32_t format)
     }
 }
 
+static uint32_t drmFormatForShmFormat(uint32_t format)
+{
+    // The wl_shm formats are the same as the DRM formats, except for these two.
+    switch (format) {
+    case WL_SHM_FORMAT_ARGB8888:
+        return DRM_FORMAT_ARGB8888;
+    case WL_SHM_FORMAT_XRGB8888:
+        return DRM_FORMAT_XRGB8888;
+    default:
+        return format;
+    }
+}
+
+static int bytesPerPixelForShmFormat(uint32_t format)
+{
+    switch (format) {
+    case WL_SHM_FORMAT_ABGR16161616:
+    case WL_SHM_FORMAT_XBGR16161616:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+static QList<uint32_t> supportedShmFormats()
+{
+    return {
+        WL_SHM_FORMAT_ARGB8888,
+        WL_SHM_FORMAT_XRGB8888,
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        WL_SHM_FORMAT_ARGB2101010,
+        WL_SHM_FORMAT_XRGB2101010,
+        WL_SHM_FORMAT_ABGR2101010,
+        WL_SHM_FORMAT_XBGR2101010,
+        WL_SHM_FORMAT_ABGR16161616,
+        WL_SHM_FORMAT_XBGR16161616,
+#endif
+    };
+}
+
+// The pool whose memory is being accessed. It can't be remapped until the access is finished
+// because the mapping may move. If the client truncates the file behind the pool,
+// accessing the memory raises SIGBUS, in which case the pages are replaced by anonymous memory
+// and the client is disconnected once the access is finished, like libwayland-server does.
+static ShmPool *s_accessedPool = nullptr;
+static struct sigaction s_previousSigbusAction;
+static bool s_sigbusHandlerInstalled = false;
+
+static void reraiseSigbus()
+{
+    sigaction(SIGBUS, &s_previousSigbusAction, nullptr);
+    raise(SIGBUS);
+}
+
+static void sigbusHandler(int signal, siginfo_t *info, void *context)
+{
+    ShmPool *pool = s_accessedPool;
+    const uchar *address = static_cast<const uchar *>(info->si_addr);
+    if (!pool || address < pool->data || address >= pool->data + pool->mappedSize) {
+        reraiseSigbus();
+        return;
+    }
+
+    pool->sigbusFault = true;
+    if (mmap(pool->data, pool->mappedSize, PROT_READ, MAP_PRIVATE | MAP_FIXED | MAP_ANONYMOUS, -1, 0) == MAP_FAILED) {
+        reraiseSigbus();
+    }
+}
+
+static void installSigbusHandler()
+{
+    if (s_sigbusHandlerInstalled) {
+        return;
+    }
+
+    struct sigaction action = {};
+    action.sa_sigaction = sigbusHandler;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGBUS, &action, &s_previousSigbusAction);
+    s_sigbusHandlerInstalled = true;
+}
+
+ShmPool::ShmPool(ShmClientBufferIntegrationPrivate *integration, KWin::FileDescriptor &&fd, uchar *data, qint64 size)
+    : integration(integration)
+    , fd(std::move(fd))
+    , data(data)
+    , size(size)
+    , mappedSize(size)
+{
+    updateSeals();
+}
+
+ShmPool::~ShmPool()
+{
+    munmap(data, mappedSize);
+}
+
+void ShmPool::updateSeals()
+{
+    // Only a memfd can be sealed. If it can't shrink, accessing the pool can't raise SIGBUS and
+    // the memory can be wrapped in a udmabuf, which doesn't accept write-sealed files though.
+    const int seals = fcntl(fd.get(), F_GET_SEALS);
+    if (seals == -1 || !(seals & F_SEAL_SHRINK)) {
+        sigbusImpossible = false;
+        m_udmabufSupported = false;
+        return;
+    }
+
+    struct stat statbuf;
+    sigbusImpossible = fstat(fd.get(), &statbuf) == 0 && statbuf.st_size >= size;
+    m_udmabufSupported = sigbusImpossible && !(seals & F_SEAL_WRITE);
+}
+
+bool ShmPool::resize(qint64 newSize)
+{
+    size = newSize;
+    if (s_accessedPool == this) {
+        return true;
+    }
+    return finishResize();
+}
+
+bool ShmPool::finishResize()
+{
+    if (mappedSize == size) {
+        return true;
+    }
+
+    void *newData = mremap(data, mappedSize, size, MREMAP_MAYMOVE);
+    if (newData == MAP_FAILED) {
+        return false;
+    }
+
+    data = static_cast<uchar *>(newData);
+    mappedSize = size;
+    updateSeals();
+    return true;
+}
+
+KWin::FileDescriptor ShmPool::udmabuf(qint64 requiredSize)
+{
+#if KWIN_HAVE_UDMABUF
+    if (!m_udmabufSupported || !integration->udmabufDevice.isValid()) {
+        return KWin::FileDescriptor{};
+    }
+
+    if (m_udmabufSize < requiredSize) {
+        // The range of a udmabuf must be page aligned and within the file, so cover as much of
+        // the file as possible, the pool is likely to be resized later.
+        struct stat statbuf;
+        if (fstat(fd.get(), &statbuf) != 0) {
+            return KWin::FileDescriptor{};
+        }
+        const qint64 pageSize = sysconf(_SC_PAGESIZE);
+        const qint64 udmabufSize = statbuf.st_size / pageSize * pageSize;
+        if (udmabufSize < requiredSize) {
+            return KWin::FileDescriptor{};
+        }
+
+        struct udmabuf_create create = {};
+        create.memfd = fd.get();
+        create.flags = UDMABUF_FLAGS_CLOEXEC;
+        create.offset = 0;
+        create.size = udmabufSize;
+
+        KWin::FileDescriptor udmabuf(ioctl(integration->udmabufDevice.get(), UDMABUF_CREATE, &create));
+        if (!udmabuf.isValid()) {
+            qCDebug(KWIN_CORE) << "Failed to create a udmabuf for a shm pool:" << strerror(errno);
+            m_udmabufSupported = false;
+            return KWin::FileDescriptor{};
+        }
+
+        m_udmabuf = std::move(udmabuf);
+        m_udmabufSize = udmabufSize;
+    }
+
+    return m_udmabuf.duplicate();
+#else
+    return KWin::FileDescriptor{};
+#endif
+}
+
+ShmPoolResource::ShmPoolResource(const std::shared_ptr<ShmPool> &pool, wl_client *client, int id, int version)
+    : QtWaylandServer::wl_shm_pool(client, id, version)
+    , m_pool(pool)
+{
+}
+
+void ShmPoolResource::shm_pool_destroy_resource(Resource *resource)
+{
+    delete this;
+}
+
+void ShmPoolResource::shm_pool_destroy(Resource *resource)
+{
+    wl_resource_destroy(resource->handle);
+}
+
+void ShmPoolResource::shm_pool_create_buffer(Resource *resource, uint32_t id, int32_t offset, int32_t width, int32_t height, int32_t stride, uint32_t format)
+{
+    if (!supportedShmFormats().contains(format)) {
+        wl_resource_post_error(resource->handle, QtWaylandServer::wl_shm::error_invalid_format, "invalid format 0x%x", format);
+        return;
+    }
+
+    // Unlike libwayland, check the stride against the size of a row in bytes. The buffer is read
+    // and exported with the stride as its pitch, so a shorter stride would read past the pool.
+    if (offset < 0 || width <= 0 || height <= 0 || stride < qint64(width) * bytesPerPixelForShmFormat(format) || height > INT32_MAX / stride
+        || offset > m_pool->size - qint64(stride) * height) {
+        wl_resource_post_error(resource->handle, QtWaylandServer::wl_shm::error_invalid_stride, "invalid width, height or stride (%dx%d, %d)", width, height, stride);
+        return;
+    }
+
+    wl_resource *bufferResource = wl_resource_create(resource->client(), &wl_buffer_interface, 1, id);
+    if (!bufferResource) {
+        wl_resource_post_no_memory(resource->handle);
+        return;
+    }
+
+    auto buffer = new ShmClientBuffer(m_pool, offset, width, height, stride, format, bufferResource);
+
+    DisplayPrivate *displayPrivate = DisplayPrivate::get(m_pool->integration->q->display());
+    displayPrivate->registerClientBuffer(buffer);
+}
+
+void ShmPoolResource::shm_pool_resize(Resource *resource, int32_t size)
+{
+    if (size < m_pool->size) {
+        wl_resource_post_error(resource->handle, QtWaylandServer::wl_shm::error_invalid_fd, "shrinking pool invalid");
+        return;
+    }
+
+    if (!m_pool->resize(size)) {
+        wl_resource_post_error(resource->handle, QtWaylandServer::wl_shm::error_invalid_fd, "failed mremap");
+    }
+}
+
+ShmClientBufferIntegrationPrivate::ShmClientBufferIntegrationPrivate(ShmClientBufferIntegration *q, Display *display, KWin::FileDescriptor &&udmabufDevice)
+    : QtWaylandServer::wl_shm(*display, 1)
+    , q(q)
+    , udmabufDevice(std::move(udmabufDevice))
+{
+}
+
+void ShmClientBufferIntegrationPrivate::shm_bind_resource(Resource *resource)
+{
+    const auto formats = supportedShmFormats();
+    for (const uint32_t format : formats) {
+        send_format(resource->handle, format);
+    }
+}
+
+void ShmClientBufferIntegrationPrivate::shm_create_pool(Resource *resource, uint32_t id, int32_t fd, int32_t size)
+{
+    KWin::FileDescriptor fileDescriptor{fd};
+
+    if (size <= 0) {
+        wl_resource_post_error(resource->handle, error_invalid_stride, "invalid size (%d)", size);
+        return;
+    }
+
+    void *data = mmap(nullptr, size, PROT_READ, MAP_SHARED, fileDescriptor.get(), 0);
+    if (data == MAP_FAILED) {
+        wl_resource_post_error(resource->handle, error_invalid_fd, "failed mmap fd %d: %s", fd, strerror(errno));
+        return;
+    }
+
+    auto pool = std::make_shared<ShmPool>(this, std::move(fileDescriptor), static_cast<uchar *>(data), size);
+    new ShmPoolResource(pool, resource->client(), id, resource->version());
+}
+
 ShmClientBuffer::ShmClientBuffer(wl_resource *resource)
     : ClientBuffer(resource, std::make_unique<ShmClientBufferPrivate>(this))
 {
@@ -127,6 +500,23 @@ ShmClientBuffer::ShmClientBuffer(wl_resource *resource)
     wl_resource_add_destroy_listener(resource, &d->destroyListener.listener);
 }
 
+ShmClientBuffer::ShmClientBuffer(const std::shared_ptr<ShmPool> &pool, qint64 offset, int width, int height, int stride, uint32_t format, wl_resource *resource)
+    : ClientBuffer(std::make_unique<ShmClientBufferPrivate>(this))
+{
+    Q_D(ShmClientBuffer);
+    d->pool = pool;
+    d->offset = offset;
+    d->width = width;
+    d->height = height;
+    d->stride = stride;
+    d->shmFormat = format;
+    d->hasAlphaChannel = alphaChannelFromFormat(format);
+    d->format = imageFormatForShmFormat(format);
+
+    d->init(resource);
+    initialize(resource);
+}
+
 QSize ShmClientBuffer::size() const
 {
     Q_D(const ShmClientBuffer);
@@ -148,10 +538,45 @@ static void cleanupShmData(void *bufferHandle)
 {
     Q_ASSERT_X(s_accessCounter > 0, "cleanup", "access counter must be positive");
     s_accessCounter--;
+    wl_shm_buffer_end_access(static_cast<wl_shm_buffer *>(bufferHandle));
     if (s_accessCounter == 0) {
         s_accessedBuffer = nullptr;
+        wl_shm_pool_unref(std::exchange(s_accessedShmPool, nullptr));
+    }
+}
+
+// The image can outlive the buffer, so it keeps the pool alive and only watches the buffer.
+struct ShmPoolAccess
+{
+    std::shared_ptr<ShmPool> pool;
+    QPointer<ShmClientBuffer> buffer;
+};
+
+static void cleanupShmPoolData(void *accessHandle)
+{
+    std::unique_ptr<ShmPoolAccess> access(static_cast<ShmPoolAccess *>(accessHandle));
+    Q_ASSERT_X(s_accessCounter > 0, "cleanup", "access counter must be positive");
+    s_accessCounter--;
+    if (s_accessCounter != 0) {
+        return;
+    }
+    s_accessedBuffer = nullptr;
+    s_accessedPool = nullptr;
+
+    // Apply the resize that has been deferred while the memory was being accessed.
+    ShmPool *pool = access->pool.get();
+    const bool remapped = pool->finishResize();
+
+    if (!access->buffer) {
+        return;
+    }
+    if (wl_resource *resource = access->buffer->resource()) {
+        if (pool->sigbusFault) {
+            wl_resource_post_error(resource, QtWaylandServer::wl_shm::error_invalid_fd, "error accessing SHM buffer");
+        } else if (!remapped) {
+            wl_resource_post_error(resource, QtWaylandServer::wl_shm::error_invalid_fd, "failed mremap");
+        }
     }
-    wl_shm_buffer_end_access(static_cast<wl_shm_buffer *>(bufferHandle));
 }
 
 QImage ShmClientBuffer::data() const
@@ -161,7 +586,26 @@ QImage ShmClientBuffer::data() const
     }
 
     Q_D(const ShmClientBuffer);
+    if (d->pool) {
+        // The buffer may be past the end of the mapping if the pool has been resized while
+        // another buffer was being accessed.
+        if (d->offset + qint64(d->stride) * d->height > d->pool->mappedSize) {
+            return QImage();
+        }
+        if (!d->pool->sigbusImpossible) {
+            installSigbusHandler();
+        }
+        s_accessedPool = d->pool.get();
+        s_accessedBuffer = this;
+        s_accessCounter++;
+        return QImage(d->pool->data + d->offset, d->width, d->height, d->stride, d->format, cleanupShmPoolData,
+                      new ShmPoolAccess{d->pool, const_cast<ShmClientBuffer *>(this)});
+    }
+
     if (wl_shm_buffer *buffer = wl_shm_buffer_get(resource())) {
+        if (!s_accessedShmPool) {
+            s_accessedShmPool = wl_shm_buffer_ref_pool(buffer);
+        }
         s_accessedBuffer = this;
         s_accessCounter++;
         wl_shm_buffer_begin_access(buffer);
@@ -172,9 +616,50 @@ QImage ShmClientBuffer::data() const
     return d->savedData;
 }
 
+const KWin::DmaBufAttributes *ShmClientBuffer::dmabufAttributes() const
+{
+    Q_D(const ShmClientBuffer);
+    if (!d->pool || d->dmabufFailed) {
+        return nullptr;
+    }
+
+    if (!d->dmabufAttributes) {
+        KWin::FileDescriptor udmabuf = d->pool->udmabuf(d->offset + qint64(d->stride) * d->height);
+        if (!udmabuf.isValid()) {
+            d->dmabufFailed = true;
+            return nullptr;
+        }
+
+        KWin::DmaBufAttributes attributes;
+        attributes.planeCount = 1;
+        attributes.width = d->width;
+        attributes.height = d->height;
+        attributes.format = drmFormatForShmFormat(d->shmFormat);
+        attributes.modifier = DRM_FORMAT_MOD_LINEAR;
+        attributes.fd[0] = std::move(udmabuf);
+        attributes.offset[0] = d->offset;
+        attributes.pitch[0] = d->stride;
+        d->dmabufAttributes = std::move(attributes);
+    }
+
+    return &*d->dmabufAttributes;
+}
+
 ShmClientBufferIntegration::ShmClientBufferIntegration(Display *display)
     : ClientBufferIntegration(display)
 {
+    if (qEnvironmentVariableIntValue("KWIN_WAYLAND_SHM_UDMABUF") == 1) {
+        KWin::FileDescriptor udmabufDevice;
+        if (KWIN_HAVE_UDMABUF) {
+            udmabufDevice = KWin::FileDescriptor{open("/dev/udmabuf", O_RDWR | O_CLOEXEC)};
+        }
+        if (!udmabufDevice.isValid()) {
+            qCWarning(KWIN_CORE) << "Zero-copy shm buffers are not supported, /dev/udmabuf is not available";
+        }
+        d = std::make_unique<ShmClientBufferIntegrationPrivate>(this, display, std::move(udmabufDevice));
+        return;
+    }
+
 #if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
     wl_display_add_shm_format(*display, WL_SHM_FORMAT_ARGB2101010);
     wl_display_add_shm_format(*display, WL_SHM_FORMAT_XRGB2101010);
@@ -186,6 +671,10 @@ ShmClientBufferIntegration::ShmClientBufferIntegration(Display *display)
     wl_display_init_shm(*display);
 }
 
+ShmClientBufferIntegration::~ShmClientBufferIntegration()
+{
+}
+
 ClientBuffer *ShmClientBufferIntegration::createBuffer(::wl_resource *resource)
 {
     if (wl_shm_buffer_get(resource)) {
@@ -9,9 +9,14 @@
 #include "clientbuffer.h"
 #include "clientbufferintegration.h"
 
+#include "core/dmabufattributes.h"
+
 namespace KWaylandServer
 {
 class ShmClientBufferPrivate;
+class ShmClientBufferIntegrationPrivate;
+class ShmPool;
+class ShmPoolResource;
 
 /**
  * The ShmClientBuffer class represents a wl_shm_buffer client buffer.
@@ -29,13 +34,32 @@ public:
 
     QImage data() const;
 
+    /**
+     * Returns the attributes of a dmabuf that refers to the memory of this buffer, or @c null
+     * if the buffer can't be shared with the GPU and its data has to be copied instead.
+     *
+     * A dmabuf is only available if zero-copy import is enabled and the client has allocated
+     * the pool with a memfd sealed against shrinking, see ShmClientBufferIntegration.
+     */
+    const KWin::DmaBufAttributes *dmabufAttributes() const;
+
     QSize size() const override;
     bool hasAlphaChannel() const override;
     Origin origin() const override;
+
+private:
+    ShmClientBuffer(const std::shared_ptr<ShmPool> &pool, qint64 offset, int width, int height, int stride, uint32_t format, wl_resource *resource);
+    friend class ShmPoolResource;
 };
 
 /**
  * The ShmClientBufferIntegration class provides support for wl_shm_buffer buffers.
+ *
+ * By default, the wl_shm global is provided by libwayland-server. If the KWIN_WAYLAND_SHM_UDMABUF
+ * environment variable is set to 1, the compositor implements wl_shm on its own instead, which
+ * allows it to keep the file descriptors of the pools. If /dev/udmabuf is available, pools that
+ * are backed by a memfd sealed against shrinking are then wrapped in a udmabuf, so their buffers
+ * can be imported by the GPU without copying them. Otherwise the buffer data is copied as usual.
  */
 class ShmClientBufferIntegration : public ClientBufferIntegration
 {
@@ -43,8 +67,12 @@ class ShmClientBufferIntegration : public ClientBufferIntegration
 
 public:
     explicit ShmClientBufferIntegration(Display *display);
+    ~ShmClientBufferIntegration() override;
 
     ClientBuffer *createBuffer(::wl_resource *resource) override;
+
+private:
+    std::unique_ptr<ShmClientBufferIntegrationPrivate> d;
 };
 
 } // namespace KWaylandServer
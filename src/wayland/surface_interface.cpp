@@ -11,6 +11,7 @@
 #include "contenttype_v1_interface.h"
 #include "display.h"
 #include "fractionalscale_v1_interface_p.h"
+#include "frametimeline.h"
 #include "idleinhibit_v1_interface_p.h"
 #include "linuxdmabufv1clientbuffer.h"
 #include "pointerconstraints_v1_interface_p.h"
@@ -312,6 +313,7 @@ void SurfaceInterfacePrivate::surface_set_input_region(Resource *resource, struc
 
 void SurfaceInterfacePrivate::surface_commit(Resource *resource)
 {
+    KWin::FrameTimeline::instant(KWin::FrameTimelineEvent::ClientCommit, quintptr(q));
     if (subSurface) {
         commitSubSurface();
     } else {